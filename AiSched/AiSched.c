@@ -0,0 +1,162 @@
+#include "AiSched.h"
+#include "main.h"
+
+/**
+ * @file AiSched.c
+ * @brief Implementation of the time-sliced AI scheduler
+ */
+
+static void update_agent(AiSched_cfg_t* cfg, AiSched_Agent_t* agent)
+{
+    uint32_t elapsed = cfg->tick - agent->last_tick;
+    uint32_t start = DWT->CYCCNT;
+
+    agent->update(agent->context, elapsed);
+
+    agent->last_cycles = DWT->CYCCNT - start;
+    agent->last_tick = cfg->tick;
+    if (elapsed > agent->max_staleness) {
+        agent->max_staleness = elapsed;
+    }
+    if (elapsed > cfg->stats.max_staleness) {
+        cfg->stats.max_staleness = elapsed;
+    }
+    cfg->stats.updates++;
+}
+
+// Round-robin over the agents whose 'boosted' flag matches, from *cursor,
+// until the budget is spent. The first agent of the pass always runs, so
+// each pass makes progress even when an earlier one used up the budget.
+// Returns the number of agents updated.
+static uint8_t run_pass(AiSched_cfg_t* cfg, uint8_t boosted, uint8_t* cursor,
+                        uint32_t start, uint32_t budget)
+{
+    uint8_t count = cfg->count;
+    uint8_t index = (*cursor < count) ? *cursor : 0;
+    uint8_t updated = 0;
+
+    for (uint8_t n = 0; n < count; n++, index = (index + 1u == count) ? 0 : index + 1u) {
+        AiSched_Agent_t* agent = &cfg->agents[index];
+
+        if ((agent->boosted ? 1 : 0) != boosted || agent->last_tick == cfg->tick) {
+            continue;
+        }
+
+        // Stop if this agent would not fit, unless this pass has not run one yet
+        uint32_t used = DWT->CYCCNT - start;
+        if (updated && used + agent->last_cycles > budget) {
+            break;
+        }
+
+        update_agent(cfg, agent);
+        updated++;
+    }
+    *cursor = index;
+    return updated;
+}
+
+void AiSched_Init(AiSched_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    cfg->tick = 0;
+    cfg->cursor = 0;
+    cfg->boost_cursor = 0;
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        cfg->agents[i].last_tick = 0;
+        cfg->agents[i].last_cycles = 0;
+        cfg->agents[i].max_staleness = 0;
+    }
+    cfg->stats = (AiSched_Stats_t){0};
+    cfg->setup_done = 1;
+}
+
+int16_t AiSched_Add(AiSched_cfg_t* cfg, AiSched_Update_t update, void* context)
+{
+    if (cfg->count >= cfg->capacity) {
+        return -1;
+    }
+
+    AiSched_Agent_t* agent = &cfg->agents[cfg->count];
+    agent->update = update;
+    agent->context = context;
+    agent->boosted = 0;
+    agent->last_tick = cfg->tick;
+    agent->last_cycles = 0;
+    agent->max_staleness = 0;
+    return cfg->count++;
+}
+
+void AiSched_Remove(AiSched_cfg_t* cfg, uint8_t index)
+{
+    if (index >= cfg->count) {
+        return;
+    }
+    cfg->count--;
+    cfg->agents[index] = cfg->agents[cfg->count];
+}
+
+uint8_t AiSched_Run(AiSched_cfg_t* cfg)
+{
+    uint32_t cycles_per_us = SystemCoreClock / 1000000u;
+    uint32_t budget = cfg->budget_us * cycles_per_us;
+    uint32_t start = DWT->CYCCNT;
+
+    cfg->tick++;
+    cfg->stats.ticks++;
+
+    // Boosted agents first; the non-boosted pass still gets one update when
+    // they used up the budget, so the round-robin keeps moving
+    uint8_t updated = run_pass(cfg, 1, &cfg->boost_cursor, start, budget);
+    updated += run_pass(cfg, 0, &cfg->cursor, start, budget);
+
+    uint32_t used_us = (DWT->CYCCNT - start) / cycles_per_us;
+    if (used_us > cfg->stats.max_used_us) {
+        cfg->stats.max_used_us = used_us;
+    }
+    if (used_us > cfg->budget_us) {
+        cfg->stats.overruns++;
+    }
+    cfg->stats.deferred += cfg->count - updated;
+    return updated;
+}
+
+uint32_t AiSched_Staleness(const AiSched_cfg_t* cfg, uint8_t index)
+{
+    if (index >= cfg->count) {
+        return 0;
+    }
+    // Counted from the next tick, when it could next be updated
+    return cfg->tick + 1u - cfg->agents[index].last_tick;
+}
+
+void AiSched_GetStats(AiSched_cfg_t* cfg, AiSched_Stats_t* stats, uint8_t reset)
+{
+    AiSched_Stats_t current = cfg->stats;
+
+    // An agent that has not been reached at all is staler than any completed wait
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        uint32_t waiting = cfg->tick - cfg->agents[i].last_tick;
+        if (waiting > current.max_staleness) {
+            current.max_staleness = waiting;
+        }
+    }
+    *stats = current;
+
+    if (reset) {
+        cfg->stats.ticks = 0;
+        cfg->stats.updates = 0;
+        cfg->stats.deferred = 0;
+        cfg->stats.overruns = 0;
+        cfg->stats.max_used_us = 0;
+        cfg->stats.max_staleness = 0;
+        for (uint8_t i = 0; i < cfg->count; i++) {
+            cfg->agents[i].max_staleness = 0;
+        }
+    }
+}
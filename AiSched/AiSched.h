@@ -0,0 +1,139 @@
+#ifndef AISCHED_H
+#define AISCHED_H
+
+#include <stdint.h>
+
+/**
+ * @file AiSched.h
+ * @brief Time-sliced AI updates within a per-tick cycle budget
+ *
+ * Updating every enemy FSM every tick makes the frame time grow with the
+ * number of enemies. AiSched_Run() instead updates agents round-robin and
+ * stops when the tick's budget (measured with the DWT cycle counter) is
+ * spent. Agents that were not reached run first on a later tick, and their
+ * update function is told how many ticks have passed so movement and timers
+ * stay correct.
+ *
+ * Agents marked 'boosted' (e.g., near the Character or on screen) are served
+ * before all others, so they stay responsive when the budget is tight. At
+ * least one boosted and one non-boosted agent (when there are any) are
+ * updated every tick, even if that goes over the budget, so with N
+ * non-boosted agents none of them waits more than about N ticks.
+ *
+ * Staleness is the number of ticks since an agent's last update: 1 means it
+ * was updated on the previous tick (fully up to date).
+ *
+ * The budget is given in microseconds and converted at the current
+ * SystemCoreClock on every run, so it stays correct when ClockGov changes
+ * the clock.
+ *
+ * Example usage:
+ * @code
+ * void enemy_update(void* context, uint32_t elapsed_ticks) {
+ *     Enemy_Update((Enemy_t*)context, elapsed_ticks);
+ * }
+ *
+ * AiSched_Agent_t agents[MAX_ENEMIES];
+ * AiSched_cfg_t ai = {
+ *     .agents = agents,
+ *     .count = 0,
+ *     .budget_us = 2000,   // 2ms of each 30ms frame
+ *     .setup_done = 0
+ * };
+ *
+ * AiSched_Init(&ai);
+ * AiSched_Add(&ai, enemy_update, &enemies[0]);
+ *
+ * // Once per game tick:
+ * agents[0].boosted = Enemy_IsOnScreen(&enemies[0]);
+ * AiSched_Run(&ai);
+ * @endcode
+ */
+
+/**
+ * @brief Agent update function
+ *
+ * @param context Pointer given to AiSched_Add()
+ * @param elapsed_ticks Ticks since this agent's last update (1 when up to date)
+ */
+typedef void (*AiSched_Update_t)(void* context, uint32_t elapsed_ticks);
+
+/**
+ * @struct AiSched_Agent_t
+ * @brief One scheduled agent
+ */
+typedef struct {
+    AiSched_Update_t update;        ///< Update function
+    void* context;                  ///< Passed to update (e.g., the enemy)
+    uint8_t boosted;                ///< Set by the game: 1 to serve before non-boosted agents
+    uint32_t last_tick;             ///< Internal: tick of the last update
+    uint32_t last_cycles;           ///< Cycles taken by the last update (cost estimate)
+    uint32_t max_staleness;         ///< Most ticks between two updates
+} AiSched_Agent_t;
+
+/**
+ * @struct AiSched_Stats_t
+ * @brief Budget and staleness instrumentation
+ */
+typedef struct {
+    uint32_t ticks;                 ///< AiSched_Run() calls
+    uint32_t updates;               ///< Agent updates run
+    uint32_t deferred;              ///< Agent updates postponed to a later tick (summed over ticks)
+    uint32_t overruns;              ///< Ticks that went over the budget
+    uint32_t max_used_us;           ///< Longest time spent in one tick
+    uint32_t max_staleness;         ///< Most ticks any agent waited between updates
+} AiSched_Stats_t;
+
+/**
+ * @struct AiSched_cfg_t
+ * @brief AI scheduler configuration and state
+ */
+typedef struct {
+    AiSched_Agent_t* agents;        ///< Agent table
+    uint8_t count;                  ///< Number of agents in use
+    uint8_t capacity;               ///< Size of the agent table
+    uint32_t budget_us;             ///< Time allowed per tick
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+    uint32_t tick;                  ///< Internal: current tick
+    uint8_t cursor;                 ///< Internal: next non-boosted agent in the round-robin
+    uint8_t boost_cursor;           ///< Internal: next boosted agent in the round-robin
+    AiSched_Stats_t stats;          ///< Internal: counters, read with AiSched_GetStats()
+} AiSched_cfg_t;
+
+/**
+ * @brief Initialise the scheduler and start the DWT cycle counter
+ */
+void AiSched_Init(AiSched_cfg_t* cfg);
+
+/**
+ * @brief Add an agent
+ *
+ * @return Agent index, or -1 if the table is full
+ */
+int16_t AiSched_Add(AiSched_cfg_t* cfg, AiSched_Update_t update, void* context);
+
+/**
+ * @brief Remove an agent (the last agent moves into its index)
+ */
+void AiSched_Remove(AiSched_cfg_t* cfg, uint8_t index);
+
+/**
+ * @brief Advance one tick and update as many agents as the budget allows
+ *
+ * @return Number of agents updated
+ */
+uint8_t AiSched_Run(AiSched_cfg_t* cfg);
+
+/**
+ * @brief Ticks since an agent's last update (1 = up to date)
+ */
+uint32_t AiSched_Staleness(const AiSched_cfg_t* cfg, uint8_t index);
+
+/**
+ * @brief Get the instrumentation counters
+ *
+ * @param reset 1 to clear the counters (and per-agent max staleness) after reading
+ */
+void AiSched_GetStats(AiSched_cfg_t* cfg, AiSched_Stats_t* stats, uint8_t reset);
+
+#endif // AISCHED_H
@@ -0,0 +1,224 @@
+#include "BehaviourTree.h"
+#include <stddef.h>
+
+/**
+ * @file BehaviourTree.c
+ * @brief Implementation of the non-recursive behaviour tree interpreter
+ */
+
+typedef struct {
+    uint8_t op;     // SEQUENCE, MEMSEQ, SELECTOR or INVERT
+    uint16_t end;   // offset just past the node's last child
+} BT_Frame_t;
+
+static inline uint16_t read16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Byte length of the node at code[pc], including its children
+static inline uint16_t node_size(const uint8_t* code, uint16_t pc)
+{
+    switch (code[pc]) {
+        case BT_OP_CONDITION:
+        case BT_OP_ACTION:
+            return 2;
+        case BT_OP_WAIT:
+            return 3;
+        default:
+            return 3u + read16(&code[pc + 1]);
+    }
+}
+
+void BT_Init(BT_cfg_t* cfg)
+{
+    cfg->setup_done = 1;
+}
+
+uint8_t BT_Validate(const BT_cfg_t* cfg, const BT_Tree_t* tree)
+{
+    uint16_t ends[BT_MAX_DEPTH];
+    uint8_t children[BT_MAX_DEPTH];
+    uint8_t ops[BT_MAX_DEPTH];
+    uint8_t depth = 0;
+    uint16_t pc = 0;
+
+    if (!tree->code || tree->size == 0) {
+        return 0;
+    }
+
+    while (pc < tree->size) {
+        uint8_t op = tree->code[pc];
+
+        if (depth) {
+            children[depth - 1]++;
+        }
+        else if (pc != 0) {
+            return 0;   // more than one root
+        }
+
+        switch (op) {
+            case BT_OP_SEQUENCE:
+            case BT_OP_MEMSEQ:
+            case BT_OP_SELECTOR:
+            case BT_OP_INVERT: {
+                if (pc + 3u > tree->size) {
+                    return 0;
+                }
+                uint32_t end = pc + 3u + read16(&tree->code[pc + 1]);
+                if (end > tree->size || (depth && end > ends[depth - 1])) {
+                    return 0;
+                }
+                pc += 3;
+                if (end == pc) {
+                    if (op == BT_OP_INVERT) {
+                        return 0;   // INVERT needs a child
+                    }
+                    break;          // empty composite, evaluated as a leaf
+                }
+                if (depth == BT_MAX_DEPTH) {
+                    return 0;
+                }
+                ops[depth] = op;
+                ends[depth] = (uint16_t)end;
+                children[depth] = 0;
+                depth++;
+                continue;           // children follow
+            }
+            case BT_OP_CONDITION:
+                if (pc + 2u > tree->size || tree->code[pc + 1] >= cfg->condition_count ||
+                    cfg->conditions[tree->code[pc + 1]] == NULL) {
+                    return 0;
+                }
+                pc += 2;
+                break;
+            case BT_OP_ACTION:
+                if (pc + 2u > tree->size || tree->code[pc + 1] >= cfg->action_count ||
+                    cfg->actions[tree->code[pc + 1]] == NULL) {
+                    return 0;
+                }
+                pc += 2;
+                break;
+            case BT_OP_WAIT:
+                if (pc + 3u > tree->size) {
+                    return 0;
+                }
+                pc += 3;
+                break;
+            default:
+                return 0;
+        }
+
+        // Close every composite that ends here
+        while (depth && pc == ends[depth - 1]) {
+            if (ops[depth - 1] == BT_OP_INVERT && children[depth - 1] != 1) {
+                return 0;
+            }
+            depth--;
+        }
+    }
+    return (depth == 0 && pc == tree->size) ? 1u : 0u;
+}
+
+void BT_StateInit(BT_State_t* state)
+{
+    state->running = BT_NO_NODE;
+    state->wait = 0;
+}
+
+BT_Status_t BT_Tick(const BT_cfg_t* cfg, const BT_Tree_t* tree, BT_State_t* state, void* agent)
+{
+    const uint8_t* code = tree->code;
+    BT_Frame_t stack[BT_MAX_DEPTH];
+    uint8_t depth = 0;
+    uint16_t pc = 0;
+    uint16_t was_running = state->running;
+    BT_Status_t status;
+
+    state->running = BT_NO_NODE;
+
+    for (;;) {
+        uint16_t node = pc;
+
+        // ===== Evaluate one node =====
+        switch (code[pc]) {
+            case BT_OP_SEQUENCE:
+            case BT_OP_MEMSEQ:
+            case BT_OP_SELECTOR:
+            case BT_OP_INVERT: {
+                uint16_t end = pc + 3u + read16(&code[pc + 1]);
+                uint8_t op = code[pc];
+                pc += 3;
+                if (pc == end) {
+                    // Empty: a sequence of nothing succeeds, a selector of nothing fails
+                    status = (op == BT_OP_SELECTOR) ? BT_FAILURE : BT_SUCCESS;
+                    break;
+                }
+                // A memory sequence resumes at the child that was running last
+                // tick (the children before it have already succeeded); a plain
+                // sequence starts over, so its guards are checked again
+                if (op == BT_OP_MEMSEQ && was_running != BT_NO_NODE &&
+                    was_running > pc && was_running < end) {
+                    uint16_t next;
+                    while ((next = pc + node_size(code, pc)) <= was_running) {
+                        pc = next;
+                    }
+                }
+                stack[depth].op = op;
+                stack[depth].end = end;
+                depth++;
+                continue;   // evaluate the first (or resumed) child
+            }
+            case BT_OP_CONDITION:
+                status = cfg->conditions[code[pc + 1]](agent) ? BT_SUCCESS : BT_FAILURE;
+                pc += 2;
+                break;
+            case BT_OP_ACTION:
+                status = cfg->actions[code[pc + 1]](agent, was_running != node);
+                pc += 2;
+                break;
+            case BT_OP_WAIT:
+                if (was_running != node) {
+                    state->wait = read16(&code[pc + 1]);
+                }
+                if (state->wait) {
+                    state->wait--;
+                    status = BT_RUNNING;
+                }
+                else {
+                    status = BT_SUCCESS;
+                }
+                pc += 3;
+                break;
+            default:
+                return BT_FAILURE;  // not reached for a validated tree
+        }
+
+        // ===== Pass the result up until a composite wants its next child =====
+        if (status == BT_RUNNING) {
+            state->running = node;
+            return BT_RUNNING;
+        }
+
+        while (depth) {
+            BT_Frame_t* parent = &stack[depth - 1];
+
+            if (parent->op == BT_OP_INVERT) {
+                status = (status == BT_SUCCESS) ? BT_FAILURE : BT_SUCCESS;
+            }
+            else {
+                // A sequence stops at the first failure, a selector at the first success
+                BT_Status_t stop = (parent->op == BT_OP_SELECTOR) ? BT_SUCCESS : BT_FAILURE;
+                if (status != stop && pc != parent->end) {
+                    break;  // next child
+                }
+                pc = parent->end;
+            }
+            depth--;
+        }
+
+        if (depth == 0) {
+            return status;
+        }
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef BEHAVIOURTREE_H
+#define BEHAVIOURTREE_H
+
+#include <stdint.h>
+
+/**
+ * @file BehaviourTree.h
+ * @brief Compact bytecode behaviour trees for enemy AI
+ *
+ * An enemy's behaviour is a tree compiled to bytes in flash by
+ * tools/bt_compiler.py (from the readable .bt files in BehaviourTree/trees,
+ * see the compiler for the text format). New behaviours are new .bt files;
+ * only genuinely new conditions and actions need C code.
+ *
+ * Bytecode, in pre-order (a node is followed by its children):
+ *   SEQUENCE len16   run children in order until one fails or is running
+ *   MEMSEQ   len16   SEQUENCE that resumes at its running child
+ *   SELECTOR len16   run children in order until one succeeds or is running
+ *   INVERT   len16   swap SUCCESS/FAILURE of its single child
+ *   CONDITION id     call conditions[id](agent): SUCCESS if true, else FAILURE
+ *   ACTION   id      call actions[id](agent, first): SUCCESS, FAILURE or RUNNING
+ *   WAIT     ticks16 RUNNING for 'ticks' ticks, then SUCCESS
+ * len16 is the byte length of the children; 16-bit values are little-endian.
+ *
+ * BT_Tick() evaluates the tree from the root every tick. SELECTOR and
+ * SEQUENCE check their children from the first every tick (reactive), so a
+ * higher-priority branch takes over at once and a guard condition stops the
+ * action it guards as soon as it fails. A MEMSEQ (memory sequence) resumes at
+ * the child that was RUNNING last tick instead, since the children before it
+ * already succeeded: "attack, then wait" is then not restarted by its own
+ * condition, and does not re-check it either.
+ *
+ * The interpreter is a loop with a small stack on the C stack (no recursion,
+ * no allocation). Execution only moves forward through the bytecode, so a
+ * tick visits each node at most once: the cost is bounded by the tree size.
+ *
+ * Per-agent state is 4 bytes: the leaf that returned RUNNING last tick (so an
+ * action knows whether it is starting or continuing) and the WAIT counter. A
+ * running action that is not reached on the next tick is simply abandoned.
+ *
+ * Example usage:
+ * @code
+ * #include "BehaviourTrees.h"   // generated: BT_chaser, BT_COND_*, BT_ACT_*
+ *
+ * static const BT_Condition_t conds[BT_COND_COUNT] = {
+ *     [BT_COND_PLAYER_NEAR] = enemy_player_near,
+ * };
+ * static const BT_Action_t acts[BT_ACT_COUNT] = {
+ *     [BT_ACT_CHASE] = enemy_chase,
+ * };
+ * BT_cfg_t bt = {conds, BT_COND_COUNT, acts, BT_ACT_COUNT, 0};
+ *
+ * BT_Init(&bt);
+ * if (!BT_Validate(&bt, &BT_chaser)) { error(); }
+ * BT_StateInit(&enemy.bt);
+ *
+ * // Each AI tick:
+ * BT_Tick(&bt, &BT_chaser, &enemy.bt, &enemy);
+ * @endcode
+ */
+
+// Deepest nesting of SEQUENCE/MEMSEQ/SELECTOR/INVERT nodes the interpreter supports
+#define BT_MAX_DEPTH 8
+
+#define BT_NO_NODE 0xFFFF
+
+/**
+ * @brief Opcodes (must match tools/bt_compiler.py)
+ */
+typedef enum {
+    BT_OP_SEQUENCE = 0x01,
+    BT_OP_SELECTOR = 0x02,
+    BT_OP_INVERT = 0x03,
+    BT_OP_MEMSEQ = 0x04,
+    BT_OP_CONDITION = 0x10,
+    BT_OP_ACTION = 0x11,
+    BT_OP_WAIT = 0x12
+} BT_Op_t;
+
+typedef enum {
+    BT_SUCCESS = 0,
+    BT_FAILURE,
+    BT_RUNNING
+} BT_Status_t;
+
+/**
+ * @brief Condition leaf: return 1 for SUCCESS, 0 for FAILURE
+ */
+typedef uint8_t (*BT_Condition_t)(void* agent);
+
+/**
+ * @brief Action leaf
+ *
+ * @param first 1 if the action did not return RUNNING on the previous tick (it is starting)
+ */
+typedef BT_Status_t (*BT_Action_t)(void* agent, uint8_t first);
+
+/**
+ * @struct BT_Tree_t
+ * @brief A compiled tree in flash (generated by tools/bt_compiler.py)
+ */
+typedef struct {
+    const char* name;               ///< Tree name (from the .bt file)
+    const uint8_t* code;            ///< Bytecode
+    uint16_t size;                  ///< Bytecode length
+} BT_Tree_t;
+
+/**
+ * @struct BT_State_t
+ * @brief Per-agent interpreter state
+ */
+typedef struct {
+    uint16_t running;               ///< Offset of the leaf that returned RUNNING, BT_NO_NODE if none
+    uint16_t wait;                  ///< Ticks left in the running WAIT
+} BT_State_t;
+
+/**
+ * @struct BT_cfg_t
+ * @brief Leaf function tables shared by all trees
+ */
+typedef struct {
+    const BT_Condition_t* conditions;   ///< Indexed by condition id (BT_COND_* in the generated header)
+    uint8_t condition_count;            ///< Entries in conditions
+    const BT_Action_t* actions;         ///< Indexed by action id (BT_ACT_*)
+    uint8_t action_count;               ///< Entries in actions
+    uint8_t setup_done;                 ///< Internal flag: 1 if initialised, 0 otherwise
+} BT_cfg_t;
+
+/**
+ * @brief Initialise the interpreter configuration
+ */
+void BT_Init(BT_cfg_t* cfg);
+
+/**
+ * @brief Check a tree before use
+ *
+ * Verifies opcodes, lengths, nesting depth (BT_MAX_DEPTH) and that every leaf
+ * id has a non-NULL function. BT_Tick() does not re-check any of this.
+ *
+ * @return 1 if the tree is valid, 0 otherwise
+ */
+uint8_t BT_Validate(const BT_cfg_t* cfg, const BT_Tree_t* tree);
+
+/**
+ * @brief Reset an agent's state (nothing running)
+ */
+void BT_StateInit(BT_State_t* state);
+
+/**
+ * @brief Evaluate the tree once for one agent
+ *
+ * @param agent Passed to every condition and action
+ * @return Status of the root
+ */
+BT_Status_t BT_Tick(const BT_cfg_t* cfg, const BT_Tree_t* tree, BT_State_t* state, void* agent);
+
+/**
+ * @brief Benchmark the interpreter cost of each node type
+ *
+ * Prints DWT cycles per node over UART. Only compiled with BT_BENCH defined.
+ */
+void BT_Bench(void);
+
+#endif // BEHAVIOURTREE_H
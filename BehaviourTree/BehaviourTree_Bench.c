@@ -0,0 +1,158 @@
+#include "BehaviourTree.h"
+
+/**
+ * @file BehaviourTree_Bench.c
+ * @brief Per-node-type cycle benchmark for the interpreter (define BT_BENCH to enable)
+ *
+ * Each node type is timed by building two trees that differ only in how
+ * many of that node they contain, and dividing the difference in cycles
+ * by the difference in node count. This cancels the fixed cost of entering
+ * and leaving BT_Tick(). Leaf figures include the call to a trivial leaf
+ * function.
+ *
+ * It also checks the sequence semantics the trees rely on: a guard that
+ * fails while the action after it is RUNNING must stop a SEQUENCE at once,
+ * and must not interrupt a MEMSEQ.
+ */
+
+#ifdef BT_BENCH
+
+#include "main.h"
+#include <stdio.h>
+
+#define BENCH_NODES 32
+#define BENCH_RUNS 64
+
+static uint8_t bench_guard;
+
+static uint8_t bench_true(void* agent) { (void)agent; return 1; }
+static uint8_t bench_false(void* agent) { (void)agent; return 0; }
+static uint8_t bench_guarded(void* agent) { (void)agent; return bench_guard; }
+static BT_Status_t bench_act(void* agent, uint8_t first) { (void)agent; (void)first; return BT_SUCCESS; }
+static BT_Status_t bench_busy(void* agent, uint8_t first) { (void)agent; (void)first; return BT_RUNNING; }
+
+static const BT_Condition_t bench_conditions[] = {bench_true, bench_false, bench_guarded};
+static const BT_Action_t bench_actions[] = {bench_act, bench_busy};
+static BT_cfg_t bench_cfg = {bench_conditions, 3, bench_actions, 2, 0};
+
+static uint8_t bench_code[6 * BENCH_NODES + 8];
+
+// A composite containing 'count' copies of a leaf
+static uint16_t make_flat(uint8_t composite, const uint8_t* leaf, uint8_t leaf_size, uint8_t count)
+{
+    uint16_t len = (uint16_t)leaf_size * count;
+    uint16_t pc = 0;
+
+    bench_code[pc++] = composite;
+    bench_code[pc++] = (uint8_t)len;
+    bench_code[pc++] = (uint8_t)(len >> 8);
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t b = 0; b < leaf_size; b++) {
+            bench_code[pc++] = leaf[b];
+        }
+    }
+    return pc;
+}
+
+// 'levels' nested composites around one true condition
+static uint16_t make_nested(uint8_t composite, uint8_t levels)
+{
+    uint16_t pc = 0;
+
+    for (uint8_t i = 0; i < levels; i++) {
+        uint16_t len = (uint16_t)(levels - 1u - i) * 3u + 2u;
+        bench_code[pc++] = composite;
+        bench_code[pc++] = (uint8_t)len;
+        bench_code[pc++] = (uint8_t)(len >> 8);
+    }
+    bench_code[pc++] = BT_OP_CONDITION;
+    bench_code[pc++] = 0;
+    return pc;
+}
+
+static uint32_t time_tree(uint16_t size)
+{
+    BT_Tree_t tree = {"bench", bench_code, size};
+    BT_State_t state;
+    uint32_t best = 0xFFFFFFFFu;
+
+    if (!BT_Validate(&bench_cfg, &tree)) {
+        printf("BT bench: invalid tree\n");
+        return 0;
+    }
+
+    // Best of several runs (the first may include flash wait states / cache misses)
+    for (uint8_t run = 0; run < BENCH_RUNS; run++) {
+        BT_StateInit(&state);
+        uint32_t start = DWT->CYCCNT;
+        BT_Tick(&bench_cfg, &tree, &state, NULL);
+        uint32_t cycles = DWT->CYCCNT - start;
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+    return best;
+}
+
+static void report_flat(const char* name, uint8_t composite, const uint8_t* leaf, uint8_t leaf_size)
+{
+    uint32_t one = time_tree(make_flat(composite, leaf, leaf_size, 1));
+    uint32_t many = time_tree(make_flat(composite, leaf, leaf_size, BENCH_NODES));
+    printf("BT %-22s %4lu cycles/node\n", name, (unsigned long)((many - one) / (BENCH_NODES - 1)));
+}
+
+static void report_nested(const char* name, uint8_t composite)
+{
+    uint32_t one = time_tree(make_nested(composite, 1));
+    uint32_t many = time_tree(make_nested(composite, BT_MAX_DEPTH));
+    printf("BT %-22s %4lu cycles/node\n", name, (unsigned long)((many - one) / (BT_MAX_DEPTH - 1)));
+}
+
+// sequence(condition guarded, action busy): tick with the guard true, then false
+static uint8_t check_guard(uint8_t op, BT_Status_t expect)
+{
+    const uint8_t code[] = {op, 4, 0, BT_OP_CONDITION, 2, BT_OP_ACTION, 1};
+    BT_Tree_t tree = {"guard", code, sizeof(code)};
+    BT_State_t state;
+
+    if (!BT_Validate(&bench_cfg, &tree)) {
+        return 0;
+    }
+    BT_StateInit(&state);
+    bench_guard = 1;
+    if (BT_Tick(&bench_cfg, &tree, &state, NULL) != BT_RUNNING) {
+        return 0;
+    }
+    bench_guard = 0;
+    return BT_Tick(&bench_cfg, &tree, &state, NULL) == expect;
+}
+
+void BT_Bench(void)
+{
+    static const uint8_t cond_true[] = {BT_OP_CONDITION, 0};
+    static const uint8_t cond_false[] = {BT_OP_CONDITION, 1};
+    static const uint8_t action[] = {BT_OP_ACTION, 0};
+    static const uint8_t wait0[] = {BT_OP_WAIT, 0, 0};
+    static const uint8_t invert[] = {BT_OP_INVERT, 2, 0, BT_OP_CONDITION, 1};
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    BT_Init(&bench_cfg);
+
+    printf("BT guard fails while running: sequence %s, memseq %s\n",
+           check_guard(BT_OP_SEQUENCE, BT_FAILURE) ? "stops" : "FAIL",
+           check_guard(BT_OP_MEMSEQ, BT_RUNNING) ? "continues" : "FAIL");
+
+    report_flat("condition (sequence)", BT_OP_SEQUENCE, cond_true, sizeof(cond_true));
+    report_flat("condition (selector)", BT_OP_SELECTOR, cond_false, sizeof(cond_false));
+    report_flat("action", BT_OP_SEQUENCE, action, sizeof(action));
+    report_flat("wait", BT_OP_SEQUENCE, wait0, sizeof(wait0));
+    report_flat("invert + condition", BT_OP_SEQUENCE, invert, sizeof(invert));
+    report_nested("sequence (nested)", BT_OP_SEQUENCE);
+    report_nested("selector (nested)", BT_OP_SELECTOR);
+    printf("BT full tick, 1 condition: %lu cycles @ %lu MHz\n",
+           (unsigned long)time_tree(make_nested(BT_OP_SEQUENCE, 1)),
+           (unsigned long)(SystemCoreClock / 1000000u));
+}
+
+#endif // BT_BENCH
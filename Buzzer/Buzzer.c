@@ -116,4 +116,119 @@ void buzzer_note(Buzzer_cfg_t* cfg, Buzzer_Note_t note, uint8_t volume_percent)
 {
     // Simply play the note frequency (note enum contains the Hz value)
     buzzer_tone(cfg, (uint32_t)note, volume_percent);
-}
\ No newline at end of file
+}
+
+// ============ PACKED TUNE PLAYBACK ============
+// Stream format produced by tools/music_compiler.py:
+//   2-byte header: milliseconds per 1/32 note (little-endian)
+//   event byte:    [7:4] duration code, [3:0] signed pitch delta (0x8 = rest)
+//   0xF0 = end, 0xF1 nn = absolute pitch, 0xF2 = tie next event to current note
+
+#define TUNE_ESC_END    0xF0u
+#define TUNE_ESC_PITCH  0xF1u
+#define TUNE_ESC_TIE    0xF2u
+#define TUNE_REST       0x8u
+
+// Silence at the end of each note so repeated notes are heard separately
+#define TUNE_GAP_MS     10u
+
+// Duration codes in 1/32 notes - must match DURATIONS in tools/music_compiler.py
+static const uint8_t BUZZER_TUNE_DURATIONS[16] = {
+    1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 0, 0, 0
+};
+
+// Octave 8 (MIDI 108-119) frequencies in Hz, lower octaves are right shifts
+static const uint16_t OCTAVE8_FREQ_HZ[12] = {
+    4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902
+};
+
+uint32_t buzzer_midi_to_freq(uint8_t midi_note)
+{
+    midi_note = (uint8_t)clamp_u32(midi_note, 24u, 119u);
+
+    uint32_t shift = 9u - (midi_note / 12u);   // MIDI 108..119 => shift 0
+    uint32_t freq = OCTAVE8_FREQ_HZ[midi_note % 12u];
+
+    // Round to nearest rather than truncating
+    return shift ? ((freq + (1u << (shift - 1u))) >> shift) : freq;
+}
+
+void buzzer_tune_start(Buzzer_cfg_t* cfg, Buzzer_Tune_t* tune, const uint8_t* stream,
+                       uint8_t volume_percent, uint8_t loop)
+{
+    tune->stream = stream;
+    tune->pos = stream + 2;
+    tune->ms_per_unit = (uint16_t)(stream[0] | (stream[1] << 8));
+    tune->pitch = 69;   // A4 until the stream sets an absolute pitch
+    tune->volume_percent = volume_percent;
+    tune->loop = loop;
+    tune->playing = 1;
+    tune->next_event_ms = HAL_GetTick();
+    tune->note_off_ms = tune->next_event_ms;
+
+    buzzer_tune_update(cfg, tune);
+}
+
+void buzzer_tune_stop(Buzzer_cfg_t* cfg, Buzzer_Tune_t* tune)
+{
+    tune->playing = 0;
+    buzzer_off(cfg);
+}
+
+uint8_t buzzer_tune_update(Buzzer_cfg_t* cfg, Buzzer_Tune_t* tune)
+{
+    if (!tune->playing) {
+        return 0;
+    }
+
+    uint32_t now = HAL_GetTick();
+
+    // Decode every event that is due (normally just one)
+    while ((int32_t)(now - tune->next_event_ms) >= 0) {
+        uint8_t event = *tune->pos++;
+        uint8_t tie = 0;
+
+        if (event == TUNE_ESC_END) {
+            if (!tune->loop) {
+                buzzer_tune_stop(cfg, tune);
+                return 0;
+            }
+            tune->pos = tune->stream + 2;
+            continue;
+        }
+        if (event == TUNE_ESC_PITCH) {
+            tune->pitch = *tune->pos++;
+            continue;
+        }
+        if (event == TUNE_ESC_TIE) {
+            tie = 1;
+            event = *tune->pos++;
+        }
+
+        uint8_t delta = event & 0x0Fu;
+        uint32_t duration_ms = (uint32_t)BUZZER_TUNE_DURATIONS[event >> 4] * tune->ms_per_unit;
+        tune->next_event_ms += duration_ms;
+
+        if (delta == TUNE_REST) {
+            tune->note_off_ms = tune->next_event_ms - duration_ms;
+            continue;
+        }
+
+        // Sign-extend the 4-bit delta
+        tune->pitch = (uint8_t)(tune->pitch + (int8_t)((int8_t)(delta << 4) >> 4));
+        tune->note_off_ms = tune->next_event_ms;
+        if (duration_ms > 2u * TUNE_GAP_MS && *tune->pos != TUNE_ESC_TIE) {
+            tune->note_off_ms -= TUNE_GAP_MS;
+        }
+        if (!tie) {
+            buzzer_tone(cfg, buzzer_midi_to_freq(tune->pitch), tune->volume_percent);
+        }
+    }
+
+    // Release the current note slightly early to articulate repeated notes
+    if ((int32_t)(now - tune->note_off_ms) >= 0) {
+        buzzer_off(cfg);
+    }
+
+    return 1;
+}
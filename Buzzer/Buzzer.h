@@ -17,6 +17,7 @@ extern "C" {
  * - Play tones at arbitrary frequencies
  * - Play musical notes (C4-C7) with symbolic names, including sharps/flats
  * - Volume control (0-100%)
+ * - Non-blocking playback of packed tunes compiled from RTTTL/MIDI files
  * 
  * Example usage:
  * @code
@@ -123,6 +124,27 @@ typedef struct {
     uint8_t pwm_started;        ///< Internal flag: 1 if PWM is running, 0 otherwise
 } Buzzer_cfg_t;
 
+/**
+ * @struct Buzzer_Tune_t
+ * @brief Playback state for a packed note stream
+ *
+ * @details Tunes are compiled at build time by tools/music_compiler.py from
+ * the RTTTL/MIDI files in Buzzer/tunes into byte arrays (see Tunes.h).
+ * Each note is usually a single byte: a 4-bit duration code and a 4-bit
+ * pitch delta in semitones from the previous note.
+ */
+typedef struct {
+    const uint8_t* stream;      ///< Start of the packed stream (header included)
+    const uint8_t* pos;         ///< Next event to decode
+    uint32_t next_event_ms;     ///< HAL tick at which the next event starts
+    uint32_t note_off_ms;       ///< HAL tick at which the current note is released
+    uint16_t ms_per_unit;       ///< Milliseconds per 1/32 note (from stream header)
+    uint8_t pitch;              ///< Current pitch as a MIDI note number
+    uint8_t volume_percent;     ///< Playback volume 0..100
+    uint8_t playing;            ///< 1 while the tune is running
+    uint8_t loop;               ///< 1 to restart at the end of the stream
+} Buzzer_Tune_t;
+
 /**
  * @brief Initialize buzzer timer
  * 
@@ -173,6 +195,49 @@ void buzzer_off(Buzzer_cfg_t* cfg);
  */
 uint8_t buzzer_is_running(Buzzer_cfg_t* cfg);
 
+/**
+ * @brief Convert a MIDI note number to a frequency in Hz
+ *
+ * @param midi_note MIDI note number (69 = A4 = 440 Hz), clamped to 24..119
+ * @return Frequency in Hz, rounded to the nearest integer
+ */
+uint32_t buzzer_midi_to_freq(uint8_t midi_note);
+
+/**
+ * @brief Start playing a packed tune
+ *
+ * Playback is non-blocking: call buzzer_tune_update() regularly (every frame
+ * is enough) to advance through the notes.
+ *
+ * @param cfg Pointer to buzzer configuration struct
+ * @param tune Playback state to use (one per simultaneous tune)
+ * @param stream Packed note stream, e.g. tune_startup from Tunes.h
+ * @param volume_percent 0..100
+ * @param loop 1 to repeat the tune forever, 0 to play once
+ */
+void buzzer_tune_start(Buzzer_cfg_t* cfg, Buzzer_Tune_t* tune, const uint8_t* stream,
+                       uint8_t volume_percent, uint8_t loop);
+
+/**
+ * @brief Advance tune playback
+ *
+ * Decodes every event that is due and updates the buzzer output.
+ * Cost is a few cycles per decoded note plus one buzzer_tone() call.
+ *
+ * @param cfg Pointer to buzzer configuration struct
+ * @param tune Playback state passed to buzzer_tune_start()
+ * @return 1 while the tune is still playing, 0 once it has finished
+ */
+uint8_t buzzer_tune_update(Buzzer_cfg_t* cfg, Buzzer_Tune_t* tune);
+
+/**
+ * @brief Stop tune playback and silence the buzzer
+ *
+ * @param cfg Pointer to buzzer configuration struct
+ * @param tune Playback state passed to buzzer_tune_start()
+ */
+void buzzer_tune_stop(Buzzer_cfg_t* cfg, Buzzer_Tune_t* tune);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "Camera.h"
+
+/**
+ * @file Camera.c
+ * @brief Implementation of the dead-zone follow camera and visibility test
+ */
+
+// Keep a view position inside [0, world - view] (0 if the world is smaller)
+static int32_t clamp_axis(int32_t pos, int32_t world, uint16_t view)
+{
+    int32_t max = world - (int32_t)view;
+
+    if (pos > max) {
+        pos = max;
+    }
+    if (pos < 0) {
+        pos = 0;
+    }
+    return pos;
+}
+
+// Move the goal just enough to bring the target back inside the dead zone
+static int32_t follow_axis(int32_t goal, int32_t target, uint16_t view, uint16_t dead)
+{
+    int32_t margin = (int32_t)(view - dead) / 2;
+
+    if (target < goal + margin) {
+        goal = target - margin;
+    }
+    else if (target > goal + margin + (int32_t)dead) {
+        goal = target - margin - (int32_t)dead;
+    }
+    return goal;
+}
+
+// Ease a 24.8 position towards a whole-pixel goal
+static int32_t ease(int32_t f, int32_t goal, uint8_t shift)
+{
+    int32_t diff = goal * 256 - f;
+
+    if (diff > -256 && diff < 256) {
+        return goal * 256;      // within a pixel: settle exactly
+    }
+    return f + diff / (1 << shift);
+}
+
+void Camera_Init(Camera_cfg_t* cfg, int32_t cx, int32_t cy)
+{
+    cfg->goal_x = clamp_axis(cx - cfg->view_w / 2, cfg->world_w, cfg->view_w);
+    cfg->goal_y = clamp_axis(cy - cfg->view_h / 2, cfg->world_h, cfg->view_h);
+    cfg->x = cfg->goal_x;
+    cfg->y = cfg->goal_y;
+    cfg->fx = cfg->x * 256;
+    cfg->fy = cfg->y * 256;
+    cfg->setup_done = 1;
+}
+
+void Camera_Follow(Camera_cfg_t* cfg, int32_t tx, int32_t ty)
+{
+    cfg->goal_x = clamp_axis(follow_axis(cfg->goal_x, tx, cfg->view_w, cfg->dead_w),
+                             cfg->world_w, cfg->view_w);
+    cfg->goal_y = clamp_axis(follow_axis(cfg->goal_y, ty, cfg->view_h, cfg->dead_h),
+                             cfg->world_h, cfg->view_h);
+
+    cfg->fx = ease(cfg->fx, cfg->goal_x, cfg->smoothing_shift);
+    cfg->fy = ease(cfg->fy, cfg->goal_y, cfg->smoothing_shift);
+    cfg->x = (cfg->fx + 128) >> 8;
+    cfg->y = (cfg->fy + 128) >> 8;
+}
+
+uint8_t Camera_IsVisible(const Camera_cfg_t* cfg, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    return x + w > cfg->x && x < cfg->x + (int32_t)cfg->view_w &&
+           y + h > cfg->y && y < cfg->y + (int32_t)cfg->view_h;
+}
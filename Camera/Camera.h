@@ -0,0 +1,85 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <stdint.h>
+
+/**
+ * @file Camera.h
+ * @brief Scrolling camera over a world larger than the screen
+ *
+ * Entities live in world coordinates: 32-bit pixels from the top-left of the
+ * level. The camera is the world position of the screen's top-left corner,
+ * so an entity is drawn at (world - camera).
+ *
+ * The camera follows a target (the Character) with a dead zone: while the
+ * target moves inside a box in the middle of the view the camera stays
+ * still, so small movements do not scroll the whole screen. When the target
+ * pushes against the box, the camera's goal moves with it, and the camera
+ * eases towards its goal by 1/2^smoothing_shift of the distance per frame
+ * (kept in 24.8 fixed point so slow catch-up does not stall on rounding).
+ * The view never leaves the world.
+ *
+ * Camera_IsVisible() is the culling test: anything whose box is off-screen
+ * needs neither drawing nor animating.
+ *
+ * Example usage:
+ * @code
+ * Camera_cfg_t cam = {
+ *     .view_w = 240, .view_h = 240,
+ *     .dead_w = 64, .dead_h = 48,
+ *     .smoothing_shift = 2,       // close a quarter of the gap per frame
+ *     .world_w = 720, .world_h = 480,
+ *     .setup_done = 0
+ * };
+ *
+ * Camera_Init(&cam, player.x, player.y);      // centred on the player
+ *
+ * // Each frame, after moving the player:
+ * Camera_Follow(&cam, player.x, player.y);
+ * if (Camera_IsVisible(&cam, enemy.x, enemy.y, 16, 16)) {
+ *     draw_enemy(enemy.x - cam.x, enemy.y - cam.y);
+ * }
+ * @endcode
+ */
+
+/**
+ * @struct Camera_cfg_t
+ * @brief Camera configuration and position
+ */
+typedef struct {
+    uint16_t view_w;                ///< Screen size in pixels
+    uint16_t view_h;
+    uint16_t dead_w;                ///< Dead zone size, centred in the view
+    uint16_t dead_h;
+    uint8_t smoothing_shift;        ///< Ease by 1/2^n of the distance per frame, 0 to snap
+    int32_t world_w;                ///< World size in pixels (the view stays inside)
+    int32_t world_h;
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+
+    int32_t x;                      ///< World position of the screen's top-left pixel
+    int32_t y;
+    int32_t goal_x;                 ///< Internal: where the camera is heading
+    int32_t goal_y;
+    int32_t fx;                     ///< Internal: position in 24.8 fixed point
+    int32_t fy;
+} Camera_cfg_t;
+
+/**
+ * @brief Initialise the camera centred on a point (within the world)
+ */
+void Camera_Init(Camera_cfg_t* cfg, int32_t cx, int32_t cy);
+
+/**
+ * @brief Follow a target point for one frame
+ */
+void Camera_Follow(Camera_cfg_t* cfg, int32_t tx, int32_t ty);
+
+/**
+ * @brief Check if a world box overlaps the screen
+ *
+ * @param x, y Top-left corner in world pixels
+ * @param w, h Size in pixels
+ */
+uint8_t Camera_IsVisible(const Camera_cfg_t* cfg, int32_t x, int32_t y, int32_t w, int32_t h);
+
+#endif // CAMERA_H
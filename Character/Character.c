@@ -1,4 +1,5 @@
 #include "Character.h"
+#include "Trace.h"
 
 // ===== ANIMATION SPRITES =====
 
@@ -58,18 +59,53 @@ const uint8_t CharacterDASHING[8][8] = {
     {255, 0, 0, 255, 255, 0, 0, 255}
 };
 
+// ===== TIMER CALLBACKS =====
+
+/**
+ * Dash timer expired: the next update leaves DASHING
+ */
+static void dash_timer_expired(TimerWheel_Timer_t* timer, void* context) {
+    Character_t* character = (Character_t*)context;
+    character->dash_active = 0;
+}
+
+/**
+ * Walk animation timer expired: next frame of the walk cycle, then restart
+ */
+static void anim_timer_expired(TimerWheel_Timer_t* timer, void* context) {
+    Character_t* character = (Character_t*)context;
+    const CharacterStateInfo_t* info = &CHAR_STATES[character->state];
+    character->animation_frame = (character->animation_frame + 1) % info->frame_count;
+    TimerWheel_Start(character->timers, timer, info->period);
+}
+
 // ===== IMPLEMENTATION =====
 
 /**
  * Initialize character at screen center
  */
-void Character_Init(Character_t* character) {
+void Character_Init(Character_t* character, TimerWheel_t* timers) {
+    // Stop timers left over from a previous game
+    if (character->timers) {
+        TimerWheel_Cancel(character->timers, &character->dash_timer);
+        TimerWheel_Cancel(character->timers, &character->anim_timer);
+    }
+
     character->x = 120;
     character->y = 120;
     character->state = CHAR_IDLE;
     character->animation_frame = 0;
-    character->frame_counter = 0;
-    character->dash_counter = 0;
+    character->dash_active = 0;
+    character->timers = timers;
+    TimerWheel_TimerInit(&character->dash_timer, dash_timer_expired, character);
+    TimerWheel_TimerInit(&character->anim_timer, anim_timer_expired, character);
+}
+
+/**
+ * Set the level collision map (not reset by Character_Init)
+ */
+void Character_SetMap(Character_t* character, const TileMap_cfg_t* map) {
+    character->map = map;
 }
 
 /**
@@ -97,25 +133,40 @@ void Character_Update(Character_t* character, Joystick_t* joy, uint8_t dash_pres
     }
     
     // ===== STEP 2: Handle dash button =====
-    if (dash_pressed && character->dash_counter == 0) {
-        character->dash_counter = CHAR_DASH_DURATION;
+    // The dash timer's callback clears dash_active when the dash is over
+    if (dash_pressed && !character->dash_active) {
+        character->dash_active = 1;
+        TimerWheel_Start(character->timers, &character->dash_timer, CHAR_DASH_DURATION);
+    } else if (dash_pressed) {
+        // Not a transition, but "why didn't it dash?" is what the trace is for
+        TRACE_FSM(character->trace_id, character->state, character->state, CHAR_EV_DASH_IGNORED);
     }
     
     // ===== STEP 3: Apply movement with speed (normal or dash) =====
     uint8_t current_speed = CHAR_SPEED;
-    if (character->dash_counter > 0) {
+    if (character->dash_active) {
         current_speed = CHAR_DASH_SPEED;
-        character->dash_counter--;
     }
     
-    int16_t new_x = character->x + (move_x * current_speed);
-    int16_t new_y = character->y + (move_y * current_speed);
+    int32_t new_x = character->x + (move_x * current_speed);
+    int32_t new_y = character->y + (move_y * current_speed);
     
-    // Keep on screen (sprite is 32x32 after 4x scaling)
-    if (new_x < 20) new_x = 20;
-    if (new_x > 220) new_x = 220;
-    if (new_y < 20) new_y = 20;
-    if (new_y > 220) new_y = 220;
+    if (character->map) {
+        // Stop at walls: sweep the hitbox through the level's collision bitset
+        TileMap_Box_t box = {
+            character->x - CHAR_HITBOX_W / 2, character->y - CHAR_HITBOX_H / 2,
+            CHAR_HITBOX_W, CHAR_HITBOX_H
+        };
+        TileMap_Move(character->map, &box, move_x * current_speed, move_y * current_speed);
+        new_x = box.x + CHAR_HITBOX_W / 2;
+        new_y = box.y + CHAR_HITBOX_H / 2;
+    } else {
+        // Keep on screen (sprite is 32x32 after 4x scaling)
+        if (new_x < 20) new_x = 20;
+        if (new_x > 220) new_x = 220;
+        if (new_y < 20) new_y = 20;
+        if (new_y > 220) new_y = 220;
+    }
     
     if (move_x != 0 || move_y != 0) {
         character->x = new_x;
@@ -123,52 +174,79 @@ void Character_Update(Character_t* character, Joystick_t* joy, uint8_t dash_pres
     }
     
     // ===== STEP 4: Update state (IDLE, WALKING, DASHING) =====
+    // The input becomes one event; the generated table gives the next state
     uint8_t is_moving = (move_x != 0 || move_y != 0);
+    CharacterEvent_t event = character->dash_active ? CHAR_EV_DASH :
+                             is_moving ? CHAR_EV_MOVE : CHAR_EV_STOP;
+    CharacterState_t next = CHAR_Next(character->state, event);
     
-    if (character->dash_counter > 0) {
-        character->state = CHAR_DASHING;
-    } else if (is_moving) {
-        character->state = CHAR_WALKING;
-    } else {
-        character->state = CHAR_IDLE;
+    if (next != character->state) {
+        TRACE_FSM(character->trace_id, character->state, next, event);
+        character->state = next;
+        // The new state's animation starts from its first frame
+        TimerWheel_Cancel(character->timers, &character->anim_timer);
+        character->animation_frame = 0;
     }
     
-    // ===== STEP 5: Update animation frame for walk cycle =====
-    if (character->state == CHAR_WALKING) {
-        character->frame_counter++;
-        if (character->frame_counter >= 10) {
-            character->frame_counter = 0;
-            character->animation_frame = (character->animation_frame + 1) % 2;
+    // ===== STEP 5: Update animation frame =====
+    // States with several frames advance one every 'period' ticks while on
+    // screen; an off-screen character is not animated
+    const CharacterStateInfo_t* info = &CHAR_STATES[character->state];
+    if (info->period && !character->culled) {
+        if (!TimerWheel_IsActive(&character->anim_timer)) {
+            TimerWheel_Start(character->timers, &character->anim_timer, info->period);
         }
     } else {
+        TimerWheel_Cancel(character->timers, &character->anim_timer);
         character->animation_frame = 0;
-        character->frame_counter = 0;
     }
 }
 
+/**
+ * Cull when the 32x32 sprite is entirely off-screen
+ */
+void Character_Cull(Character_t* character, const Camera_cfg_t* camera) {
+    character->culled = !Camera_IsVisible(camera, character->x - 16, character->y - 16, 32, 32);
+}
+
 /**
  * Draw character sprite based on current state
  */
-void Character_Draw(Character_t* character) {
+void Character_Draw(Character_t* character, const Camera_cfg_t* camera) {
+    
+    int32_t x_pos = character->x - 16;  // 8x8 sprite * 4x scale = 16 offset
+    int32_t y_pos = character->y - 16;
+    
+    if (camera) {
+        if (!Camera_IsVisible(camera, x_pos, y_pos, 32, 32)) {
+            return;
+        }
+        x_pos -= camera->x;
+        y_pos -= camera->y;
+    }
     
-    int16_t x_pos = character->x - 16;  // 8x8 sprite * 4x scale = 16 offset
-    int16_t y_pos = character->y - 16;
+    const Fsm_Frame_t* frame = &CHAR_STATES[character->state].frames[character->animation_frame];
+    LCD_Draw_Sprite_Colour_Scaled(x_pos, y_pos, CHAR_SPRITE_H, CHAR_SPRITE_W,
+                                  frame->sprite, frame->colour, CHAR_SPRITE_SCALE);
+}
+
+/**
+ * Submit character sprite to a draw list
+ */
+void Character_Submit(Character_t* character, const Camera_cfg_t* camera, DrawList_cfg_t* list, int16_t z) {
+    int32_t x_pos = character->x - 16;
+    int32_t y_pos = character->y - 16;
     
-    switch (character->state) {
-        case CHAR_IDLE:
-            LCD_Draw_Sprite_Colour_Scaled(x_pos, y_pos, 8, 8, (uint8_t*)CharacterIDLE, 5, 4);
-            break;
-        
-        case CHAR_WALKING:
-            if (character->animation_frame == 0) {
-                LCD_Draw_Sprite_Colour_Scaled(x_pos, y_pos, 8, 8, (uint8_t*)CharacterWALK1, 5, 4);
-            } else {
-                LCD_Draw_Sprite_Colour_Scaled(x_pos, y_pos, 8, 8, (uint8_t*)CharacterWALK2, 5, 4);
-            }
-            break;
-        
-        case CHAR_DASHING:
-            LCD_Draw_Sprite_Colour_Scaled(x_pos, y_pos, 8, 8, (uint8_t*)CharacterDASHING, 6, 4);
-            break;
+    if (camera) {
+        x_pos -= camera->x;
+        y_pos -= camera->y;
     }
+    // Too far off-screen for the list's 16-bit bounds: nothing to draw
+    if (x_pos < INT16_MIN / 2 || x_pos > INT16_MAX / 2 || y_pos < INT16_MIN / 2 || y_pos > INT16_MAX / 2) {
+        return;
+    }
+    
+    const Fsm_Frame_t* frame = &CHAR_STATES[character->state].frames[character->animation_frame];
+    DrawList_Sprite(list, z, x_pos, y_pos, CHAR_SPRITE_H, CHAR_SPRITE_W,
+                    frame->sprite, frame->colour, CHAR_SPRITE_SCALE);
 }
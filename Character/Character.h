@@ -4,6 +4,10 @@
 #include <stdint.h>
 #include "Joystick.h"
 #include "LCD.h"
+#include "TimerWheel.h"
+#include "TileMap.h"
+#include "Camera.h"
+#include "DrawList.h"
 
 /**
  * @file Character.h
@@ -11,15 +15,20 @@
  * 
  * Use Joystick_t direction (N/S/E/W) to move sprite around screen.
  * Supports IDLE, WALKING, and DASHING states based on movement.
+ * Dash duration and walk animation are timers on a TimerWheel_t driven by
+ * the game tick, so nothing is counted down per character per frame.
+ * With a level collision map set, movement stops at walls and platforms;
+ * without one, the character is kept on screen.
+ * Positions are world coordinates; drawing through a Camera_cfg_t places
+ * the sprite on screen and skips it when it is off-screen.
  */
 
 // ===== CHARACTER STATES =====
 
-typedef enum {
-    CHAR_IDLE = 0,      // Not moving
-    CHAR_WALKING,       // Moving in a direction
-    CHAR_DASHING        // Fast movement (button triggered)
-} CharacterState_t;
+// States (CHAR_IDLE, CHAR_WALKING, CHAR_DASHING), events (CHAR_EV_*), the
+// transition table and each state's name, sprites, LED effect and sound are
+// generated from Character/fsm/character.fsm by tools/fsm_compiler.py
+#include "StateMachines.h"
 
 // ===== CHARACTER DATA =====
 
@@ -28,49 +37,93 @@ typedef enum {
  * @brief Sprite position and state
  * 
  * Minimal structure: just the data needed
- * - Position on screen
+ * - Position in the world
  * - Current state (IDLE, WALKING, DASHING)
  * - Animation frame (for walking animation)
+ * - Timers for the dash and the walk cycle
  */
 typedef struct {
-    int16_t x;                      // X position
-    int16_t y;                      // Y position
+    int32_t x;                      // X position (world pixels, sprite centre)
+    int32_t y;                      // Y position
     CharacterState_t state;         // Current state
     uint8_t animation_frame;        // 0 or 1 (walk cycle)
-    uint8_t frame_counter;          // Counter for animation timing
-    uint8_t dash_counter;           // Frames remaining in dash
+    uint8_t dash_active;            // 1 while the dash timer runs
+    TimerWheel_t* timers;           // Wheel driving the timers below (game ticks)
+    TimerWheel_Timer_t dash_timer;  // Ends the dash
+    TimerWheel_Timer_t anim_timer;  // Advances the walk cycle while walking
+    const TileMap_cfg_t* map;       // Level collision map, NULL to keep to the screen
+    uint8_t culled;                 // 1 while off-screen: not drawn, walk cycle paused
+    uint8_t trace_id;               // Entity id in the FSM trace (not reset by Character_Init)
 } Character_t;
 
 // ===== CONSTANTS =====
 
 #define CHAR_SPEED 2                // Pixels per frame (normal)
 #define CHAR_DASH_SPEED 5           // Pixels per frame (dashing)
-#define CHAR_DASH_DURATION 20       // Frames (dash lasts this long)
+#define CHAR_DASH_DURATION 20       // Ticks (dash lasts this long)
+#define CHAR_HITBOX_W 24            // Collision box, centred on (x, y): the sprite's
+#define CHAR_HITBOX_H 32            // solid columns at 4x scale
 
 // ===== FUNCTIONS =====
 
 /**
  * @brief Initialize character at screen center
+ * 
+ * The character must be zero-initialised (e.g., a global) or have been
+ * initialised before: any timers it still has running are cancelled.
+ * 
+ * @param timers Timer wheel ticked once per game frame
  */
-void Character_Init(Character_t* character);
+void Character_Init(Character_t* character, TimerWheel_t* timers);
+
+/**
+ * @brief Set the level the character collides with
+ * 
+ * Kept across Character_Init(). The character's hitbox must start clear of
+ * solid tiles.
+ * 
+ * @param map Collision map in pixels matching the screen, NULL for none
+ */
+void Character_SetMap(Character_t* character, const TileMap_cfg_t* map);
 
 /**
  * @brief Update character position and state
  * 
  * Uses joy->direction for 8-way movement
  * Sets state to WALKING when moving, IDLE when stopped
- * Handles dash countdown and speed boost
+ * Starts the dash timer and applies the speed boost while it runs
  */
 void Character_Update(Character_t* character, Joystick_t* joy, uint8_t dash_pressed);
 
+/**
+ * @brief Update the culling flag from the camera
+ * 
+ * Call once per frame after the camera has moved. While culled, the
+ * character is not drawn and its walk animation timer does not run.
+ */
+void Character_Cull(Character_t* character, const Camera_cfg_t* camera);
+
 /**
  * @brief Draw character sprite on LCD
  * 
- * Draws different sprite based on current state:
+ * Draws the current frame of the state's animation (CHAR_STATES):
  * - IDLE: standing sprite
  * - WALKING: animated walk cycle
  * - DASHING: speed lines sprite
+ * 
+ * @param camera View into the world, NULL if world and screen coordinates are the same
+ */
+void Character_Draw(Character_t* character, const Camera_cfg_t* camera);
+
+/**
+ * @brief Submit the character sprite to a draw list instead of drawing it
+ * 
+ * Same sprite and position as Character_Draw(); an off-screen character is
+ * culled by the list.
+ * 
+ * @param camera View into the world, NULL if world and screen coordinates are the same
+ * @param z Draw order in the list
  */
-void Character_Draw(Character_t* character);
+void Character_Submit(Character_t* character, const Camera_cfg_t* camera, DrawList_cfg_t* list, int16_t z);
 
 #endif // CHARACTER_H
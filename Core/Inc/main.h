@@ -36,7 +36,27 @@ extern "C" {
 
 /* Exported types ------------------------------------------------------------*/
 /* USER CODE BEGIN ET */
-
+// Instrumented interrupt handlers (stm32l4xx_it.c): StackMon and IrqLat entries
+typedef enum {
+    IRQ_ID_SYSTICK,
+    IRQ_ID_PENDSV,
+    IRQ_ID_BUTTONS,     // EXTI2, EXTI3, EXTI15_10
+    IRQ_ID_TIM6,
+    IRQ_ID_LED_DMA,
+    IRQ_ID_LCD_DMA,
+    IRQ_ID_USART3,
+    IRQ_ID_RNG,
+    IRQ_ID_COUNT
+} IrqId_t;
+
+// State machines in the FSM trace (Trace.h, decoded by tools/trace_decode.py)
+typedef enum {
+    TRACE_ENTITY_SCENE,     // Scene manager: states are SCENE_* ids
+    TRACE_ENTITY_PLAYER,    // game_character: CHAR_* states, CHAR_EV_* events
+    TRACE_ENTITY_VERSUS_0,  // versus_players[0] and [1]
+    TRACE_ENTITY_VERSUS_1,
+    TRACE_ENTITY_COUNT
+} TraceEntity_t;
 /* USER CODE END ET */
 
 /* Exported constants --------------------------------------------------------*/
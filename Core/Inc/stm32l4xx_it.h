@@ -60,6 +60,16 @@ void EXTI3_IRQHandler(void);
 void EXTI15_10_IRQHandler(void);
 void TIM6_DAC_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void DMA1_Channel7_IRQHandler(void);
+void DMA1_Channel5_IRQHandler(void);
+void USART3_IRQHandler(void);
+void RNG_IRQHandler(void);
+#ifdef IRQ_LATENCY
+void TIM7_IRQHandler(void);
+void COMP_IRQHandler(void);
+void LPTIM2_IRQHandler(void);
+void SWPMI1_IRQHandler(void);
+#endif
 
 /* USER CODE END EFP */
 
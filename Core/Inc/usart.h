@@ -35,12 +35,14 @@ extern "C" {
 extern UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN Private defines */
+extern UART_HandleTypeDef huart3;
 
 /* USER CODE END Private defines */
 
 void MX_USART2_UART_Init(void);
 
 /* USER CODE BEGIN Prototypes */
+void MX_USART3_UART_Init(void);
 
 /* USER CODE END Prototypes */
 
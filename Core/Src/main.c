@@ -12,9 +12,14 @@
 //
 // Controls:
 // - Joystick: Move character in any direction
-// - Button (BTN3): Trigger dash ability
+// - Button (BTN3): Trigger dash ability (quit from the pause screen)
+// - Button (BTN2): Pause / resume
+// - Button (B1): Versus game with a second board over the link cable (menu)
+// - BTN2/BTN3: Start from the menu; any button returns to the menu from game over
 //
 // Architecture:
+// - Scheduler: input, audio, logic, render and logging tasks with periods and deadlines
+// - Scene manager: outer FSM (BOOT, MENU, PLAY, PAUSE, GAME_OVER, VERSUS) with enter/exit per scene
 // - update_character(): Updates FSM based on input (game logic)
 // - render_game(): Draws everything to LCD (rendering only)
 // - Character module: Encapsulates character FSM, sprites, and movement
@@ -26,17 +31,42 @@
 #include "usart.h"     // For serial output
 #include "gpio.h"      // GPIO control
 #include "adc.h"       // ADC for joystick input
+#include "rng.h"       // Hardware RNG clock (entropy for seeding)
 
 // AUTO-GENERATED STM32 FUNCTION PROTOTYPES - DO NOT EDIT
 void SystemClock_Config(void);
 void PeriphCommonClock_Config(void);
 
 // Buzzer library
-#include "Buzzer.h" // Not used but included for completeness and future expansion of the demo to include buzzer functionality
+#include "Buzzer.h" // Buzzer on TIM2 CH3 for sound effects
+#include "Tunes.h"  // Packed tunes generated from Buzzer/tunes at build time
 #include "PWM.h"    // For PWM control of the LED 
+#include "PWM_Effects.h" // DMA-driven LED effects (breathing, flashing)
 #include "LCD.h"  // For LCD demonstration 
 #include "Joystick.h" // include the Joystick driver functions
 #include "Character.h" // Character object with FSM for game sprite
+#include "Power.h"     // WFI frame pacing and low-power run when idle
+#include "ClockGov.h"  // Load-based 80/48/24 MHz clock scaling
+#include "Scene.h"     // Outer game-flow FSM (boot, menu, play, pause, game over)
+#include "Scheduler.h" // Cooperative task scheduler (input, audio, logic, render, logging)
+#include "WorkQueue.h" // Deferred interrupt work run from PendSV
+#include "TimerWheel.h" // Game timers (dash, animation) driven by the game tick
+#include "AiSched.h"    // Time-sliced AI agent updates within a per-tick budget
+#include "FlowField.h"  // Shared pathfinding field towards the Character
+#include "BehaviourTree.h" // Bytecode behaviour trees for enemy AI
+#include "Snapshot.h"    // Game state save/restore (retry, rollback)
+#include "Netcode.h"     // Rollback lockstep with a second board over USART3
+#include "KVStore.h"     // Settings and calibration in flash
+#include "TileMap.h"     // Level collision bitset (walls, platforms)
+#include "LevelStream.h" // Level tiles streamed from compressed flash chunks
+#include "Levels.h"      // Levels compiled from LevelStream/levels at build time
+#include "Camera.h"      // Scrolling view over the level, follows the Character
+#include "Random.h"      // Hardware entropy pool and deterministic PRNG
+#include "StackMon.h"    // Stack high-water marks and overflow guard
+#include "IrqLat.h"      // Interrupt latency and jitter probes (IRQ_LATENCY builds)
+#include "Trace.h"       // FSM transition trace ring (FSM_TRACE builds)
+#include "Wcet.h"        // Worst-case execution time harness (WCET_BENCH builds)
+#include "DrawList.h"    // Z-ordered draw list with off-screen and occlusion culling
 
 #include <stdint.h>
 #include <stdio.h>
@@ -54,6 +84,8 @@ Buzzer_cfg_t buzzer_cfg = {
 };
 
 // ===== LCD CONFIGURATION =====
+void lcd_wait_hook(void);
+
 ST7789V2_cfg_t cfg0 = {
     .setup_done = 0,
     .spi = SPI2,
@@ -63,7 +95,8 @@ ST7789V2_cfg_t cfg0 = {
     .CS = {.port = GPIOB, .pin = GPIO_PIN_12},
     .MOSI = {.port = GPIOB, .pin = GPIO_PIN_15},
     .SCLK = {.port = GPIOB, .pin = GPIO_PIN_13},
-    .dma = {.instance = DMA1, .channel = DMA1_Channel5}
+    .dma = {.instance = DMA1, .channel = DMA1_Channel5},
+    .wait_hook = lcd_wait_hook   // Input and audio keep running during LCD_Refresh
 };
 
 // ===== JOYSTICK CONFIGURATION =====
@@ -81,6 +114,9 @@ Joystick_cfg_t joystick_cfg = {
 // Joystick data structure to hold readings
 Joystick_t joystick_data;
 
+// Tune playback state (startup jingle, dash sound effect)
+Buzzer_Tune_t sfx_tune;
+
 // ===== PWM CONFIGURATION =====
 // Configure PWM to use TIM4 Channel 1 (current hardware setup)
 PWM_cfg_t pwm_cfg = {
@@ -92,12 +128,242 @@ PWM_cfg_t pwm_cfg = {
     .setup_done = 0
 };
 
-// ===== FSM STATE DEFINITIONS =====
+// ===== LED EFFECTS CONFIGURATION =====
+// TIM4 update events trigger DMA1 Channel 7 (request 6) to stream duty values into TIM4->CCR1
+PWM_FX_cfg_t pwm_fx_cfg = {
+    .pwm = &pwm_cfg,
+    .dma = DMA1,
+    .dma_channel = DMA1_Channel7,
+    .dma_request = 6,
+    .dma_irq = DMA1_Channel7_IRQn,
+    .setup_done = 0
+};
+
+// LED effect for each character state
+const PWM_FX_Pattern_t led_fx_idle    = {PWM_FX_BREATHE, 2000, 2, 60, 0};   // Slow breathing
+const PWM_FX_Pattern_t led_fx_walking = {PWM_FX_SOLID,    100, 0, 40, 0};   // Steady glow
+const PWM_FX_Pattern_t led_fx_dashing = {PWM_FX_BLINK,     80, 0, 100, 0};  // Fast flashing
+
+// ===== POWER CONFIGURATION =====
+void power_clocks_changed(void);
+uint8_t power_busy(void);
+
+// Sleep between 30 ms frames; after 15 s without input drop to 2 MHz low-power run
+Power_cfg_t power_cfg = {
+    .frame_period_ms = 30,
+    .idle_frame_period_ms = 100,
+    .idle_timeout_ms = 15000,
+    .restore_clocks = SystemClock_Config,
+    .clocks_changed = power_clocks_changed,
+    .busy = power_busy,
+    .setup_done = 0
+};
+
+// ===== CLOCK GOVERNOR CONFIGURATION =====
+void governor_clocks_changed(void);
+
+// Buzzer (TIM2) and LED (TIM4) keep their 1 MHz tick on every clock profile
+ClockGov_cfg_t clock_gov = {
+    .timers = {&htim2, &htim4},
+    .timer_count = 2,
+    .timer_tick_hz = 1000000,
+    .up_percent = 85,
+    .down_percent = 60,
+    .down_hold_frames = 30,    // ~1 s of light frames before slowing down
+    .clocks_changed = governor_clocks_changed,
+    .setup_done = 0
+};
+
+// ===== PERSISTENT STORAGE =====
+// Last 4 pages of flash bank 2 (excluded from FLASH in the linker script).
+// Code runs from bank 1, so writing and erasing here does not stall the CPU
+KV_cfg_t kv_store = {
+    .base = 0x080FE000,
+    .page_count = 4,
+    .setup_done = 0
+};
+
+// Keys in the store (never renumber: the values outlive the firmware)
+enum {
+    KV_KEY_JOYSTICK_CENTRE = 0,     // uint16_t x, y
+};
+
+// ===== TASKS =====
+// The main loop is a cooperative scheduler. Each task runs to completion;
+// when nothing is due the core sleeps (WFI) until the next release.
+// Lower priority number = more urgent.
+enum {
+    TASK_INPUT = 0,
+    TASK_AUDIO,
+    TASK_LOGIC,
+    TASK_RENDER,
+    TASK_LOG,
+    TASK_STORAGE,
+    TASK_COUNT
+};
+
+void input_task(void);
+void audio_task(void);
+void logic_task(void);
+void render_task(void);
+void log_task(void);
+void storage_task(void);
+void sched_idle(uint32_t sleep_us);
+void sched_task_begin(uint8_t task);
+void sched_task_end(uint8_t task, uint8_t missed);
+void log_yield(void);
 
-// ===== NO OUTER FSM =====
-// This demo focuses on a SINGLE CHARACTER FSM for the game sprite. There is no overarching game state machine in this demo.
-// The character has its own internal FSM (IDLE/RUNNING/JUMPING) that runs continuously.
+Sched_Task_t tasks[TASK_COUNT] = {
+    //                   name       function      period deadline priority (ms)
+    [TASK_INPUT]   = {"input",   input_task,      10,    10,    0},
+    [TASK_AUDIO]   = {"audio",   audio_task,       5,    10,    1},
+    [TASK_LOGIC]   = {"logic",   logic_task,      30,    15,    2},
+    [TASK_RENDER]  = {"render",  render_task,     30,    30,    3},
+    [TASK_LOG]     = {"log",     log_task,      1000,  1000,    4},
+    [TASK_STORAGE] = {"storage", storage_task,     5,    50,    5},
+};
 
+Sched_cfg_t sched = {
+    .tasks = tasks,
+    .count = TASK_COUNT,
+    .time_us = Power_TimeUs,
+    .idle = sched_idle,
+#ifdef STACKMON_TASKS
+    .task_begin = sched_task_begin,
+#endif
+    .task_end = sched_task_end,
+    .setup_done = 0
+};
+
+// Stack high-water marks: the whole stack, each task (2 KB window repainted
+// per run, only with STACKMON_TASKS) and the depth at which each interrupt
+// starts. An MPU guard at the bottom of the stack turns an overflow into a
+// fault instead of corrupted globals.
+StackMon_Entry_t stack_tasks[TASK_COUNT];
+StackMon_Entry_t stack_isrs[IRQ_ID_COUNT] = {
+    [IRQ_ID_SYSTICK] = {"systick"},
+    [IRQ_ID_PENDSV]  = {"pendsv"},
+    [IRQ_ID_BUTTONS] = {"buttons"},
+    [IRQ_ID_TIM6]    = {"tim6"},
+    [IRQ_ID_LED_DMA] = {"led"},
+    [IRQ_ID_LCD_DMA] = {"lcd"},
+    [IRQ_ID_USART3]  = {"usart3"},
+    [IRQ_ID_RNG]     = {"rng"},
+};
+StackMon_cfg_t stack_mon = {
+    .tasks = stack_tasks,
+    .task_count = TASK_COUNT,
+    .isrs = stack_isrs,
+    .isr_count = IRQ_ID_COUNT,
+    .task_window = 2048,
+    .guard = 1,
+    .setup_done = 0
+};
+
+#ifdef IRQ_LATENCY
+// Interrupt latency per priority level of the plan in INTERRUPT_PRIORITIES.md:
+// TIM7 at 0 (timer probe), spare vectors at the Netcode level (5), the LCD
+// level (14) and the lowest level (15). Handler run times and SysTick
+// interval jitter come from the same entries as the stack marks.
+IrqLat_Irq_t irq_lat_irqs[IRQ_ID_COUNT] = {
+    [IRQ_ID_SYSTICK] = {"systick", SysTick_IRQn, 1000},
+    [IRQ_ID_PENDSV]  = {"pendsv", PendSV_IRQn, 0},
+    [IRQ_ID_BUTTONS] = {"buttons", EXTI15_10_IRQn, 0},
+    [IRQ_ID_TIM6]    = {"tim6", TIM6_DAC_IRQn, 0},
+    [IRQ_ID_LED_DMA] = {"led", DMA1_Channel7_IRQn, 0},
+    [IRQ_ID_LCD_DMA] = {"lcd", DMA1_Channel5_IRQn, 0},
+    [IRQ_ID_USART3]  = {"usart3", USART3_IRQn, 0},
+    [IRQ_ID_RNG]     = {"rng", RNG_IRQn, 0},
+};
+IrqLat_Probe_t irq_lat_probes[] = {
+    {"tim7", TIM7_IRQn, 0},
+    {"comp", COMP_IRQn, 5},
+    {"lptim2", LPTIM2_IRQn, 14},
+    {"swpmi1", SWPMI1_IRQn, 15},
+};
+IrqLat_cfg_t irq_lat = {
+    .irqs = irq_lat_irqs,
+    .irq_count = IRQ_ID_COUNT,
+    .probes = irq_lat_probes,
+    .probe_count = sizeof(irq_lat_probes) / sizeof(irq_lat_probes[0]),
+    .timer = TIM7,
+    .period_us = 1003,          // drifts against SysTick and the frame
+    .inversion_cycles = 400,    // 5 us at 80 MHz
+    .setup_done = 0
+};
+#endif
+
+#ifdef FSM_TRACE
+// Set when the game is paused: the log task then dumps the FSM trace
+uint8_t trace_dump_pending = 0;
+#endif
+
+// ===== OUTER GAME FSM (SCENES) =====
+// The game flow is a scene state machine on top of the character FSM:
+//
+//   BOOT --(1 s)--> MENU --(BTN2/BTN3)--> PLAY <--(BTN2)--> PAUSE
+//                   ^  |                                       |
+//                   |  +--(B1)--> VERSUS --(BTN2)--> MENU      |
+//                   +------(any button)---- GAME_OVER <--(BTN3)
+//
+// Static scenes (boot, menu, pause, game over) draw once and then leave the
+// LCD alone until their content changes, so the loop just sleeps between frames.
+enum {
+    SCENE_BOOT = 0,
+    SCENE_MENU,
+    SCENE_PLAY,
+    SCENE_PAUSE,
+    SCENE_GAME_OVER,
+    SCENE_VERSUS,
+    SCENE_COUNT
+};
+
+void boot_enter(void);
+void boot_update(void);
+void boot_render(void);
+void menu_update(void);
+void menu_render(void);
+void play_enter(void);
+void play_update(void);
+void play_render(void);
+void pause_enter(void);
+void pause_update(void);
+void pause_render(void);
+void game_over_enter(void);
+void game_over_update(void);
+void game_over_render(void);
+void versus_enter(void);
+void versus_update(void);
+void versus_render(void);
+
+const Scene_t scenes[SCENE_COUNT] = {
+    [SCENE_BOOT]      = {"BOOT",      boot_enter,      NULL, boot_update,      boot_render,      1},
+    [SCENE_MENU]      = {"MENU",      NULL,            NULL, menu_update,      menu_render,      1},
+    [SCENE_PLAY]      = {"PLAY",      play_enter,      NULL, play_update,      play_render,      0},
+    [SCENE_PAUSE]     = {"PAUSE",     pause_enter,     NULL, pause_update,     pause_render,     1},
+    [SCENE_GAME_OVER] = {"GAME OVER", game_over_enter, NULL, game_over_update, game_over_render, 1},
+    [SCENE_VERSUS]    = {"VERSUS",    versus_enter,    NULL, versus_update,    versus_render,    0},
+};
+
+SceneManager_t scene_mgr = {
+    .scenes = scenes,
+    .count = SCENE_COUNT,
+    .trace_id = TRACE_ENTITY_SCENE,
+    .setup_done = 0
+};
+
+// Boot splash timing (non-blocking, driven by time in scene)
+#define BOOT_SPLASH_MS 500
+uint8_t boot_stage = 0;
+
+// Hold BTN3 during reset: the first splash is a random pattern that drives
+// every pixel (a display test). Fixed seed, so every board shows the same one
+#define BOOT_TEST_SEED 0xD15C0001u
+uint8_t boot_display_test = 0;
+Random_t boot_test_rng;
+
+// LED effect for the game over screen: one slow fade, then off
+const PWM_FX_Pattern_t led_fx_game_over = {PWM_FX_FADE_OUT, 1500, 0, 100, 1};
 
 
 // ===== UTILITY FUNCTIONS =====
@@ -114,29 +380,206 @@ int _write(int file, char *ptr, int len) {
 // Global character object
 Character_t game_character;
 
-// Dash button state
-volatile uint8_t dash_button_pressed = 0;
+// Game timers, ticked once per PLAY logic frame (so they freeze while paused)
+TimerWheel_t game_timers;
 
-// Last debounce timestamp for dash button
-volatile uint32_t dash_button_last_interrupt_time = 0;
+// The level: tiles of 8x8 pixels, streamed from flash in 16x16-tile chunks
+// around the view, and its collision bitset (the whole level, 1 bit per
+// tile). The level never changes during a game, so it is not part of the
+// snapshot.
+#define LEVEL_TILE_SHIFT 3
+#define LEVEL_VIEW_TILES (240 >> LEVEL_TILE_SHIFT)
+#define LEVEL_SLOTS 16
+#define LEVEL_PREFETCH_BYTES 128
+uint32_t level_rows[TILEMAP_WORDS(LEVEL_WORLD_WIDTH, LEVEL_WORLD_HEIGHT)];
+TileMap_cfg_t level_map = {
+    .width = LEVEL_WORLD_WIDTH,
+    .height = LEVEL_WORLD_HEIGHT,
+    .tile_shift = LEVEL_TILE_SHIFT,
+    .rows = level_rows,
+    .setup_done = 0
+};
+uint8_t level_slots[LEVEL_SLOTS][LEVELSTREAM_CHUNK_BYTES];
+LevelStream_cfg_t level_stream = {
+    .slots = level_slots,
+    .slot_count = LEVEL_SLOTS,
+    .budget = LEVEL_PREFETCH_BYTES,
+    .setup_done = 0
+};
+
+// The camera scrolls the 240x240 screen over the level, following the
+// Character once it leaves a 64x48 dead zone in the middle of the screen
+Camera_cfg_t camera = {
+    .view_w = 240,
+    .view_h = 240,
+    .dead_w = 64,
+    .dead_h = 48,
+    .smoothing_shift = 2,
+    .world_w = LEVEL_WORLD_WIDTH << LEVEL_TILE_SHIFT,
+    .world_h = LEVEL_WORLD_HEIGHT << LEVEL_TILE_SHIFT,
+    .setup_done = 0
+};
+
+// Hardware entropy, only for seeding. Gameplay randomness comes from a
+// generator in the snapshot state, so a retry replays it exactly.
+Random_cfg_t random_cfg = {
+    .rng = RNG,
+    .irqn = RNG_IRQn,
+    .setup_done = 0
+};
+Random_t game_rng;              // Seeded from the pool at each new game (picks the spawn point)
+
+// Single-player state snapshot in SRAM2: slot 0 is the retry point taken
+// when a game starts, slot 1 is scratch for the size/delta report
+#define PLAY_SNAPSHOT_SLOT_SIZE 1024
+enum { PLAY_SNAP_RETRY = 0, PLAY_SNAP_SCRATCH, PLAY_SNAP_SLOTS };
+const Snapshot_Region_t play_state[] = {
+    {&game_character, sizeof(game_character)},
+    {&game_timers, sizeof(game_timers)},
+    {&camera, sizeof(camera)},
+    {&game_rng, sizeof(game_rng)},
+};
+uint8_t play_snapshot_slots[PLAY_SNAP_SLOTS * PLAY_SNAPSHOT_SLOT_SIZE] SNAPSHOT_RAM2;
+Snapshot_cfg_t play_snapshot = {
+    .regions = play_state,
+    .region_count = sizeof(play_state) / sizeof(play_state[0]),
+    .slots = play_snapshot_slots,
+    .slot_size = PLAY_SNAPSHOT_SLOT_SIZE,
+    .slot_count = PLAY_SNAP_SLOTS,
+    .dma_channel = NULL,
+    .setup_done = 0
+};
+uint8_t play_retry_saved;       // 1 once a game has started (the retry slot holds a state)
+
+// AI agents (enemy FSMs) updated round-robin within a per-frame budget
+#define AI_MAX_AGENTS 16
+#define AI_BUDGET_US 2000
+AiSched_Agent_t ai_agents[AI_MAX_AGENTS];
+AiSched_cfg_t ai_sched = {
+    .agents = ai_agents,
+    .count = 0,
+    .capacity = AI_MAX_AGENTS,
+    .budget_us = AI_BUDGET_US,
+    .setup_done = 0
+};
+
+// ===== VERSUS (TWO BOARDS) =====
+// The simulated state is everything below, and nothing else: both boards
+// start it identically and advance it only from versus_simulate(), so the
+// Netcode module can snapshot, roll back and resimulate it.
+// Input byte: joystick direction in the low nibble, dash in bit 4.
+#define VERSUS_INPUT_DASH 0x10
+Character_t versus_players[NET_PLAYERS];
+TimerWheel_t versus_timers;     // Separate from game_timers: single-player state is not simulated
+
+const Snapshot_Region_t versus_state[] = {
+    {versus_players, sizeof(versus_players)},
+    {&versus_timers, sizeof(versus_timers)},
+};
+#define VERSUS_SNAPSHOT_SLOT_SIZE 1024
+uint8_t versus_snapshot_slots[NET_SNAPSHOTS * VERSUS_SNAPSHOT_SLOT_SIZE] SNAPSHOT_RAM2;
+Snapshot_cfg_t versus_snapshot = {
+    .regions = versus_state,
+    .region_count = sizeof(versus_state) / sizeof(versus_state[0]),
+    .slots = versus_snapshot_slots,
+    .slot_size = VERSUS_SNAPSHOT_SLOT_SIZE,
+    .slot_count = NET_SNAPSHOTS,
+    .dma_channel = NULL,
+    .setup_done = 0
+};
+
+void versus_simulate(const Net_Input_t inputs[NET_PLAYERS]);
+void versus_restart(void);
+
+Net_cfg_t net_cfg = {
+    .uart = USART3,
+    .irqn = USART3_IRQn,
+    .snapshot = &versus_snapshot,
+    .simulate = versus_simulate,
+    .restart = versus_restart,
+    .local_id = 0,              // Set from the chip's unique ID in main()
+    .setup_done = 0
+};
+
+// Dash press kept until a simulated frame has used it (Net_Tick may stall)
+uint8_t versus_dash = 0;
+
+// ===== BUTTON EVENTS =====
+// Set by the EXTI callback, taken once per frame by the main loop
+#define BUTTON_DASH   0x01  // BTN3 (PC3)
+#define BUTTON_PAUSE  0x02  // BTN2 (PC2)
+#define BUTTON_SELECT 0x04  // B1 user button (PC13)
+volatile uint8_t button_events = 0;
+
+// Buttons pressed since the previous frame (read by the scene updates)
+uint8_t frame_buttons = 0;
+
+// Set by the input task when there was input since the last logic frame
+uint8_t input_activity = 0;
+
+// Last debounce timestamp for each button
+volatile uint32_t button_last_interrupt_time[3] = {0};
 
 // Debounce delay in milliseconds - prevents multiple triggers from single button press
 #define DEBOUNCE_DELAY 200
 
+// Last rendered character state and camera position - the frame is only
+// redrawn when these change
+Character_t rendered_character;
+int32_t rendered_camera_x;
+int32_t rendered_camera_y;
+uint8_t render_needed = 1;
+
+// Height of the status text band at the top of the screen
+#define HUD_HEIGHT 24
+
+// The game view is drawn through a draw list: level regions at the back,
+// then sprites, then the HUD. Level regions are opaque, so anything they
+// cover completely is culled before it is drawn.
+#define DRAW_Z_LEVEL 0
+#define DRAW_Z_SPRITES 10
+#define DRAW_Z_HUD 20
+
+// The HUD label ("St:" and the state name) only changes with the state, so
+// it is drawn into its own surface then and stamped onto the screen (colour
+// 0 transparent) every frame
+#define HUD_LABEL_W 136
+#define HUD_LABEL_H 14
+uint8_t hud_label_pixels[LCD_SURFACE_BYTES(HUD_LABEL_W, HUD_LABEL_H)];
+LCD_Surface_t hud_label = {
+    HUD_LABEL_W, HUD_LABEL_H, LCD_SURFACE_STRIDE(HUD_LABEL_W), hud_label_pixels, NULL
+};
+uint8_t hud_label_state = 0xFF;     // State drawn in hud_label (0xFF: none yet)
+
+DrawList_Item_t game_draw_items[16];
+DrawList_cfg_t game_draw = {
+    .items = game_draw_items,
+    .capacity = 16,
+    .setup_done = 0
+};
+
 // ===== FUNCTION PROTOTYPES =====
-void update_character(Joystick_t* joy);
+void update_character(Joystick_t* joy, uint8_t dash_pressed);
+void character_effects(CharacterState_t state);
+void spawn_character(void);
 void render_game(void);
+void draw_level(int16_t x, int16_t y, int16_t w, int16_t h);
+uint8_t take_button_events(void);
+void button_work(uint32_t pin);
+#ifdef WCET_BENCH
+uint8_t wcet_run_profile(void);
+uint8_t wcet_run(void);
+#endif
 
 /**
- * @brief Get character state name
+ * @brief Take (read and clear) the button events collected by the EXTI callback
  */
-const char* get_char_state_name(CharacterState_t state) {
-    switch (state) {
-        case CHAR_IDLE:    return "IDLE";
-        case CHAR_WALKING: return "WALK";
-        case CHAR_DASHING: return "DASH";
-        default:           return "???";
-    }
+uint8_t take_button_events(void) {
+    __disable_irq();
+    uint8_t events = button_events;
+    button_events = 0;
+    __enable_irq();
+    return events;
 }
 
 // ===== Main Function =====
@@ -147,77 +590,692 @@ const char* get_char_state_name(CharacterState_t state) {
   */
 int main(void)
 {
+    // Paint the stack before anything uses it, and arm the overflow guard
+    StackMon_Init(&stack_mon);
+
     /* MCU Configuration */
     HAL_Init();
     SystemClock_Config();
     PeriphCommonClock_Config();
 
+    // Deferred interrupt work must be ready before any interrupt is enabled
+    WorkQueue_Init();
+
     /* Initialize peripherals */
     MX_GPIO_Init();
     MX_USART2_UART_Init();
     MX_ADC1_Init();  // Initialize ADC for joystick
+    MX_USART3_UART_Init();  // Link cable to a second board (versus mode)
+    MX_RNG_Init();          // Entropy for seeding (clocked from PLLSAI1)
+    Random_Init(&random_cfg);
+
+#ifdef FLOWFIELD_BENCH
+    // Pathfinding rebuild timings over UART (configure with -DFLOWFIELD_BENCH=ON)
+    FlowField_Bench();
+#endif
+#ifdef BT_BENCH
+    // Behaviour tree cycles per node type over UART (configure with -DBT_BENCH=ON)
+    BT_Bench();
+#endif
+#ifdef TILEMAP_BENCH
+    // Collision queries per frame over UART (configure with -DTILEMAP_BENCH=ON)
+    TileMap_Bench();
+#endif
+
+    // Frame pacing (sleep instead of busy-wait)
+    Power_Init(&power_cfg);
     
     // Initialize LCD first (this sets up GPIOB pins)
     LCD_init(&cfg0);
+    DrawList_Init(&game_draw);
 
     // Initialize TIM4 AFTER LCD to avoid GPIO conflict on PB6
     MX_TIM4_Init();
+
+    // Initialize TIM2 for the buzzer
+    MX_TIM2_Init();
+    buzzer_init(&buzzer_cfg);
   
-    // Initialize Joystick
+    // Initialize Joystick; its centre is calibrated once and kept in flash.
+    // Hold B1 during reset to calibrate again
+    KV_Init(&kv_store);
     Joystick_Init(&joystick_cfg);
+    uint16_t centre[2];
+    if (HAL_GPIO_ReadPin(B1_GPIO_Port, B1_Pin) != GPIO_PIN_RESET &&
+        KV_Get(&kv_store, KV_KEY_JOYSTICK_CENTRE, centre, sizeof(centre)) == sizeof(centre)) {
+        joystick_cfg.center_x = centre[0];
+        joystick_cfg.center_y = centre[1];
+    }
+    else {
+        Joystick_Calibrate(&joystick_cfg);
+        centre[0] = joystick_cfg.center_x;
+        centre[1] = joystick_cfg.center_y;
+        KV_Set(&kv_store, KV_KEY_JOYSTICK_CENTRE, centre, sizeof(centre));
+    }
     
-    // Initialize Character
-    Character_Init(&game_character);
-    
-    // make screen black
-    LCD_Fill_Buffer(0);
-    LCD_Refresh(&cfg0);
+    // Initialize game timers, the level and Character
+    TimerWheel_Init(&game_timers);
+    LevelStream_Init(&level_stream);
+    LevelStream_Load(&level_stream, &LEVEL_world, &level_map);
+    Character_SetMap(&game_character, &level_map);
+    game_character.trace_id = TRACE_ENTITY_PLAYER;
+    Character_Init(&game_character, &game_timers);
+    AiSched_Init(&ai_sched);
 
-    // Startup animation
-    LCD_printString("Character",  15, 50, 1, 4);
-    LCD_Refresh(&cfg0);
-    HAL_Delay(500);
-    
-    LCD_Fill_Buffer(0);
-    LCD_printString("FSM+Dash",  30, 50, 1, 4);
-    LCD_Refresh(&cfg0);
-    HAL_Delay(500);
+    Snapshot_Init(&play_snapshot);
 
-    // Display instructions
-    LCD_Fill_Buffer(0);
-    LCD_printString("Move Joystk", 10, 30, 1, 2);
-    LCD_printString("Press Btn", 10, 60, 1, 2);
-    LCD_printString("to", 70, 85, 1, 2);
-    LCD_printString("DASH!", 45, 110, 1, 3);
-    LCD_Refresh(&cfg0);
-    HAL_Delay(2000);
+    // Link to a second board; the unique ID decides which board is player 1
+    Snapshot_Init(&versus_snapshot);
+    net_cfg.local_id = HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2();
+    Net_Init(&net_cfg);
 
     // Initialize PWM for LED control
     PWM_Init(&pwm_cfg);
     PWM_SetFreq(&pwm_cfg, 1000);
     PWM_SetDuty(&pwm_cfg, 0);
+
+    // LED effects run from DMA, the main loop only changes pattern on state changes
+    PWM_FX_Init(&pwm_fx_cfg);
+    PWM_FX_Start(&pwm_fx_cfg, &led_fx_idle);
+
+    // Clock scaling starts at the full 80 MHz set by SystemClock_Config
+    ClockGov_Init(&clock_gov);
+
+#ifdef WCET_BENCH
+    // Worst case of the update and render paths against the frame budget, at
+    // every clock profile (configure with -DWCET_BENCH=ON). A build that misses
+    // the budget stops here, so it cannot be mistaken for one that passed
+    if (!wcet_run()) {
+        Error_Handler();
+    }
+#endif
     
+#ifdef IRQ_LATENCY
+    // Latency probes, once every interrupt priority is set (configure with -DIRQ_LATENCY=ON)
+    IrqLat_Init(&irq_lat);
+#endif
+
     // Ensure LD2 on PA5 starts OFF
     HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET);
 
     printf("Character FSM Demo initialized.\n");
 
+    // Boot splash, menu and game all run from the scene manager
+#ifdef FSM_TRACE
+    Trace_Init();
+#endif
+    Scene_Init(&scene_mgr, SCENE_BOOT);
+
+    // Everything from here on runs as scheduled tasks
+    Sched_Init(&sched);
     while (1)
     {
-        // ===== CHARACTER FSM MAIN LOOP =====
-        // Simply update and render the character
-        
-        // Read joystick input
-        Joystick_Read(&joystick_cfg, &joystick_data);
-        
-        // Update character FSM (logic only)
-        update_character(&joystick_data);
-        
-        // Render everything to screen
+        Sched_RunOnce(&sched);
+    }
+}
+
+// ===== TASK FUNCTIONS =====
+
+/**
+ * @brief Input task: sample the joystick, collect button events, track activity
+ */
+void input_task(void) {
+    Joystick_Read(&joystick_cfg, &joystick_data);
+    frame_buttons |= take_button_events();
+
+    // Any input (or a dash still running) keeps the system at full speed.
+    // Reported from the logic task: this task also runs inside LCD_Refresh,
+    // where a clock change would disturb the SPI transfer
+    if (frame_buttons || joystick_data.direction != CENTRE ||
+        (Scene_Current(&scene_mgr) == SCENE_PLAY && game_character.state != CHAR_IDLE) ||
+        Scene_Current(&scene_mgr) == SCENE_VERSUS) {
+        input_activity = 1;
+    }
+}
+
+/**
+ * @brief Audio task: advance any sound effect that is playing
+ */
+void audio_task(void) {
+    buzzer_tune_update(&buzzer_cfg, &sfx_tune);
+}
+
+/**
+ * @brief Logic task: scene transitions and game logic, then clock scaling
+ */
+void logic_task(void) {
+    if (input_activity) {
+        input_activity = 0;
+        Power_ReportActivity(&power_cfg);
+    }
+
+    if (Scene_Update(&scene_mgr)) {
+        printf("Scene: %s\n", Scene_Name(&scene_mgr));
+    }
+
+    // Button events are consumed once per logic frame
+    frame_buttons = 0;
+
+    // Pick the slowest clock that still fits the work of the last frame;
+    // a missed deadline counts as a full frame of load
+    uint32_t period_us = tasks[TASK_LOGIC].period_ms * 1000;
+    uint32_t busy_us = Sched_TakeBusyUs(&sched);
+    if (Sched_TakeMisses(&sched)) {
+        busy_us = period_us;
+    }
+    if (!Power_IsLowPower(&power_cfg)) {
+        ClockGov_Update(&clock_gov, busy_us, period_us);
+    }
+}
+
+/**
+ * @brief Render task: static scenes only draw when their content changed
+ */
+void render_task(void) {
+    Scene_Render(&scene_mgr);
+}
+
+/**
+ * @brief Log task: duty cycle, clock and per-task statistics once per second
+ */
+void log_task(void) {
+    Power_Stats_t power_stats;
+    Power_GetStats(&power_stats);
+    printf("Power: active %u.%u%% at %lu MHz, %lu frames (%lu late)%s\n",
+           power_stats.active_permille / 10, power_stats.active_permille % 10,
+           (unsigned long)(ClockGov_GetSysclkHz(&clock_gov) / 1000000),
+           (unsigned long)power_stats.frames, (unsigned long)power_stats.overruns,
+           Power_IsLowPower(&power_cfg) ? " [low-power run]" : "");
+
+    // The UART is blocking: let input and audio run between lines
+    Sched_Yield(&sched, tasks[TASK_AUDIO].priority);
+
+    // Deadline misses / longest run time (us) per task over the last second
+    printf("Tasks:");
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        printf(" %s %lu/%lu", tasks[i].name,
+               (unsigned long)tasks[i].misses, (unsigned long)tasks[i].max_run_us);
+    }
+    printf("\n");
+    Sched_ResetStats(&sched);
+
+    // Stack: peak of everything together, each task's peak ('+' = used its
+    // whole window, so at least this much; STACKMON_TASKS builds only) and the
+    // depth at which each interrupt started. All in bytes below the top of RAM.
+    uint32_t stack_cycles = DWT->CYCCNT;
+    uint32_t stack_peak = StackMon_Peak(&stack_mon);
+    stack_cycles = DWT->CYCCNT - stack_cycles;
+    printf("Stack: peak %lu of %lu bytes (boot %lu), %u nested IRQs, scan %lu us\n",
+           (unsigned long)stack_peak, (unsigned long)StackMon_Size(&stack_mon),
+           (unsigned long)stack_mon.boot_depth, stack_mon.max_nesting,
+           (unsigned long)(stack_cycles / (SystemCoreClock / 1000000u)));
+#ifdef STACKMON_TASKS
+    printf("Stack tasks:");
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        printf(" %s %lu%s", tasks[i].name, (unsigned long)stack_tasks[i].max_depth,
+               stack_tasks[i].saturated ? "+" : "");
+    }
+    printf("\n");
+#endif
+    printf("Stack IRQs:");
+    for (uint8_t i = 0; i < IRQ_ID_COUNT; i++) {
+        printf(" %s %lu", stack_isrs[i].name, (unsigned long)stack_isrs[i].max_depth);
+    }
+    printf("\n");
+    Sched_Yield(&sched, tasks[TASK_AUDIO].priority);
+
+    // Game view draw list: items per outcome, and overdraw as pixels written
+    // per screen pixel that changed (1.00 = each written once)
+    const DrawList_Stats_t* draw = &game_draw.stats;
+    uint32_t overdraw = draw->pixels_covered ? draw->pixels_drawn * 100 / draw->pixels_covered : 100;
+    printf("Draw: %lu frames, %lu items: %lu drawn, %lu off-screen, %lu occluded, %lu dropped; "
+           "overdraw %lu.%02lu, %lu px culled\n",
+           (unsigned long)draw->frames, (unsigned long)draw->submitted, (unsigned long)draw->drawn,
+           (unsigned long)draw->offscreen, (unsigned long)draw->occluded, (unsigned long)draw->dropped,
+           (unsigned long)(overdraw / 100), (unsigned long)(overdraw % 100),
+           (unsigned long)draw->pixels_culled);
+    DrawList_ResetStats(&game_draw);
+
+#ifdef FSM_TRACE
+    // Recent state machine transitions, requested by pausing the game
+    // (decode the captured log with tools/trace_decode.py)
+    if (trace_dump_pending) {
+        trace_dump_pending = 0;
+        Trace_Dump(log_yield);
+    }
+#endif
+
+#ifdef IRQ_LATENCY
+    // Interrupt latency per priority level and handler run times over the
+    // last second, in cycles (see INTERRUPT_PRIORITIES.md)
+    IrqLat_Print(&irq_lat, log_yield);
+    IrqLat_Reset(&irq_lat);
+#endif
+
+    // Deferred interrupt work: queue pressure and worst post-to-run latency
+    {
+        WorkQueue_Stats_t wq_stats;
+        WorkQueue_GetStats(&wq_stats, 1);
+        printf("WorkQ: %lu run, %lu dropped, max depth %lu, max latency %lu us\n",
+               (unsigned long)wq_stats.run, (unsigned long)wq_stats.dropped,
+               (unsigned long)wq_stats.max_depth, (unsigned long)wq_stats.max_latency_us);
+    }
+
+    printf("Timers: %lu active, %lu expired, %lu cascaded, max %u per tick\n",
+           (unsigned long)game_timers.active, (unsigned long)game_timers.expired,
+           (unsigned long)game_timers.cascaded, game_timers.max_expired_per_tick);
+
+    {
+        AiSched_Stats_t ai_stats;
+        AiSched_GetStats(&ai_sched, &ai_stats, 1);
+        printf("AI: %u agents, %lu updates, %lu deferred, %lu overruns, max %lu us, max staleness %lu\n",
+               ai_sched.count, (unsigned long)ai_stats.updates, (unsigned long)ai_stats.deferred,
+               (unsigned long)ai_stats.overruns, (unsigned long)ai_stats.max_used_us,
+               (unsigned long)ai_stats.max_staleness);
+    }
+
+    {
+        KV_Stats_t kv_stats;
+        KV_GetStats(&kv_store, &kv_stats, 1);
+        printf("KV: index built in %lu us, %lu records, %lu erases, %lu errors, max step %lu cycles\n",
+               (unsigned long)(kv_stats.index_build_cycles / (SystemCoreClock / 1000000u)),
+               (unsigned long)kv_stats.records_written, (unsigned long)kv_stats.erases,
+               (unsigned long)kv_stats.flash_errors, (unsigned long)kv_stats.max_service_cycles);
+    }
+
+    // Level streaming: decompression throughput and chunks that were late
+    {
+        LevelStream_Stats_t level_stats;
+        LevelStream_GetStats(&level_stream, &level_stats, 1);
+        if (level_stats.cycles) {
+            printf("Level: %lu chunks loaded, %lu stalls, %lu bytes at %lu KB/s, max update %lu us, load %lu us\n",
+                   (unsigned long)level_stats.chunks_loaded, (unsigned long)level_stats.stalls,
+                   (unsigned long)level_stats.bytes,
+                   (unsigned long)((uint64_t)level_stats.bytes * SystemCoreClock / level_stats.cycles / 1024u),
+                   (unsigned long)(level_stats.max_update_cycles / (SystemCoreClock / 1000000u)),
+                   (unsigned long)(level_stats.load_cycles / (SystemCoreClock / 1000000u)));
+        }
+    }
+
+    // Game state snapshot: size, worst save/restore time, and how many bytes
+    // a delta against the retry point takes now (once a game has saved one)
+    if (play_retry_saved) {
+        Snapshot_Stats_t snap_stats;
+        Snapshot_GetStats(&play_snapshot, &snap_stats, 1);
+        Snapshot_Save(&play_snapshot, PLAY_SNAP_SCRATCH);
+        static uint8_t delta[PLAY_SNAPSHOT_SLOT_SIZE];
+        uint16_t delta_bytes = Snapshot_DeltaEncode(&play_snapshot, PLAY_SNAP_SCRATCH, PLAY_SNAP_RETRY,
+                                                    delta, sizeof(delta));
+        // Leave this save out of the next report: only the game's own count
+        Snapshot_Stats_t scratch_stats;
+        Snapshot_GetStats(&play_snapshot, &scratch_stats, 1);
+        printf("Snapshot: %u bytes, save %lu cycles, restore %lu cycles, delta %u bytes\n",
+               Snapshot_Size(&play_snapshot), (unsigned long)snap_stats.max_save_cycles,
+               (unsigned long)snap_stats.max_restore_cycles, delta_bytes);
+    }
+
+    if (net_cfg.state != NET_IDLE) {
+        Net_Stats_t net_stats;
+        Net_GetStats(&net_cfg, &net_stats, 1);
+        printf("Net: frame %lu, rx %lu tx %lu bad %lu, %lu stalls, %lu rollbacks (max %lu), %lu/%lu desyncs\n",
+               (unsigned long)net_cfg.frame, (unsigned long)net_stats.packets_rx,
+               (unsigned long)net_stats.packets_tx, (unsigned long)net_stats.bad_packets,
+               (unsigned long)net_stats.stalls, (unsigned long)net_stats.rollbacks,
+               (unsigned long)net_stats.max_rollback, (unsigned long)net_stats.desyncs,
+               (unsigned long)net_stats.checks);
+
+#ifdef NET_BENCH
+        // Worst-case rollback cost, measured on the live state (configure with -DNET_BENCH=ON)
+        uint32_t cycles = Net_MeasureResim(&net_cfg, NET_MAX_ROLLBACK);
+        if (cycles) {
+            printf("Net: %u-frame resim %lu cycles (%lu us)\n", NET_MAX_ROLLBACK, (unsigned long)cycles,
+                   (unsigned long)(cycles / (SystemCoreClock / 1000000u)));
+        }
+#endif
+        printf("Net: longest rollback %lu cycles\n", (unsigned long)net_stats.max_resim_cycles);
+    }
+}
+
+/**
+ * @brief Storage task: at most one flash program or erase step per run
+ *
+ * Flash cannot be programmed or erased in low-power run, so writes wait
+ * there (they stay queued in RAM).
+ */
+void storage_task(void) {
+    if (!Power_IsLowPower(&power_cfg)) {
+        KV_Service(&kv_store);
+    }
+}
+
+/**
+ * @brief Power hook: stay at full speed until the flash store has finished
+ */
+uint8_t power_busy(void) {
+    return KV_IsBusy(&kv_store);
+}
+
+/**
+ * @brief Scheduler idle hook: sleep until the next task release
+ */
+void sched_idle(uint32_t sleep_us) {
+    Power_Idle(&power_cfg, sleep_us);
+}
+
+/**
+ * @brief Scheduler hooks around each task run: per-task stack marks (with
+ *        STACKMON_TASKS), and frame counts for the power report (a frame
+ *        ends with its render)
+ */
+#ifdef STACKMON_TASKS
+void sched_task_begin(uint8_t task) {
+    StackMon_TaskBegin(&stack_mon, task);
+}
+#endif
+
+void sched_task_end(uint8_t task, uint8_t missed) {
+#ifdef STACKMON_TASKS
+    StackMon_TaskEnd(&stack_mon, task);
+#endif
+    if (task == TASK_RENDER) {
+        Power_CountFrame(missed);
+    }
+}
+
+/**
+ * @brief Log task hook between UART lines: let input and audio run
+ */
+void log_yield(void) {
+    Sched_Yield(&sched, tasks[TASK_AUDIO].priority);
+}
+
+/**
+ * @brief LCD DMA wait hook: run urgent tasks (input, audio) while a row is sent
+ *
+ * Game logic is not allowed here so the frame being drawn stays consistent.
+ */
+void lcd_wait_hook(void) {
+    Sched_Yield(&sched, tasks[TASK_AUDIO].priority);
+}
+
+// ===== SCENES =====
+
+/**
+ * @brief Boot: two splash screens, BOOT_SPLASH_MS each, with the startup jingle
+ */
+void boot_enter(void) {
+    boot_stage = 0;
+    boot_display_test = (HAL_GPIO_ReadPin(BTN3_GPIO_Port, BTN3_Pin) == GPIO_PIN_RESET);
+    Random_Seed(&boot_test_rng, BOOT_TEST_SEED);
+
+    // Startup jingle plays in the background while the splash is shown
+    buzzer_tune_start(&buzzer_cfg, &sfx_tune, tune_startup, 30, 0);
+}
+
+void boot_update(void) {
+    uint32_t t = Scene_TimeInScene(&scene_mgr);
+
+    if (t >= 2 * BOOT_SPLASH_MS) {
+        Scene_Request(&scene_mgr, SCENE_MENU);
+    }
+    else if (t >= BOOT_SPLASH_MS && boot_stage == 0) {
+        boot_stage = 1;
+        Scene_Invalidate(&scene_mgr);
+    }
+}
+
+void boot_render(void) {
+    LCD_Fill_Buffer(0);
+    if (boot_stage == 0 && boot_display_test) {
+        LCD_randomiseBuffer(Random_NextCtx, &boot_test_rng);
+    }
+    else if (boot_stage == 0) {
+        LCD_printString("Character",  15, 50, 1, 4);
+    }
+    else {
+        LCD_printString("FSM+Dash",  30, 50, 1, 4);
+    }
+    LCD_Refresh(&cfg0);
+}
+
+/**
+ * @brief Menu: instructions, B1 starts a versus game, BTN2/BTN3 a single-player game
+ */
+void menu_update(void) {
+    if (frame_buttons & BUTTON_SELECT) {
+        Scene_Request(&scene_mgr, SCENE_VERSUS);
+    }
+    else if (frame_buttons) {
+        Scene_Request(&scene_mgr, SCENE_PLAY);
+    }
+}
+
+void menu_render(void) {
+    LCD_Fill_Buffer(0);
+    LCD_printString("Move Joystk", 10, 30, 1, 2);
+    LCD_printString("Press Btn", 10, 60, 1, 2);
+    LCD_printString("to", 70, 85, 1, 2);
+    LCD_printString("DASH!", 45, 110, 1, 3);
+    LCD_printString("BTN2/3: start", 10, 170, 1, 2);
+    LCD_printString("B1: versus", 10, 200, 1, 2);
+    LCD_Refresh(&cfg0);
+}
+
+/**
+ * @brief Play: the character FSM. BTN2 pauses.
+ */
+void play_enter(void) {
+    // A new game unless we are resuming from pause
+    if (Scene_Previous(&scene_mgr) != SCENE_PAUSE) {
+        Random_SeedFromPool(&random_cfg, &game_rng);
+        Character_Init(&game_character, &game_timers);
+        spawn_character();
+        Camera_Init(&camera, game_character.x, game_character.y);
+        Snapshot_Save(&play_snapshot, PLAY_SNAP_RETRY);
+        play_retry_saved = 1;
+    }
+    LevelStream_Update(&level_stream, camera.x >> LEVEL_TILE_SHIFT, camera.y >> LEVEL_TILE_SHIFT,
+                       LEVEL_VIEW_TILES + 1, LEVEL_VIEW_TILES + 1);
+    PWM_FX_Start(&pwm_fx_cfg, CHAR_STATES[game_character.state].led);
+
+    // The pause overlay (or the previous scene) is on screen: redraw everything
+    render_needed = 1;
+}
+
+void play_update(void) {
+    if (frame_buttons & BUTTON_PAUSE) {
+        Scene_Request(&scene_mgr, SCENE_PAUSE);
+        return;
+    }
+
+    // Advance game time: expired timers feed the character FSM before it updates
+    TimerWheel_Tick(&game_timers);
+
+    // Update character FSM (logic only)
+    update_character(&joystick_data, (frame_buttons & BUTTON_DASH) ? 1 : 0);
+
+    // Scroll after the character, then cull it (an off-screen character
+    // neither draws nor animates)
+    Camera_Follow(&camera, game_character.x, game_character.y);
+    Character_Cull(&game_character, &camera);
+
+    // Decompress the level chunks in and ahead of the view. The view covers
+    // one more tile than fits the screen when it is not tile-aligned.
+    LevelStream_Update(&level_stream, camera.x >> LEVEL_TILE_SHIFT, camera.y >> LEVEL_TILE_SHIFT,
+                       LEVEL_VIEW_TILES + 1, LEVEL_VIEW_TILES + 1);
+
+    // Update AI agents after the character, so they react to where it is now
+    AiSched_Run(&ai_sched);
+}
+
+void play_render(void) {
+    // Render only when something visible changed
+    if (render_needed ||
+        camera.x != rendered_camera_x ||
+        camera.y != rendered_camera_y ||
+        game_character.x != rendered_character.x ||
+        game_character.y != rendered_character.y ||
+        game_character.state != rendered_character.state ||
+        game_character.animation_frame != rendered_character.animation_frame) {
         render_game();
-        
-        // Small delay to prevent overwhelming the LCD
-        HAL_Delay(30);
+        rendered_character = game_character;
+        rendered_camera_x = camera.x;
+        rendered_camera_y = camera.y;
+        render_needed = 0;
+    }
+}
+
+/**
+ * @brief Pause: overlay on the frozen game. BTN2 resumes, B1 retries, BTN3 ends the game.
+ */
+void pause_enter(void) {
+    buzzer_tune_stop(&buzzer_cfg, &sfx_tune);
+    PWM_FX_Start(&pwm_fx_cfg, &led_fx_idle);
+#ifdef FSM_TRACE
+    // Something odd just happened? The log task dumps the recent transitions
+    trace_dump_pending = 1;
+#endif
+}
+
+void pause_update(void) {
+    if (frame_buttons & BUTTON_PAUSE) {
+        Scene_Request(&scene_mgr, SCENE_PLAY);
+    }
+    else if (frame_buttons & BUTTON_SELECT) {
+        // Instant retry: put the whole game state back as it was at the start
+        Snapshot_Restore(&play_snapshot, PLAY_SNAP_RETRY);
+        Scene_Request(&scene_mgr, SCENE_PLAY);
+    }
+    else if (frame_buttons & BUTTON_DASH) {
+        Scene_Request(&scene_mgr, SCENE_GAME_OVER);
+    }
+}
+
+void pause_render(void) {
+    // Draw over the last game frame: only the rows under the box are sent to the LCD
+    LCD_Draw_Rect(40, 90, 160, 60, 0, 1);
+    LCD_Draw_Rect(40, 90, 160, 60, 1, 0);
+    LCD_printString("PAUSED", 66, 100, 1, 3);
+    LCD_printString("B1: retry  BTN3: quit", 57, 132, 1, 1);
+    LCD_Refresh(&cfg0);
+}
+
+/**
+ * @brief Game over: waits for any button, then back to the menu
+ */
+void game_over_enter(void) {
+    PWM_FX_Start(&pwm_fx_cfg, &led_fx_game_over);
+}
+
+void game_over_update(void) {
+    if (frame_buttons) {
+        Scene_Request(&scene_mgr, SCENE_MENU);
+    }
+}
+
+void game_over_render(void) {
+    LCD_Fill_Buffer(0);
+    LCD_printString("GAME", 72, 60, 1, 4);
+    LCD_printString("OVER", 72, 100, 1, 4);
+    LCD_printString("Any btn: menu", 15, 180, 1, 2);
+    LCD_Refresh(&cfg0);
+}
+
+/**
+ * @brief Versus: two boards over the link cable, one character each. BTN2 leaves.
+ */
+void versus_enter(void) {
+    versus_dash = 0;
+    PWM_FX_Start(&pwm_fx_cfg, &led_fx_idle);
+    Net_Start(&net_cfg);     // calls versus_restart()
+}
+
+/**
+ * @brief Versus start state, identical on both boards (Netcode calls this
+ *        whenever a session starts, including after the other board restarted)
+ */
+void versus_restart(void) {
+    // Characters first: Character_Init cancels their timers in the old wheel
+    // before the wheel is cleared
+    for (uint8_t p = 0; p < NET_PLAYERS; p++) {
+        Character_Init(&versus_players[p], &versus_timers);
+        versus_players[p].trace_id = TRACE_ENTITY_VERSUS_0 + p;
+    }
+    TimerWheel_Init(&versus_timers);
+    versus_players[0].x = 80;
+    versus_players[1].x = 160;
+}
+
+void versus_update(void) {
+    if (frame_buttons & BUTTON_PAUSE) {
+        Net_Stop(&net_cfg);
+        Scene_Request(&scene_mgr, SCENE_MENU);
+        return;
+    }
+
+    if (frame_buttons & BUTTON_DASH) {
+        versus_dash = 1;
+    }
+    Net_Input_t input = (Net_Input_t)(joystick_data.direction & 0x0F);
+    if (versus_dash) {
+        input |= VERSUS_INPUT_DASH;
+    }
+
+    // Sound and LED are not part of the simulation: they follow the local
+    // player's state from outside, so a rollback never replays them
+    Character_t* me = &versus_players[net_cfg.local_player];
+    CharacterState_t previous_state = me->state;
+
+    if (Net_Tick(&net_cfg, input)) {
+        versus_dash = 0;
+    }
+
+    if (net_cfg.state == NET_RUNNING && me->state != previous_state) {
+        character_effects(me->state);
+    }
+}
+
+void versus_render(void) {
+    char line[32];
+
+    LCD_Fill_Buffer(0);
+    if (net_cfg.state != NET_RUNNING) {
+        LCD_printString("Waiting for", 30, 90, 1, 2);
+        LCD_printString("link cable", 35, 120, 1, 2);
+        LCD_printString("BTN2: menu", 40, 180, 1, 2);
+        LCD_Refresh(&cfg0);
+        return;
+    }
+
+    for (uint8_t p = 0; p < NET_PLAYERS; p++) {
+        Character_Draw(&versus_players[p], NULL);
+    }
+
+    sprintf(line, "You: P%u", net_cfg.local_player + 1);
+    LCD_printString(line, 10, 5, 1, 2);
+    if (!Net_IsConnected(&net_cfg)) {
+        LCD_printString("Link lost", 120, 5, 1, 2);
+    }
+    else {
+        sprintf(line, "Rb:%lu", (unsigned long)net_cfg.stats.rollbacks);
+        LCD_printString(line, 140, 5, 1, 2);
+    }
+    LCD_Refresh(&cfg0);
+}
+
+/**
+ * @brief Advance the versus game one frame (called by Netcode, also when resimulating)
+ *
+ * Must be deterministic and free of side effects: only the integer character
+ * and timer state changes, from the inputs alone.
+ */
+void versus_simulate(const Net_Input_t inputs[NET_PLAYERS]) {
+    TimerWheel_Tick(&versus_timers);
+
+    for (uint8_t p = 0; p < NET_PLAYERS; p++) {
+        Joystick_t joy = {0};
+        joy.direction = (Direction)(inputs[p] & 0x0F);
+        Character_Update(&versus_players[p], &joy, (inputs[p] & VERSUS_INPUT_DASH) ? 1 : 0);
     }
 }
 
@@ -233,20 +1291,122 @@ int main(void)
  * 
  * Separated from rendering for cleaner code architecture.
  */
-void update_character(Joystick_t* joy) {
-    // Check if dash was pressed and clear the flag
-    uint8_t dash_pressed = dash_button_pressed;
-    dash_button_pressed = 0;
-    
+void update_character(Joystick_t* joy, uint8_t dash_pressed) {
+    CharacterState_t previous_state = game_character.state;
+
     // Update character FSM with current input
     Character_Update(&game_character, joy, dash_pressed);
+
+    if (game_character.state != previous_state) {
+        character_effects(game_character.state);
+    }
+}
+
+/**
+ * @brief Start the character at a random clear spot of the level
+ *
+ * Draws from game_rng after it is seeded for a new game; the retry snapshot
+ * is taken afterwards, so a retry starts from the same spot. If no try is
+ * clear the character keeps the position Character_Init() gave it.
+ */
+#define SPAWN_TRIES 16
+void spawn_character(void) {
+    const uint32_t world_w = LEVEL_WORLD_WIDTH << LEVEL_TILE_SHIFT;
+    const uint32_t world_h = LEVEL_WORLD_HEIGHT << LEVEL_TILE_SHIFT;
+
+    for (uint8_t i = 0; i < SPAWN_TRIES; i++) {
+        TileMap_Box_t box = {
+            .x = (int32_t)Random_Below(&game_rng, world_w - CHAR_HITBOX_W + 1),
+            .y = (int32_t)Random_Below(&game_rng, world_h - CHAR_HITBOX_H + 1),
+            .w = CHAR_HITBOX_W,
+            .h = CHAR_HITBOX_H
+        };
+        if (!TileMap_BoxHits(&level_map, &box)) {
+            game_character.x = box.x + CHAR_HITBOX_W / 2;
+            game_character.y = box.y + CHAR_HITBOX_H / 2;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief LED and sound for a character entering a new state
+ */
+void character_effects(CharacterState_t state) {
+    const CharacterStateInfo_t* info = &CHAR_STATES[state];
+
+    // Switch LED effect (DMA keeps it running without further CPU work)
+    PWM_FX_Start(&pwm_fx_cfg, info->led);
+
+    // Play the state's sound effect on entry (the dash sound for DASHING)
+    if (info->sound) {
+        buzzer_tune_start(&buzzer_cfg, &sfx_tune, info->sound, 30, 0);
+    }
+}
+
+/**
+ * @brief Draw the level into a rectangle of the screen (clipped to the screen)
+ *
+ * The rectangle is cleared, then each run of same-coloured tiles along a
+ * row is one filled rectangle, cut to the area being drawn.
+ */
+void draw_level(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > 240) { w = 240 - x; }
+    if (y + h > 240) { h = 240 - y; }
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    if (w == 240 && h == 240) {
+        LCD_Fill_Buffer(0);
+    }
+    else {
+        LCD_Draw_Rect(x, y, w, h, 0, 1);
+    }
+
+    // The tiles under the rectangle, in world tile coordinates
+    int16_t tile = 1 << LEVEL_TILE_SHIFT;
+    int16_t tx0 = (camera.x + x) >> LEVEL_TILE_SHIFT;
+    int16_t tx1 = (camera.x + x + w - 1) >> LEVEL_TILE_SHIFT;
+    int16_t ty0 = (camera.y + y) >> LEVEL_TILE_SHIFT;
+    int16_t ty1 = (camera.y + y + h - 1) >> LEVEL_TILE_SHIFT;
+
+    for (int16_t ty = ty0; ty <= ty1; ty++) {
+        int16_t top = (ty << LEVEL_TILE_SHIFT) - camera.y;
+        int16_t bottom = top + tile;
+        if (top < y) { top = y; }
+        if (bottom > y + h) { bottom = y + h; }
+
+        int16_t tx = tx0;
+        while (tx <= tx1) {
+            uint8_t colour = LEVELSTREAM_TILE_COLOUR(LevelStream_Tile(&level_stream, tx, ty));
+            int16_t run = 1;
+            while (tx + run <= tx1 &&
+                   LEVELSTREAM_TILE_COLOUR(LevelStream_Tile(&level_stream, tx + run, ty)) == colour) {
+                run++;
+            }
+            if (colour) {
+                int16_t left = (tx << LEVEL_TILE_SHIFT) - camera.x;
+                int16_t right = left + run * tile;
+                if (left < x) { left = x; }
+                if (right > x + w) { right = x + w; }
+                LCD_Draw_Rect(left, top, right - left, bottom - top, colour, 1);
+            }
+            tx += run;
+        }
+    }
 }
 
 /**
  * @brief Render the game to the LCD screen
  * 
  * This function handles all rendering/drawing:
- * - Clears the screen buffer
+ * - Scrolls the level already in the screen buffer by the camera movement
+ *   and draws only the strips that scrolled into view (everything after a
+ *   scene change or a jump of a whole screen)
+ * - Puts the level back under the old sprite and status text
  * - Draws character sprite
  * - Draws debug information (state, position)
  * - Refreshes LCD to display the frame
@@ -254,50 +1414,391 @@ void update_character(Joystick_t* joy) {
  * Separated from game logic for cleaner code architecture.
  */
 void render_game(void) {
-    // Clear screen buffer
-    LCD_Fill_Buffer(0);
-    
-    // Draw character at current position with animation
-    Character_Draw(&game_character);
+    int32_t dx = camera.x - rendered_camera_x;
+    int32_t dy = camera.y - rendered_camera_y;
+
+    DrawList_Begin(&game_draw);
+    if (render_needed || dx <= -240 || dx >= 240 || dy <= -240 || dy >= 240) {
+        DrawList_Callback(&game_draw, DRAW_Z_LEVEL, 0, 0, 240, 240, 1, draw_level);
+    }
+    else {
+        if (dx || dy) {
+            // The camera moved right/down, so the picture moves left/up
+            LCD_Shift_Buffer(-dx, -dy);
+            if (dx > 0) {
+                DrawList_Callback(&game_draw, DRAW_Z_LEVEL, 240 - dx, 0, dx, 240, 1, draw_level);
+            }
+            else if (dx < 0) {
+                DrawList_Callback(&game_draw, DRAW_Z_LEVEL, 0, 0, -dx, 240, 1, draw_level);
+            }
+            if (dy > 0) {
+                DrawList_Callback(&game_draw, DRAW_Z_LEVEL, 0, 240 - dy, 240, dy, 1, draw_level);
+            }
+            else if (dy < 0) {
+                DrawList_Callback(&game_draw, DRAW_Z_LEVEL, 0, 0, 240, -dy, 1, draw_level);
+            }
+        }
+
+        // Erase the old sprite and status text (moved with the level)
+        DrawList_Callback(&game_draw, DRAW_Z_LEVEL, rendered_character.x - 16 - camera.x,
+                          rendered_character.y - 16 - camera.y, 32, 32, 1, draw_level);
+        DrawList_Callback(&game_draw, DRAW_Z_LEVEL, 0, -dy, 240, HUD_HEIGHT, 1, draw_level);
+        DrawList_Callback(&game_draw, DRAW_Z_LEVEL, 0, 0, 240, HUD_HEIGHT, 1, draw_level);
+    }
     
-    // Draw debug info
-    LCD_printString("St:", 10, 5, 1, 2);
-    LCD_printString((char*)get_char_state_name(game_character.state), 60, 5, 1, 2);
+    // Character at current position with animation
+    Character_Submit(&game_character, &camera, &game_draw, DRAW_Z_SPRITES);
     
+    // Debug info
+    if (hud_label_state != game_character.state) {
+        LCD_Set_Target(&hud_label);
+        LCD_Fill_Buffer(0);
+        LCD_printString("St:", 0, 0, 1, 2);
+        LCD_printString(CHAR_STATES[game_character.state].name, 50, 0, 1, 2);
+        LCD_Set_Target(NULL);
+        hud_label_state = game_character.state;
+    }
+    DrawList_Blit(&game_draw, DRAW_Z_HUD, 10, 5, &hud_label, 0);
+
     char pos_str[24];
-    sprintf(pos_str, "X:%d Y:%d", game_character.x, game_character.y);
-    LCD_printString(pos_str, 120, 5, 1, 2);
+    sprintf(pos_str, "X:%ld Y:%ld", (long)game_character.x, (long)game_character.y);
+    DrawList_Text(&game_draw, DRAW_Z_HUD, 120, 5, pos_str, 1, 2);
     
-    // Refresh LCD to display this frame
+    // Draw back to front, then refresh LCD to display this frame
+    DrawList_Flush(&game_draw);
     LCD_Refresh(&cfg0);
 }
 
+/**
+ * @brief Called by the Power module after every system clock change
+ *
+ * The UART baud rates depend on the bus clock, so both UARTs are re-initialised.
+ * The LED effect and buzzer timers are clocked 40x slower in low-power run,
+ * so they are stopped there and the LED effect restarted on the way out.
+ */
+void power_clocks_changed(void) {
+    MX_USART2_UART_Init();
+    MX_USART3_UART_Init();
+    Net_Attach(&net_cfg);
+
+    // Slower input/logic/render rate in low-power run
+    uint16_t frame_ms = Power_IsLowPower(&power_cfg) ? power_cfg.idle_frame_period_ms
+                                                      : power_cfg.frame_period_ms;
+    Sched_SetPeriod(&sched, TASK_INPUT, frame_ms / 3, frame_ms / 3);
+    Sched_SetPeriod(&sched, TASK_LOGIC, frame_ms, frame_ms / 2);
+    Sched_SetPeriod(&sched, TASK_RENDER, frame_ms, frame_ms);
+
+    if (Power_IsLowPower(&power_cfg)) {
+        buzzer_tune_stop(&buzzer_cfg, &sfx_tune);
+        PWM_FX_Stop(&pwm_fx_cfg);
+    }
+    else {
+        // SystemClock_Config restored 80 MHz behind the governor's back
+        ClockGov_Resync(&clock_gov);
+        if (Scene_Current(&scene_mgr) == SCENE_PLAY) {
+            PWM_FX_Start(&pwm_fx_cfg, CHAR_STATES[game_character.state].led);
+        }
+        else {
+            PWM_FX_Start(&pwm_fx_cfg, &led_fx_idle);
+        }
+    }
+}
+
+/**
+ * @brief Called by the clock governor after switching profile
+ *
+ * Timers and SysTick are handled by the governor and HAL, only the UART
+ * baud rates need recalculating.
+ */
+void governor_clocks_changed(void) {
+    MX_USART2_UART_Init();
+    MX_USART3_UART_Init();
+    Net_Attach(&net_cfg);
+}
+
+#ifdef WCET_BENCH
+// ===== WORST-CASE EXECUTION TIME =====
+// Character_Update, render_game and LCD_Refresh driven through the inputs
+// that make them slowest. Update and render run once per frame each, so
+// their maxima together must fit the frame period. render_game ends with
+// its own LCD_Refresh; the refresh is also timed alone, for reference.
+
+enum {
+    WCET_CHARACTER_UPDATE,
+    WCET_RENDER_GAME,
+    WCET_LCD_REFRESH,
+    WCET_PROBE_COUNT
+};
+
+// Where the character is put: at the world corners (the camera clamped, the
+// widest position text in the HUD), and with the camera in the middle of the
+// world, centred on each screen edge so the sprite is half clipped
+enum {
+    WCET_POS_CENTRE,
+    WCET_POS_WORLD_MIN,
+    WCET_POS_WORLD_MAX,
+    WCET_POS_SCREEN_LEFT,
+    WCET_POS_SCREEN_RIGHT,
+    WCET_POS_SCREEN_TOP,
+    WCET_POS_SCREEN_BOTTOM,
+    WCET_POS_COUNT
+};
+
+#define WCET_DIRECTIONS 9       // CENTRE and the 8 compass directions
+#define WCET_FRAMES_MAX 16      // Radix for the animation frame in render case ids
+#define WCET_SCROLL 239         // Largest scroll that still shifts the screen instead of redrawing it
+
+static const char* const wcet_position_names[WCET_POS_COUNT] = {
+    "centre", "world top-left", "world bottom-right",
+    "screen left", "screen right", "screen top", "screen bottom"
+};
+
+static const char* const wcet_direction_names[WCET_DIRECTIONS] = {
+    "CENTRE", "N", "NE", "E", "SE", "S", "SW", "W", "NW"
+};
+
+Joystick_t wcet_joystick;
+
+/**
+ * @brief Name a case from its id (the id packs the loop counters of wcet_run)
+ */
+const char* wcet_case_name(uint8_t probe, uint16_t id) {
+    static char name[80];
+
+    if (probe == WCET_CHARACTER_UPDATE) {
+        uint8_t dash_pressed = id % 2;
+        uint8_t direction = (id / 2) % WCET_DIRECTIONS;
+        uint8_t pos = (id / (2 * WCET_DIRECTIONS)) % WCET_POS_COUNT;
+        uint8_t dash_active = (id / (2 * WCET_DIRECTIONS * WCET_POS_COUNT)) % 2;
+        uint8_t state = id / (4 * WCET_DIRECTIONS * WCET_POS_COUNT);
+
+        snprintf(name, sizeof(name), "%s%s at %s, input %s%s", CHAR_STATES[state].name,
+                 dash_active ? " (dash running)" : "", wcet_position_names[pos],
+                 wcet_direction_names[direction], dash_pressed ? " + dash" : "");
+    }
+    else if (probe == WCET_RENDER_GAME) {
+        uint8_t scroll = id % 2;
+        uint8_t pos = (id / 2) % WCET_POS_COUNT;
+        uint8_t frame = (id / (2 * WCET_POS_COUNT)) % WCET_FRAMES_MAX;
+        uint8_t state = id / (2 * WCET_POS_COUNT * WCET_FRAMES_MAX);
+
+        snprintf(name, sizeof(name), "%s frame %u at %s, %s", CHAR_STATES[state].name, frame,
+                 wcet_position_names[pos], scroll ? "scrolled" : "full redraw");
+    }
+    else {
+        snprintf(name, sizeof(name), "all rows dirty");
+    }
+    return name;
+}
+
+Wcet_Probe_t wcet_probes[WCET_PROBE_COUNT] = {
+    [WCET_CHARACTER_UPDATE] = {"Character_Update", 1},
+    [WCET_RENDER_GAME]      = {"render_game", 1},
+    [WCET_LCD_REFRESH]      = {"LCD_Refresh", 0},   // Already part of render_game
+};
+
+Wcet_cfg_t wcet_cfg = {
+    .probes = wcet_probes,
+    .probe_count = WCET_PROBE_COUNT,
+    .budget_us = 0,             // The frame period, set from power_cfg by wcet_run()
+    .case_name = wcet_case_name,
+    .setup_done = 0
+};
+
+/**
+ * @brief Put the character and the camera in one of the WCET_POS_* places
+ *
+ * The level chunks in view are decompressed, as play_update() would have.
+ */
+void wcet_place(uint8_t pos) {
+    int32_t x = camera.world_w / 2;
+    int32_t y = camera.world_h / 2;
+
+    if (pos == WCET_POS_WORLD_MIN) {
+        x = CHAR_HITBOX_W / 2;
+        y = CHAR_HITBOX_H / 2;
+    }
+    else if (pos == WCET_POS_WORLD_MAX) {
+        x = camera.world_w - CHAR_HITBOX_W / 2;
+        y = camera.world_h - CHAR_HITBOX_H / 2;
+    }
+    Camera_Init(&camera, x, y);
+
+    switch (pos) {
+        case WCET_POS_SCREEN_LEFT:   x = camera.x; break;
+        case WCET_POS_SCREEN_RIGHT:  x = camera.x + camera.view_w; break;
+        case WCET_POS_SCREEN_TOP:    y = camera.y; break;
+        case WCET_POS_SCREEN_BOTTOM: y = camera.y + camera.view_h; break;
+        default: break;
+    }
+    game_character.x = x;
+    game_character.y = y;
+    Character_Cull(&game_character, &camera);
+
+    LevelStream_Update(&level_stream, camera.x >> LEVEL_TILE_SHIFT, camera.y >> LEVEL_TILE_SHIFT,
+                       LEVEL_VIEW_TILES + 1, LEVEL_VIEW_TILES + 1);
+}
+
+/**
+ * @brief Start a Character_Update case: a fresh character in a state, placed
+ */
+void wcet_character_case(CharacterState_t state, uint8_t dash_active, uint8_t pos) {
+    Character_Init(&game_character, &game_timers);
+    wcet_place(pos);
+    game_character.state = state;
+    if (dash_active) {
+        game_character.dash_active = 1;
+        TimerWheel_Start(&game_timers, &game_character.dash_timer, CHAR_DASH_DURATION);
+    }
+}
+
+/**
+ * @brief Start a render_game case
+ *
+ * A full redraw repaints the whole level; a scroll shifts the screen by
+ * almost its size and repaints two nearly full strips, which can cost more.
+ * Either way every row is dirty for the LCD_Refresh at the end.
+ */
+void wcet_render_case(CharacterState_t state, uint8_t frame, uint8_t pos, uint8_t scroll) {
+    Character_Init(&game_character, &game_timers);
+    wcet_place(pos);
+    game_character.state = state;
+    game_character.animation_frame = frame;
+
+    rendered_character = game_character;
+    rendered_camera_x = camera.x - (scroll ? WCET_SCROLL : 0);
+    rendered_camera_y = camera.y - (scroll ? WCET_SCROLL : 0);
+    render_needed = !scroll;
+    hud_label_state = 0xFF;     // Redraw the HUD label every run, not only on a state change
+}
+
+/**
+ * @brief Run every case at the current clock, print the maxima and check them
+ *        against the frame period
+ *
+ * @return 1 if update and render fit the frame period at their worst, 0 if not
+ */
+uint8_t wcet_run_profile(void) {
+    wcet_cfg.budget_us = (uint32_t)power_cfg.frame_period_ms * 1000;
+    Wcet_Init(&wcet_cfg);
+    printf("WCET at %lu MHz, %u runs per case\n",
+           (unsigned long)(SystemCoreClock / 1000000), WCET_REPEAT);
+
+    // Every state, with and without a dash running, every place, every input
+    uint16_t id = 0;
+    for (uint8_t state = 0; state < CHAR_STATE_COUNT; state++) {
+        for (uint8_t dash_active = 0; dash_active < 2; dash_active++) {
+            for (uint8_t pos = 0; pos < WCET_POS_COUNT; pos++) {
+                for (uint8_t direction = 0; direction < WCET_DIRECTIONS; direction++) {
+                    for (uint8_t dash_pressed = 0; dash_pressed < 2; dash_pressed++, id++) {
+                        wcet_joystick.direction = (Direction)direction;
+                        WCET_MEASURE(&wcet_cfg, WCET_CHARACTER_UPDATE, id,
+                                     wcet_character_case((CharacterState_t)state, dash_active, pos),
+                                     Character_Update(&game_character, &wcet_joystick, dash_pressed));
+                    }
+                }
+            }
+        }
+    }
+
+    // Every state and animation frame (the longest state name and position
+    // text in the HUD among them), every place, full redraw and scroll
+    for (uint8_t state = 0; state < CHAR_STATE_COUNT; state++) {
+        for (uint8_t frame = 0; frame < CHAR_STATES[state].frame_count && frame < WCET_FRAMES_MAX; frame++) {
+            for (uint8_t pos = 0; pos < WCET_POS_COUNT; pos++) {
+                for (uint8_t scroll = 0; scroll < 2; scroll++) {
+                    id = ((state * WCET_FRAMES_MAX + frame) * WCET_POS_COUNT + pos) * 2 + scroll;
+                    WCET_MEASURE(&wcet_cfg, WCET_RENDER_GAME, id,
+                                 wcet_render_case((CharacterState_t)state, frame, pos, scroll),
+                                 render_game());
+                }
+            }
+        }
+    }
+
+    // The whole screen changed
+    WCET_MEASURE(&wcet_cfg, WCET_LCD_REFRESH, 0, LCD_Fill_Buffer(0), LCD_Refresh(&cfg0));
+
+    return Wcet_Report(&wcet_cfg);
+}
+
+/**
+ * @brief Run every case at each clock profile, slowest last
+ *
+ * The governor only steps up after a frame has overrun, so a worst-case frame
+ * has to fit at whichever profile it happens to arrive in. Leaves the clock at
+ * 80 MHz and the game as it was before a new game starts.
+ *
+ * @return 1 if update and render fit the frame period at every profile, 0 if not
+ */
+uint8_t wcet_run(void) {
+    uint8_t pass = 1;
+
+    for (uint8_t profile = 0; profile < CLOCKGOV_PROFILE_COUNT; profile++) {
+        if (!ClockGov_SetProfile(&clock_gov, profile)) {
+            printf("WCET: could not switch to %lu MHz\n",
+                   (unsigned long)(clockgov_profiles[profile].sysclk_hz / 1000000));
+            pass = 0;
+            continue;
+        }
+        if (!wcet_run_profile()) {
+            pass = 0;
+        }
+    }
+    ClockGov_SetProfile(&clock_gov, 0);
+
+    // Back to the state a new game starts from
+    Character_Init(&game_character, &game_timers);
+    Camera_Init(&camera, game_character.x, game_character.y);
+    render_needed = 1;
+    return pass;
+}
+#endif
+
 // ===== Interrupt Callback =====
 
 /**
-  * @brief EXTI line detection callback - Dash Button
+  * @brief EXTI line detection callback - Game Buttons
   * @param GPIO_Pin: Specifies which GPIO pin triggered the interrupt
   * 
-  * @note This callback is triggered when the user presses the dash button (BTN3).
-  *       The interrupt sets a flag that tells the character to start dashing.
-  *       We keep ISRs SHORT and SIMPLE - just set a flag. The main loop handles everything else.
+  * @note This callback is triggered when the user presses BTN2, BTN3 or B1.
+  *       It only posts the pin to the work queue: debouncing and waking the main
+  *       loop run in button_work() from PendSV, after all other interrupts.
+  *       We keep ISRs SHORT and SIMPLE. The main loop handles everything else.
   *       Never use HAL_Delay() in an interrupt handler as it can cause the system to hang!
   */
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  WorkQueue_Post(button_work, GPIO_Pin);
+}
+
+/**
+  * @brief Button bottom half (runs from PendSV): debounce and record the event
+  * @param pin: GPIO pin that triggered the interrupt
+  */
+void button_work(uint32_t pin)
 {
   uint32_t current_time = HAL_GetTick();
-  
-  // Check if dash button (BTN3) was pressed
-  if (GPIO_Pin == BTN3_Pin)
+  uint8_t index;
+  uint8_t event;
+
+  switch (pin)
   {
-    // Debouncing: ignore interrupts that happen too quickly (within 200ms)
-    if ((current_time - dash_button_last_interrupt_time) > DEBOUNCE_DELAY)
-    {
-      dash_button_last_interrupt_time = current_time;
-      
-      // Set flag to trigger dash in the character FSM
-      dash_button_pressed = 1;
-    }
+    case BTN3_Pin: index = 0; event = BUTTON_DASH;   break;
+    case BTN2_Pin: index = 1; event = BUTTON_PAUSE;  break;
+    case B1_Pin:   index = 2; event = BUTTON_SELECT; break;
+    default: return;
+  }
+
+  // Debouncing: ignore presses that happen too quickly (within 200ms)
+  if ((current_time - button_last_interrupt_time[index]) > DEBOUNCE_DELAY)
+  {
+    button_last_interrupt_time[index] = current_time;
+    button_events |= event;
+
+    // Wake the main loop and sample input straight away rather than at the next release
+    Sched_Trigger(&sched, TASK_INPUT);
+    Power_NotifyEvent();
   }
 }
 
@@ -22,6 +22,13 @@
 #include "stm32l4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "PWM_Effects.h"
+#include "ST7789V2_Driver.h"
+#include "WorkQueue.h"
+#include "Netcode.h"
+#include "Random.h"
+#include "StackMon.h"
+#include "IrqLat.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -36,7 +43,14 @@
 
 /* Private macro -------------------------------------------------------------*/
 /* USER CODE BEGIN PM */
-
+// First and last thing in every instrumented handler (ids from IrqId_t)
+#ifdef IRQ_LATENCY
+#define IRQ_ENTER(id) do { IrqLat_Enter(&irq_lat, (id)); StackMon_IsrEnter(&stack_mon, (id)); } while (0)
+#define IRQ_EXIT(id)  do { StackMon_IsrExit(&stack_mon); IrqLat_Exit(&irq_lat, (id)); } while (0)
+#else
+#define IRQ_ENTER(id) StackMon_IsrEnter(&stack_mon, (id))
+#define IRQ_EXIT(id)  StackMon_IsrExit(&stack_mon)
+#endif
 /* USER CODE END PM */
 
 /* Private variables ---------------------------------------------------------*/
@@ -57,6 +71,14 @@
 /* External variables --------------------------------------------------------*/
 extern TIM_HandleTypeDef htim6;
 /* USER CODE BEGIN EV */
+extern PWM_FX_cfg_t pwm_fx_cfg;
+extern ST7789V2_cfg_t cfg0;
+extern Net_cfg_t net_cfg;
+extern Random_cfg_t random_cfg;
+extern StackMon_cfg_t stack_mon;
+#ifdef IRQ_LATENCY
+extern IrqLat_cfg_t irq_lat;
+#endif
 
 /* USER CODE END EV */
 
@@ -96,16 +118,22 @@ void HardFault_Handler(void)
 /**
   * @brief This function handles Memory management fault.
   */
-void MemManage_Handler(void)
+__attribute__((naked)) void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+  // The only MPU region is the StackMon guard, so this is a stack overflow.
+  // Nothing can be pushed while the MPU is on, so turn it off first (no C
+  // before that), then record the overflow and halt.
+  __asm volatile(
+      "ldr r0, =0xE000ED94    \n"  // MPU->CTRL
+      "movs r1, #0            \n"
+      "str r1, [r0]           \n"
+      "dsb                    \n"
+      "isb                    \n"
+      "ldr r0, =stack_mon     \n"
+      "b StackMon_GuardFault  \n"
+      ".ltorg                 \n");
   /* USER CODE END MemoryManagement_IRQn 0 */
-  while (1)
-  {
-    /* USER CODE BEGIN W1_MemoryManagement_IRQn 0 */
-    /* USER CODE END W1_MemoryManagement_IRQn 0 */
-  }
 }
 
 /**
@@ -170,10 +198,13 @@ void DebugMon_Handler(void)
 void PendSV_Handler(void)
 {
   /* USER CODE BEGIN PendSV_IRQn 0 */
+  IRQ_ENTER(IRQ_ID_PENDSV);
+  // Deferred work posted by interrupt handlers (lowest priority, before the main loop)
+  WorkQueue_PendSVHandler();
 
   /* USER CODE END PendSV_IRQn 0 */
   /* USER CODE BEGIN PendSV_IRQn 1 */
-
+  IRQ_EXIT(IRQ_ID_PENDSV);
   /* USER CODE END PendSV_IRQn 1 */
 }
 
@@ -183,11 +214,12 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
+  IRQ_ENTER(IRQ_ID_SYSTICK);
 
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  IRQ_EXIT(IRQ_ID_SYSTICK);
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -204,11 +236,12 @@ void SysTick_Handler(void)
 void EXTI2_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI2_IRQn 0 */
+  IRQ_ENTER(IRQ_ID_BUTTONS);
 
   /* USER CODE END EXTI2_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(BTN2_Pin);
   /* USER CODE BEGIN EXTI2_IRQn 1 */
-
+  IRQ_EXIT(IRQ_ID_BUTTONS);
   /* USER CODE END EXTI2_IRQn 1 */
 }
 
@@ -218,11 +251,12 @@ void EXTI2_IRQHandler(void)
 void EXTI3_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI3_IRQn 0 */
+  IRQ_ENTER(IRQ_ID_BUTTONS);
 
   /* USER CODE END EXTI3_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(BTN3_Pin);
   /* USER CODE BEGIN EXTI3_IRQn 1 */
-
+  IRQ_EXIT(IRQ_ID_BUTTONS);
   /* USER CODE END EXTI3_IRQn 1 */
 }
 
@@ -232,11 +266,12 @@ void EXTI3_IRQHandler(void)
 void EXTI15_10_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI15_10_IRQn 0 */
+  IRQ_ENTER(IRQ_ID_BUTTONS);
 
   /* USER CODE END EXTI15_10_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(B1_Pin);
   /* USER CODE BEGIN EXTI15_10_IRQn 1 */
-
+  IRQ_EXIT(IRQ_ID_BUTTONS);
   /* USER CODE END EXTI15_10_IRQn 1 */
 }
 
@@ -246,14 +281,83 @@ void EXTI15_10_IRQHandler(void)
 void TIM6_DAC_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM6_DAC_IRQn 0 */
+  IRQ_ENTER(IRQ_ID_TIM6);
 
   /* USER CODE END TIM6_DAC_IRQn 0 */
   HAL_TIM_IRQHandler(&htim6);
   /* USER CODE BEGIN TIM6_DAC_IRQn 1 */
-
+  IRQ_EXIT(IRQ_ID_TIM6);
   /* USER CODE END TIM6_DAC_IRQn 1 */
 }
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles DMA1 channel7 global interrupt (TIM4 update => LED effects).
+  */
+void DMA1_Channel7_IRQHandler(void)
+{
+  IRQ_ENTER(IRQ_ID_LED_DMA);
+  PWM_FX_IRQHandler(&pwm_fx_cfg);
+  IRQ_EXIT(IRQ_ID_LED_DMA);
+}
+
+/**
+  * @brief This function handles DMA1 channel5 global interrupt (SPI2 TX => LCD).
+  */
+void DMA1_Channel5_IRQHandler(void)
+{
+  IRQ_ENTER(IRQ_ID_LCD_DMA);
+  ST7789V2_DMA_IRQHandler(&cfg0);
+  IRQ_EXIT(IRQ_ID_LCD_DMA);
+}
+
+/**
+  * @brief This function handles USART3 global interrupt (Netcode link).
+  */
+void USART3_IRQHandler(void)
+{
+  IRQ_ENTER(IRQ_ID_USART3);
+  Net_UART_IRQHandler(&net_cfg);
+  IRQ_EXIT(IRQ_ID_USART3);
+}
+
+/**
+  * @brief This function handles RNG global interrupt (entropy pool).
+  */
+void RNG_IRQHandler(void)
+{
+  IRQ_ENTER(IRQ_ID_RNG);
+  Random_IRQHandler(&random_cfg);
+  IRQ_EXIT(IRQ_ID_RNG);
+}
+
+#ifdef IRQ_LATENCY
+/**
+  * @brief This function handles TIM7 global interrupt (IrqLat timer probe, priority 0).
+  */
+void TIM7_IRQHandler(void)
+{
+  IrqLat_TimerIRQHandler(&irq_lat);
+}
+
+/**
+  * @brief Spare vectors pended by IrqLat as software probes (priorities 5, 14, 15).
+  */
+void COMP_IRQHandler(void)
+{
+  IrqLat_ProbeIRQHandler(&irq_lat, 1);
+}
+
+void LPTIM2_IRQHandler(void)
+{
+  IrqLat_ProbeIRQHandler(&irq_lat, 2);
+}
+
+void SWPMI1_IRQHandler(void)
+{
+  IrqLat_ProbeIRQHandler(&irq_lat, 3);
+}
+#endif
+
 /* USER CODE END 1 */
@@ -36,17 +36,17 @@ static uint8_t *__sbrk_heap_end = NULL;
  *
  * @verbatim
  * ############################################################################
- * #  .data  #  .bss  #       newlib heap       #          MSP stack          #
- * #         #        #                         # Reserved by _Min_Stack_Size #
+ * #  .data  #  .bss  #  newlib heap  #guard#           MSP stack              #
+ * #         #        #(_Min_Heap_Size)#    #   (at least _Min_Stack_Size)    #
  * ############################################################################
- * ^-- RAM start      ^-- _end                             _estack, RAM end --^
+ * ^-- RAM start      ^-- _end         ^-- _sstack         _estack, RAM end --^
  * @endverbatim
  *
  * This implementation starts allocating at the '_end' linker symbol
- * The '_Min_Stack_Size' linker symbol reserves a memory for the MSP stack
- * The implementation considers '_estack' linker symbol to be RAM end
- * NOTE: If the MSP stack, at any point during execution, grows larger than the
- * reserved size, please increase the '_Min_Stack_Size'.
+ * The heap stops at the '_sstack' linker symbol, where the stack area (and
+ * the StackMon MPU guard at its bottom) begins
+ * NOTE: If malloc runs out, increase '_Min_Heap_Size'. The stack use is
+ * reported by StackMon.
  *
  * @param incr Memory size
  * @return Pointer to allocated memory
@@ -54,10 +54,8 @@ static uint8_t *__sbrk_heap_end = NULL;
 void *_sbrk(ptrdiff_t incr)
 {
   extern uint8_t _end; /* Symbol defined in the linker script */
-  extern uint8_t _estack; /* Symbol defined in the linker script */
-  extern uint32_t _Min_Stack_Size; /* Symbol defined in the linker script */
-  const uint32_t stack_limit = (uint32_t)&_estack - (uint32_t)&_Min_Stack_Size;
-  const uint8_t *max_heap = (uint8_t *)stack_limit;
+  extern uint8_t _sstack; /* Symbol defined in the linker script */
+  const uint8_t *max_heap = &_sstack;
   uint8_t *prev_heap_end;
 
   /* Initialize heap end at first call */
@@ -0,0 +1,269 @@
+#include "DrawList.h"
+#include <string.h>
+
+/**
+ * @file DrawList.c
+ * @brief Implementation of the z-ordered draw list with culling
+ */
+
+// Font cell of LCD_printString(): 5x7 glyphs, one column apart, per font_size
+#define TEXT_CELL_W 6
+#define TEXT_CELL_H 7
+
+typedef struct {
+    int16_t x0;
+    int16_t y0;
+    int16_t x1;                     // Exclusive
+    int16_t y1;
+} Clip_t;
+
+/**
+ * Bounds clipped to the screen, 0 if nothing is left
+ */
+static uint8_t clip(const DrawList_Item_t* item, Clip_t* out) {
+    int32_t x0 = item->x;
+    int32_t y0 = item->y;
+    int32_t x1 = x0 + item->w;
+    int32_t y1 = y0 + item->h;
+
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > ST7789V2_WIDTH) x1 = ST7789V2_WIDTH;
+    if (y1 > ST7789V2_HEIGHT) y1 = ST7789V2_HEIGHT;
+    if (x0 >= x1 || y0 >= y1) {
+        return 0;
+    }
+    out->x0 = x0;
+    out->y0 = y0;
+    out->x1 = x1;
+    out->y1 = y1;
+    return 1;
+}
+
+static DrawList_Item_t* add(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint8_t kind) {
+    cfg->stats.submitted++;
+    if (cfg->count >= cfg->capacity) {
+        cfg->stats.dropped++;
+        return NULL;
+    }
+
+    DrawList_Item_t* item = &cfg->items[cfg->count++];
+    item->x = x;
+    item->y = y;
+    item->w = w;
+    item->h = h;
+    item->z = z;
+    item->kind = kind;
+    item->opaque = 0;
+    return item;
+}
+
+/**
+ * Set bits [x0, x1) of a row mask
+ */
+static void mask_set(uint32_t* mask, int16_t x0, int16_t x1) {
+    while (x0 < x1) {
+        uint8_t bit = x0 & 31;
+        int16_t n = 32 - bit;
+        if (n > x1 - x0) {
+            n = x1 - x0;
+        }
+        mask[x0 >> 5] |= (n == 32) ? 0xFFFFFFFFu : ((1u << n) - 1) << bit;
+        x0 += n;
+    }
+}
+
+/**
+ * Screen area covered by the drawn items, each pixel counted once
+ *
+ * The screen is cut into horizontal bands at every top and bottom edge; in a
+ * band every item either spans all of its rows or none, so one row mask per
+ * band gives its area.
+ */
+static uint32_t covered_area(const DrawList_cfg_t* cfg, const uint8_t* drawn) {
+    static int16_t edges[2 * DRAWLIST_MAX_ITEMS];   // Static: 256 bytes would step over the stack guard
+    uint8_t edge_count = 0;
+    Clip_t c;
+
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        if (drawn[i] && clip(&cfg->items[i], &c)) {
+            edges[edge_count++] = c.y0;
+            edges[edge_count++] = c.y1;
+        }
+    }
+    for (uint8_t i = 1; i < edge_count; i++) {
+        int16_t e = edges[i];
+        uint8_t j = i;
+        for (; j > 0 && edges[j - 1] > e; j--) {
+            edges[j] = edges[j - 1];
+        }
+        edges[j] = e;
+    }
+
+    uint32_t area = 0;
+    for (uint8_t k = 0; k + 1 < edge_count; k++) {
+        int16_t top = edges[k];
+        int16_t bottom = edges[k + 1];
+        if (top == bottom) {
+            continue;
+        }
+
+        uint32_t mask[(ST7789V2_WIDTH + 31) / 32] = {0};
+        for (uint8_t i = 0; i < cfg->count; i++) {
+            if (drawn[i] && clip(&cfg->items[i], &c) && c.y0 <= top && c.y1 >= bottom) {
+                mask_set(mask, c.x0, c.x1);
+            }
+        }
+        uint16_t width = 0;
+        for (uint8_t w = 0; w < sizeof(mask) / sizeof(mask[0]); w++) {
+            width += __builtin_popcount(mask[w]);
+        }
+        area += (uint32_t)width * (bottom - top);
+    }
+    return area;
+}
+
+void DrawList_Init(DrawList_cfg_t* cfg) {
+    if (cfg->capacity > DRAWLIST_MAX_ITEMS) {
+        cfg->capacity = DRAWLIST_MAX_ITEMS;
+    }
+    cfg->count = 0;
+    DrawList_ResetStats(cfg);
+    cfg->setup_done = 1;
+}
+
+void DrawList_Begin(DrawList_cfg_t* cfg) {
+    cfg->count = 0;
+}
+
+void DrawList_Sprite(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, uint8_t rows, uint8_t cols,
+                     const uint8_t* pixels, uint8_t colour, uint8_t scale) {
+    DrawList_Item_t* item = add(cfg, z, x, y, cols * scale, rows * scale, DRAWLIST_SPRITE);
+    if (item) {
+        item->colour = colour;
+        item->scale = scale;
+        item->data.sprite.pixels = pixels;
+        item->data.sprite.rows = rows;
+        item->data.sprite.cols = cols;
+    }
+}
+
+void DrawList_Text(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, const char* text,
+                   uint8_t colour, uint8_t font_size) {
+    int16_t w = (int16_t)strlen(text) * TEXT_CELL_W * font_size;
+    DrawList_Item_t* item = add(cfg, z, x, y, w, TEXT_CELL_H * font_size, DRAWLIST_TEXT);
+    if (item) {
+        item->colour = colour;
+        item->scale = font_size;
+        item->data.text = text;
+    }
+}
+
+void DrawList_Rect(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, int16_t w, int16_t h,
+                   uint8_t colour, uint8_t fill) {
+    DrawList_Item_t* item = add(cfg, z, x, y, w, h, DRAWLIST_RECT);
+    if (item) {
+        item->opaque = fill ? 1 : 0;
+        item->colour = colour;
+        item->data.fill = fill;
+    }
+}
+
+void DrawList_Blit(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, const LCD_Surface_t* surface,
+                   int16_t key) {
+    DrawList_Item_t* item = add(cfg, z, x, y, surface->width, surface->height, DRAWLIST_BLIT);
+    if (item) {
+        item->opaque = key < 0;
+        item->data.blit.surface = surface;
+        item->data.blit.key = key;
+    }
+}
+
+void DrawList_Callback(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, int16_t w, int16_t h,
+                       uint8_t opaque, void (*draw)(int16_t x, int16_t y, int16_t w, int16_t h)) {
+    DrawList_Item_t* item = add(cfg, z, x, y, w, h, DRAWLIST_CALLBACK);
+    if (item) {
+        item->opaque = opaque;
+        item->data.draw = draw;
+    }
+}
+
+void DrawList_Flush(DrawList_cfg_t* cfg) {
+    DrawList_Item_t* items = cfg->items;
+    uint8_t drawn[DRAWLIST_MAX_ITEMS];
+
+    // Stable insertion sort by z: lists are short and mostly submitted in order
+    for (uint8_t i = 1; i < cfg->count; i++) {
+        DrawList_Item_t item = items[i];
+        uint8_t j = i;
+        for (; j > 0 && items[j - 1].z > item.z; j--) {
+            items[j] = items[j - 1];
+        }
+        items[j] = item;
+    }
+
+    // Cull: off the screen, or inside one opaque item drawn later
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        Clip_t c;
+        drawn[i] = 0;
+        if (!clip(&items[i], &c)) {
+            cfg->stats.offscreen++;
+            continue;
+        }
+
+        uint8_t hidden = 0;
+        for (uint8_t j = i + 1; j < cfg->count && !hidden; j++) {
+            Clip_t o;
+            hidden = items[j].opaque && clip(&items[j], &o) &&
+                     o.x0 <= c.x0 && o.y0 <= c.y0 && o.x1 >= c.x1 && o.y1 >= c.y1;
+        }
+        uint32_t area = (uint32_t)(c.x1 - c.x0) * (c.y1 - c.y0);
+        if (hidden) {
+            cfg->stats.occluded++;
+            cfg->stats.pixels_culled += area;
+            continue;
+        }
+        drawn[i] = 1;
+        cfg->stats.drawn++;
+        cfg->stats.pixels_drawn += area;
+    }
+
+    // Rasterise back to front
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        const DrawList_Item_t* item = &items[i];
+        if (!drawn[i]) {
+            continue;
+        }
+        switch (item->kind) {
+            case DRAWLIST_SPRITE:
+                LCD_Draw_Sprite_Colour_Scaled(item->x, item->y, item->data.sprite.rows,
+                                              item->data.sprite.cols, item->data.sprite.pixels,
+                                              item->colour, item->scale);
+                break;
+            case DRAWLIST_TEXT:
+                LCD_printString(item->data.text, item->x, item->y, item->colour, item->scale);
+                break;
+            case DRAWLIST_RECT:
+                LCD_Draw_Rect(item->x, item->y, item->w, item->h, item->colour, item->data.fill);
+                break;
+            case DRAWLIST_BLIT:
+                LCD_Blit(item->data.blit.surface, 0, 0, item->w, item->h, item->x, item->y,
+                         item->data.blit.key);
+                break;
+            case DRAWLIST_CALLBACK:
+                item->data.draw(item->x, item->y, item->w, item->h);
+                break;
+            default:
+                break;
+        }
+    }
+
+    cfg->stats.pixels_covered += covered_area(cfg, drawn);
+    cfg->stats.frames++;
+    cfg->count = 0;
+}
+
+void DrawList_ResetStats(DrawList_cfg_t* cfg) {
+    memset(&cfg->stats, 0, sizeof(cfg->stats));
+}
@@ -0,0 +1,187 @@
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include <stdint.h>
+#include "LCD.h"
+
+/**
+ * @file DrawList.h
+ * @brief Per-frame draw list: z-ordered, with off-screen and occlusion culling
+ *
+ * Instead of drawing straight into the LCD buffer, a frame submits its
+ * sprites, text, rectangles, pre-drawn surfaces and background regions to
+ * a list, each with a z value and its screen bounds. DrawList_Flush() then:
+ * 1. sorts the list once by z (higher z is drawn later, on top; equal z
+ *    keeps the order of submission),
+ * 2. culls items whose bounds are entirely off the screen,
+ * 3. culls items entirely inside the bounds of one opaque item drawn after
+ *    them (a filled rectangle, a surface stamped without a transparency key,
+ *    or a callback that paints all of its bounds),
+ * 4. rasterises what is left, in order.
+ * Culling is by bounds only: an item covered by several opaque items
+ * together, but by none of them alone, is still drawn.
+ *
+ * Items are kept by value in a caller-provided array. Text is kept by
+ * pointer, so the string must stay valid until the flush.
+ *
+ * Statistics accumulate over flushes until DrawList_ResetStats(): items
+ * submitted, drawn and culled (and dropped because the list was full), and
+ * the pixel areas behind the overdraw ratio: the bounds area of what was
+ * drawn against the area of the screen it covered (a ratio of 1.0 means no
+ * pixel was written twice).
+ *
+ * Example usage:
+ * @code
+ * DrawList_Item_t items[16];
+ * DrawList_cfg_t list = {
+ *     .items = items,
+ *     .capacity = 16,
+ *     .setup_done = 0
+ * };
+ *
+ * DrawList_Init(&list);
+ *
+ * // Each frame:
+ * DrawList_Begin(&list);
+ * DrawList_Callback(&list, 0, 0, 0, 240, 240, 1, draw_background);
+ * DrawList_Sprite(&list, 10, x, y, 8, 8, (const uint8_t*)sprite, 1, 4);
+ * DrawList_Text(&list, 20, 10, 5, "Score", 1, 2);
+ * DrawList_Flush(&list);
+ * LCD_Refresh(&cfg0);
+ * @endcode
+ */
+
+/**
+ * @enum DrawList_Kind_t
+ * @brief What an item draws
+ */
+typedef enum {
+    DRAWLIST_SPRITE,                ///< LCD_Draw_Sprite_Colour_Scaled()
+    DRAWLIST_TEXT,                  ///< LCD_printString()
+    DRAWLIST_RECT,                  ///< LCD_Draw_Rect()
+    DRAWLIST_BLIT,                  ///< LCD_Blit() of a whole surface
+    DRAWLIST_CALLBACK               ///< A function drawing a screen region
+} DrawList_Kind_t;
+
+/**
+ * @struct DrawList_Item_t
+ * @brief One submitted draw call
+ */
+typedef struct {
+    int16_t x;                      ///< Screen bounds (may extend off the screen)
+    int16_t y;
+    int16_t w;
+    int16_t h;
+    int16_t z;                      ///< Higher is drawn later (on top)
+    uint8_t kind;                   ///< DrawList_Kind_t
+    uint8_t opaque;                 ///< 1 if it paints every pixel of its bounds
+    uint8_t colour;
+    uint8_t scale;                  ///< Sprite scale or font size
+    union {
+        struct {
+            const uint8_t* pixels;  ///< rows x cols, 255 is transparent
+            uint8_t rows;
+            uint8_t cols;
+        } sprite;
+        const char* text;
+        uint8_t fill;
+        struct {
+            const LCD_Surface_t* surface;
+            int16_t key;            ///< Transparent colour, or LCD_NO_KEY
+        } blit;
+        void (*draw)(int16_t x, int16_t y, int16_t w, int16_t h);
+    } data;
+} DrawList_Item_t;
+
+/**
+ * @struct DrawList_Stats_t
+ * @brief Counts since the last DrawList_ResetStats()
+ */
+typedef struct {
+    uint32_t frames;                ///< Flushes
+    uint32_t submitted;             ///< Items submitted
+    uint32_t drawn;                 ///< Items rasterised
+    uint32_t offscreen;             ///< Items culled: entirely off the screen
+    uint32_t occluded;              ///< Items culled: under an opaque item
+    uint32_t dropped;               ///< Items lost because the list was full
+    uint32_t pixels_drawn;          ///< Bounds area of the items drawn (on screen part)
+    uint32_t pixels_covered;        ///< Screen area those items covered, each pixel once
+    uint32_t pixels_culled;         ///< Bounds area of the occluded items (drawing saved)
+} DrawList_Stats_t;
+
+/**
+ * @struct DrawList_cfg_t
+ * @brief Draw list storage and statistics
+ */
+typedef struct {
+    DrawList_Item_t* items;         ///< Storage for one frame's items
+    uint8_t capacity;               ///< Number of items (at most 64)
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+
+    uint8_t count;                  ///< Internal: items submitted this frame
+    DrawList_Stats_t stats;         ///< Read directly, cleared by DrawList_ResetStats()
+} DrawList_cfg_t;
+
+#define DRAWLIST_MAX_ITEMS 64
+
+/**
+ * @brief Empty the list and clear the statistics
+ */
+void DrawList_Init(DrawList_cfg_t* cfg);
+
+/**
+ * @brief Start a frame: drop anything submitted but not flushed
+ */
+void DrawList_Begin(DrawList_cfg_t* cfg);
+
+/**
+ * @brief Submit a sprite (LCD_Draw_Sprite_Colour_Scaled), never opaque
+ */
+void DrawList_Sprite(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, uint8_t rows, uint8_t cols,
+                     const uint8_t* pixels, uint8_t colour, uint8_t scale);
+
+/**
+ * @brief Submit a string (LCD_printString), never opaque
+ *
+ * @param text Must stay valid until DrawList_Flush()
+ */
+void DrawList_Text(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, const char* text,
+                   uint8_t colour, uint8_t font_size);
+
+/**
+ * @brief Submit a rectangle (LCD_Draw_Rect), opaque if filled
+ */
+void DrawList_Rect(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, int16_t w, int16_t h,
+                   uint8_t colour, uint8_t fill);
+
+/**
+ * @brief Submit a surface to stamp (LCD_Blit), opaque without a transparency key
+ *
+ * @param surface Must stay valid and unchanged until DrawList_Flush()
+ * @param key Transparent colour 0-15, or LCD_NO_KEY
+ */
+void DrawList_Blit(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, const LCD_Surface_t* surface,
+                   int16_t key);
+
+/**
+ * @brief Submit a region drawn by a function (e.g. the level background)
+ *
+ * @param opaque 1 if draw() paints every pixel inside (x, y, w, h)
+ * @param draw Called with the bounds as submitted; it clips to the screen itself
+ */
+void DrawList_Callback(DrawList_cfg_t* cfg, int16_t z, int16_t x, int16_t y, int16_t w, int16_t h,
+                       uint8_t opaque, void (*draw)(int16_t x, int16_t y, int16_t w, int16_t h));
+
+/**
+ * @brief Sort, cull and draw the frame's items into the LCD buffer, then empty the list
+ *
+ * Does not refresh the LCD.
+ */
+void DrawList_Flush(DrawList_cfg_t* cfg);
+
+/**
+ * @brief Clear the statistics
+ */
+void DrawList_ResetStats(DrawList_cfg_t* cfg);
+
+#endif // DRAWLIST_H
@@ -0,0 +1,200 @@
+#include "FlowField.h"
+#include <string.h>
+
+/**
+ * @file FlowField.c
+ * @brief Implementation of the time-sliced flow-field BFS (repairs and full rebuilds)
+ *
+ * dist holds distances plus an offset, base (the stored value of distance
+ * 0), so a repair can add k to every distance by lowering base by k. A full
+ * rebuild puts base as high as the largest distance allows, which leaves
+ * room for that many steps of goal movement before the next full rebuild.
+ */
+
+#define NO_TILE 0xFFFF                  // old_goal outside a repair
+
+// Neighbour offsets (orthogonal first, so straight paths are preferred on ties)
+// and the direction a neighbour must step to come back to the expanded tile
+static const int8_t neighbour_dx[8] = { 0, 1, 0, -1, 1, 1, -1, -1};
+static const int8_t neighbour_dy[8] = {-1, 0, 1,  0, -1, 1, 1, -1};
+static const uint8_t step_back[8] = {S, W, N, E, SW, NW, NE, SE};
+
+static inline uint8_t is_passable(const FlowField_cfg_t* cfg, int16_t x, int16_t y)
+{
+    if (x < 0 || y < 0 || x >= cfg->width || y >= cfg->height) {
+        return 0;
+    }
+    uint16_t i = (uint16_t)y * cfg->width + (uint16_t)x;
+    return (cfg->passable[i >> 3] >> (i & 7u)) & 1u;
+}
+
+static inline void set_dir(FlowField_cfg_t* cfg, uint16_t i, uint8_t dir)
+{
+    uint8_t* byte = &cfg->dirs[i >> 1];
+    if (i & 1u) {
+        *byte = (uint8_t)((*byte & 0x0Fu) | (dir << 4));
+    }
+    else {
+        *byte = (uint8_t)((*byte & 0xF0u) | dir);
+    }
+}
+
+// Distances are below the tile count, so their stored values stay below UNREACHED
+static inline uint16_t full_base(const FlowField_cfg_t* cfg)
+{
+    return (uint16_t)(FLOWFIELD_UNREACHED - 1u - (uint32_t)cfg->width * cfg->height);
+}
+
+void FlowField_Init(FlowField_cfg_t* cfg)
+{
+    uint32_t tiles = (uint32_t)cfg->width * cfg->height;
+
+    memset(cfg->dirs, CENTRE, FLOWFIELD_DIR_BYTES(cfg->width, cfg->height));
+    memset(cfg->dist, 0xFF, tiles * sizeof(uint16_t));
+    cfg->building = 0;
+    cfg->repairing = 0;
+    cfg->stale = 1;
+    cfg->goal = 0;
+    cfg->old_goal = NO_TILE;
+    cfg->base = full_base(cfg);
+    cfg->head = 0;
+    cfg->tail = 0;
+    cfg->builds = 0;
+    cfg->repairs = 0;
+    cfg->restarts = 0;
+    cfg->expanded = 0;
+    cfg->setup_done = 1;
+}
+
+void FlowField_SetGoal(FlowField_cfg_t* cfg, uint8_t tx, uint8_t ty)
+{
+    if (!is_passable(cfg, tx, ty)) {
+        return;
+    }
+
+    uint16_t goal = (uint16_t)ty * cfg->width + tx;
+    if (goal == cfg->goal && !cfg->stale) {
+        return;
+    }
+
+    // Repair if the finished field reaches the new goal (and base has room
+    // for the offset); otherwise rebuild from scratch
+    uint16_t stored = cfg->dist[goal];
+    uint16_t k = stored - cfg->base;
+    if (!cfg->building && !cfg->stale && stored != FLOWFIELD_UNREACHED && k <= cfg->base) {
+        cfg->base -= k;                 // every distance + k: an upper bound from the new goal
+        cfg->old_goal = cfg->goal;
+        cfg->repairing = 1;
+    }
+    else {
+        if (cfg->building) {
+            cfg->restarts++;
+        }
+        memset(cfg->dist, 0xFF, (uint32_t)cfg->width * cfg->height * sizeof(uint16_t));
+        cfg->base = full_base(cfg);
+        cfg->old_goal = NO_TILE;
+        cfg->repairing = 0;
+    }
+
+    cfg->dist[goal] = cfg->base;
+    set_dir(cfg, goal, CENTRE);
+    cfg->queue[0] = goal;
+    cfg->head = 0;
+    cfg->tail = 1;
+    cfg->goal = goal;
+    cfg->stale = 0;
+    cfg->building = 1;
+}
+
+uint8_t FlowField_Update(FlowField_cfg_t* cfg, uint16_t max_tiles)
+{
+    uint16_t expanded = 0;
+
+    while (cfg->building && cfg->head != cfg->tail) {
+        if (max_tiles && expanded == max_tiles) {
+            return 0;
+        }
+
+        uint16_t i = cfg->queue[cfg->head++];
+        int16_t x = (int16_t)(i % cfg->width);
+        int16_t y = (int16_t)(i / cfg->width);
+        uint16_t next_dist = cfg->dist[i] + 1u;
+
+        for (uint8_t n = 0; n < 8; n++) {
+            int16_t nx = x + neighbour_dx[n];
+            int16_t ny = y + neighbour_dy[n];
+
+            if (!is_passable(cfg, nx, ny)) {
+                continue;
+            }
+            // Diagonal: both orthogonal neighbours must be open
+            if (n >= 4 && (!is_passable(cfg, nx, y) || !is_passable(cfg, x, ny))) {
+                continue;
+            }
+
+            // Only tiles that get closer are expanded: in a rebuild that is
+            // every tile not reached yet (UNREACHED), in a repair the tiles
+            // below their bound. The old goal never gets closer than its
+            // bound but has to stop pointing at itself.
+            uint16_t j = (uint16_t)ny * cfg->width + (uint16_t)nx;
+            if (next_dist < cfg->dist[j]) {
+                cfg->dist[j] = next_dist;
+                set_dir(cfg, j, step_back[n]);
+                cfg->queue[cfg->tail++] = j;
+            }
+            else if (j == cfg->old_goal && next_dist == cfg->dist[j]) {
+                set_dir(cfg, j, step_back[n]);
+                cfg->old_goal = NO_TILE;
+            }
+        }
+        expanded++;
+    }
+
+    if (cfg->building) {
+        cfg->building = 0;
+        cfg->expanded = cfg->tail;
+        if (cfg->repairing) {
+            cfg->repairs++;
+        }
+        else {
+            cfg->builds++;
+        }
+    }
+    return 1;
+}
+
+void FlowField_Invalidate(FlowField_cfg_t* cfg)
+{
+    cfg->stale = 1;
+}
+
+Direction FlowField_Dir(const FlowField_cfg_t* cfg, uint8_t tx, uint8_t ty)
+{
+    if (tx >= cfg->width || ty >= cfg->height) {
+        return CENTRE;
+    }
+
+    uint16_t i = (uint16_t)ty * cfg->width + tx;
+
+    // Once complete, tiles the search did not reach have no path (their
+    // direction may be left over from an earlier goal)
+    if (!cfg->building && cfg->dist[i] == FLOWFIELD_UNREACHED) {
+        return CENTRE;
+    }
+    return (Direction)((i & 1u) ? (cfg->dirs[i >> 1] >> 4) : (cfg->dirs[i >> 1] & 0x0Fu));
+}
+
+uint16_t FlowField_Distance(const FlowField_cfg_t* cfg, uint8_t tx, uint8_t ty)
+{
+    if (tx >= cfg->width || ty >= cfg->height) {
+        return FLOWFIELD_UNREACHED;
+    }
+
+    uint16_t stored = cfg->dist[(uint16_t)ty * cfg->width + tx];
+    return (stored == FLOWFIELD_UNREACHED) ? FLOWFIELD_UNREACHED : (uint16_t)(stored - cfg->base);
+}
+
+uint8_t FlowField_IsReady(const FlowField_cfg_t* cfg)
+{
+    return (cfg->setup_done && !cfg->building && !cfg->stale) ? 1u : 0u;
+}
@@ -0,0 +1,155 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <stdint.h>
+#include "Joystick.h"
+
+/**
+ * @file FlowField.h
+ * @brief Shared flow-field pathfinding towards one goal tile
+ *
+ * Instead of every enemy searching its own path to the player, one
+ * breadth-first search from the goal (the Character's tile) over the level's
+ * passability bitset gives every reachable tile the direction of its next
+ * step towards the goal. Any number of enemies then look up their tile's
+ * direction in O(1).
+ *
+ * Moves are 8-way with unit cost. Diagonal steps are only allowed when both
+ * orthogonal neighbours are passable (no cutting corners). Directions use the
+ * Joystick Direction enum, so a follower can share the Character's movement
+ * code; CENTRE means "at the goal" or "no path".
+ *
+ * When the goal moves within the reachable area the field is repaired, not
+ * rebuilt. If the new goal was k steps from the old one, every tile is at
+ * most k steps further from it than before, so old distance + k is an upper
+ * bound. The repair adds k to every distance at once (a shared offset, no
+ * pass over the grid), then searches from the new goal and only expands
+ * tiles whose distance drops below that bound; every other tile keeps its
+ * old direction, which still leads along a shortest path to the new goal.
+ * When the player walks one tile, the tiles that got further away (on an
+ * open map, the wedge behind them) are not touched at all. A goal in
+ * another region, a change to the grid (FlowField_Invalidate()) or a goal
+ * move during an update is a full rebuild instead.
+ *
+ * Updates are also time-sliced: FlowField_SetGoal() starts one and
+ * FlowField_Update() expands at most a given number of tiles per call, so
+ * it can be spread over several frames. During an update the field is
+ * always safe to follow: tiles not reached yet keep their old direction,
+ * and following the mix can never loop.
+ *
+ * No enemy type follows a field yet; FlowField_Bench() is the only caller.
+ *
+ * Memory is supplied by the caller (no malloc). For a W x H grid:
+ * - dist:   W*H uint16_t (kept between updates, the repair starts from it)
+ * - queue:  W*H uint16_t (working)
+ * - dirs:   FLOWFIELD_DIR_BYTES(W, H) bytes (the published field, 4 bits per tile)
+ * A 60x60 field uses 16.2 KB in total.
+ *
+ * Passability bitset: bit (y * width + x), least significant bit first,
+ * 1 = passable.
+ *
+ * Example usage:
+ * @code
+ * static uint16_t ff_dist[32 * 32], ff_queue[32 * 32];
+ * static uint8_t ff_dirs[FLOWFIELD_DIR_BYTES(32, 32)];
+ *
+ * FlowField_cfg_t flow = {
+ *     .width = 32, .height = 32,
+ *     .passable = level_bits,
+ *     .dist = ff_dist, .queue = ff_queue, .dirs = ff_dirs,
+ *     .setup_done = 0
+ * };
+ * FlowField_Init(&flow);
+ *
+ * // Each frame:
+ * FlowField_SetGoal(&flow, player_tx, player_ty);  // no-op if unchanged
+ * FlowField_Update(&flow, 256);                   // at most 256 tiles this frame
+ *
+ * // Each enemy:
+ * Direction step = FlowField_Dir(&flow, enemy_tx, enemy_ty);
+ * @endcode
+ */
+
+#define FLOWFIELD_DIR_BYTES(w, h) ((((uint32_t)(w) * (h)) + 1u) / 2u)
+#define FLOWFIELD_UNREACHED 0xFFFF
+
+/**
+ * @struct FlowField_cfg_t
+ * @brief Flow-field configuration, buffers and build state
+ */
+typedef struct {
+    uint8_t width;                  ///< Grid width in tiles
+    uint8_t height;                 ///< Grid height in tiles
+    const uint8_t* passable;        ///< Passability bitset (1 = passable)
+    uint16_t* dist;                 ///< Steps to the goal per tile, plus base
+    uint16_t* queue;                ///< Working: BFS queue of tile indices
+    uint8_t* dirs;                  ///< Published: Direction per tile, 4 bits each
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+    uint8_t building;               ///< Internal flag: 1 while an update is in progress
+    uint8_t repairing;              ///< Internal flag: 1 if that update is a repair
+    uint8_t stale;                  ///< Internal flag: 1 to force the next rebuild
+    uint16_t goal;                  ///< Internal: goal tile index
+    uint16_t old_goal;              ///< Internal: previous goal during a repair
+    uint16_t base;                  ///< Internal: stored value of distance 0 in dist
+    uint16_t head;                  ///< Internal: BFS queue read position
+    uint16_t tail;                  ///< Internal: BFS queue write position
+    uint32_t builds;                ///< Completed full rebuilds
+    uint32_t repairs;               ///< Completed repairs after a goal move
+    uint32_t restarts;              ///< Updates abandoned because the goal moved again
+    uint32_t expanded;              ///< Tiles expanded by the last completed update
+} FlowField_cfg_t;
+
+/**
+ * @brief Initialise the field with no goal (every tile CENTRE)
+ */
+void FlowField_Init(FlowField_cfg_t* cfg);
+
+/**
+ * @brief Set the goal tile and start a repair or rebuild if it changed
+ *
+ * Does nothing if the goal is unchanged (and the grid not invalidated).
+ * A goal outside the grid or on an impassable tile is ignored.
+ */
+void FlowField_SetGoal(FlowField_cfg_t* cfg, uint8_t tx, uint8_t ty);
+
+/**
+ * @brief Continue the repair or rebuild
+ *
+ * @param max_tiles Most tiles to expand in this call, 0 for no limit
+ * @return 1 if the field is complete, 0 if the update needs more calls
+ */
+uint8_t FlowField_Update(FlowField_cfg_t* cfg, uint16_t max_tiles);
+
+/**
+ * @brief Force the next FlowField_SetGoal() to rebuild (call after the passability grid changes)
+ */
+void FlowField_Invalidate(FlowField_cfg_t* cfg);
+
+/**
+ * @brief Direction of the next step towards the goal from a tile
+ *
+ * @return Direction, CENTRE at the goal, outside the grid or with no path
+ */
+Direction FlowField_Dir(const FlowField_cfg_t* cfg, uint8_t tx, uint8_t ty);
+
+/**
+ * @brief Steps from a tile to the goal
+ *
+ * @return Distance, FLOWFIELD_UNREACHED if not reachable (or not reached yet)
+ */
+uint16_t FlowField_Distance(const FlowField_cfg_t* cfg, uint8_t tx, uint8_t ty);
+
+/**
+ * @brief Check if the last repair or rebuild has finished
+ */
+uint8_t FlowField_IsReady(const FlowField_cfg_t* cfg);
+
+/**
+ * @brief Benchmark full rebuilds and one-tile repairs on open and maze-like grids up to 60x60
+ *
+ * Prints DWT cycle counts and microseconds per update over UART. Only
+ * compiled with FLOWFIELD_BENCH defined (it needs 16 KB of RAM while running).
+ */
+void FlowField_Bench(void);
+
+#endif // FLOWFIELD_H
@@ -0,0 +1,121 @@
+#include "FlowField.h"
+
+/**
+ * @file FlowField_Bench.c
+ * @brief Update-time benchmark for FlowField (define FLOWFIELD_BENCH to enable)
+ *
+ * For each grid size, times a full rebuild with the goal in the centre on:
+ * - an open grid (every tile passable, the most tiles to visit)
+ * - a maze-like grid (vertical walls every 4 columns with alternating gaps,
+ *   giving long winding paths)
+ * the worst single FlowField_Update() slice when the same rebuild is
+ * spread over frames at FLOWFIELD_BENCH_SLICE tiles per call, and the repair
+ * when the goal then moves one tile (the player walking).
+ */
+
+#ifdef FLOWFIELD_BENCH
+
+#include "main.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_MAX 60
+#define FLOWFIELD_BENCH_SLICE 256
+
+static uint8_t bench_bits[(BENCH_MAX * BENCH_MAX + 7) / 8];
+static uint16_t bench_dist[BENCH_MAX * BENCH_MAX];
+static uint16_t bench_queue[BENCH_MAX * BENCH_MAX];
+static uint8_t bench_dirs[FLOWFIELD_DIR_BYTES(BENCH_MAX, BENCH_MAX)];
+
+static void make_grid(uint8_t size, uint8_t maze)
+{
+    memset(bench_bits, 0, sizeof(bench_bits));
+    for (uint16_t y = 0; y < size; y++) {
+        for (uint16_t x = 0; x < size; x++) {
+            uint8_t wall = 0;
+            if (maze && (x % 4) == 3) {
+                // Gap at the bottom of odd walls, at the top of even walls
+                uint16_t gap_y = ((x / 4) & 1u) ? (size - 1u) : 0;
+                wall = (y != gap_y);
+            }
+            if (!wall) {
+                uint16_t i = y * size + x;
+                bench_bits[i >> 3] |= (uint8_t)(1u << (i & 7u));
+            }
+        }
+    }
+}
+
+static void bench_one(uint8_t size, uint8_t maze)
+{
+    FlowField_cfg_t flow = {
+        .width = size,
+        .height = size,
+        .passable = bench_bits,
+        .dist = bench_dist,
+        .queue = bench_queue,
+        .dirs = bench_dirs,
+        .setup_done = 0
+    };
+    uint8_t goal = size / 2;
+
+    make_grid(size, maze);
+    if (maze && (goal % 4) == 3) {
+        goal--;     // keep the goal off a wall
+    }
+
+    // Full rebuild in one call
+    FlowField_Init(&flow);
+    uint32_t start = DWT->CYCCNT;
+    FlowField_SetGoal(&flow, goal, goal);
+    FlowField_Update(&flow, 0);
+    uint32_t full_cycles = DWT->CYCCNT - start;
+    uint16_t full_tiles = flow.expanded;
+
+    // Same rebuild, sliced
+    FlowField_Invalidate(&flow);
+    FlowField_SetGoal(&flow, goal, goal);
+    uint32_t worst_slice = 0;
+    uint16_t slices = 0;
+    uint8_t done = 0;
+    while (!done) {
+        start = DWT->CYCCNT;
+        done = FlowField_Update(&flow, FLOWFIELD_BENCH_SLICE);
+        uint32_t cycles = DWT->CYCCNT - start;
+        if (cycles > worst_slice) {
+            worst_slice = cycles;
+        }
+        slices++;
+    }
+    uint16_t far_steps = FlowField_Distance(&flow, 0, 0);
+
+    // Goal one tile down (never a maze wall: walls are whole columns)
+    start = DWT->CYCCNT;
+    FlowField_SetGoal(&flow, goal, goal + 1);
+    FlowField_Update(&flow, 0);
+    uint32_t repair_cycles = DWT->CYCCNT - start;
+
+    uint32_t cycles_per_us = SystemCoreClock / 1000000u;
+    printf("FlowField %2ux%-2u %-4s: %7lu cycles (%5lu us), %u slices of %u, worst %lu us, far tile %u steps\n",
+           size, size, maze ? "maze" : "open",
+           (unsigned long)full_cycles, (unsigned long)(full_cycles / cycles_per_us),
+           slices, FLOWFIELD_BENCH_SLICE, (unsigned long)(worst_slice / cycles_per_us), far_steps);
+    printf("FlowField %2ux%-2u %-4s: one-tile move repaired in %lu us, %u of %u tiles expanded\n",
+           size, size, maze ? "maze" : "open", (unsigned long)(repair_cycles / cycles_per_us),
+           flow.expanded, full_tiles);
+}
+
+void FlowField_Bench(void)
+{
+    static const uint8_t sizes[] = {16, 32, 48, 60};
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    for (uint8_t s = 0; s < sizeof(sizes); s++) {
+        bench_one(sizes[s], 0);
+        bench_one(sizes[s], 1);
+    }
+}
+
+#endif // FLOWFIELD_BENCH
@@ -0,0 +1,248 @@
+#include "IrqLat.h"
+
+/**
+ * @file IrqLat.c
+ * @brief Implementation of the interrupt latency probes and handler statistics
+ */
+
+#ifdef IRQ_LATENCY
+
+#include <stdio.h>
+#include <string.h>
+
+// Timer probe ticks are 2 cycles: the 16-bit counter then covers 819 us at 80 MHz
+#define IRQLAT_TIMER_PRESCALER 2
+
+static uint8_t bucket(uint32_t cycles)
+{
+    int8_t b = 28 - (int8_t)__CLZ(cycles | 1u);    // 31 - clz - 3: < 16 cycles -> 0
+
+    if (b < 0) {
+        b = 0;
+    }
+    if (b >= IRQLAT_BUCKETS) {
+        b = IRQLAT_BUCKETS - 1;
+    }
+    return (uint8_t)b;
+}
+
+// Lower bound of a bucket in cycles, for reports
+static uint32_t bucket_floor(uint8_t b)
+{
+    return b ? (1u << (b + 3)) : 0;
+}
+
+// One latency sample for a probe whose event happened at 'event' (cycle count)
+static void sample(IrqLat_cfg_t* cfg, IrqLat_Probe_t* probe, uint32_t latency, uint32_t event)
+{
+    if (probe->samples == 0 || latency < probe->min_cycles) {
+        probe->min_cycles = latency;
+    }
+    if (latency > probe->max_cycles) {
+        probe->max_cycles = latency;
+    }
+    probe->hist[bucket(latency)]++;
+    probe->samples++;
+
+    if (latency <= cfg->inversion_cycles) {
+        return;
+    }
+
+    // Waiting behind a handler of the same or a higher priority is expected.
+    // If none finished since the event, what held us up was masking by
+    // lower-priority code.
+    for (uint8_t level = 0; level <= probe->priority; level++) {
+        if ((int32_t)(cfg->last_exit[level] - event) > 0) {
+            return;
+        }
+    }
+    probe->inversions++;
+    if (latency > probe->max_inversion_cycles) {
+        probe->max_inversion_cycles = latency;
+    }
+}
+
+void IrqLat_Init(IrqLat_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    IrqLat_Reset(cfg);
+    for (uint8_t i = 0; i < cfg->irq_count; i++) {
+        cfg->irqs[i].priority = (uint8_t)NVIC_GetPriority(cfg->irqs[i].irqn);
+    }
+    for (uint8_t i = 0; i < cfg->probe_count; i++) {
+        HAL_NVIC_SetPriority(cfg->probes[i].irqn, cfg->probes[i].priority, 0);
+        HAL_NVIC_EnableIRQ(cfg->probes[i].irqn);
+    }
+    cfg->next_probe = 1;
+
+    // Timer probe: update event every period_us, counter restarts from 0
+    if (cfg->timer == TIM6) {
+        __HAL_RCC_TIM6_CLK_ENABLE();
+    }
+    else {
+        __HAL_RCC_TIM7_CLK_ENABLE();
+    }
+    cfg->timer->CR1 = 0;
+    cfg->timer->PSC = IRQLAT_TIMER_PRESCALER - 1;
+    cfg->timer->ARR = (uint32_t)cfg->period_us * (SystemCoreClock / 1000000u) / IRQLAT_TIMER_PRESCALER - 1;
+    cfg->timer->EGR = TIM_EGR_UG;
+    cfg->timer->SR = 0;
+    cfg->timer->DIER = TIM_DIER_UIE;
+    cfg->timer->CR1 = TIM_CR1_CEN;
+
+    cfg->setup_done = 1;
+}
+
+void IrqLat_Enter(IrqLat_cfg_t* cfg, uint8_t irq)
+{
+    if (!cfg->setup_done || irq >= cfg->irq_count) {
+        return;
+    }
+
+    IrqLat_Irq_t* entry = &cfg->irqs[irq];
+    uint32_t now = DWT->CYCCNT;
+
+    if (entry->period_us && entry->count) {
+        int32_t jitter = (int32_t)(now - entry->last_enter_cycles) -
+                         (int32_t)(entry->period_us * (SystemCoreClock / 1000000u));
+        if (jitter < 0) {
+            jitter = -jitter;
+        }
+        if ((uint32_t)jitter > entry->max_jitter_cycles) {
+            entry->max_jitter_cycles = (uint32_t)jitter;
+        }
+    }
+    entry->last_enter_cycles = now;
+    entry->enter_cycles = now;
+}
+
+void IrqLat_Exit(IrqLat_cfg_t* cfg, uint8_t irq)
+{
+    if (!cfg->setup_done || irq >= cfg->irq_count) {
+        return;
+    }
+
+    IrqLat_Irq_t* entry = &cfg->irqs[irq];
+    uint32_t now = DWT->CYCCNT;
+    uint32_t run = now - entry->enter_cycles;
+
+    entry->count++;
+    entry->run_hist[bucket(run)]++;
+    if (run > entry->max_run_cycles) {
+        entry->max_run_cycles = run;
+    }
+    cfg->last_exit[entry->priority & (IRQLAT_LEVELS - 1)] = now;
+}
+
+void IrqLat_TimerIRQHandler(IrqLat_cfg_t* cfg)
+{
+    // Read the counter first: it started from 0 at the update event
+    uint32_t latency = cfg->timer->CNT * IRQLAT_TIMER_PRESCALER;
+    uint32_t now = DWT->CYCCNT;
+
+    cfg->timer->SR = ~TIM_SR_UIF;
+    if (!cfg->setup_done) {
+        return;
+    }
+    sample(cfg, &cfg->probes[0], latency, now - latency);
+
+    // Pend one software probe; it runs when this handler (and anything at
+    // its level or above) is done
+    if (cfg->probe_count > 1) {
+        IrqLat_Probe_t* probe = &cfg->probes[cfg->next_probe];
+
+        if (++cfg->next_probe >= cfg->probe_count) {
+            cfg->next_probe = 1;
+        }
+        probe->pend_cycles = DWT->CYCCNT;
+        NVIC_SetPendingIRQ(probe->irqn);
+    }
+}
+
+void IrqLat_ProbeIRQHandler(IrqLat_cfg_t* cfg, uint8_t probe)
+{
+    uint32_t now = DWT->CYCCNT;
+
+    if (!cfg->setup_done || probe == 0 || probe >= cfg->probe_count) {
+        return;
+    }
+    uint32_t pended = cfg->probes[probe].pend_cycles;
+    sample(cfg, &cfg->probes[probe], now - pended, pended);
+}
+
+// " 16:830 32:150 ..." for the non-empty buckets
+static void print_hist(const uint32_t* hist)
+{
+    for (uint8_t b = 0; b < IRQLAT_BUCKETS; b++) {
+        if (hist[b]) {
+            printf(" %s%lu:%lu", b == IRQLAT_BUCKETS - 1 ? ">=" : "",
+                   (unsigned long)bucket_floor(b), (unsigned long)hist[b]);
+        }
+    }
+    printf("\n");
+}
+
+void IrqLat_Print(IrqLat_cfg_t* cfg, void (*between_lines)(void))
+{
+    printf("IRQ latency in cycles at %lu MHz (histogram: bucket floor:count)\n",
+           (unsigned long)(SystemCoreClock / 1000000u));
+
+    for (uint8_t i = 0; i < cfg->probe_count; i++) {
+        IrqLat_Probe_t* probe = &cfg->probes[i];
+
+        printf("  %s p%u: %lu samples, min %lu max %lu jitter %lu, %lu inversions (max %lu) |",
+               probe->name, probe->priority, (unsigned long)probe->samples,
+               (unsigned long)probe->min_cycles, (unsigned long)probe->max_cycles,
+               (unsigned long)(probe->max_cycles - probe->min_cycles),
+               (unsigned long)probe->inversions, (unsigned long)probe->max_inversion_cycles);
+        print_hist(probe->hist);
+        if (between_lines) {
+            between_lines();
+        }
+    }
+
+    for (uint8_t i = 0; i < cfg->irq_count; i++) {
+        IrqLat_Irq_t* entry = &cfg->irqs[i];
+
+        printf("  %s p%u: %lu runs, max %lu", entry->name, entry->priority,
+               (unsigned long)entry->count, (unsigned long)entry->max_run_cycles);
+        if (entry->period_us) {
+            printf(", period jitter %lu", (unsigned long)entry->max_jitter_cycles);
+        }
+        printf(" |");
+        print_hist(entry->run_hist);
+        if (between_lines) {
+            between_lines();
+        }
+    }
+}
+
+void IrqLat_Reset(IrqLat_cfg_t* cfg)
+{
+    for (uint8_t i = 0; i < cfg->probe_count; i++) {
+        IrqLat_Probe_t* probe = &cfg->probes[i];
+
+        probe->samples = 0;
+        probe->min_cycles = 0;
+        probe->max_cycles = 0;
+        probe->inversions = 0;
+        probe->max_inversion_cycles = 0;
+        memset(probe->hist, 0, sizeof(probe->hist));
+    }
+    for (uint8_t i = 0; i < cfg->irq_count; i++) {
+        IrqLat_Irq_t* entry = &cfg->irqs[i];
+
+        entry->count = 0;
+        entry->max_run_cycles = 0;
+        entry->max_jitter_cycles = 0;
+        memset(entry->run_hist, 0, sizeof(entry->run_hist));
+    }
+}
+
+#endif // IRQ_LATENCY
@@ -0,0 +1,169 @@
+#ifndef IRQLAT_H
+#define IRQLAT_H
+
+#include <stdint.h>
+#include "main.h"
+
+/**
+ * @file IrqLat.h
+ * @brief Interrupt latency and jitter measurement (priority plan checking)
+ *
+ * Latency is the time from the event that raises an interrupt to the first
+ * instruction of its handler. Most peripherals do not say when their event
+ * happened, so latency is measured with probes whose event time is known:
+ * - a timer probe: a basic timer (TIM7) whose counter restarts at 0 on the
+ *   update event, so the counter read at handler entry is exactly the time
+ *   since the event
+ * - software probes: spare interrupt vectors set to the priority levels of
+ *   the real handlers and pended (one per timer tick, round robin) with a
+ *   cycle-counter timestamp
+ * The timer runs asynchronously to the frame, so the probes sample "an
+ * interrupt at this level fires now: how long does it wait?" at random
+ * points in the workload. Per probe: minimum, maximum (max - min is the
+ * jitter) and a log2 histogram.
+ *
+ * The real handlers are bracketed with IrqLat_Enter() / IrqLat_Exit(), which
+ * record how long each one runs (what the others wait behind), with a
+ * histogram, and for periodic ones the jitter of the interval between
+ * entries.
+ *
+ * A probe sample that waited longer than inversion_cycles while no handler
+ * at the same or a higher priority finished in the meantime was held up by
+ * lower-priority code masking interrupts (a __disable_irq() section in the
+ * main loop, or in a lower-priority handler): a priority inversion. These
+ * are counted per probe.
+ *
+ * Only built into the firmware with IRQ_LATENCY defined (configure with
+ * -DIRQ_LATENCY=ON): the timer probe interrupts 1000 times a second at the
+ * highest priority.
+ *
+ * Example usage:
+ * @code
+ * IrqLat_Irq_t irqs[2] = {
+ *     {"systick", SysTick_IRQn, 1000},       // periodic, 1000 us
+ *     {"usart3", USART3_IRQn, 0},
+ * };
+ * IrqLat_Probe_t probes[2] = {
+ *     {"tim7", TIM7_IRQn, 0},                // the timer probe comes first
+ *     {"p5", COMP_IRQn, 5},                  // software probe at priority 5
+ * };
+ * IrqLat_cfg_t lat = {
+ *     .irqs = irqs, .irq_count = 2,
+ *     .probes = probes, .probe_count = 2,
+ *     .timer = TIM7, .period_us = 1003,
+ *     .inversion_cycles = 400,
+ *     .setup_done = 0
+ * };
+ *
+ * IrqLat_Init(&lat);          // after every interrupt priority is set
+ *
+ * void USART3_IRQHandler(void) {
+ *     IrqLat_Enter(&lat, 1);
+ *     ...
+ *     IrqLat_Exit(&lat, 1);
+ * }
+ * void TIM7_IRQHandler(void) { IrqLat_TimerIRQHandler(&lat); }
+ * void COMP_IRQHandler(void) { IrqLat_ProbeIRQHandler(&lat, 1); }
+ *
+ * IrqLat_Print(&lat, NULL);   // tables over UART
+ * @endcode
+ */
+
+#define IRQLAT_BUCKETS 12       // Bucket 0: < 16 cycles, bucket b: [2^(b+3), 2^(b+4)), last: everything above
+#define IRQLAT_LEVELS 16        // NVIC priority levels (4 bits on the STM32L4)
+
+/**
+ * @struct IrqLat_Irq_t
+ * @brief One instrumented interrupt handler and its statistics
+ */
+typedef struct {
+    const char* name;               ///< For reports
+    IRQn_Type irqn;                 ///< For its priority (read at IrqLat_Init())
+    uint16_t period_us;             ///< Expected period for interval jitter (0 = not periodic)
+
+    uint32_t count;                 ///< Handler runs
+    uint32_t max_run_cycles;        ///< Longest handler run (including anything nesting in it)
+    uint32_t max_jitter_cycles;     ///< Largest |interval - period| (periodic only)
+    uint32_t run_hist[IRQLAT_BUCKETS];  ///< Handler run time histogram
+    uint8_t priority;               ///< Internal: NVIC priority level
+    uint32_t enter_cycles;          ///< Internal: cycle count at entry
+    uint32_t last_enter_cycles;     ///< Internal: previous entry (interval)
+} IrqLat_Irq_t;
+
+/**
+ * @struct IrqLat_Probe_t
+ * @brief One latency probe and its statistics
+ */
+typedef struct {
+    const char* name;               ///< For reports
+    IRQn_Type irqn;                 ///< Timer interrupt (probe 0) or a spare vector
+    uint8_t priority;               ///< Priority level probed (set by IrqLat_Init())
+
+    uint32_t samples;               ///< Latency samples taken
+    uint32_t min_cycles;            ///< Shortest latency
+    uint32_t max_cycles;            ///< Longest latency (max - min = jitter)
+    uint32_t inversions;            ///< Samples held up by lower-priority code
+    uint32_t max_inversion_cycles;  ///< Longest of those
+    uint32_t hist[IRQLAT_BUCKETS];  ///< Latency histogram
+    volatile uint32_t pend_cycles;  ///< Internal: cycle count when pended (software probes)
+} IrqLat_Probe_t;
+
+/**
+ * @struct IrqLat_cfg_t
+ * @brief Latency harness configuration and state
+ */
+typedef struct {
+    IrqLat_Irq_t* irqs;             ///< Instrumented handlers
+    uint8_t irq_count;
+    IrqLat_Probe_t* probes;         ///< Probe 0 is the timer, the rest are software probes
+    uint8_t probe_count;
+    TIM_TypeDef* timer;             ///< Basic timer for probe 0 (TIM6 or TIM7), clocked at HCLK
+    uint16_t period_us;             ///< Timer probe period (not a multiple of the frame or tick periods)
+    uint16_t inversion_cycles;      ///< Latency above this with no higher-priority work counts as an inversion
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+
+    uint8_t next_probe;             ///< Internal: software probe pended on the next timer tick
+    uint32_t last_exit[IRQLAT_LEVELS];  ///< Internal: cycle count of the last handler exit per level
+} IrqLat_cfg_t;
+
+/**
+ * @brief Read the handler priorities, set the probe priorities and start the timer probe
+ *
+ * Call after every interrupt priority has been configured.
+ */
+void IrqLat_Init(IrqLat_cfg_t* cfg);
+
+/**
+ * @brief First thing in an instrumented handler
+ */
+void IrqLat_Enter(IrqLat_cfg_t* cfg, uint8_t irq);
+
+/**
+ * @brief Last thing in an instrumented handler
+ */
+void IrqLat_Exit(IrqLat_cfg_t* cfg, uint8_t irq);
+
+/**
+ * @brief Timer probe interrupt handler (probe 0)
+ */
+void IrqLat_TimerIRQHandler(IrqLat_cfg_t* cfg);
+
+/**
+ * @brief Software probe interrupt handler
+ */
+void IrqLat_ProbeIRQHandler(IrqLat_cfg_t* cfg, uint8_t probe);
+
+/**
+ * @brief Print the probe and handler tables over UART (printf)
+ *
+ * @param between_lines Called after each line (e.g. to let urgent tasks run
+ *                      while the UART is busy), may be NULL
+ */
+void IrqLat_Print(IrqLat_cfg_t* cfg, void (*between_lines)(void));
+
+/**
+ * @brief Clear all statistics
+ */
+void IrqLat_Reset(IrqLat_cfg_t* cfg);
+
+#endif // IRQLAT_H
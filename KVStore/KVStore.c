@@ -0,0 +1,524 @@
+#include "KVStore.h"
+#include <string.h>
+
+/**
+ * @file KVStore.c
+ * @brief Implementation of the log-structured flash key-value store
+ */
+
+#define KV_PAGE_SIZE FLASH_PAGE_SIZE
+#define KV_REC_MAGIC 0xB7u
+#define KV_ERASED 0xFFFFFFFFu
+#define KV_FLASH_ERRORS (FLASH_SR_OPERR | FLASH_SR_PROGERR | FLASH_SR_WRPERR | FLASH_SR_PGAERR | \
+                         FLASH_SR_SIZERR | FLASH_SR_PGSERR | FLASH_SR_MISERR | FLASH_SR_FASTERR | \
+                         FLASH_SR_RDERR)
+
+// Bytes a record takes in flash: header double-word plus the value in whole double-words
+#define REC_SIZE(len) (8u + (((uint32_t)(len) + 7u) & ~7u))
+
+enum {
+    KV_OP_NONE = 0,
+    KV_OP_PROGRAM,
+    KV_OP_ERASE
+};
+
+enum {
+    KV_STAGE_NONE = 0,
+    KV_STAGE_PAGE,      // page header (opens a new page)
+    KV_STAGE_QUEUE,     // first record in the queue
+    KV_STAGE_COPY       // live record copied out of the tail page
+};
+
+static inline uint32_t flash_read(uint32_t addr)
+{
+    return *(const volatile uint32_t*)addr;
+}
+
+static inline uint32_t page_addr(const KV_cfg_t* cfg, uint8_t page)
+{
+    return cfg->base + (uint32_t)page * KV_PAGE_SIZE;
+}
+
+static uint32_t record_hash(uint32_t header, const uint8_t* value, uint16_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        hash = (hash ^ (uint8_t)(header >> (8 * i))) * 16777619u;
+    }
+    for (uint16_t i = 0; i < len; i++) {
+        hash = (hash ^ value[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint8_t header_valid(uint32_t header)
+{
+    return (header & 0xFFu) == KV_REC_MAGIC &&
+           ((header >> 8) & 0xFFu) < KV_MAX_KEYS &&
+           (header >> 16) <= KV_MAX_VALUE;
+}
+
+static uint8_t page_is_erased(const KV_cfg_t* cfg, uint8_t page)
+{
+    uint32_t addr = page_addr(cfg, page);
+
+    for (uint32_t offset = 0; offset < KV_PAGE_SIZE; offset += 4) {
+        if (flash_read(addr + offset) != KV_ERASED) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint8_t erased_pages(const KV_cfg_t* cfg)
+{
+    uint8_t count = 0;
+
+    for (uint8_t p = 0; p < cfg->page_count; p++) {
+        if (cfg->page_seq[p] == 0 && !(cfg->dirty_pages & (1u << p))) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Index every valid record of a page; returns the first free address
+static uint32_t scan_page(KV_cfg_t* cfg, uint8_t page)
+{
+    uint32_t end = page_addr(cfg, page) + KV_PAGE_SIZE;
+    uint32_t pos = page_addr(cfg, page) + 8;
+
+    while (pos + 8 <= end) {
+        uint32_t header = flash_read(pos);
+        if (header == KV_ERASED) {
+            return pos;
+        }
+        if (!header_valid(header)) {
+            return end;     // damaged page: nothing more is appended to it
+        }
+        uint16_t len = (uint16_t)(header >> 16);
+        if (pos + REC_SIZE(len) > end) {
+            return end;
+        }
+        // A record torn by a reset fails its checksum and is skipped
+        if (flash_read(pos + 4) == record_hash(header, (const uint8_t*)(pos + 8), len)) {
+            cfg->index[(header >> 8) & 0xFFu] = len ? pos : 0;
+        }
+        pos += REC_SIZE(len);
+    }
+    return end;
+}
+
+// ===== FLASH OPERATIONS =====
+// Each starts one operation and returns; KV_Service() finishes it once BSY clears
+
+static void program_next(KV_cfg_t* cfg)
+{
+    volatile uint32_t* dst = (volatile uint32_t*)(cfg->stage_addr + (uint32_t)cfg->stage_pos * 8u);
+    const uint32_t* src = &cfg->stage_buf[cfg->stage_pos * 2u];
+
+    HAL_FLASH_Unlock();
+    FLASH->SR = KV_FLASH_ERRORS;
+    FLASH->CR |= FLASH_CR_PG;
+    dst[0] = src[0];
+    __ISB();
+    dst[1] = src[1];
+
+    cfg->stage_pos++;
+    cfg->busy = KV_OP_PROGRAM;
+    cfg->stats.double_words++;
+}
+
+static void start_erase(KV_cfg_t* cfg, uint8_t page)
+{
+    uint32_t offset = page_addr(cfg, page) - FLASH_BASE;
+    uint32_t pnb = (offset % FLASH_BANK_SIZE) / KV_PAGE_SIZE;
+    uint32_t cr;
+
+    HAL_FLASH_Unlock();
+    FLASH->SR = KV_FLASH_ERRORS;
+    cr = FLASH->CR & ~(FLASH_CR_PNB_Msk | FLASH_CR_BKER);
+    cr |= FLASH_CR_PER | (pnb << FLASH_CR_PNB_Pos);
+    if (offset >= FLASH_BANK_SIZE) {
+        cr |= FLASH_CR_BKER;
+    }
+    FLASH->CR = cr;
+    FLASH->CR |= FLASH_CR_STRT;
+
+    cfg->erase_page = page;
+    cfg->busy = KV_OP_ERASE;
+}
+
+static void finish_op(KV_cfg_t* cfg)
+{
+    uint32_t sr = FLASH->SR;
+    uint8_t failed = (sr & KV_FLASH_ERRORS) != 0;
+
+    FLASH->CR &= ~(FLASH_CR_PG | FLASH_CR_PER);
+    if (failed) {
+        FLASH->SR = KV_FLASH_ERRORS;
+        cfg->stats.flash_errors++;
+    }
+
+    // The data cache may still hold the words as they were before the program
+    // or erase (HAL_FLASH_Program and HAL_FLASHEx_Erase flush it the same way)
+    if (FLASH->ACR & FLASH_ACR_DCEN) {
+        __HAL_FLASH_DATA_CACHE_DISABLE();
+        __HAL_FLASH_DATA_CACHE_RESET();
+        __HAL_FLASH_DATA_CACHE_ENABLE();
+    }
+
+    if (cfg->busy == KV_OP_PROGRAM) {
+        cfg->stage_error |= failed;
+    }
+    else if (cfg->busy == KV_OP_ERASE) {
+        uint8_t page = cfg->erase_page;
+
+        cfg->stats.erases++;
+
+        if (failed) {
+            cfg->dirty_pages |= (uint8_t)(1u << page);     // try again
+        }
+        else {
+            cfg->dirty_pages &= (uint8_t)~(1u << page);
+        }
+        if (cfg->compacting && page == cfg->tail_page) {
+            cfg->page_seq[page] = 0;
+            cfg->compacting = 0;
+            do {
+                cfg->tail_page = (uint8_t)((cfg->tail_page + 1u) % cfg->page_count);
+            } while (cfg->page_seq[cfg->tail_page] == 0 && cfg->tail_page != cfg->head_page);
+        }
+    }
+    cfg->busy = KV_OP_NONE;
+}
+
+// ===== LOG =====
+
+static uint8_t open_page(KV_cfg_t* cfg)
+{
+    uint8_t page = 0;
+
+    if (cfg->head) {
+        page = (uint8_t)((cfg->head_page + 1u) % cfg->page_count);
+    }
+    else {
+        while (page < cfg->page_count && (cfg->page_seq[page] || (cfg->dirty_pages & (1u << page)))) {
+            page++;
+        }
+    }
+    if (page >= cfg->page_count || cfg->page_seq[page] || (cfg->dirty_pages & (1u << page))) {
+        return 0;   // no erased page yet (compaction or an erase still to come)
+    }
+
+    cfg->stage_buf[0] = KV_PAGE_MAGIC;
+    cfg->stage_buf[1] = cfg->next_seq;
+    cfg->stage = KV_STAGE_PAGE;
+    cfg->stage_addr = page_addr(cfg, page);
+    cfg->stage_dw = 1;
+    cfg->stage_pos = 0;
+    cfg->stage_error = 0;
+    return 1;
+}
+
+static void stage_record(KV_cfg_t* cfg, uint8_t stage, uint8_t key, const uint8_t* value, uint16_t len)
+{
+    uint32_t header = KV_REC_MAGIC | ((uint32_t)key << 8) | ((uint32_t)len << 16);
+
+    memset(cfg->stage_buf, 0xFF, sizeof(cfg->stage_buf));
+    memcpy(&cfg->stage_buf[2], value, len);
+    cfg->stage_buf[0] = header;
+    cfg->stage_buf[1] = record_hash(header, value, len);
+
+    cfg->stage = stage;
+    cfg->stage_addr = cfg->head;
+    cfg->stage_dw = (uint8_t)(REC_SIZE(len) / 8u);
+    cfg->stage_pos = 0;
+    cfg->stage_error = 0;
+}
+
+// Stage the first queued record, or a new page if it does not fit in this one
+static uint8_t stage_queue(KV_cfg_t* cfg)
+{
+    uint8_t len = cfg->queue[1];
+
+    if (!cfg->head || cfg->head + REC_SIZE(len) > page_addr(cfg, cfg->head_page) + KV_PAGE_SIZE) {
+        return open_page(cfg);
+    }
+    stage_record(cfg, KV_STAGE_QUEUE, cfg->queue[0], &cfg->queue[2], len);
+    return 1;
+}
+
+// Stage the next live record of the tail page, or erase the page when none are left
+static void compact_step(KV_cfg_t* cfg)
+{
+    uint32_t end = page_addr(cfg, cfg->tail_page) + KV_PAGE_SIZE;
+
+    while (cfg->compact_pos + 8 <= end) {
+        uint32_t pos = cfg->compact_pos;
+        uint32_t header = flash_read(pos);
+        if (header == KV_ERASED || !header_valid(header)) {
+            break;
+        }
+        uint8_t key = (uint8_t)(header >> 8);
+        uint16_t len = (uint16_t)(header >> 16);
+        if (pos + REC_SIZE(len) > end) {
+            break;
+        }
+        cfg->compact_pos = pos + REC_SIZE(len);
+
+        if (len && cfg->index[key] == pos) {
+            if (cfg->head + REC_SIZE(len) > page_addr(cfg, cfg->head_page) + KV_PAGE_SIZE) {
+                cfg->stats.flash_errors++;  // more live data than the store can hold: dropped
+                cfg->index[key] = 0;
+                continue;
+            }
+            stage_record(cfg, KV_STAGE_COPY, key, (const uint8_t*)(pos + 8), len);
+            cfg->stage_src = pos;
+            program_next(cfg);
+            return;
+        }
+    }
+    start_erase(cfg, cfg->tail_page);
+}
+
+static void commit_stage(KV_cfg_t* cfg)
+{
+    uint8_t stage = cfg->stage;
+    uint32_t size = (uint32_t)cfg->stage_dw * 8u;
+
+    cfg->stage = KV_STAGE_NONE;
+
+    if (stage == KV_STAGE_PAGE) {
+        uint8_t page = (uint8_t)((cfg->stage_addr - cfg->base) / KV_PAGE_SIZE);
+        if (cfg->stage_error) {
+            cfg->dirty_pages |= (uint8_t)(1u << page);
+            return;
+        }
+        if (!cfg->head) {
+            cfg->tail_page = page;
+        }
+        cfg->page_seq[page] = cfg->next_seq++;
+        cfg->head_page = page;
+        cfg->head = cfg->stage_addr + 8;
+
+        // Always keep an erased page ready: compact the oldest one now
+        if (erased_pages(cfg) == 0) {
+            cfg->compacting = 1;
+            cfg->compact_pos = page_addr(cfg, cfg->tail_page) + 8;
+            cfg->stats.compactions++;
+        }
+        return;
+    }
+
+    // A failed record is skipped in flash (its checksum is wrong) and tried again
+    cfg->head += size;
+    if (cfg->stage_error) {
+        if (stage == KV_STAGE_COPY) {
+            cfg->compact_pos = cfg->stage_src;
+        }
+        return;
+    }
+
+    uint8_t key = (uint8_t)(cfg->stage_buf[0] >> 8);
+    uint16_t len = (uint16_t)(cfg->stage_buf[0] >> 16);
+    cfg->index[key] = len ? cfg->stage_addr : 0;
+    cfg->stats.records_written++;
+
+    if (stage == KV_STAGE_QUEUE) {
+        uint16_t used = 2u + cfg->queue[1];
+        cfg->queue_len -= used;
+        memmove(cfg->queue, &cfg->queue[used], cfg->queue_len);
+    }
+}
+
+// ===== API =====
+
+void KV_Init(KV_cfg_t* cfg)
+{
+    uint8_t valid = 0;
+    uint32_t last_seq = 0;
+
+    if (cfg->setup_done) {
+        return;
+    }
+    if (cfg->page_count < 2 || cfg->page_count > KV_MAX_PAGES || (cfg->base % KV_PAGE_SIZE)) {
+        Error_Handler();
+    }
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    uint32_t start = DWT->CYCCNT;
+
+    memset(cfg->index, 0, sizeof(cfg->index));
+    memset(cfg->page_seq, 0, sizeof(cfg->page_seq));
+    memset(&cfg->stats, 0, sizeof(cfg->stats));
+    cfg->dirty_pages = 0;
+    cfg->head = 0;
+    cfg->head_page = 0;
+    cfg->tail_page = 0;
+    cfg->next_seq = 1;
+    cfg->compacting = 0;
+    cfg->busy = KV_OP_NONE;
+    cfg->stage = KV_STAGE_NONE;
+    cfg->queue_len = 0;
+
+    // Page headers: in use (sequence number), erased, or garbage to erase
+    for (uint8_t p = 0; p < cfg->page_count; p++) {
+        uint32_t addr = page_addr(cfg, p);
+        uint32_t seq = flash_read(addr + 4);
+        if (flash_read(addr) == KV_PAGE_MAGIC && seq != 0 && seq != KV_ERASED) {
+            cfg->page_seq[p] = seq;
+            valid++;
+            if (seq >= cfg->next_seq) {
+                cfg->next_seq = seq + 1;
+            }
+        }
+        else if (!page_is_erased(cfg, p)) {
+            cfg->dirty_pages |= (uint8_t)(1u << p);
+        }
+    }
+
+    // Replay the log oldest page first, so newer records win
+    for (uint8_t i = 0; i < valid; i++) {
+        uint8_t page = 0;
+        uint32_t best = KV_ERASED;
+        for (uint8_t p = 0; p < cfg->page_count; p++) {
+            if (cfg->page_seq[p] > last_seq && cfg->page_seq[p] < best) {
+                best = cfg->page_seq[p];
+                page = p;
+            }
+        }
+        last_seq = best;
+        if (i == 0) {
+            cfg->tail_page = page;
+        }
+        cfg->head_page = page;
+        cfg->head = scan_page(cfg, page);
+    }
+
+    // Reset during a compaction: finish it (records already copied are skipped)
+    if (valid && erased_pages(cfg) == 0 && !cfg->dirty_pages) {
+        cfg->compacting = 1;
+        cfg->compact_pos = page_addr(cfg, cfg->tail_page) + 8;
+    }
+
+    cfg->stats.index_build_cycles = DWT->CYCCNT - start;
+    cfg->setup_done = 1;
+}
+
+uint16_t KV_Get(KV_cfg_t* cfg, uint8_t key, void* value, uint16_t size)
+{
+    const uint8_t* pending = NULL;
+    uint16_t pos = 0;
+    uint16_t len;
+
+    if (key >= KV_MAX_KEYS) {
+        return 0;
+    }
+
+    // The newest queued value wins over flash
+    while (pos < cfg->queue_len) {
+        if (cfg->queue[pos] == key) {
+            pending = &cfg->queue[pos];
+        }
+        pos += 2u + cfg->queue[pos + 1];
+    }
+
+    if (pending) {
+        len = pending[1];
+        memcpy(value, &pending[2], (len < size) ? len : size);
+        return len;
+    }
+    if (!cfg->index[key]) {
+        return 0;
+    }
+    len = (uint16_t)(flash_read(cfg->index[key]) >> 16);
+    memcpy(value, (const void*)(cfg->index[key] + 8), (len < size) ? len : size);
+    return len;
+}
+
+uint8_t KV_Set(KV_cfg_t* cfg, uint8_t key, const void* value, uint16_t len)
+{
+    if (key >= KV_MAX_KEYS || len > KV_MAX_VALUE || (len == 0 && value)) {
+        return 0;
+    }
+    if (cfg->queue_len + 2u + len > KV_QUEUE_SIZE) {
+        cfg->stats.queue_full++;
+        return 0;
+    }
+
+    cfg->queue[cfg->queue_len] = key;
+    cfg->queue[cfg->queue_len + 1] = (uint8_t)len;
+    if (len) {
+        memcpy(&cfg->queue[cfg->queue_len + 2], value, len);
+    }
+    cfg->queue_len += 2u + len;
+    return 1;
+}
+
+uint8_t KV_Delete(KV_cfg_t* cfg, uint8_t key)
+{
+    return KV_Set(cfg, key, NULL, 0);
+}
+
+void KV_Service(KV_cfg_t* cfg)
+{
+    if (!cfg->setup_done || (FLASH->SR & FLASH_SR_BSY)) {
+        return;
+    }
+    uint32_t start = DWT->CYCCNT;
+
+    if (cfg->busy != KV_OP_NONE) {
+        finish_op(cfg);
+    }
+
+    if (cfg->stage != KV_STAGE_NONE && !cfg->stage_error && cfg->stage_pos < cfg->stage_dw) {
+        program_next(cfg);
+    }
+    else {
+        if (cfg->stage != KV_STAGE_NONE) {
+            commit_stage(cfg);
+        }
+
+        // Garbage pages first, then compaction (so an erased page is always
+        // ready), then new records
+        if (cfg->dirty_pages) {
+            uint8_t page = 0;
+            while (!(cfg->dirty_pages & (1u << page))) {
+                page++;
+            }
+            start_erase(cfg, page);
+        }
+        else if (cfg->compacting) {
+            compact_step(cfg);
+        }
+        else if (cfg->queue_len && stage_queue(cfg)) {
+            program_next(cfg);
+        }
+    }
+
+    if (cfg->busy == KV_OP_NONE) {
+        HAL_FLASH_Lock();
+    }
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    if (cycles > cfg->stats.max_service_cycles) {
+        cfg->stats.max_service_cycles = cycles;
+    }
+}
+
+uint8_t KV_IsBusy(const KV_cfg_t* cfg)
+{
+    return cfg->queue_len || cfg->stage != KV_STAGE_NONE || cfg->busy != KV_OP_NONE ||
+           cfg->compacting || cfg->dirty_pages;
+}
+
+void KV_GetStats(KV_cfg_t* cfg, KV_Stats_t* stats, uint8_t reset)
+{
+    *stats = cfg->stats;
+    if (reset) {
+        cfg->stats.max_service_cycles = 0;
+    }
+}
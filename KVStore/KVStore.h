@@ -0,0 +1,168 @@
+#ifndef KVSTORE_H
+#define KVSTORE_H
+
+#include <stdint.h>
+#include "main.h"
+
+/**
+ * @file KVStore.h
+ * @brief Wear-levelled key-value store in flash with non-blocking writes
+ *
+ * Settings, calibration and high scores are kept in a few flash pages
+ * reserved at the end of bank 2 (the linker script keeps code out of them).
+ * The pages are a log: a new value is appended as a record, never written
+ * over the old one, so every page is erased only once per lap of the log.
+ *
+ * Nothing blocks. KV_Set() only queues the record in RAM (KV_Get() sees it
+ * at once); KV_Service(), called from a scheduler task, starts at most one
+ * flash operation per call - one double-word (8-byte) program or one page
+ * erase - and returns. The code runs from bank 1, so the CPU keeps
+ * executing while bank 2 is busy; only a KV_Get() from flash during a page
+ * erase waits for it (~22 ms).
+ *
+ * When the log reaches its last erased page, the oldest page is compacted
+ * in the background: its records that are still current are copied to the
+ * head of the log, then it is erased. Up to (page_count - 2) pages of live
+ * data fit.
+ *
+ * Lookup is O(1): a RAM index holds the flash address of the latest record
+ * of every key. It is rebuilt at boot by walking the record headers (a few
+ * KB of flash reads, well under a millisecond; the time is in the stats).
+ * A record interrupted by a reset fails its checksum and is ignored.
+ *
+ * Flash layout (all little-endian 32-bit words):
+ *   page:   KV_PAGE_MAGIC, sequence number, records...
+ *   record: 0xB7 | key << 8 | length << 16, FNV-1a of (first word + value),
+ *           value padded with 0xFF to a multiple of 8 bytes
+ * A record with length 0 deletes the key.
+ *
+ * Example usage:
+ * @code
+ * KV_cfg_t kv = {
+ *     .base = 0x080FE000,     // last 4 pages of bank 2
+ *     .page_count = 4,
+ *     .setup_done = 0
+ * };
+ *
+ * KV_Init(&kv);               // builds the index
+ *
+ * uint16_t best;
+ * if (KV_Get(&kv, KEY_HIGH_SCORE, &best, sizeof(best)) != sizeof(best)) {
+ *     best = 0;
+ * }
+ * KV_Set(&kv, KEY_HIGH_SCORE, &best, sizeof(best));
+ *
+ * // Every few milliseconds (a scheduler task):
+ * KV_Service(&kv);
+ * @endcode
+ */
+
+#define KV_MAX_KEYS 32          // Keys are 0 .. KV_MAX_KEYS-1
+#define KV_MAX_VALUE 64         // Largest value in bytes
+#define KV_MAX_PAGES 8
+#define KV_QUEUE_SIZE 256       // RAM queue for records waiting to be written
+#define KV_PAGE_MAGIC 0x3153564Bu   // "KVS1"
+
+/**
+ * @struct KV_Stats_t
+ * @brief Store activity counters
+ */
+typedef struct {
+    uint32_t index_build_cycles;    ///< CPU cycles KV_Init() took to build the index
+    uint32_t records_written;       ///< Records programmed (including compaction copies)
+    uint32_t double_words;          ///< 8-byte flash programs
+    uint32_t erases;                ///< Pages erased
+    uint32_t compactions;           ///< Pages compacted
+    uint32_t queue_full;            ///< KV_Set() calls rejected because the queue was full
+    uint32_t flash_errors;          ///< Program/erase errors reported by the flash controller
+    uint32_t max_service_cycles;    ///< Longest KV_Service() call
+} KV_Stats_t;
+
+/**
+ * @struct KV_cfg_t
+ * @brief Key-value store configuration and state
+ */
+typedef struct {
+    uint32_t base;                          ///< Flash address of the first page (page aligned, ideally bank 2)
+    uint8_t page_count;                     ///< Pages in the store (2 .. KV_MAX_PAGES)
+    uint8_t setup_done;                     ///< Internal flag: 1 if initialised, 0 otherwise
+
+    uint32_t index[KV_MAX_KEYS];            ///< Internal: flash address of each key's record, 0 if none
+    uint32_t page_seq[KV_MAX_PAGES];        ///< Internal: sequence number of each page, 0 if erased
+    uint8_t dirty_pages;                    ///< Internal: bitmask of pages holding garbage (to erase)
+    uint8_t head_page;                      ///< Internal: page being appended to
+    uint8_t tail_page;                      ///< Internal: oldest page
+    uint32_t head;                          ///< Internal: next free address, 0 if no page is open
+    uint32_t next_seq;                      ///< Internal: sequence number for the next page opened
+    uint8_t compacting;                     ///< Internal flag: copying live records out of the tail page
+    uint32_t compact_pos;                   ///< Internal: next record to look at in the tail page
+
+    uint8_t busy;                           ///< Internal: flash operation in progress (KV_OP_*)
+    uint8_t erase_page;                     ///< Internal: page being erased
+    uint8_t stage;                          ///< Internal: what the staged record is (KV_STAGE_*)
+    uint32_t stage_addr;                    ///< Internal: where the staged record goes
+    uint8_t stage_dw;                       ///< Internal: double-words in the staged record
+    uint8_t stage_pos;                      ///< Internal: double-words programmed so far
+    uint8_t stage_error;                    ///< Internal flag: programming the staged record failed
+    uint32_t stage_src;                     ///< Internal: source of a compaction copy
+    uint32_t stage_buf[2 + KV_MAX_VALUE / 4];   ///< Internal: record being programmed
+
+    uint8_t queue[KV_QUEUE_SIZE];           ///< Internal: pending records (key, length, value)
+    uint16_t queue_len;                     ///< Internal: bytes used in the queue
+    KV_Stats_t stats;                       ///< Internal: read with KV_GetStats()
+} KV_cfg_t;
+
+/**
+ * @brief Build the RAM index from flash
+ *
+ * Pages that hold neither records nor erased flash are queued for erasing.
+ * Does not erase or program anything itself.
+ */
+void KV_Init(KV_cfg_t* cfg);
+
+/**
+ * @brief Read a value
+ *
+ * @param value Buffer for the value
+ * @param size Size of the buffer (a longer value is truncated)
+ * @return Length of the stored value, 0 if the key has no value
+ */
+uint16_t KV_Get(KV_cfg_t* cfg, uint8_t key, void* value, uint16_t size);
+
+/**
+ * @brief Store a value (queued; written to flash by KV_Service())
+ *
+ * @param len 1 .. KV_MAX_VALUE bytes
+ * @return 1 if queued, 0 if the key or length is invalid or the queue is full
+ */
+uint8_t KV_Set(KV_cfg_t* cfg, uint8_t key, const void* value, uint16_t len);
+
+/**
+ * @brief Delete a key (queued like KV_Set())
+ *
+ * @return 1 if queued, 0 otherwise
+ */
+uint8_t KV_Delete(KV_cfg_t* cfg, uint8_t key);
+
+/**
+ * @brief Advance background work: at most one flash program or erase per call
+ *
+ * Call every few milliseconds. Returns immediately while the flash is busy.
+ */
+void KV_Service(KV_cfg_t* cfg);
+
+/**
+ * @brief Check if writes are still pending
+ *
+ * @return 1 if records are queued or a flash operation is running
+ */
+uint8_t KV_IsBusy(const KV_cfg_t* cfg);
+
+/**
+ * @brief Get the activity counters
+ *
+ * @param reset 1 to clear the maximums after reading
+ */
+void KV_GetStats(KV_cfg_t* cfg, KV_Stats_t* stats, uint8_t reset);
+
+#endif // KVSTORE_H
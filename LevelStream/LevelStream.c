@@ -0,0 +1,338 @@
+#include "LevelStream.h"
+#include <string.h>
+
+/**
+ * @file LevelStream.c
+ * @brief Implementation of chunk streaming and run-length decompression
+ */
+
+#define NO_CHUNK 0xFFFFu
+#define NO_SLOT 0xFFu
+
+// A rectangle of chunks (inclusive); empty when x0 > x1
+typedef struct {
+    int16_t x0, y0, x1, y1;
+} Area_t;
+
+static void dwt_enable(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static void clip(const LevelStream_Level_t* level, Area_t* area)
+{
+    if (area->x0 < 0) area->x0 = 0;
+    if (area->y0 < 0) area->y0 = 0;
+    if (area->x1 >= level->chunks_w) area->x1 = level->chunks_w - 1;
+    if (area->y1 >= level->chunks_h) area->y1 = level->chunks_h - 1;
+}
+
+static uint8_t in_area(const LevelStream_Level_t* level, uint16_t chunk, const Area_t* area)
+{
+    int16_t cx = (int16_t)(chunk % level->chunks_w);
+    int16_t cy = (int16_t)(chunk / level->chunks_w);
+    return cx >= area->x0 && cx <= area->x1 && cy >= area->y0 && cy <= area->y1;
+}
+
+// First chunk of an area that is not loaded, or NO_CHUNK
+static uint16_t find_missing(const LevelStream_cfg_t* cfg, const Area_t* area)
+{
+    for (int16_t cy = area->y0; cy <= area->y1; cy++) {
+        for (int16_t cx = area->x0; cx <= area->x1; cx++) {
+            uint16_t chunk = (uint16_t)(cy * cfg->level->chunks_w + cx);
+            if (cfg->chunk_slot[chunk] == NO_SLOT) {
+                return chunk;
+            }
+        }
+    }
+    return NO_CHUNK;
+}
+
+// A free slot, else the one whose chunk is furthest from the view (never one
+// inside 'keep'), or NO_SLOT
+static uint8_t take_slot(const LevelStream_cfg_t* cfg, const Area_t* view, const Area_t* keep)
+{
+    const LevelStream_Level_t* level = cfg->level;
+    int16_t mid_x = (int16_t)((view->x0 + view->x1) / 2);
+    int16_t mid_y = (int16_t)((view->y0 + view->y1) / 2);
+    uint8_t victim = NO_SLOT;
+    int16_t victim_dist = -1;
+
+    for (uint8_t s = 0; s < cfg->slot_count; s++) {
+        uint16_t chunk = cfg->slot_chunk[s];
+        if (chunk == NO_CHUNK) {
+            if (cfg->job_chunk == NO_CHUNK || s != cfg->job_slot) {
+                return s;
+            }
+            continue;
+        }
+        if (in_area(level, chunk, keep)) {
+            continue;
+        }
+        int16_t dx = (int16_t)(chunk % level->chunks_w) - mid_x;
+        int16_t dy = (int16_t)(chunk / level->chunks_w) - mid_y;
+        int16_t dist = (int16_t)((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy));
+        if (dist > victim_dist) {
+            victim = s;
+            victim_dist = dist;
+        }
+    }
+    return victim;
+}
+
+static void start_job(LevelStream_cfg_t* cfg, uint16_t chunk, uint8_t slot)
+{
+    uint16_t old = cfg->slot_chunk[slot];
+
+    if (old != NO_CHUNK) {
+        cfg->chunk_slot[old] = NO_SLOT;
+        cfg->slot_chunk[slot] = NO_CHUNK;
+        cfg->stats.evictions++;
+    }
+    cfg->job_chunk = chunk;
+    cfg->job_slot = slot;
+    cfg->job_dst = 0;
+    cfg->job_src = cfg->level->offsets[chunk];
+    cfg->job_run = 0;
+}
+
+// Decompress up to max tiles of the current job; returns the tiles written
+static uint16_t decode(LevelStream_cfg_t* cfg, uint16_t max)
+{
+    const uint8_t* src = cfg->level->data;
+    uint8_t* dst = cfg->slots[cfg->job_slot];
+    uint16_t done = 0;
+    uint32_t start = DWT->CYCCNT;
+
+    while (cfg->job_dst < LEVELSTREAM_CHUNK_BYTES && done < max) {
+        if (cfg->job_run == 0) {
+            uint8_t control = src[cfg->job_src++];
+            if (control < 128u) {
+                cfg->job_literal = 1;
+                cfg->job_run = (uint8_t)(control + 1u);
+            }
+            else {
+                cfg->job_literal = 0;
+                cfg->job_run = (uint8_t)(control - 125u);
+                cfg->job_value = src[cfg->job_src++];
+            }
+        }
+
+        uint16_t n = cfg->job_run;
+        if (n > LEVELSTREAM_CHUNK_BYTES - cfg->job_dst) {
+            n = (uint16_t)(LEVELSTREAM_CHUNK_BYTES - cfg->job_dst);   // corrupt data: stay in the slot
+        }
+        if (n > max - done) {
+            n = (uint16_t)(max - done);
+        }
+        if (cfg->job_literal) {
+            memcpy(&dst[cfg->job_dst], &src[cfg->job_src], n);
+            cfg->job_src += n;
+        }
+        else {
+            memset(&dst[cfg->job_dst], cfg->job_value, n);
+        }
+        cfg->job_dst += n;
+        cfg->job_run = (uint8_t)(cfg->job_run - n);
+        done += n;
+    }
+
+    cfg->stats.cycles += DWT->CYCCNT - start;
+    cfg->stats.bytes += done;
+    return done;
+}
+
+static void finish_job(LevelStream_cfg_t* cfg)
+{
+    cfg->chunk_slot[cfg->job_chunk] = cfg->job_slot;
+    cfg->slot_chunk[cfg->job_slot] = cfg->job_chunk;
+    cfg->job_chunk = NO_CHUNK;
+    cfg->stats.chunks_loaded++;
+}
+
+static void drop_all(LevelStream_cfg_t* cfg)
+{
+    memset(cfg->chunk_slot, NO_SLOT, sizeof(cfg->chunk_slot));
+    for (uint8_t s = 0; s < LEVELSTREAM_MAX_SLOTS; s++) {
+        cfg->slot_chunk[s] = NO_CHUNK;
+    }
+    cfg->job_chunk = NO_CHUNK;
+}
+
+void LevelStream_Init(LevelStream_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+    if (cfg->slot_count < 2 || cfg->slot_count > LEVELSTREAM_MAX_SLOTS) {
+        Error_Handler();
+    }
+
+    drop_all(cfg);
+    cfg->level = NULL;
+    memset(&cfg->stats, 0, sizeof(cfg->stats));
+    dwt_enable();
+    cfg->setup_done = 1;
+}
+
+void LevelStream_Load(LevelStream_cfg_t* cfg, const LevelStream_Level_t* level, TileMap_cfg_t* map)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint16_t chunks = (uint16_t)(level->chunks_w * level->chunks_h);
+
+    if (chunks > LEVELSTREAM_MAX_CHUNKS) {
+        Error_Handler();
+    }
+    drop_all(cfg);
+    cfg->level = level;
+    cfg->view_tx = 0;
+    cfg->view_ty = 0;
+    cfg->dir_x = 0;
+    cfg->dir_y = 0;
+
+    if (map) {
+        if (map->width != level->width || map->height != level->height) {
+            Error_Handler();
+        }
+        TileMap_Init(map);
+
+        // Decompress every chunk once through slot 0 and copy out the solid bits
+        for (uint16_t chunk = 0; chunk < chunks; chunk++) {
+            start_job(cfg, chunk, 0);
+            decode(cfg, LEVELSTREAM_CHUNK_BYTES);
+            const uint8_t* tiles = cfg->slots[0];
+            uint16_t x0 = (uint16_t)((chunk % level->chunks_w) * LEVELSTREAM_CHUNK);
+            uint16_t y0 = (uint16_t)((chunk / level->chunks_w) * LEVELSTREAM_CHUNK);
+            for (uint16_t i = 0; i < LEVELSTREAM_CHUNK_BYTES; i++) {
+                if (tiles[i] & LEVELSTREAM_TILE_SOLID) {
+                    TileMap_Set(map, x0 + (i % LEVELSTREAM_CHUNK), y0 + (i / LEVELSTREAM_CHUNK), 1);
+                }
+            }
+        }
+        cfg->job_chunk = NO_CHUNK;
+    }
+
+    cfg->stats.load_cycles = DWT->CYCCNT - start;
+}
+
+uint8_t LevelStream_Update(LevelStream_cfg_t* cfg, int16_t tx, int16_t ty, uint16_t tw, uint16_t th)
+{
+    const LevelStream_Level_t* level = cfg->level;
+    uint32_t start = DWT->CYCCNT;
+    uint16_t budget = cfg->budget;
+
+    if (!level || tw == 0 || th == 0) {
+        return 0;
+    }
+
+    // Prefetch in the direction the view last moved (kept while it is still)
+    if (tx != cfg->view_tx) {
+        cfg->dir_x = (tx > cfg->view_tx) ? 1 : -1;
+    }
+    if (ty != cfg->view_ty) {
+        cfg->dir_y = (ty > cfg->view_ty) ? 1 : -1;
+    }
+    cfg->view_tx = tx;
+    cfg->view_ty = ty;
+
+    // Chunks in view, and the chunks wanted: the view plus one chunk ahead
+    Area_t view = {
+        (int16_t)(tx >> LEVELSTREAM_CHUNK_SHIFT),
+        (int16_t)(ty >> LEVELSTREAM_CHUNK_SHIFT),
+        (int16_t)((tx + (int16_t)tw - 1) >> LEVELSTREAM_CHUNK_SHIFT),
+        (int16_t)((ty + (int16_t)th - 1) >> LEVELSTREAM_CHUNK_SHIFT)
+    };
+    Area_t want = view;
+    if (cfg->dir_x > 0) want.x1++;
+    if (cfg->dir_x < 0) want.x0--;
+    if (cfg->dir_y > 0) want.y1++;
+    if (cfg->dir_y < 0) want.y0--;
+    clip(level, &view);
+    clip(level, &want);
+
+    // The view moved away from the chunk being prefetched: drop it
+    if (cfg->job_chunk != NO_CHUNK && !in_area(level, cfg->job_chunk, &want)) {
+        cfg->job_chunk = NO_CHUNK;
+    }
+
+    for (;;) {
+        // A chunk in view is missing: load it now, whatever the budget
+        uint16_t needed = find_missing(cfg, &view);
+        uint8_t urgent = (needed != NO_CHUNK);
+
+        if (!urgent && budget == 0) {
+            break;
+        }
+
+        // A prefetch outside the view waits for nothing: abandon it (its slot
+        // is still free) rather than finish it before the chunk that is needed
+        if (urgent && cfg->job_chunk != NO_CHUNK && !in_area(level, cfg->job_chunk, &view)) {
+            cfg->job_chunk = NO_CHUNK;
+        }
+        if (cfg->job_chunk == NO_CHUNK) {
+            uint16_t chunk = urgent ? needed : find_missing(cfg, &want);
+            if (chunk == NO_CHUNK) {
+                break;
+            }
+            uint8_t slot = take_slot(cfg, &view, urgent ? &view : &want);
+            if (slot == NO_SLOT) {
+                break;      // not enough slots for this view
+            }
+            start_job(cfg, chunk, slot);
+        }
+
+        uint16_t n = decode(cfg, urgent ? LEVELSTREAM_CHUNK_BYTES : budget);
+        if (!urgent) {
+            budget -= n;
+        }
+        if (cfg->job_dst == LEVELSTREAM_CHUNK_BYTES) {
+            if (urgent) {
+                cfg->stats.stalls++;    // only chunks in view are decoded this way
+            }
+            finish_job(cfg);
+        }
+    }
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    if (cycles > cfg->stats.max_update_cycles) {
+        cfg->stats.max_update_cycles = cycles;
+    }
+    return find_missing(cfg, &view) == NO_CHUNK;
+}
+
+const uint8_t* LevelStream_Row(const LevelStream_cfg_t* cfg, int16_t tx, int16_t ty)
+{
+    const LevelStream_Level_t* level = cfg->level;
+
+    if (!level || tx < 0 || ty < 0 || tx >= (int16_t)level->width || ty >= (int16_t)level->height) {
+        return NULL;
+    }
+    uint16_t chunk = (uint16_t)((ty >> LEVELSTREAM_CHUNK_SHIFT) * level->chunks_w +
+                                (tx >> LEVELSTREAM_CHUNK_SHIFT));
+    uint8_t slot = cfg->chunk_slot[chunk];
+    if (slot == NO_SLOT) {
+        return NULL;
+    }
+    return &cfg->slots[slot][(ty & (LEVELSTREAM_CHUNK - 1)) * LEVELSTREAM_CHUNK +
+                             (tx & (LEVELSTREAM_CHUNK - 1))];
+}
+
+uint8_t LevelStream_Tile(const LevelStream_cfg_t* cfg, int16_t tx, int16_t ty)
+{
+    const LevelStream_Level_t* level = cfg->level;
+
+    if (!level || tx < 0 || ty < 0 || tx >= (int16_t)level->width || ty >= (int16_t)level->height) {
+        return 0;
+    }
+    const uint8_t* tile = LevelStream_Row(cfg, tx, ty);
+    return tile ? *tile : LEVELSTREAM_TILE_MISSING;
+}
+
+void LevelStream_GetStats(LevelStream_cfg_t* cfg, LevelStream_Stats_t* stats, uint8_t reset)
+{
+    *stats = cfg->stats;
+    if (reset) {
+        cfg->stats.max_update_cycles = 0;
+    }
+}
@@ -0,0 +1,179 @@
+#ifndef LEVELSTREAM_H
+#define LEVELSTREAM_H
+
+#include <stdint.h>
+#include "main.h"
+#include "TileMap.h"
+
+/**
+ * @file LevelStream.h
+ * @brief Large levels streamed from compressed flash chunks into RAM slots
+ *
+ * A level is a grid of byte tiles, cut into chunks of 16x16 tiles. Each
+ * chunk is compressed separately by tools/level_compiler.py and stays in
+ * flash. Only the chunks around the view are decompressed, into a small
+ * ring of 256-byte RAM slots. A 30x30-tile view (the whole screen in 8x8
+ * tiles) touches up to 3x3 chunks, so 16 slots (4 KB) hold the view plus
+ * the chunks ahead of it, for a level of any size.
+ *
+ * LevelStream_Update() is called once per frame with the view rectangle.
+ * It decompresses, in order of need:
+ * - chunks in the view that are missing (all at once: they are needed now;
+ *   this should only happen after a jump, and is counted as a stall). A
+ *   prefetch in progress outside the view is abandoned first, so it does
+ *   not delay them
+ * - chunks one step ahead of the view in the direction it last moved,
+ *   at most `budget` bytes per call, so loading is spread over frames
+ * A chunk being decompressed can be paused at any byte and resumed on the
+ * next call. When all slots are taken, the slot furthest from the view is
+ * reused.
+ *
+ * Collision does not need streaming: at one bit per tile the whole level's
+ * TileMap fits in RAM (a 256x128 level is 4 KB), so LevelStream_Load() fills
+ * it once from the solid tiles.
+ *
+ * Tile byte: bit 7 set = solid, bits 0-3 = LCD colour index (0 = nothing
+ * drawn), bits 4-6 reserved.
+ *
+ * Chunk compression (a byte run-length code, decoded in place): a control
+ * byte n, then
+ * - n = 0..127:   n + 1 literal tiles follow
+ * - n = 128..255: one tile follows, repeated n - 125 times (3..130)
+ *
+ * Example usage:
+ * @code
+ * #include "Levels.h"     // generated from the .lvl files in LevelStream/levels
+ *
+ * static uint8_t slots[16][LEVELSTREAM_CHUNK_BYTES];
+ * static uint32_t level_rows[TILEMAP_WORDS(LEVEL_CAVE_WIDTH, LEVEL_CAVE_HEIGHT)];
+ * static TileMap_cfg_t level_map = {
+ *     .width = LEVEL_CAVE_WIDTH, .height = LEVEL_CAVE_HEIGHT,
+ *     .tile_shift = 3, .rows = level_rows
+ * };
+ *
+ * LevelStream_cfg_t stream = {
+ *     .slots = slots, .slot_count = 16,
+ *     .budget = 128,          // bytes decompressed per frame for prefetching
+ *     .setup_done = 0
+ * };
+ *
+ * LevelStream_Init(&stream);
+ * LevelStream_Load(&stream, &LEVEL_cave, &level_map);
+ *
+ * // Each frame, with the view in tiles:
+ * LevelStream_Update(&stream, view_tx, view_ty, 30, 30);
+ * uint8_t tile = LevelStream_Tile(&stream, tx, ty);
+ * @endcode
+ */
+
+#define LEVELSTREAM_CHUNK 16                // Tiles per chunk side
+#define LEVELSTREAM_CHUNK_SHIFT 4
+#define LEVELSTREAM_CHUNK_BYTES (LEVELSTREAM_CHUNK * LEVELSTREAM_CHUNK)
+#define LEVELSTREAM_MAX_CHUNKS 256          // Chunks per level (e.g. 256x256 tiles)
+#define LEVELSTREAM_MAX_SLOTS 16
+
+#define LEVELSTREAM_TILE_SOLID 0x80
+#define LEVELSTREAM_TILE_COLOUR(t) ((t) & 0x0F)
+#define LEVELSTREAM_TILE_MISSING 0xFF       // Chunk not loaded (never a real tile)
+
+/**
+ * @struct LevelStream_Level_t
+ * @brief A compiled level in flash (generated by tools/level_compiler.py)
+ */
+typedef struct {
+    const char* name;
+    uint16_t width;                 ///< Width in tiles
+    uint16_t height;                ///< Height in tiles
+    uint8_t chunks_w;               ///< Chunks across
+    uint8_t chunks_h;               ///< Chunks down
+    const uint32_t* offsets;        ///< Start of each chunk in data (row-major), plus the end
+    const uint8_t* data;            ///< Compressed chunks
+} LevelStream_Level_t;
+
+/**
+ * @struct LevelStream_Stats_t
+ * @brief Streaming activity and decompression throughput
+ */
+typedef struct {
+    uint32_t bytes;                 ///< Tiles decompressed
+    uint32_t cycles;                ///< CPU cycles spent decompressing them
+    uint32_t chunks_loaded;         ///< Chunks decompressed into slots
+    uint32_t evictions;             ///< Loaded chunks dropped to reuse their slot
+    uint32_t stalls;                ///< Chunks decompressed outside the budget because the view needed them
+    uint32_t max_update_cycles;     ///< Longest LevelStream_Update()
+    uint32_t load_cycles;           ///< LevelStream_Load() time (building the collision map)
+} LevelStream_Stats_t;
+
+/**
+ * @struct LevelStream_cfg_t
+ * @brief Streaming configuration, slots and state
+ */
+typedef struct {
+    uint8_t (*slots)[LEVELSTREAM_CHUNK_BYTES];  ///< slot_count chunk buffers
+    uint8_t slot_count;                         ///< Number of slots (2 .. LEVELSTREAM_MAX_SLOTS)
+    uint16_t budget;                            ///< Bytes to prefetch per LevelStream_Update()
+    uint8_t setup_done;                         ///< Internal flag: 1 if initialised, 0 otherwise
+
+    const LevelStream_Level_t* level;           ///< Internal: level being streamed
+    uint8_t chunk_slot[LEVELSTREAM_MAX_CHUNKS]; ///< Internal: slot holding each chunk, 0xFF if none
+    uint16_t slot_chunk[LEVELSTREAM_MAX_SLOTS]; ///< Internal: chunk in each slot, 0xFFFF if free
+
+    uint16_t job_chunk;                         ///< Internal: chunk being decompressed, 0xFFFF if none
+    uint8_t job_slot;                           ///< Internal: its slot
+    uint16_t job_dst;                           ///< Internal: tiles written so far
+    uint32_t job_src;                           ///< Internal: next compressed byte
+    uint8_t job_run;                            ///< Internal: tiles left in the current run
+    uint8_t job_literal;                        ///< Internal flag: current run is literal
+    uint8_t job_value;                          ///< Internal: tile of the current repeat run
+
+    int16_t view_tx;                            ///< Internal: last view position
+    int16_t view_ty;
+    int8_t dir_x;                               ///< Internal: direction the view last moved (-1, 0, 1)
+    int8_t dir_y;
+    LevelStream_Stats_t stats;                  ///< Internal: read with LevelStream_GetStats()
+} LevelStream_cfg_t;
+
+/**
+ * @brief Initialise with every slot free
+ */
+void LevelStream_Init(LevelStream_cfg_t* cfg);
+
+/**
+ * @brief Start streaming a level, and fill its collision map
+ *
+ * Drops every loaded chunk. If map is not NULL, it must be width x height
+ * tiles of the level (Error_Handler() otherwise); it is initialised and
+ * every solid tile set, decompressing the whole level once.
+ */
+void LevelStream_Load(LevelStream_cfg_t* cfg, const LevelStream_Level_t* level, TileMap_cfg_t* map);
+
+/**
+ * @brief Stream chunks for a view rectangle (in tiles); call once per frame
+ *
+ * @return 1 if every chunk in the view is loaded
+ */
+uint8_t LevelStream_Update(LevelStream_cfg_t* cfg, int16_t tx, int16_t ty, uint16_t tw, uint16_t th);
+
+/**
+ * @brief Get a tile
+ *
+ * @return Tile byte, 0 outside the level, LEVELSTREAM_TILE_MISSING if its chunk is not loaded
+ */
+uint8_t LevelStream_Tile(const LevelStream_cfg_t* cfg, int16_t tx, int16_t ty);
+
+/**
+ * @brief Pointer to a tile in its loaded chunk, for reading along a row
+ *
+ * @return Valid for LEVELSTREAM_CHUNK - (tx % LEVELSTREAM_CHUNK) tiles,
+ *         NULL if outside the level or not loaded
+ */
+const uint8_t* LevelStream_Row(const LevelStream_cfg_t* cfg, int16_t tx, int16_t ty);
+
+/**
+ * @brief Get the activity counters
+ *
+ * @param reset 1 to clear the maximum after reading
+ */
+void LevelStream_GetStats(LevelStream_cfg_t* cfg, LevelStream_Stats_t* stats, uint8_t reset);
+
+#endif // LEVELSTREAM_H
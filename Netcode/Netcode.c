@@ -0,0 +1,558 @@
+#include "Netcode.h"
+#include "Trace.h"
+#include <string.h>
+
+/**
+ * @file Netcode.c
+ * @brief Implementation of the rollback lockstep link
+ */
+
+#define NET_SYNC_BYTE 0xA5
+#define NET_PKT_HELLO 0x01
+#define NET_PKT_INPUT 0x02
+#define NET_MAX_SEND 24         // inputs per packet (covers the worst-case unacknowledged span)
+#define NET_NO_FRAME 0xFFFFFFFFu
+
+enum {
+    PARSE_SYNC = 0,
+    PARSE_TYPE,
+    PARSE_LEN,
+    PARSE_PAYLOAD,
+    PARSE_CRC_LO,
+    PARSE_CRC_HI
+};
+
+#if (NET_SNAPSHOTS & (NET_SNAPSHOTS - 1)) != 0 || (NET_INPUT_RING & (NET_INPUT_RING - 1)) != 0
+#error "NET_SNAPSHOTS and NET_INPUT_RING must be powers of two"
+#endif
+
+#define IN_SLOT(f) ((f) & (NET_INPUT_RING - 1u))
+#define SNAP_SLOT(f) ((f) & (NET_SNAPSHOTS - 1u))
+
+// ===== CHECKSUMS =====
+
+// CRC-16/CCITT: a corrupted packet accepted as valid would desync the boards
+// for good, so 8 bits is not enough on a noisy cable
+static uint16_t crc16(const uint8_t* data, uint8_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ 0x1021u) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static inline void put32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t get32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ===== SNAPSHOTS =====
+
+static void save_state(Net_cfg_t* cfg, uint32_t frame)
+{
+    Snapshot_Save(cfg->snapshot, (uint8_t)SNAP_SLOT(frame));
+    cfg->snapshot_frame[SNAP_SLOT(frame)] = frame;
+    cfg->snapshot_crc[SNAP_SLOT(frame)] = Snapshot_Checksum(cfg->snapshot, (uint8_t)SNAP_SLOT(frame));
+}
+
+static void load_state(Net_cfg_t* cfg, uint32_t frame)
+{
+    Snapshot_Restore(cfg->snapshot, (uint8_t)SNAP_SLOT(frame));
+}
+
+// ===== SIMULATION =====
+
+static Net_Input_t predict(const Net_cfg_t* cfg)
+{
+    return cfg->confirmed ? cfg->remote_inputs[IN_SLOT(cfg->confirmed - 1u)] : 0;
+}
+
+// Save the state before 'frame', then simulate it
+static void step(Net_cfg_t* cfg, uint32_t frame, uint8_t save)
+{
+    Net_Input_t inputs[NET_PLAYERS];
+
+    if (frame >= cfg->confirmed) {
+        cfg->remote_inputs[IN_SLOT(frame)] = predict(cfg);
+    }
+    if (save) {
+        save_state(cfg, frame);
+    }
+
+    inputs[cfg->local_player] = cfg->local_inputs[IN_SLOT(frame)];
+    inputs[cfg->local_player ^ 1u] = cfg->remote_inputs[IN_SLOT(frame)];
+    cfg->simulate(inputs);
+}
+
+static void rollback(Net_cfg_t* cfg)
+{
+    uint32_t from = cfg->rollback_from;
+    uint32_t frames = cfg->frame - from;
+    uint32_t start = DWT->CYCCNT;
+
+    cfg->rollback_from = NET_NO_FRAME;
+
+    load_state(cfg, from);
+    TRACE_REPLAY(1);
+    for (uint32_t f = from; f < cfg->frame; f++) {
+        step(cfg, f, f != from);    // the snapshot of 'from' is what was just loaded
+    }
+    TRACE_REPLAY(0);
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    cfg->stats.rollbacks++;
+    cfg->stats.resim_frames += frames;
+    if (frames > cfg->stats.max_rollback) {
+        cfg->stats.max_rollback = frames;
+    }
+    if (cycles > cfg->stats.max_resim_cycles) {
+        cfg->stats.max_resim_cycles = cycles;
+    }
+}
+
+// ===== TRANSPORT =====
+
+static void send_packet(Net_cfg_t* cfg, uint8_t type, const uint8_t* payload, uint8_t len)
+{
+    uint16_t size = (uint16_t)len + 5u;
+    uint16_t free_space = NET_TX_SIZE - 1u - (uint16_t)((cfg->tx_head - cfg->tx_tail) & (NET_TX_SIZE - 1u));
+
+    if (size > free_space) {
+        cfg->stats.tx_dropped++;
+        return;
+    }
+
+    // CRC covers type, length and payload
+    uint8_t header[3] = {NET_SYNC_BYTE, type, len};
+    uint8_t all[2 + sizeof(cfg->parse_buf)];
+    all[0] = type;
+    all[1] = len;
+    memcpy(&all[2], payload, len);
+    uint16_t crc = crc16(all, (uint8_t)(len + 2u));
+
+    uint16_t head = cfg->tx_head;
+    for (uint8_t i = 0; i < 3; i++) {
+        cfg->tx_buf[head] = header[i];
+        head = (head + 1u) & (NET_TX_SIZE - 1u);
+    }
+    for (uint8_t i = 0; i < len; i++) {
+        cfg->tx_buf[head] = payload[i];
+        head = (head + 1u) & (NET_TX_SIZE - 1u);
+    }
+    cfg->tx_buf[head] = (uint8_t)crc;
+    head = (head + 1u) & (NET_TX_SIZE - 1u);
+    cfg->tx_buf[head] = (uint8_t)(crc >> 8);
+    head = (head + 1u) & (NET_TX_SIZE - 1u);
+
+    __DMB();
+    cfg->tx_head = head;
+    cfg->uart->CR1 |= USART_CR1_TXEIE;  // the ISR sends and disables it when empty
+    cfg->stats.packets_tx++;
+}
+
+static void send_hello(Net_cfg_t* cfg)
+{
+    uint8_t payload[8];
+    put32(&payload[0], cfg->local_id);
+    put32(&payload[4], cfg->session);
+    send_packet(cfg, NET_PKT_HELLO, payload, sizeof(payload));
+}
+
+static void send_inputs(Net_cfg_t* cfg)
+{
+    uint8_t payload[4 + 4 + 1 + NET_MAX_SEND + 4 + 4];
+    uint32_t known = cfg->frame + NET_INPUT_DELAY;    // local inputs exist below this
+    uint32_t start = cfg->peer_ack;
+
+    if (known - start > NET_MAX_SEND) {
+        start = known - NET_MAX_SEND;
+    }
+    uint8_t count = (uint8_t)(known - start);
+
+    put32(&payload[0], cfg->confirmed);
+    put32(&payload[4], start);
+    payload[8] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        payload[9 + i] = cfg->local_inputs[IN_SLOT(start + i)];
+    }
+
+    // Checksum of the newest saved state that depends only on confirmed inputs
+    // (the snapshot of frame f is the state before f, so it needs inputs below f)
+    uint32_t check = (cfg->frame && cfg->confirmed >= cfg->frame) ? cfg->frame - 1u : cfg->confirmed;
+    if (cfg->snapshot_frame[SNAP_SLOT(check)] != check) {
+        check = 0;
+    }
+    put32(&payload[9 + count], check);
+    put32(&payload[13 + count], cfg->snapshot_crc[SNAP_SLOT(check)]);
+    send_packet(cfg, NET_PKT_INPUT, payload, (uint8_t)(17u + count));
+}
+
+static void reset_session(Net_cfg_t* cfg)
+{
+    cfg->frame = 0;
+    cfg->confirmed = 0;
+    cfg->peer_ack = 0;
+    cfg->rollback_from = NET_NO_FRAME;
+    cfg->idle_ticks = 0;
+    cfg->peer_inputs_seen = 0;
+    cfg->check_pending = 0;
+    memset(cfg->local_inputs, 0, sizeof(cfg->local_inputs));
+    memset(cfg->remote_inputs, 0, sizeof(cfg->remote_inputs));
+    for (uint8_t i = 0; i < NET_SNAPSHOTS; i++) {
+        cfg->snapshot_frame[i] = NET_NO_FRAME;
+    }
+}
+
+// Back to frame 0, with the game back in its start state
+static void restart(Net_cfg_t* cfg)
+{
+    reset_session(cfg);
+    cfg->restart();
+}
+
+// Start a new session of our own and wait for the other board's hello
+static void resync(Net_cfg_t* cfg)
+{
+    // The cycle counter at a moment set by the player (or by the link
+    // dropping) is as good as random: the other board only has to see a
+    // value different from our last session's
+    uint32_t session = DWT->CYCCNT;
+    cfg->session = (session == cfg->session) ? session + 1u : session;
+    restart(cfg);
+    cfg->state = NET_SYNCING;
+    send_hello(cfg);
+}
+
+static void handle_hello(Net_cfg_t* cfg, const uint8_t* payload, uint8_t len)
+{
+    if (len != 8 || cfg->state == NET_IDLE) {
+        return;
+    }
+    uint32_t peer_id = get32(&payload[0]);
+    uint32_t peer_session = get32(&payload[4]);
+
+    if (cfg->state == NET_RUNNING) {
+        if (peer_session == cfg->peer_session) {
+            return;     // a repeat of the hello that started this session
+        }
+        // The other board left and started again: follow it from frame 0,
+        // keeping our own session so it does not restart in turn
+        restart(cfg);
+    }
+    cfg->peer_session = peer_session;
+    cfg->local_player = (cfg->local_id < peer_id) ? 0 : 1;
+    cfg->state = NET_RUNNING;
+    send_hello(cfg);    // in case ours was missed
+}
+
+static void handle_inputs(Net_cfg_t* cfg, const uint8_t* payload, uint8_t len)
+{
+    if (cfg->state != NET_RUNNING || len < 17 || len != 17u + payload[8]) {
+        cfg->stats.bad_packets++;
+        return;
+    }
+
+    uint32_t ack = get32(&payload[0]);
+    uint32_t start = get32(&payload[4]);
+    uint8_t count = payload[8];
+
+    cfg->peer_inputs_seen = 1;
+    if (ack > cfg->peer_ack && ack <= cfg->frame + NET_INPUT_DELAY) {
+        cfg->peer_ack = ack;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t f = start + i;
+        if (f < cfg->confirmed) {
+            continue;   // already have it
+        }
+        if (f > cfg->confirmed || f >= cfg->frame + NET_INPUT_RING - NET_INPUT_DELAY) {
+            break;      // gap (a lost packet): the next packet repeats these
+        }
+
+        Net_Input_t input = payload[9 + i];
+        if (f < cfg->frame && cfg->remote_inputs[IN_SLOT(f)] != input && f < cfg->rollback_from) {
+            cfg->rollback_from = f;   // simulated with a wrong prediction
+        }
+        cfg->remote_inputs[IN_SLOT(f)] = input;
+        cfg->confirmed++;
+    }
+
+    cfg->check_frame = get32(&payload[9 + count]);
+    cfg->check_crc = get32(&payload[13 + count]);
+    cfg->check_pending = 1;
+}
+
+static void process_rx(Net_cfg_t* cfg)
+{
+    while (cfg->rx_tail != cfg->rx_head) {
+        uint8_t byte = cfg->rx_buf[cfg->rx_tail];
+        cfg->rx_tail = (cfg->rx_tail + 1u) & (NET_RX_SIZE - 1u);
+
+        switch (cfg->parse_state) {
+            case PARSE_SYNC:
+                if (byte == NET_SYNC_BYTE) {
+                    cfg->parse_state = PARSE_TYPE;
+                }
+                break;
+            case PARSE_TYPE:
+                cfg->parse_type = byte;
+                cfg->parse_state = PARSE_LEN;
+                break;
+            case PARSE_LEN:
+                if (byte > sizeof(cfg->parse_buf)) {
+                    cfg->stats.bad_packets++;
+                    cfg->parse_state = PARSE_SYNC;
+                    break;
+                }
+                cfg->parse_len = byte;
+                cfg->parse_pos = 0;
+                cfg->parse_state = byte ? PARSE_PAYLOAD : PARSE_CRC_LO;
+                break;
+            case PARSE_PAYLOAD:
+                cfg->parse_buf[cfg->parse_pos++] = byte;
+                if (cfg->parse_pos == cfg->parse_len) {
+                    cfg->parse_state = PARSE_CRC_LO;
+                }
+                break;
+            case PARSE_CRC_LO:
+                cfg->parse_crc = byte;
+                cfg->parse_state = PARSE_CRC_HI;
+                break;
+            case PARSE_CRC_HI: {
+                uint8_t all[2 + sizeof(cfg->parse_buf)];
+                all[0] = cfg->parse_type;
+                all[1] = cfg->parse_len;
+                memcpy(&all[2], cfg->parse_buf, cfg->parse_len);
+                cfg->parse_state = PARSE_SYNC;
+
+                if (crc16(all, (uint8_t)(cfg->parse_len + 2u)) != (uint16_t)(cfg->parse_crc | (byte << 8))) {
+                    cfg->stats.bad_packets++;
+                    break;
+                }
+                cfg->stats.packets_rx++;
+                cfg->idle_ticks = 0;
+                if (cfg->parse_type == NET_PKT_HELLO) {
+                    handle_hello(cfg, cfg->parse_buf, cfg->parse_len);
+                }
+                else if (cfg->parse_type == NET_PKT_INPUT) {
+                    handle_inputs(cfg, cfg->parse_buf, cfg->parse_len);
+                }
+                break;
+            }
+        }
+    }
+}
+
+static void compare_checksum(Net_cfg_t* cfg)
+{
+    uint32_t f = cfg->check_frame;
+
+    cfg->check_pending = 0;
+    if (f == 0 || f > cfg->confirmed || f >= cfg->frame || cfg->snapshot_frame[SNAP_SLOT(f)] != f) {
+        return;     // not final here yet, or already out of the snapshot ring
+    }
+    cfg->stats.checks++;
+    if (cfg->snapshot_crc[SNAP_SLOT(f)] != cfg->check_crc) {
+        cfg->stats.desyncs++;
+    }
+}
+
+// ===== PUBLIC API =====
+
+void Net_Init(Net_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    cfg->state = NET_IDLE;
+    cfg->rx_head = cfg->rx_tail = 0;
+    cfg->tx_head = cfg->tx_tail = 0;
+    cfg->parse_state = PARSE_SYNC;
+    cfg->rx_overruns = 0;
+    memset(&cfg->stats, 0, sizeof(cfg->stats));
+    reset_session(cfg);
+
+    if (!cfg->snapshot->setup_done || cfg->snapshot->slot_count < NET_SNAPSHOTS || !cfg->restart) {
+        Error_Handler();    // snapshot not initialised, too few slots for the ring, or no restart()
+    }
+
+    Net_Attach(cfg);
+    cfg->setup_done = 1;
+}
+
+void Net_Attach(Net_cfg_t* cfg)
+{
+    cfg->uart->CR1 |= USART_CR1_RXNEIE;
+    if (cfg->tx_head != cfg->tx_tail) {
+        cfg->uart->CR1 |= USART_CR1_TXEIE;
+    }
+    HAL_NVIC_SetPriority(cfg->irqn, 5, 0);
+    HAL_NVIC_EnableIRQ(cfg->irqn);
+}
+
+void Net_Start(Net_cfg_t* cfg)
+{
+    // Anything still in the receive ring is from before: drop it
+    cfg->rx_tail = cfg->rx_head;
+    cfg->parse_state = PARSE_SYNC;
+    resync(cfg);
+}
+
+void Net_Stop(Net_cfg_t* cfg)
+{
+    cfg->state = NET_IDLE;
+}
+
+uint8_t Net_Tick(Net_cfg_t* cfg, Net_Input_t input)
+{
+    uint8_t advanced = 0;
+
+    if (cfg->state == NET_IDLE) {
+        return 0;
+    }
+
+    cfg->idle_ticks++;
+    process_rx(cfg);
+
+    if (cfg->state == NET_SYNCING) {
+        send_hello(cfg);
+        return 0;
+    }
+    // Nothing heard for too long: the other board may have been reset or
+    // left. Start over, so both boards meet again at frame 0 when it is back
+    if (cfg->idle_ticks >= NET_TIMEOUT_TICKS) {
+        resync(cfg);
+        return 0;
+    }
+
+    // Correct mispredictions before anything else looks at the state
+    if (cfg->rollback_from != NET_NO_FRAME) {
+        rollback(cfg);
+    }
+    if (cfg->check_pending) {
+        compare_checksum(cfg);
+    }
+
+    // Advance unless that would take us past the rollback window
+    if (cfg->frame < cfg->confirmed + NET_MAX_ROLLBACK) {
+        cfg->local_inputs[IN_SLOT(cfg->frame + NET_INPUT_DELAY)] = input;
+        step(cfg, cfg->frame, 1);
+        cfg->frame++;
+        advanced = 1;
+    }
+    else {
+        cfg->stats.stalls++;
+    }
+
+    // Until the other board shows it has our hello, keep repeating it
+    if (!cfg->peer_inputs_seen) {
+        send_hello(cfg);
+    }
+    send_inputs(cfg);
+    return advanced;
+}
+
+uint8_t Net_IsConnected(const Net_cfg_t* cfg)
+{
+    return (cfg->state == NET_RUNNING && cfg->idle_ticks < NET_LOST_TICKS) ? 1u : 0u;
+}
+
+uint32_t Net_MeasureResim(Net_cfg_t* cfg, uint8_t n)
+{
+    if (cfg->state != NET_RUNNING || cfg->rollback_from != NET_NO_FRAME) {
+        return 0;
+    }
+    if (n > NET_MAX_ROLLBACK) {
+        n = NET_MAX_ROLLBACK;
+    }
+    if (n > cfg->frame) {
+        n = (uint8_t)cfg->frame;
+    }
+    uint32_t from = cfg->frame - n;
+    if (n == 0 || cfg->snapshot_frame[SNAP_SLOT(from)] != from) {
+        return 0;
+    }
+
+    // Checksum of the current state, through the slot of the next frame (not saved yet)
+    save_state(cfg, cfg->frame);
+    uint32_t before = cfg->snapshot_crc[SNAP_SLOT(cfg->frame)];
+
+    // Same path as a real rollback
+    cfg->rollback_from = from;
+    uint32_t start = DWT->CYCCNT;
+    load_state(cfg, from);
+    TRACE_REPLAY(1);
+    for (uint32_t f = from; f < cfg->frame; f++) {
+        step(cfg, f, f != from);
+    }
+    TRACE_REPLAY(0);
+    uint32_t cycles = DWT->CYCCNT - start;
+    cfg->rollback_from = NET_NO_FRAME;
+
+    save_state(cfg, cfg->frame);
+    if (cfg->snapshot_crc[SNAP_SLOT(cfg->frame)] != before) {
+        cfg->stats.desyncs++;   // same inputs, different result: not deterministic
+    }
+    cfg->snapshot_frame[SNAP_SLOT(cfg->frame)] = NET_NO_FRAME;
+    return cycles;
+}
+
+void Net_GetStats(Net_cfg_t* cfg, Net_Stats_t* stats, uint8_t reset)
+{
+    cfg->stats.rx_overruns = cfg->rx_overruns;
+    *stats = cfg->stats;
+    if (reset) {
+        cfg->stats.max_rollback = 0;
+        cfg->stats.max_resim_cycles = 0;
+    }
+}
+
+void Net_UART_IRQHandler(Net_cfg_t* cfg)
+{
+    USART_TypeDef* uart = cfg->uart;
+    uint32_t isr = uart->ISR;
+
+    if (isr & USART_ISR_ORE) {
+        uart->ICR = USART_ICR_ORECF;
+        cfg->rx_overruns++;
+    }
+
+    if (isr & USART_ISR_RXNE) {
+        uint8_t byte = (uint8_t)uart->RDR;
+        uint16_t next = (cfg->rx_head + 1u) & (NET_RX_SIZE - 1u);
+        if (next != cfg->rx_tail) {
+            cfg->rx_buf[cfg->rx_head] = byte;
+            cfg->rx_head = next;
+        }
+        else {
+            cfg->rx_overruns++;
+        }
+    }
+
+    if ((isr & USART_ISR_TXE) && (uart->CR1 & USART_CR1_TXEIE)) {
+        if (cfg->tx_tail != cfg->tx_head) {
+            uart->TDR = cfg->tx_buf[cfg->tx_tail];
+            cfg->tx_tail = (cfg->tx_tail + 1u) & (NET_TX_SIZE - 1u);
+        }
+        else {
+            uart->CR1 &= ~USART_CR1_TXEIE;
+        }
+    }
+}
@@ -0,0 +1,233 @@
+#ifndef NETCODE_H
+#define NETCODE_H
+
+#include <stdint.h>
+#include "main.h"
+#include "Snapshot.h"
+
+/**
+ * @file Netcode.h
+ * @brief Deterministic lockstep for two boards over a UART link, with rollback
+ *
+ * Both boards run the same simulation from the same start state, one tick per
+ * frame, fed with both players' inputs. Only inputs travel over the link
+ * (one byte per player per tick, tagged with its frame number), never game
+ * state, so the simulation must be deterministic: integer / fixed-point
+ * maths only, no floats, no HAL_GetTick(), no randomness that is not seeded
+ * identically, and no side effects (sound, LED) inside simulate().
+ *
+ * Latency is hidden in two ways:
+ * - Local inputs are applied NET_INPUT_DELAY frames late, which gives them
+ *   time to reach the other board before they are needed.
+ * - When a remote input has not arrived, it is predicted (the last known
+ *   input is repeated) and the tick goes ahead. Before every tick the game
+ *   state is saved; when the real input arrives and differs from the
+ *   prediction, the state is rolled back to that frame and the frames since
+ *   are simulated again with the corrected input.
+ *
+ * A board never gets more than NET_MAX_ROLLBACK frames ahead of the inputs
+ * it has confirmed; if it would, it stalls (skips the tick) until the other
+ * board catches up.
+ *
+ * The game state is saved before every tick with the Snapshot module (one
+ * slot per frame in a ring of NET_SNAPSHOTS). Each snapshot also gets a
+ * checksum; the boards exchange checksums of confirmed frames to detect a
+ * desync.
+ *
+ * Each Net_Start() begins a session with a new session number, sent in the
+ * hello. A running board that gets a hello with a session number it has not
+ * seen knows the other board has started again (left and came back, or was
+ * reset): it puts the game back in its start state with restart() and
+ * follows from frame 0. A running board that hears nothing for
+ * NET_TIMEOUT_TICKS starts a new session itself, so both meet again at
+ * frame 0 once the link is back.
+ *
+ * Packets: 0xA5, type, payload length, payload, CRC-16 (little-endian).
+ *
+ * Example usage:
+ * @code
+ * static const Snapshot_Region_t state[] = {
+ *     {players, sizeof(players)},
+ *     {&timers, sizeof(timers)},
+ * };
+ * static uint8_t slots[NET_SNAPSHOTS * 1024] SNAPSHOT_RAM2;
+ * Snapshot_cfg_t snap = {state, 2, slots, 1024, NET_SNAPSHOTS, NULL, 0};
+ *
+ * void simulate(const Net_Input_t inputs[NET_PLAYERS]) { ... one tick ... }
+ * void restart(void) { ... start state ... }
+ *
+ * Net_cfg_t net = {
+ *     .uart = USART3, .irqn = USART3_IRQn,
+ *     .snapshot = &snap,
+ *     .simulate = simulate,
+ *     .restart = restart,
+ *     .local_id = HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2(),
+ *     .setup_done = 0
+ * };
+ *
+ * Snapshot_Init(&snap);
+ * Net_Init(&net);
+ * Net_Start(&net);                       // restart(), then handshake
+ *
+ * // Each game tick:
+ * Net_Tick(&net, my_input);
+ *
+ * // In USART3_IRQHandler():
+ * Net_UART_IRQHandler(&net);
+ * @endcode
+ */
+
+#define NET_PLAYERS 2
+#define NET_SNAPSHOTS 8                         // Saved states (power of two)
+#define NET_MAX_ROLLBACK (NET_SNAPSHOTS - 1)    // Most frames a remote input may be late
+#define NET_INPUT_DELAY 2                       // Frames before a local input takes effect
+#define NET_INPUT_RING 32                       // Input history per player (power of two)
+#define NET_RX_SIZE 256                         // UART receive ring (power of two)
+#define NET_TX_SIZE 128                         // UART transmit ring (power of two)
+#define NET_LOST_TICKS 30                       // Ticks without a packet before the link counts as lost
+#define NET_TIMEOUT_TICKS 100                   // Ticks without a packet before the session starts over
+
+/**
+ * @brief One player's input for one tick (meaning defined by the game)
+ */
+typedef uint8_t Net_Input_t;
+
+typedef enum {
+    NET_IDLE = 0,       ///< Not started
+    NET_SYNCING,        ///< Waiting for the other board's hello
+    NET_RUNNING         ///< Exchanging inputs
+} Net_State_t;
+
+/**
+ * @struct Net_Stats_t
+ * @brief Link and rollback instrumentation
+ */
+typedef struct {
+    uint32_t packets_rx;            ///< Valid packets received
+    uint32_t packets_tx;            ///< Packets queued for sending
+    uint32_t bad_packets;           ///< Packets dropped (CRC or format error)
+    uint32_t rx_overruns;           ///< Bytes lost because the receive ring was full
+    uint32_t tx_dropped;            ///< Packets not sent because the transmit ring was full
+    uint32_t stalls;                ///< Ticks skipped waiting for remote inputs
+    uint32_t rollbacks;             ///< Mispredictions corrected
+    uint32_t resim_frames;          ///< Frames simulated again in rollbacks
+    uint32_t max_rollback;          ///< Most frames rolled back at once
+    uint32_t max_resim_cycles;      ///< Longest rollback (restore + resimulate), in CPU cycles
+    uint32_t checks;                ///< Checksums compared with the other board
+    uint32_t desyncs;               ///< Checksums that did not match
+} Net_Stats_t;
+
+/**
+ * @struct Net_cfg_t
+ * @brief Netcode configuration and state
+ */
+typedef struct {
+    USART_TypeDef* uart;                            ///< Link UART (initialised, 8N1)
+    IRQn_Type irqn;                                 ///< Its interrupt
+    Snapshot_cfg_t* snapshot;                       ///< Game state, initialised, with NET_SNAPSHOTS slots
+    void (*simulate)(const Net_Input_t inputs[NET_PLAYERS]);    ///< Advance the game one tick
+    void (*restart)(void);                          ///< Put the game in its start state (same on both boards)
+    uint32_t local_id;                              ///< Unique per board, decides the player numbers
+    uint8_t setup_done;                             ///< Internal flag: 1 if initialised, 0 otherwise
+
+    Net_State_t state;                              ///< Link state
+    uint8_t local_player;                           ///< This board's player index (valid once running)
+    uint32_t session;                               ///< Internal: this board's session number (in its hello)
+    uint32_t peer_session;                          ///< Internal: the other board's, from its hello
+    uint32_t frame;                                 ///< Next frame to simulate
+    uint32_t confirmed;                             ///< Remote inputs are known for all frames below this
+    uint32_t peer_ack;                              ///< Internal: the other board has our inputs below this
+    uint32_t rollback_from;                         ///< Internal: earliest mispredicted frame
+    uint32_t idle_ticks;                            ///< Internal: ticks since the last valid packet
+    uint8_t peer_inputs_seen;                       ///< Internal flag: an input packet has arrived
+    Net_Input_t local_inputs[NET_INPUT_RING];       ///< Internal: local input history
+    Net_Input_t remote_inputs[NET_INPUT_RING];      ///< Internal: remote inputs (confirmed or predicted)
+    uint32_t snapshot_frame[NET_SNAPSHOTS];         ///< Internal: frame held by each snapshot slot
+    uint32_t snapshot_crc[NET_SNAPSHOTS];           ///< Internal: checksum of each snapshot
+    uint32_t check_frame;                           ///< Internal: checksum from the other board to compare
+    uint32_t check_crc;                             ///< Internal: its value
+    uint8_t check_pending;                          ///< Internal flag: a checksum is waiting to be compared
+
+    volatile uint16_t rx_head, rx_tail;             ///< Internal: receive ring (ISR writes head)
+    volatile uint16_t tx_head, tx_tail;             ///< Internal: transmit ring (ISR reads tail)
+    uint8_t rx_buf[NET_RX_SIZE];                    ///< Internal: receive ring storage
+    uint8_t tx_buf[NET_TX_SIZE];                    ///< Internal: transmit ring storage
+    uint8_t parse_state;                            ///< Internal: packet parser state
+    uint8_t parse_type;                             ///< Internal: packet being parsed
+    uint8_t parse_len;                              ///< Internal: its payload length
+    uint8_t parse_pos;                              ///< Internal: bytes of payload received
+    uint8_t parse_crc;                              ///< Internal: low byte of the received CRC
+    uint8_t parse_buf[64];                          ///< Internal: payload
+
+    volatile uint32_t rx_overruns;                  ///< Internal: counted in the ISR
+    Net_Stats_t stats;                              ///< Internal: read with Net_GetStats()
+} Net_cfg_t;
+
+/**
+ * @brief Initialise the module and enable the UART receive interrupt
+ *
+ * The snapshot configuration must already be initialised (Snapshot_Init()).
+ */
+void Net_Init(Net_cfg_t* cfg);
+
+/**
+ * @brief Re-enable the UART interrupts after the UART was re-initialised (e.g., clock change)
+ */
+void Net_Attach(Net_cfg_t* cfg);
+
+/**
+ * @brief Start a new session: restart() the game, reset frame counters and begin the handshake
+ *
+ * Bytes received before the call (from an earlier session) are dropped.
+ */
+void Net_Start(Net_cfg_t* cfg);
+
+/**
+ * @brief Stop the session (inputs are no longer sent or simulated)
+ */
+void Net_Stop(Net_cfg_t* cfg);
+
+/**
+ * @brief Run one game tick
+ *
+ * Processes received packets, rolls back and resimulates on a misprediction,
+ * simulates the next frame (unless stalled) and sends this board's inputs.
+ * May call restart() when the session starts over (see above).
+ *
+ * @param input This board's input for this tick
+ * @return 1 if a frame was simulated (input used), 0 if syncing or stalled
+ */
+uint8_t Net_Tick(Net_cfg_t* cfg, Net_Input_t input);
+
+/**
+ * @brief Check if the other board has been heard from recently
+ */
+uint8_t Net_IsConnected(const Net_cfg_t* cfg);
+
+/**
+ * @brief Measure the cost of rolling back and resimulating the last n frames
+ *
+ * Restores the snapshot from n frames ago and simulates forward again with
+ * the same inputs. The resulting state must be identical (a determinism
+ * check); a mismatch is counted as a desync. This is a full rollback on
+ * the live game, with its trace entries, so call it on demand (the log task
+ * does only in NET_BENCH builds), not every frame.
+ *
+ * @param n Frames to resimulate (clamped to NET_MAX_ROLLBACK and the frames played)
+ * @return CPU cycles taken, 0 if nothing could be measured
+ */
+uint32_t Net_MeasureResim(Net_cfg_t* cfg, uint8_t n);
+
+/**
+ * @brief Get the instrumentation counters
+ *
+ * @param reset 1 to clear the maximums after reading
+ */
+void Net_GetStats(Net_cfg_t* cfg, Net_Stats_t* stats, uint8_t reset);
+
+/**
+ * @brief UART interrupt handler - call from the link UART's IRQHandler
+ */
+void Net_UART_IRQHandler(Net_cfg_t* cfg);
+
+#endif // NETCODE_H
@@ -0,0 +1,268 @@
+#include "PWM_Effects.h"
+#include "stm32l4xx_hal.h"
+
+/**
+ * @file PWM_Effects.c
+ * @brief Implementation of the DMA-driven LED effects engine
+ *
+ * Two duty tables are used as a ping-pong pair: one is streamed by the DMA
+ * in circular mode while the other can be rendered with a chained pattern.
+ * At the end of each table loop the DMA transfer-complete interrupt counts
+ * down the repeats and, when the pattern ends, either switches to the other
+ * table or stops the effect.
+ */
+
+// Duty tables (compare register values), streamed by DMA
+static uint16_t fx_table[2][PWM_FX_MAX_STEPS];
+
+// Gamma 2.2 curve sampled at 65 points: (i/64)^2.2 scaled to 0..65535
+static const uint16_t gamma_lut[65] = {
+        0,     7,    32,    78,   147,   240,   359,   504,   676,   875,
+     1104,  1361,  1648,  1966,  2314,  2693,  3104,  3547,  4022,  4530,
+     5072,  5646,  6255,  6897,  7574,  8286,  9033,  9815, 10632, 11486,
+    12375, 13301, 14263, 15262, 16298, 17371, 18482, 19630, 20816, 22040,
+    23303, 24604, 25943, 27322, 28739, 30196, 31692, 33227, 34802, 36417,
+    38072, 39768, 41503, 43280, 45097, 46954, 48853, 50793, 52774, 54796,
+    56860, 58966, 61114, 63303, 65535
+};
+
+static inline uint32_t clamp_u32(uint32_t x, uint32_t lo, uint32_t hi)
+{
+    if (x < lo) return lo;
+    if (x > hi) return hi;
+    return x;
+}
+
+// Perceived brightness (0..1024) to linear duty (0..65535), interpolating the LUT
+static uint32_t gamma_correct(uint32_t brightness)
+{
+    brightness = clamp_u32(brightness, 0u, 1024u);
+    uint32_t index = brightness >> 4;
+    uint32_t frac = brightness & 0x0Fu;
+    if (index >= 64u) {
+        return gamma_lut[64];
+    }
+    return gamma_lut[index] + (((gamma_lut[index + 1u] - gamma_lut[index]) * frac) >> 4);
+}
+
+// Channel number (0-based) of a DMA channel within its controller
+static uint32_t dma_channel_index(PWM_FX_cfg_t* fx)
+{
+    return ((uint32_t)fx->dma_channel - (uint32_t)fx->dma - 0x08u) / 0x14u;
+}
+
+// Address of the compare register for the configured timer channel (CCR1..CCR4 are contiguous)
+static volatile uint32_t* compare_register(PWM_FX_cfg_t* fx)
+{
+    return &fx->pwm->htim->Instance->CCR1 + (fx->pwm->channel >> 2);
+}
+
+// Render one pattern period into a duty table, returns the number of steps
+static uint16_t render_pattern(uint16_t* table, const PWM_FX_Pattern_t* pattern, uint32_t top)
+{
+    uint32_t steps = ((uint32_t)pattern->period_ms * PWM_FX_UPDATE_HZ) / 1000u;
+    steps = clamp_u32(steps, 2u, PWM_FX_MAX_STEPS);
+
+    // Brightness range scaled from percent to 0..1024
+    uint32_t lo = (clamp_u32(pattern->min_percent, 0u, 100u) * 1024u) / 100u;
+    uint32_t hi = (clamp_u32(pattern->max_percent, 0u, 100u) * 1024u) / 100u;
+    if (lo > hi) {
+        uint32_t t = lo; lo = hi; hi = t;
+    }
+    uint32_t span = hi - lo;
+
+    for (uint32_t i = 0; i < steps; i++) {
+        // Phase through the period, 0..1023
+        uint32_t phase = (i * 1024u) / steps;
+        uint32_t level;
+
+        switch (pattern->shape) {
+            case PWM_FX_FADE_IN:  level = lo + ((span * phase) >> 10); break;
+            case PWM_FX_FADE_OUT: level = hi - ((span * phase) >> 10); break;
+            case PWM_FX_BREATHE:
+                // Triangle: up over the first half, down over the second
+                level = (phase < 512u) ? lo + ((span * phase) >> 9)
+                                       : hi - ((span * (phase - 512u)) >> 9);
+                break;
+            case PWM_FX_BLINK:    level = (phase < 512u) ? hi : lo; break;
+            case PWM_FX_SOLID:
+            default:              level = hi; break;
+        }
+
+        uint32_t ccr = (gamma_correct(level) * top) >> 16;
+        table[i] = (uint16_t)clamp_u32(ccr, 0u, top - 1u);
+    }
+    return (uint16_t)steps;
+}
+
+// Point the DMA channel at a duty table and start streaming it (channel must be disabled)
+static void dma_stream_slot(PWM_FX_cfg_t* fx, uint8_t slot)
+{
+    uint32_t idx = dma_channel_index(fx);
+
+    fx->dma->IFCR = DMA_IFCR_CGIF1 << (4u * idx);
+    fx->dma_channel->CMAR = (uint32_t)fx_table[slot];
+    fx->dma_channel->CNDTR = fx->slot_steps[slot];
+    fx->active_slot = slot;
+    fx->dma_channel->CCR |= DMA_CCR_EN;
+}
+
+void PWM_FX_Init(PWM_FX_cfg_t* fx)
+{
+    if (fx->setup_done) {
+        return;
+    }
+
+    if (!fx->pwm->setup_done) {
+        PWM_Init(fx->pwm);
+    }
+
+    RCC->AHB1ENR |= (fx->dma == DMA1) ? RCC_AHB1ENR_DMA1EN : RCC_AHB1ENR_DMA2EN;
+
+    // Route the timer update request to this channel
+    uint32_t idx = dma_channel_index(fx);
+    DMA_Request_TypeDef* cselr = (fx->dma == DMA1) ? DMA1_CSELR : DMA2_CSELR;
+    cselr->CSELR = (cselr->CSELR & ~(0xFu << (4u * idx))) | ((uint32_t)fx->dma_request << (4u * idx));
+
+    // Memory (16-bit, incrementing) => compare register (16-bit), circular, interrupt per loop
+    fx->dma_channel->CCR = 0;
+    fx->dma_channel->CPAR = (uint32_t)compare_register(fx);
+    fx->dma_channel->CCR = DMA_CCR_MSIZE_0 |
+                           DMA_CCR_PSIZE_0 |
+                           DMA_CCR_MINC    |
+                           DMA_CCR_CIRC    |
+                           DMA_CCR_DIR     |
+                           DMA_CCR_TCIE;
+
+    // Lowest priority: a late table switch only delays the pattern change by one step
+    HAL_NVIC_SetPriority(fx->dma_irq, 15, 0);
+    HAL_NVIC_EnableIRQ(fx->dma_irq);
+
+    fx->running = 0;
+    fx->chained = 0;
+    fx->active_slot = 0;
+    fx->setup_done = 1;
+}
+
+uint8_t PWM_FX_IsRunning(PWM_FX_cfg_t* fx)
+{
+    return fx->running ? 1u : 0u;
+}
+
+// Stop streaming and restore the timer (the DMA interrupt must not run meanwhile)
+static void stop_effect(PWM_FX_cfg_t* fx)
+{
+    if (!fx->running) {
+        fx->chained = 0;
+        return;
+    }
+
+    fx->dma_channel->CCR &= ~DMA_CCR_EN;
+    __HAL_TIM_DISABLE_DMA(fx->pwm->htim, TIM_DMA_UPDATE);
+    fx->running = 0;
+    fx->chained = 0;
+
+    // Output off, then restore the frequency that was in use before effects started
+    PWM_Off(fx->pwm);
+    PWM_SetFreq(fx->pwm, fx->pwm->tick_freq_hz / (fx->saved_arr + 1u));
+}
+
+void PWM_FX_Stop(PWM_FX_cfg_t* fx)
+{
+    if (!fx->setup_done) {
+        return;
+    }
+
+    // The transfer-complete interrupt reprograms the channel too (table
+    // switch, stop at the end of a pattern): keep it out while stopping
+    HAL_NVIC_DisableIRQ(fx->dma_irq);
+    stop_effect(fx);
+    HAL_NVIC_EnableIRQ(fx->dma_irq);
+}
+
+void PWM_FX_Start(PWM_FX_cfg_t* fx, const PWM_FX_Pattern_t* pattern)
+{
+    if (!fx->setup_done) {
+        PWM_FX_Init(fx);
+    }
+
+    // Keep the transfer-complete interrupt out until the new table streams:
+    // a stop or table switch from it in the middle would leave the channel
+    // half-configured. A completion it missed is cleared with the flags.
+    HAL_NVIC_DisableIRQ(fx->dma_irq);
+
+    // Stop streaming (keep the timer running) and drop any chained pattern
+    fx->dma_channel->CCR &= ~DMA_CCR_EN;
+    fx->chained = 0;
+
+    if (!fx->running) {
+        // Retune the timer so each update event is one table step
+        fx->saved_arr = __HAL_TIM_GET_AUTORELOAD(fx->pwm->htim);
+        PWM_SetFreq(fx->pwm, PWM_FX_UPDATE_HZ);
+        PWM_SetDuty(fx->pwm, 1);   // Starts the PWM output, the DMA overwrites the duty
+        __HAL_TIM_ENABLE_DMA(fx->pwm->htim, TIM_DMA_UPDATE);
+    }
+
+    uint32_t top = __HAL_TIM_GET_AUTORELOAD(fx->pwm->htim) + 1u;
+    uint8_t slot = fx->active_slot ^ 1u;
+    fx->slot_steps[slot] = render_pattern(fx_table[slot], pattern, top);
+    fx->loops_left = pattern->repeat;
+    fx->running = 1;
+
+    dma_stream_slot(fx, slot);
+    HAL_NVIC_EnableIRQ(fx->dma_irq);
+}
+
+void PWM_FX_Chain(PWM_FX_cfg_t* fx, const PWM_FX_Pattern_t* pattern)
+{
+    if (!fx->setup_done) {
+        PWM_FX_Start(fx, pattern);
+        return;
+    }
+
+    // Keep the ISR from switching to the idle table while it is re-rendered,
+    // or from ending the effect between the check and the queueing
+    HAL_NVIC_DisableIRQ(fx->dma_irq);
+    if (!fx->running) {
+        HAL_NVIC_EnableIRQ(fx->dma_irq);
+        PWM_FX_Start(fx, pattern);
+        return;
+    }
+
+    uint32_t top = __HAL_TIM_GET_AUTORELOAD(fx->pwm->htim) + 1u;
+    uint8_t slot = fx->active_slot ^ 1u;
+    fx->chained = 0;
+    fx->slot_steps[slot] = render_pattern(fx_table[slot], pattern, top);
+    fx->chained_repeat = pattern->repeat;
+    fx->chained = 1;
+    HAL_NVIC_EnableIRQ(fx->dma_irq);
+}
+
+void PWM_FX_IRQHandler(PWM_FX_cfg_t* fx)
+{
+    uint32_t idx = dma_channel_index(fx);
+    uint32_t tc_flag = DMA_ISR_TCIF1 << (4u * idx);
+
+    if (!(fx->dma->ISR & tc_flag)) {
+        return;
+    }
+    fx->dma->IFCR = DMA_IFCR_CGIF1 << (4u * idx);
+
+    // One full period of the table has been played (loops_left == 0 means forever)
+    uint8_t finished = 0;
+    if (fx->loops_left > 0) {
+        fx->loops_left--;
+        finished = (fx->loops_left == 0);
+    }
+
+    if (fx->chained && fx->loops_left == 0) {
+        // Switch to the chained table at the period boundary
+        fx->dma_channel->CCR &= ~DMA_CCR_EN;
+        fx->chained = 0;
+        fx->loops_left = fx->chained_repeat;
+        dma_stream_slot(fx, fx->active_slot ^ 1u);
+    }
+    else if (finished) {
+        stop_effect(fx);
+    }
+}
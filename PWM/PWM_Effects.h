@@ -0,0 +1,159 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+#include "PWM.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file PWM_Effects.h
+ * @brief DMA-driven LED effects (breathing, fades, blinking) for the PWM library
+ *
+ * Instead of calling PWM_SetDuty() every frame, an effect is rendered once into
+ * a table of gamma-corrected compare values. The timer's update event then
+ * triggers a DMA transfer that copies the next value into the CCR register,
+ * so a running effect costs no CPU time per frame. A DMA interrupt fires once
+ * per loop of the table to count repeats and switch to a chained pattern.
+ *
+ * The engine retunes the timer to PWM_FX_UPDATE_HZ while an effect runs.
+ * Only one engine instance is supported (the duty tables are static).
+ * PWM_FX_Start(), PWM_FX_Chain() and PWM_FX_Stop() mask the DMA interrupt
+ * while they reprogram the channel, so they are safe against it; call them
+ * from the main loop, not from other interrupts.
+ *
+ * Example usage:
+ * @code
+ * // TIM4 update event => DMA1 Channel 7, request 6 on STM32L476
+ * PWM_FX_cfg_t fx_cfg = {
+ *     .pwm = &pwm_cfg,
+ *     .dma = DMA1,
+ *     .dma_channel = DMA1_Channel7,
+ *     .dma_request = 6,
+ *     .dma_irq = DMA1_Channel7_IRQn,
+ *     .setup_done = 0
+ * };
+ *
+ * const PWM_FX_Pattern_t breathe = {PWM_FX_BREATHE, 2000, 5, 80, 0};
+ * const PWM_FX_Pattern_t flash   = {PWM_FX_BLINK, 100, 0, 100, 5};
+ *
+ * PWM_FX_Init(&fx_cfg);
+ * PWM_FX_Start(&fx_cfg, &flash);     // Flash 5 times...
+ * PWM_FX_Chain(&fx_cfg, &breathe);   // ...then breathe forever
+ *
+ * // In DMA1_Channel7_IRQHandler():
+ * PWM_FX_IRQHandler(&fx_cfg);
+ * @endcode
+ */
+
+// Rate at which the duty table advances (also the LED PWM frequency while an effect runs)
+#define PWM_FX_UPDATE_HZ 250
+
+// Steps per table: 512 steps at 250 Hz gives patterns up to 2048 ms long
+#define PWM_FX_MAX_STEPS 512
+
+/**
+ * @enum PWM_FX_Shape_t
+ * @brief Brightness curve of one pattern period
+ */
+typedef enum {
+    PWM_FX_SOLID = 0,   ///< Constant at max_percent
+    PWM_FX_FADE_IN,     ///< Ramp from min_percent up to max_percent
+    PWM_FX_FADE_OUT,    ///< Ramp from max_percent down to min_percent
+    PWM_FX_BREATHE,     ///< Ramp up then down (triangle in perceived brightness)
+    PWM_FX_BLINK        ///< max_percent for the first half, min_percent for the second
+} PWM_FX_Shape_t;
+
+/**
+ * @struct PWM_FX_Pattern_t
+ * @brief Description of an LED effect
+ *
+ * Brightness values are perceived brightness and are gamma corrected when
+ * the duty table is rendered.
+ */
+typedef struct {
+    PWM_FX_Shape_t shape;   ///< Brightness curve
+    uint16_t period_ms;     ///< Length of one period (clamped to PWM_FX_MAX_STEPS table entries)
+    uint8_t min_percent;    ///< Lowest brightness 0..100
+    uint8_t max_percent;    ///< Highest brightness 0..100
+    uint8_t repeat;         ///< Number of periods to play, 0 = forever
+} PWM_FX_Pattern_t;
+
+/**
+ * @struct PWM_FX_cfg_t
+ * @brief Configuration and state of the effects engine
+ *
+ * @details The DMA channel and request must be the ones wired to the update
+ * event of the PWM timer (see the DMA request mapping table in the reference manual).
+ */
+typedef struct {
+    PWM_cfg_t* pwm;                     ///< PWM instance the effects drive (must be set up)
+    DMA_TypeDef* dma;                   ///< DMA controller (e.g., DMA1)
+    DMA_Channel_TypeDef* dma_channel;   ///< DMA channel for the timer update request (e.g., DMA1_Channel7)
+    uint8_t dma_request;                ///< CSELR request number for the timer update (e.g., 6)
+    IRQn_Type dma_irq;                  ///< DMA channel interrupt (e.g., DMA1_Channel7_IRQn)
+    uint8_t setup_done;                 ///< Internal flag: 1 if initialised, 0 otherwise
+    volatile uint8_t running;           ///< Internal flag: 1 while an effect is streaming
+    volatile uint8_t active_slot;       ///< Internal: duty table being streamed (0 or 1)
+    volatile uint8_t chained;           ///< Internal flag: 1 if the other table holds a chained pattern
+    volatile uint8_t loops_left;        ///< Internal: periods left in the current pattern (0 = forever)
+    uint8_t chained_repeat;             ///< Internal: repeat count of the chained pattern
+    uint16_t slot_steps[2];             ///< Internal: number of entries in each duty table
+    uint32_t saved_arr;                 ///< Internal: timer period to restore when effects stop
+} PWM_FX_cfg_t;
+
+/**
+ * @brief Initialise the effects engine (DMA channel, request mapping and interrupt)
+ *
+ * @param fx Pointer to effects configuration struct
+ *
+ * @note The PWM timer must be initialised (MX_TIMx_Init) before calling this
+ */
+void PWM_FX_Init(PWM_FX_cfg_t* fx);
+
+/**
+ * @brief Start an effect immediately, replacing any running or chained effect
+ *
+ * @param fx Pointer to effects configuration struct
+ * @param pattern Effect to play
+ */
+void PWM_FX_Start(PWM_FX_cfg_t* fx, const PWM_FX_Pattern_t* pattern);
+
+/**
+ * @brief Queue an effect to start when the current one ends
+ *
+ * If the current effect repeats forever, the switch happens at the end of its
+ * current period. Only one effect can be queued; a second call replaces it.
+ * If nothing is running the effect starts immediately.
+ *
+ * @param fx Pointer to effects configuration struct
+ * @param pattern Effect to play next
+ */
+void PWM_FX_Chain(PWM_FX_cfg_t* fx, const PWM_FX_Pattern_t* pattern);
+
+/**
+ * @brief Stop any effect, turn the output off and restore the original PWM frequency
+ *
+ * @param fx Pointer to effects configuration struct
+ */
+void PWM_FX_Stop(PWM_FX_cfg_t* fx);
+
+/**
+ * @brief Check if an effect is running
+ *
+ * @param fx Pointer to effects configuration struct
+ * @return 1 if an effect is streaming, 0 otherwise
+ */
+uint8_t PWM_FX_IsRunning(PWM_FX_cfg_t* fx);
+
+/**
+ * @brief DMA interrupt handler - call from the DMA channel IRQ handler
+ *
+ * @param fx Pointer to effects configuration struct
+ */
+void PWM_FX_IRQHandler(PWM_FX_cfg_t* fx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,153 @@
+#include "ClockGov.h"
+
+/**
+ * @file ClockGov.c
+ * @brief Implementation of the load-based clock governor
+ */
+
+// All profiles stay in voltage range 1: PLLSAI1 feeds the ADC (64 MHz) and
+// RNG (48 MHz), which exceed the 26 MHz range 2 limit
+const ClockGov_Profile_t clockgov_profiles[CLOCKGOV_PROFILE_COUNT] = {
+    {80000000, 10, RCC_PLLR_DIV2, FLASH_LATENCY_4},     // VCO 160 MHz
+    {48000000, 12, RCC_PLLR_DIV4, FLASH_LATENCY_2},     // VCO 192 MHz
+    {24000000, 12, RCC_PLLR_DIV8, FLASH_LATENCY_1},     // VCO 192 MHz
+};
+
+// Keep the timers counting at timer_tick_hz (new prescaler loads at the next update event)
+static void rescale_timers(ClockGov_cfg_t* cfg)
+{
+    uint32_t timer_clk = clockgov_profiles[cfg->profile].sysclk_hz;
+    uint32_t psc = timer_clk / cfg->timer_tick_hz - 1u;
+
+    for (uint8_t i = 0; i < cfg->timer_count; i++) {
+        cfg->timers[i]->Init.Prescaler = psc;
+        __HAL_TIM_SET_PRESCALER(cfg->timers[i], psc);
+    }
+}
+
+// Run from HSI16, retune the PLL, then switch back to it
+static HAL_StatusTypeDef apply_profile(const ClockGov_Profile_t* profile)
+{
+    RCC_OscInitTypeDef osc = {0};
+    RCC_ClkInitTypeDef clk = {0};
+
+    clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK |
+                    RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clk.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    clk.APB1CLKDivider = RCC_HCLK_DIV1;
+    clk.APB2CLKDivider = RCC_HCLK_DIV1;
+
+    // The PLL can't be reconfigured while it drives SYSCLK
+    clk.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+    if (HAL_RCC_ClockConfig(&clk, FLASH_LATENCY_0) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    osc.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+    osc.PLL.PLLState = RCC_PLL_ON;
+    osc.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+    osc.PLL.PLLM = 1;
+    osc.PLL.PLLN = profile->pll_n;
+    osc.PLL.PLLP = RCC_PLLP_DIV7;
+    osc.PLL.PLLQ = RCC_PLLQ_DIV4;
+    osc.PLL.PLLR = profile->pll_r;
+    if (HAL_RCC_OscConfig(&osc) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    // HAL orders the flash latency change correctly for both directions
+    clk.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+    return HAL_RCC_ClockConfig(&clk, profile->flash_latency);
+}
+
+void ClockGov_Init(ClockGov_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    cfg->profile = 0;
+    cfg->quiet_frames = 0;
+    cfg->switches = 0;
+    cfg->setup_done = 1;
+}
+
+uint8_t ClockGov_SetProfile(ClockGov_cfg_t* cfg, uint8_t index)
+{
+    if (index >= CLOCKGOV_PROFILE_COUNT) {
+        return 0;
+    }
+    if (index == cfg->profile) {
+        return 1;
+    }
+
+    if (apply_profile(&clockgov_profiles[index]) != HAL_OK) {
+        // Get back to a known clock; without one nothing else will work
+        if (apply_profile(&clockgov_profiles[cfg->profile]) != HAL_OK) {
+            Error_Handler();
+        }
+        return 0;
+    }
+
+    cfg->profile = index;
+    cfg->quiet_frames = 0;
+    cfg->switches++;
+    rescale_timers(cfg);
+
+    if (cfg->clocks_changed) {
+        cfg->clocks_changed();
+    }
+    return 1;
+}
+
+void ClockGov_Resync(ClockGov_cfg_t* cfg)
+{
+    cfg->profile = 0;
+    cfg->quiet_frames = 0;
+    rescale_timers(cfg);
+}
+
+void ClockGov_Update(ClockGov_cfg_t* cfg, uint32_t busy_us, uint32_t period_us)
+{
+    if (!cfg->setup_done || period_us == 0) {
+        return;
+    }
+
+    uint32_t current_hz = clockgov_profiles[cfg->profile].sysclk_hz;
+
+    // Missed the deadline: go straight to full speed
+    if (busy_us >= period_us) {
+        ClockGov_SetProfile(cfg, 0);
+        return;
+    }
+
+    // Close to the deadline: one step faster
+    if ((uint64_t)busy_us * 100u > (uint64_t)period_us * cfg->up_percent) {
+        if (cfg->profile > 0) {
+            ClockGov_SetProfile(cfg, cfg->profile - 1u);
+        }
+        return;
+    }
+
+    if (cfg->profile + 1u >= CLOCKGOV_PROFILE_COUNT) {
+        return;
+    }
+
+    // Would this frame still fit comfortably at the next slower clock?
+    uint32_t slower_hz = clockgov_profiles[cfg->profile + 1u].sysclk_hz;
+    uint64_t predicted_us = ((uint64_t)busy_us * current_hz) / slower_hz;
+
+    if (predicted_us * 100u < (uint64_t)period_us * cfg->down_percent) {
+        if (++cfg->quiet_frames >= cfg->down_hold_frames) {
+            ClockGov_SetProfile(cfg, cfg->profile + 1u);
+        }
+    }
+    else {
+        cfg->quiet_frames = 0;
+    }
+}
+
+uint32_t ClockGov_GetSysclkHz(ClockGov_cfg_t* cfg)
+{
+    return clockgov_profiles[cfg->profile].sysclk_hz;
+}
@@ -0,0 +1,120 @@
+#ifndef CLOCKGOV_H
+#define CLOCKGOV_H
+
+#include <stdint.h>
+#include "main.h"
+
+/**
+ * @file ClockGov.h
+ * @brief Clock governor: pick the slowest system clock that still meets the frame deadline
+ *
+ * SystemClock_Config() always runs the core at 80 MHz. Frames that only read
+ * the joystick (idle character, static menu) need a fraction of that.
+ * ClockGov_Update() is called once per frame with the measured busy time. It
+ * steps between predefined PLL profiles (80/48/24 MHz):
+ *
+ * - Up one profile as soon as a frame uses more than up_percent of its period
+ * - Straight to the fastest profile if a frame missed its deadline
+ * - Down one profile only after down_hold_frames consecutive frames that would
+ *   still fit in down_percent of the period at the slower clock (hysteresis)
+ *
+ * On every switch the flash latency is adjusted and the listed timers get a
+ * new prescaler so they keep ticking at timer_tick_hz (buzzer and LED PWM
+ * frequencies don't change). SysTick is re-initialised by the HAL. Other
+ * clock-dependent peripherals (UART baud rate) are re-initialised from the
+ * clocks_changed callback. The SPI clock is PCLK/2 and scales with the profile.
+ * Its cost is part of the measured busy time, so the governor accounts for it.
+ *
+ * Example usage:
+ * @code
+ * ClockGov_cfg_t gov_cfg = {
+ *     .timers = {&htim2, &htim4},
+ *     .timer_count = 2,
+ *     .timer_tick_hz = 1000000,
+ *     .up_percent = 85,
+ *     .down_percent = 60,
+ *     .down_hold_frames = 30,
+ *     .clocks_changed = reinit_uart,
+ *     .setup_done = 0
+ * };
+ *
+ * ClockGov_Init(&gov_cfg);   // after SystemClock_Config() and MX_TIMx_Init()
+ * while (1) {
+ *     update(); render();
+ *     ClockGov_Update(&gov_cfg, busy_us, 30000);
+ *     wait_for_next_frame();
+ * }
+ * @endcode
+ */
+
+#define CLOCKGOV_MAX_TIMERS 4
+
+/**
+ * @struct ClockGov_Profile_t
+ * @brief One system clock setting (HSI 16 MHz => PLL, M = 1)
+ */
+typedef struct {
+    uint32_t sysclk_hz;         ///< Resulting SYSCLK = HCLK = PCLK1 = PCLK2
+    uint32_t pll_n;             ///< PLL multiplier (VCO = 16 MHz * N)
+    uint32_t pll_r;             ///< PLL R divider (RCC_PLLR_DIVx)
+    uint32_t flash_latency;     ///< Flash wait states for this clock in voltage range 1
+} ClockGov_Profile_t;
+
+// Profiles, fastest first
+#define CLOCKGOV_PROFILE_COUNT 3
+extern const ClockGov_Profile_t clockgov_profiles[CLOCKGOV_PROFILE_COUNT];
+
+/**
+ * @struct ClockGov_cfg_t
+ * @brief Governor configuration and state
+ */
+typedef struct {
+    TIM_HandleTypeDef* timers[CLOCKGOV_MAX_TIMERS];    ///< Timers (on APB1/APB2, divider 1) to keep at timer_tick_hz
+    uint8_t timer_count;                ///< Number of entries in timers
+    uint32_t timer_tick_hz;             ///< Counter clock the timers should keep (e.g., 1000000)
+    uint8_t up_percent;                 ///< Step up when busy time exceeds this share of the period (e.g., 85)
+    uint8_t down_percent;               ///< Step down when the slower clock would stay below this share (e.g., 60)
+    uint16_t down_hold_frames;          ///< Consecutive quiet frames required before stepping down (e.g., 30)
+    void (*clocks_changed)(void);       ///< Optional: re-initialise clock-dependent peripherals (UART baud etc.)
+    uint8_t setup_done;                 ///< Internal flag: 1 if initialised, 0 otherwise
+    uint8_t profile;                    ///< Internal: index of the active profile
+    uint16_t quiet_frames;              ///< Internal: consecutive frames that qualified for stepping down
+    uint32_t switches;                  ///< Internal: number of profile switches (for statistics)
+} ClockGov_cfg_t;
+
+/**
+ * @brief Initialise the governor (assumes the fastest profile is active)
+ */
+void ClockGov_Init(ClockGov_cfg_t* cfg);
+
+/**
+ * @brief Feed one frame's busy time and switch profile if needed
+ *
+ * @param busy_us Time the frame spent awake (e.g., Sched_TakeBusyUs())
+ * @param period_us Frame period
+ */
+void ClockGov_Update(ClockGov_cfg_t* cfg, uint32_t busy_us, uint32_t period_us);
+
+/**
+ * @brief Switch to a profile immediately
+ *
+ * @param index Index into clockgov_profiles (0 = fastest)
+ * @return 1 on success, 0 if the clock switch failed (old clock kept)
+ */
+uint8_t ClockGov_SetProfile(ClockGov_cfg_t* cfg, uint8_t index);
+
+/**
+ * @brief Resynchronise after the clock was changed elsewhere (e.g., SystemClock_Config)
+ *
+ * Marks the fastest profile as active and rescales the timers for it.
+ */
+void ClockGov_Resync(ClockGov_cfg_t* cfg);
+
+/**
+ * @brief Get the active system clock
+ *
+ * @return SYSCLK of the active profile in Hz
+ */
+uint32_t ClockGov_GetSysclkHz(ClockGov_cfg_t* cfg);
+
+#endif // CLOCKGOV_H
@@ -0,0 +1,212 @@
+#include "Power.h"
+
+/**
+ * @file Power.c
+ * @brief Implementation of WFI-based idling and low-power run
+ */
+
+// Set from interrupts to end a sleep early
+static volatile uint8_t wake_event = 0;
+
+// Duty-cycle accounting for the current one-second window
+static uint32_t window_start_us = 0;
+static uint32_t window_sleep_us = 0;
+static uint32_t window_frames = 0;
+static uint32_t window_overruns = 0;
+
+// Last completed window
+static Power_Stats_t last_stats;
+static uint8_t stats_ready = 0;
+
+uint32_t Power_TimeUs(void)
+{
+    uint32_t tick, val;
+
+    // Re-read if the tick changed while sampling SysTick, so the pair is consistent
+    do {
+        tick = HAL_GetTick();
+        val = SysTick->VAL;
+    } while (tick != HAL_GetTick());
+
+    uint32_t load = SysTick->LOAD + 1u;
+    uint32_t elapsed = load - 1u - val;   // SysTick counts down
+    return tick * 1000u + (elapsed * 1000u) / load;
+}
+
+static void close_window_if_due(uint32_t now_us)
+{
+    uint32_t window_us = now_us - window_start_us;
+    if (window_us < 1000000u) {
+        return;
+    }
+
+    if (window_sleep_us > window_us) {
+        window_sleep_us = window_us;
+    }
+    last_stats.sleep_us = window_sleep_us;
+    last_stats.active_us = window_us - window_sleep_us;
+    last_stats.active_permille = (uint16_t)(((uint64_t)last_stats.active_us * 1000u) / window_us);
+    last_stats.frames = window_frames;
+    last_stats.overruns = window_overruns;
+    stats_ready = 1;
+
+    window_start_us = now_us;
+    window_sleep_us = 0;
+    window_frames = 0;
+    window_overruns = 0;
+}
+
+void Power_Init(Power_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    // Let debug stay attached through sleep (otherwise SWD drops during WFI)
+    HAL_DBGMCU_EnableDBGSleepMode();
+
+    cfg->low_power = 0;
+    cfg->last_activity_ms = HAL_GetTick();
+
+    window_start_us = Power_TimeUs();
+    window_sleep_us = 0;
+    window_frames = 0;
+    window_overruns = 0;
+    stats_ready = 0;
+    cfg->setup_done = 1;
+}
+
+void Power_NotifyEvent(void)
+{
+    wake_event = 1;
+}
+
+void Power_SleepUntil(uint32_t deadline_ms)
+{
+    uint32_t start_us = Power_TimeUs();
+
+    while ((int32_t)(HAL_GetTick() - deadline_ms) < 0) {
+        // Check and sleep with interrupts masked: an interrupt that arrives in
+        // between still wakes WFI (it becomes pending), so no wakeup is lost
+        __disable_irq();
+        if (wake_event) {
+            __enable_irq();
+            break;
+        }
+        __WFI();
+        __enable_irq();
+    }
+    wake_event = 0;
+
+    uint32_t now_us = Power_TimeUs();
+    window_sleep_us += now_us - start_us;
+    close_window_if_due(now_us);
+}
+
+void Power_ReportActivity(Power_cfg_t* cfg)
+{
+    cfg->last_activity_ms = HAL_GetTick();
+    if (cfg->low_power) {
+        Power_ExitLowPowerRun(cfg);
+    }
+}
+
+uint8_t Power_IsLowPower(Power_cfg_t* cfg)
+{
+    return cfg->low_power ? 1u : 0u;
+}
+
+void Power_CountFrame(uint8_t overrun)
+{
+    window_frames++;
+    if (overrun) {
+        window_overruns++;
+    }
+
+    // A fully loaded system never sleeps, so the window may also close here
+    close_window_if_due(Power_TimeUs());
+}
+
+void Power_Idle(Power_cfg_t* cfg, uint32_t sleep_us)
+{
+    if (!cfg->low_power && cfg->idle_timeout_ms > 0 &&
+        (HAL_GetTick() - cfg->last_activity_ms) >= cfg->idle_timeout_ms) {
+        Power_EnterLowPowerRun(cfg);
+    }
+
+    // Round up to whole ticks so short sleeps still reach the release time
+    Power_SleepUntil(HAL_GetTick() + (sleep_us + 999u) / 1000u);
+}
+
+void Power_EnterLowPowerRun(Power_cfg_t* cfg)
+{
+    RCC_OscInitTypeDef osc = {0};
+    RCC_ClkInitTypeDef clk = {0};
+
+    if (cfg->low_power) {
+        return;
+    }
+    // An erase or program still running would be cut off by the flash latency
+    // change, and the store could not finish it in low-power run
+    if (cfg->busy && cfg->busy()) {
+        return;
+    }
+
+    // MSI range 5 = 2 MHz, the maximum system clock in low-power run
+    osc.OscillatorType = RCC_OSCILLATORTYPE_MSI;
+    osc.MSIState = RCC_MSI_ON;
+    osc.MSICalibrationValue = RCC_MSICALIBRATION_DEFAULT;
+    osc.MSIClockRange = RCC_MSIRANGE_5;
+    osc.PLL.PLLState = RCC_PLL_NONE;
+    if (HAL_RCC_OscConfig(&osc) != HAL_OK) {
+        return;
+    }
+
+    clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK |
+                    RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clk.SYSCLKSource = RCC_SYSCLKSOURCE_MSI;
+    clk.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    clk.APB1CLKDivider = RCC_HCLK_DIV1;
+    clk.APB2CLKDivider = RCC_HCLK_DIV1;
+    if (HAL_RCC_ClockConfig(&clk, FLASH_LATENCY_0) != HAL_OK) {
+        return;
+    }
+
+    // Main PLL is no longer needed (HSI stays on for PLLSAI1 => ADC)
+    osc.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+    osc.PLL.PLLState = RCC_PLL_OFF;
+    HAL_RCC_OscConfig(&osc);
+
+    HAL_PWREx_EnableLowPowerRunMode();
+    cfg->low_power = 1;
+
+    if (cfg->clocks_changed) {
+        cfg->clocks_changed();
+    }
+}
+
+void Power_ExitLowPowerRun(Power_cfg_t* cfg)
+{
+    if (!cfg->low_power) {
+        return;
+    }
+
+    // Regulator back to main mode before raising the clock
+    HAL_PWREx_DisableLowPowerRunMode();
+    if (cfg->restore_clocks) {
+        cfg->restore_clocks();
+    }
+    cfg->low_power = 0;
+
+    if (cfg->clocks_changed) {
+        cfg->clocks_changed();
+    }
+}
+
+uint8_t Power_GetStats(Power_Stats_t* stats)
+{
+    *stats = last_stats;
+    uint8_t fresh = stats_ready;
+    stats_ready = 0;
+    return fresh;
+}
@@ -0,0 +1,149 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include "main.h"
+
+/**
+ * @file Power.h
+ * @brief Power-aware idling: sleep (WFI) instead of busy-waiting
+ *
+ * HAL_Delay() spins at full power. Power_Idle(), the scheduler's idle hook,
+ * instead puts the core to sleep with WFI until the next task release.
+ * SysTick (every 1 ms), DMA completion and input interrupts wake it up. Input
+ * interrupts can also end the sleep early by calling Power_NotifyEvent().
+ *
+ * After a long period without activity the system can drop into low-power run
+ * mode (MSI at 2 MHz, regulator in low-power mode) with a longer frame period.
+ * The first activity restores the full-speed clocks. Flash cannot be erased
+ * or programmed in low-power run, so the optional busy() callback holds the
+ * switch off while a flash operation may still be running.
+ *
+ * Active vs sleep time is measured continuously and reported per second,
+ * with the frames the caller counted (Power_CountFrame(), e.g. from the
+ * scheduler's task_end hook) and how many of them overran.
+ *
+ * Example usage:
+ * @code
+ * Power_cfg_t power_cfg = {
+ *     .frame_period_ms = 30,
+ *     .idle_frame_period_ms = 100,
+ *     .idle_timeout_ms = 10000,
+ *     .restore_clocks = SystemClock_Config,
+ *     .clocks_changed = reinit_uart,
+ *     .busy = flash_busy,
+ *     .setup_done = 0
+ * };
+ *
+ * void sched_idle(uint32_t sleep_us) {
+ *     Power_Idle(&power_cfg, sleep_us);  // sleeps, may enter low-power run
+ * }
+ * void sched_task_end(uint8_t task, uint8_t missed) {
+ *     if (task == TASK_RENDER) Power_CountFrame(missed);
+ * }
+ *
+ * Power_Init(&power_cfg);
+ * // In the input task:
+ * if (input_active) Power_ReportActivity(&power_cfg);
+ * @endcode
+ */
+
+/**
+ * @struct Power_cfg_t
+ * @brief Frame pacing and low-power configuration
+ */
+typedef struct {
+    uint32_t frame_period_ms;           ///< Frame period at full speed (e.g., 30)
+    uint32_t idle_frame_period_ms;      ///< Frame period in low-power run (e.g., 100)
+    uint32_t idle_timeout_ms;           ///< Inactivity before entering low-power run (0 = never)
+    void (*restore_clocks)(void);       ///< Restores the full-speed clock tree (e.g., SystemClock_Config)
+    void (*clocks_changed)(void);       ///< Optional: re-initialise clock-dependent peripherals (UART baud etc.)
+    uint8_t (*busy)(void);              ///< Optional: returns 1 while low-power run must wait (flash writes)
+    uint8_t setup_done;                 ///< Internal flag: 1 if initialised, 0 otherwise
+    uint8_t low_power;                  ///< Internal flag: 1 while in low-power run
+    uint32_t last_activity_ms;          ///< Internal: HAL tick of the last reported activity
+} Power_cfg_t;
+
+/**
+ * @struct Power_Stats_t
+ * @brief Duty cycle over the last complete one-second window
+ */
+typedef struct {
+    uint16_t active_permille;   ///< Time awake, in 1/1000 of the window (1000 = never slept)
+    uint32_t active_us;         ///< Time awake in the window (microseconds)
+    uint32_t sleep_us;          ///< Time asleep in the window (microseconds)
+    uint32_t frames;            ///< Frames counted by Power_CountFrame() in the window
+    uint32_t overruns;          ///< Of those, frames that missed their deadline
+} Power_Stats_t;
+
+/**
+ * @brief Initialise idling and duty-cycle measurement
+ */
+void Power_Init(Power_cfg_t* cfg);
+
+/**
+ * @brief Idle hook for an external scheduler: sleep for up to sleep_us
+ *
+ * Enters low-power run if nothing has been reported for idle_timeout_ms.
+ * Returns early if Power_NotifyEvent() is called from an interrupt.
+ */
+void Power_Idle(Power_cfg_t* cfg, uint32_t sleep_us);
+
+/**
+ * @brief Sleep (WFI) until the HAL tick reaches the given value or an event is notified
+ *
+ * @param deadline_ms HAL_GetTick() value to wake up at
+ */
+void Power_SleepUntil(uint32_t deadline_ms);
+
+/**
+ * @brief Wake the main loop early (safe to call from interrupts)
+ */
+void Power_NotifyEvent(void);
+
+/**
+ * @brief Record user activity: resets the idle timer and leaves low-power run
+ */
+void Power_ReportActivity(Power_cfg_t* cfg);
+
+/**
+ * @brief Check if the system is in low-power run mode
+ *
+ * @return 1 in low-power run, 0 at full speed
+ */
+uint8_t Power_IsLowPower(Power_cfg_t* cfg);
+
+/**
+ * @brief Switch to MSI 2 MHz and enable low-power run mode
+ *
+ * Does nothing while the busy() callback returns 1.
+ */
+void Power_EnterLowPowerRun(Power_cfg_t* cfg);
+
+/**
+ * @brief Leave low-power run mode and restore the full-speed clocks
+ */
+void Power_ExitLowPowerRun(Power_cfg_t* cfg);
+
+/**
+ * @brief Microsecond timestamp from the HAL tick and the SysTick counter
+ *
+ * Keeps counting while the core sleeps (unlike the DWT cycle counter).
+ */
+uint32_t Power_TimeUs(void);
+
+/**
+ * @brief Count a completed frame in the current window
+ *
+ * @param overrun 1 if the frame finished after its deadline
+ */
+void Power_CountFrame(uint8_t overrun);
+
+/**
+ * @brief Get the duty cycle of the last complete one-second window
+ *
+ * @return 1 if a new window has completed since the last call, 0 otherwise
+ */
+uint8_t Power_GetStats(Power_Stats_t* stats);
+
+#endif // POWER_H
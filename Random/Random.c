@@ -0,0 +1,154 @@
+#include "Random.h"
+
+/**
+ * @file Random.c
+ * @brief Implementation of the entropy pool and the xoshiro128** generator
+ */
+
+#define RANDOM_ENTROPY_TIMEOUT_MS 2
+
+// ===== Generator =====
+
+static inline uint32_t rotl(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+// SplitMix32 step, used to spread one seed word over the whole state
+static uint32_t splitmix32(uint32_t* x)
+{
+    uint32_t z = (*x += 0x9E3779B9u);
+    z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+    return z ^ (z >> 16);
+}
+
+void Random_Seed(Random_t* rng, uint32_t seed)
+{
+    for (uint8_t i = 0; i < 4; i++) {
+        rng->s[i] = splitmix32(&seed);
+    }
+    // All-zero is the one state xoshiro never leaves
+    if ((rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3]) == 0) {
+        rng->s[0] = 1;
+    }
+}
+
+uint32_t Random_Next(Random_t* rng)
+{
+    uint32_t* s = rng->s;
+    uint32_t result = rotl(s[1] * 5u, 7) * 9u;
+    uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+    return result;
+}
+
+uint32_t Random_NextCtx(void* context)
+{
+    return Random_Next((Random_t*)context);
+}
+
+uint32_t Random_Below(Random_t* rng, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)Random_Next(rng) * n) >> 32);
+}
+
+// ===== Entropy pool =====
+
+void Random_Init(Random_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    // Cycle counter: fallback entropy when the RNG is not clocked
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    cfg->head = cfg->tail = 0;
+    cfg->errors = 0;
+    cfg->timeouts = 0;
+
+    HAL_NVIC_SetPriority(cfg->irqn, 15, 0);
+    HAL_NVIC_EnableIRQ(cfg->irqn);
+    cfg->rng->CR |= RNG_CR_IE | RNG_CR_RNGEN;
+    cfg->setup_done = 1;
+}
+
+void Random_IRQHandler(Random_cfg_t* cfg)
+{
+    uint32_t sr = cfg->rng->SR;
+
+    if (sr & (RNG_SR_SEIS | RNG_SR_CEIS)) {
+        // Seed error: restart the generator. Clock error: it recovers by
+        // itself once the clock is back. Either way the word is discarded.
+        cfg->rng->SR = ~(sr & (RNG_SR_SEIS | RNG_SR_CEIS));
+        if (sr & RNG_SR_SEIS) {
+            cfg->rng->CR &= ~RNG_CR_RNGEN;
+            cfg->rng->CR |= RNG_CR_RNGEN;
+        }
+        cfg->errors++;
+        return;
+    }
+
+    if (sr & RNG_SR_DRDY) {
+        uint32_t word = cfg->rng->DR;
+        uint8_t next = (cfg->head + 1) & (RANDOM_POOL_WORDS - 1);
+
+        if (next != cfg->tail) {
+            cfg->pool[cfg->head] = word;
+            cfg->head = next;
+            next = (next + 1) & (RANDOM_POOL_WORDS - 1);
+        }
+        if (next == cfg->tail) {
+            // Full: stop the peripheral (and its current) until a word is taken
+            cfg->rng->CR &= ~(RNG_CR_IE | RNG_CR_RNGEN);
+        }
+    }
+}
+
+uint8_t Random_TakeEntropy(Random_cfg_t* cfg, uint32_t* word)
+{
+    uint8_t tail = cfg->tail;
+
+    if (tail == cfg->head) {
+        return 0;
+    }
+    *word = cfg->pool[tail];
+    cfg->tail = (tail + 1) & (RANDOM_POOL_WORDS - 1);
+
+    // Room again: restart the peripheral (harmless if still running)
+    cfg->rng->CR |= RNG_CR_IE | RNG_CR_RNGEN;
+    return 1;
+}
+
+uint32_t Random_Entropy(Random_cfg_t* cfg)
+{
+    uint32_t word;
+    uint32_t start = HAL_GetTick();
+
+    while (!Random_TakeEntropy(cfg, &word)) {
+        if (HAL_GetTick() - start > RANDOM_ENTROPY_TIMEOUT_MS) {
+            cfg->timeouts++;
+            uint32_t cycles = DWT->CYCCNT;
+            return splitmix32(&cycles);
+        }
+    }
+    return word;
+}
+
+void Random_SeedFromPool(Random_cfg_t* cfg, Random_t* rng)
+{
+    for (uint8_t i = 0; i < 4; i++) {
+        rng->s[i] = Random_Entropy(cfg);
+    }
+    if ((rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3]) == 0) {
+        rng->s[0] = 1;
+    }
+}
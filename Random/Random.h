@@ -0,0 +1,136 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+#include "main.h"
+
+/**
+ * @file Random.h
+ * @brief Hardware entropy pool and a fast seedable PRNG
+ *
+ * Two parts with different jobs:
+ *
+ * - The entropy pool (Random_cfg_t) collects true random words from the
+ *   RNG peripheral in its interrupt. It is only for seeding: a handful of
+ *   words at boot or at the start of a game, never per frame. When the pool
+ *   is full the peripheral is switched off until a word is taken.
+ *
+ * - The generator (Random_t) is xoshiro128**: 16 bytes of state, a few
+ *   shifts, rotates and one multiply per 32-bit result. The same seed gives
+ *   the same sequence on every board, so anything that replay, retry or the
+ *   netcode must reproduce draws from a Random_t that lives in the snapshot
+ *   state, never from the pool, rand() or the clock. Random_NextCtx() is
+ *   the same step for callbacks that take a void* context, such as
+ *   LCD_randomiseBuffer().
+ *
+ * Example usage:
+ * @code
+ * Random_cfg_t random_cfg = {
+ *     .rng = RNG,
+ *     .irqn = RNG_IRQn,
+ *     .setup_done = 0
+ * };
+ * Random_t game_rng;
+ *
+ * MX_RNG_Init();                              // RNG clock (HAL)
+ * Random_Init(&random_cfg);                   // start filling the pool
+ *
+ * Random_SeedFromPool(&random_cfg, &game_rng);  // a new game
+ * uint32_t roll = Random_Below(&game_rng, 6);   // 0..5, deterministic from here
+ *
+ * // In stm32l4xx_it.c:
+ * void RNG_IRQHandler(void) { Random_IRQHandler(&random_cfg); }
+ * @endcode
+ */
+
+#define RANDOM_POOL_WORDS 8         // Entropy pool size (power of 2)
+
+/**
+ * @struct Random_t
+ * @brief Generator state (xoshiro128**), plain data so it can be snapshotted
+ */
+typedef struct {
+    uint32_t s[4];
+} Random_t;
+
+/**
+ * @struct Random_cfg_t
+ * @brief Hardware entropy pool configuration and state
+ */
+typedef struct {
+    RNG_TypeDef* rng;               ///< RNG peripheral (clocked by MX_RNG_Init())
+    IRQn_Type irqn;                 ///< RNG interrupt
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+
+    volatile uint32_t pool[RANDOM_POOL_WORDS];  ///< Internal: words from the interrupt
+    volatile uint8_t head;          ///< Internal: next word written (interrupt)
+    volatile uint8_t tail;          ///< Internal: next word taken
+    volatile uint32_t errors;       ///< Seed or clock errors seen (peripheral restarted)
+    uint32_t timeouts;              ///< Random_Entropy() calls that gave up waiting
+} Random_cfg_t;
+
+// ===== Generator =====
+
+/**
+ * @brief Seed the generator from one word (expanded with SplitMix32)
+ *
+ * Any seed, including 0, gives a valid state.
+ */
+void Random_Seed(Random_t* rng, uint32_t seed);
+
+/**
+ * @brief Next 32 random bits
+ */
+uint32_t Random_Next(Random_t* rng);
+
+/**
+ * @brief Uniform value in 0 .. n - 1 (0 if n is 0)
+ *
+ * Multiply-and-shift instead of modulo: no division, and no visible bias
+ * for the small ranges games use.
+ */
+uint32_t Random_Below(Random_t* rng, uint32_t n);
+
+/**
+ * @brief Random_Next() for a callback that takes a void* context
+ *
+ * @param context The Random_t to step
+ */
+uint32_t Random_NextCtx(void* context);
+
+// ===== Entropy pool =====
+
+/**
+ * @brief Start the RNG peripheral and its interrupt filling the pool
+ *
+ * The peripheral clock must already be on (MX_RNG_Init()).
+ */
+void Random_Init(Random_cfg_t* cfg);
+
+/**
+ * @brief RNG interrupt handler: store a word, recover from errors
+ */
+void Random_IRQHandler(Random_cfg_t* cfg);
+
+/**
+ * @brief Take one word from the pool without waiting
+ *
+ * @return 1 if a word was taken, 0 if the pool is empty
+ */
+uint8_t Random_TakeEntropy(Random_cfg_t* cfg, uint32_t* word);
+
+/**
+ * @brief Take one word from the pool, waiting up to 2 ms for the peripheral
+ *
+ * If the RNG has no clock (low-power run) the wait times out and the word
+ * is made from the cycle counter instead, which is still different on
+ * every call but not truly random.
+ */
+uint32_t Random_Entropy(Random_cfg_t* cfg);
+
+/**
+ * @brief Seed a generator from four pool words
+ */
+void Random_SeedFromPool(Random_cfg_t* cfg, Random_t* rng);
+
+#endif // RANDOM_H
@@ -122,6 +122,28 @@ Written by Aeron Jarvis and James Avery
 // ========== Buffer Configuration ==========
 #define BUFFER_LENGTH ST7789V2_HEIGHT*ST7789V2_WIDTH/2  // 4 pixels per byte (2 bits per pixel)
 
+// ========== Surfaces ==========
+
+/* Surface
+*   A 4-bit image in the same layout as the screen buffer: two pixels per byte with the even x in the low
+*   nibble, rows stride bytes apart. The screen buffer is one; others are off-screen images. Every drawing
+*   function draws into the current target surface (the screen unless LCD_Set_Target() chose another), so
+*   a composite element (panel, score box, menu frame) can be drawn once into its own surface with the
+*   usual functions, then stamped onto the screen each frame with LCD_Blit().
+*   dirty has one flag per row, set when the row is drawn to (NULL if not needed; the screen's flags are
+*   the rows LCD_Refresh() sends).*/
+typedef struct {
+    uint16_t width;         // Pixels
+    uint16_t height;
+    uint16_t stride;        // Bytes per row, at least LCD_SURFACE_STRIDE(width)
+    uint8_t* data;          // height * stride bytes
+    uint8_t* dirty;         // height row flags, or NULL
+} LCD_Surface_t;
+
+#define LCD_SURFACE_STRIDE(width) (((width) + 1) / 2)
+#define LCD_SURFACE_BYTES(width, height) (LCD_SURFACE_STRIDE(width) * (height))
+#define LCD_NO_KEY (-1)     // LCD_Blit() transparency key: copy every pixel
+
 // ========== Function Prototypes ==========
 
 /* Palette Selection 
@@ -154,7 +176,7 @@ void LCD_turnOff(ST7789V2_cfg_t* cfg);
 void LCD_turnOn(ST7789V2_cfg_t* cfg);
 
 /* Clear
-*   Clears the screen buffer.*/
+*   Clears the current target (the screen buffer by default).*/
 void LCD_clear();
 
 /* Normal mode
@@ -185,26 +207,35 @@ void LCD_printChar(char const c, const uint16_t x, const uint16_t y, uint8_t col
 * @param x      The x co-ordinate of the pixel (0 to 239)
 * @param y      The y co-ordinate of the pixel (0 to 279)
 * @param colour The colour of the pixel
-* @details This function sets the colour of a pixel in the screen buffer.*/
+* @details This function sets the colour of a pixel in the current target (the screen buffer by default).*/
 void LCD_Set_Pixel(const uint16_t x, const uint16_t y, uint8_t colour);
 
 /* Get a Pixel
-*   This function gets the status of a pixel in the screen buffer.
-*   @param  x - the x co-ordinate of the pixel (0 to 83)
-*   @param  y - the y co-ordinate of the pixel (0 to 47)
-*   @returns - colour of pixel*/
+*   This function gets the colour of a pixel in the current target (the screen buffer by default).
+*   @param  x - the x co-ordinate of the pixel (0 to 239)
+*   @param  y - the y co-ordinate of the pixel (0 to 239)
+*   @returns - colour of pixel, 0 outside the target*/
 uint8_t LCD_Get_Pixel(const uint16_t x, const uint16_t y);
 
+/* Shift Buffer
+*   Moves the whole image in the screen buffer by (dx, dy) pixels, for scrolling: only the strips exposed
+*   at the edges then need drawing. Exposed pixels are cleared to colour 0 (whole exposed rows keep their
+*   old contents). Every row is marked for the next refresh.
+*   @param  dx - pixels to move right (negative = left), any value
+*   @param  dy - pixels to move down (negative = up)*/
+void LCD_Shift_Buffer(const int16_t dx, const int16_t dy);
+
 /* Refresh display
 *   This functions sends the screen buffer to the display.*/
 void LCD_Refresh(ST7789V2_cfg_t* cfg);
 
 /* Randomise buffer
-*   This function fills the buffer with random data.  Can be used to test the display.
+*   This function fills the buffer with random data, 32 bits per call of next().  Can be used to test the display.
 *   A call to refresh() must be made to update the display to reflect the change in pixels.
-*   The seed is not set and so the generated pattern will probably be the same each time.
-*   TODO: Randomise the seed - maybe using the noise on the AnalogIn pins.*/
-void LCD_randomiseBuffer();
+*   The pattern depends only on the generator behind next(): a seeded generator gives a repeatable one.
+*   @param  next - returns 32 random bits
+*   @param  context - passed to next() (e.g. the generator state)*/
+void LCD_randomiseBuffer(uint32_t (*next)(void* context), void* context);
 
 /* Plot Array
 *   This function plots a one-dimensional array in the buffer.
@@ -283,10 +314,32 @@ void LCD_Draw_Sprite_Scaled(const uint16_t x0, const uint16_t y0, const uint16_t
 void LCD_Draw_Sprite_Colour_Scaled(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint8_t colour, const uint8_t scale);
 
 /* Fill Buffer
-*   This function fills the image buffer with the desired colour
+*   This function fills the current target (the screen buffer by default) with the desired colour
 *   @param  colour - Value from 0-15 referring to the colour map colour*/
 void LCD_Fill_Buffer(const uint8_t colour);
 
+/* Set Target
+*   Directs all drawing functions (pixels, lines, shapes, text, sprites, fill, clear and LCD_Blit) to a
+*   surface. LCD_Shift_Buffer(), LCD_randomiseBuffer() and LCD_Refresh() always use the screen buffer.
+*   @param  surface - the surface to draw into, NULL for the screen buffer*/
+void LCD_Set_Target(LCD_Surface_t* surface);
+
+/* Get Target
+*   @returns - the current target surface (the screen buffer's surface if none was set), e.g. to blit
+*              part of the screen into a surface, or to restore the target after drawing elsewhere*/
+LCD_Surface_t* LCD_Get_Target(void);
+
+/* Blit
+*   Copies a rectangle of a surface onto the current target, clipped to both. Whole bytes are copied
+*   directly when source and destination pixels share the same nibble position; otherwise the nibbles are
+*   realigned two pixels at a time. The destination rows are marked for the next refresh.
+*   @param  src - source surface (must not be the current target)
+*   @param  sx, sy - top-left of the rectangle in the source
+*   @param  w, h - size of the rectangle
+*   @param  x, y - where its top-left goes in the target
+*   @param  key - colour 0-15 that is transparent (not copied), or LCD_NO_KEY*/
+void LCD_Blit(const LCD_Surface_t* src, int16_t sx, int16_t sy, int16_t w, int16_t h, int16_t x, int16_t y, int16_t key);
+
 /* Fill Screen
 *   This function directly writes to the LCD filling in a rectangle with a solid colour
 *   x0 must be < x1 and y0 must be < y1, function does no parameter checking
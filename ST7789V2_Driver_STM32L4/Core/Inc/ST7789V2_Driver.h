@@ -100,6 +100,7 @@ typedef struct ST7789V2_cfg_struct {
    SPI_TypeDef *spi;
    GPIO_Pin_t RST, BL, DC, CS, MOSI, SCLK;
    DMA_Channel_t dma;
+   void (*wait_hook)(void); // Optional: run while waiting for a DMA transfer (must not use the LCD)
 } ST7789V2_cfg_t;
 
 void ST7789V2_Init(ST7789V2_cfg_t* cfg);
@@ -120,6 +121,12 @@ void ST7789V2_BL_Off(ST7789V2_cfg_t* cfg);
 
 void ST7789V2_Fill(ST7789V2_cfg_t* cfg, uint16_t* colour, uint32_t len);
 
+// Wait for the current DMA transfer to finish, sleeping (WFI) instead of spinning
+void ST7789V2_Wait_Idle(ST7789V2_cfg_t* cfg);
+
+// Call from the LCD DMA channel IRQ handler (e.g. DMA1_Channel5_IRQHandler)
+void ST7789V2_DMA_IRQHandler(ST7789V2_cfg_t* cfg);
+
 
 void gpio_init(ST7789V2_cfg_t* cfg);
 void spi_init(ST7789V2_cfg_t* cfg);
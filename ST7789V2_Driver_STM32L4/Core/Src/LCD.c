@@ -1,4 +1,5 @@
 #include "LCD.h"
+#include <string.h>
 
 
 // Image buffer storing pixel data, 4 pixels per byte (2 bits per pixel)
@@ -6,6 +7,12 @@ static uint8_t image_buffer[BUFFER_LENGTH];
 // Tracks which rows have changed and need to be refreshed, this speeds up LCD_Refresh by only sending data for those rows
 static uint8_t track_changes[ST7789V2_HEIGHT]; 
 
+// The screen buffer as a surface, and the surface drawing functions write to
+static LCD_Surface_t screen = {
+  ST7789V2_WIDTH, ST7789V2_HEIGHT, ST7789V2_WIDTH / 2, image_buffer, track_changes
+};
+static LCD_Surface_t *target = &screen;
+
 // Define multiple palettes. These must be kept in sync with the LCD_Palette enum
 // and the LCD_Set_Palette function
 // Each palette is an array of 16 RGB565 colour values
@@ -61,13 +68,7 @@ void LCD_turnOn(ST7789V2_cfg_t* cfg) {
 }
 
 void LCD_clear() {
-  // Writes zeroes to frame buffer 32 bits at a time
-  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
-    track_changes[y] = 1;
-  }
-  for (int i = 0; i < BUFFER_LENGTH >> 2; i++) {
-    ((uint32_t*)image_buffer)[i] = 0;
-  }
+  LCD_Fill_Buffer(0);
 }
 
 void LCD_Set_Palette(LCD_Palette palette) {
@@ -145,34 +146,162 @@ void LCD_printChar(char const c, const uint16_t x, const uint16_t y, uint8_t col
 }
 
 void LCD_Set_Pixel(const uint16_t x, const uint16_t y, uint8_t colour) {
-  track_changes[y] = 1;
-  uint16_t index = (ST7789V2_WIDTH*y + x) >> 1;  // Bit shift instead of divide by 2
-  if (x < ST7789V2_WIDTH && y < ST7789V2_HEIGHT) {
+  LCD_Surface_t *s = target;
+  if (x < s->width && y < s->height) {
+    uint8_t *byte = &s->data[y * s->stride + (x >> 1)];  // Bit shift instead of divide by 2
+    if (s->dirty) {
+      s->dirty[y] = 1;
+    }
     if (x&1) {
-      image_buffer[index] = (colour << 4) | (image_buffer[index] & 0x0F);
+      *byte = (colour << 4) | (*byte & 0x0F);
     }
     else {
-      image_buffer[index] = colour | (image_buffer[index] & 0xF0);
+      *byte = colour | (*byte & 0xF0);
     }
   }
 }
 
 uint8_t LCD_Get_Pixel(const uint16_t x, const uint16_t y) {
-  uint16_t pixel = x * y;
-  if (pixel & 0x1) {
-    return (image_buffer[pixel >> 1] & 0xF0) >> 4;
+  const LCD_Surface_t *s = target;
+  if (x >= s->width || y >= s->height) {
+    return 0;
+  }
+  uint8_t byte = s->data[y * s->stride + (x >> 1)];
+  if (x & 0x1) {
+    return (byte & 0xF0) >> 4;
   }
   else {
-    return (image_buffer[pixel >> 1] & 0x0F);
+    return (byte & 0x0F);
   }
 }
 
 void LCD_Fill_Buffer(const uint8_t colour) {
-  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
-    track_changes[y] = 1;
+  LCD_Surface_t *s = target;
+  if (s->dirty) {
+    memset(s->dirty, 1, s->height);
+  }
+  memset(s->data, colour | (colour << 4), (size_t)s->stride * s->height);
+}
+
+void LCD_Set_Target(LCD_Surface_t* surface) {
+  target = surface ? surface : &screen;
+}
+
+LCD_Surface_t* LCD_Get_Target(void) {
+  return target;
+}
+
+// Copy w pixels of one row from source pixel sx to destination pixel dx.
+// Destination bytes are written whole where both their pixels are copied;
+// with an even offset between source and destination those bytes are
+// plain copies, with an odd one each is made from two source nibbles.
+static void blit_row(uint8_t *dst, int16_t dx, const uint8_t *src, int16_t sx, int16_t w, int16_t key) {
+  const int16_t offset = sx - dx;                 // Source pixel = destination pixel + offset
+  const int16_t first = dx >> 1;
+  const int16_t last = (dx + w - 1) >> 1;
+  const int16_t last_full = ((dx + w) & 1) ? last - 1 : last;  // Last byte with both pixels copied
+
+  for (int16_t b = first; b <= last; b++) {
+    uint8_t mask = 0xFF;
+    if (b == first && (dx & 1)) {
+      mask &= 0xF0;
+    }
+    if (b == last && ((dx + w) & 1)) {
+      mask &= 0x0F;
+    }
+
+    if (mask == 0xFF && key < 0 && !(offset & 1)) {
+      // Run of whole bytes in step with the source
+      const int16_t run = last_full - b + 1;
+      memcpy(&dst[b], &src[b + offset / 2], run);
+      b += run - 1;
+      continue;
+    }
+
+    // The two source pixels for this byte, as one byte in destination order
+    const int16_t p = 2 * b + offset;             // Source pixel for the low nibble
+    uint8_t pixels;
+    if (!(offset & 1)) {
+      pixels = src[p >> 1];
+    }
+    else {
+      pixels = 0;
+      if (mask & 0x0F) {
+        pixels |= src[p >> 1] >> 4;               // p is odd: a high nibble
+      }
+      if (mask & 0xF0) {
+        pixels |= src[(p + 1) >> 1] << 4;         // p + 1 is even: a low nibble
+      }
+    }
+
+    if (key >= 0) {
+      if ((pixels & 0x0F) == key) {
+        mask &= 0xF0;
+      }
+      if ((pixels >> 4) == key) {
+        mask &= 0x0F;
+      }
+    }
+    dst[b] = (dst[b] & ~mask) | (pixels & mask);
   }
-  for (int i = 0; i < BUFFER_LENGTH; i++) {
-    image_buffer[i] = colour | (colour << 4);
+}
+
+void LCD_Blit(const LCD_Surface_t* src, int16_t sx, int16_t sy, int16_t w, int16_t h, int16_t x, int16_t y, int16_t key) {
+  LCD_Surface_t *dst = target;
+
+  // Clip to the source, then to the destination
+  if (sx < 0) { x -= sx; w += sx; sx = 0; }
+  if (sy < 0) { y -= sy; h += sy; sy = 0; }
+  if (sx + w > src->width) { w = src->width - sx; }
+  if (sy + h > src->height) { h = src->height - sy; }
+  if (x < 0) { sx -= x; w += x; x = 0; }
+  if (y < 0) { sy -= y; h += y; y = 0; }
+  if (x + w > dst->width) { w = dst->width - x; }
+  if (y + h > dst->height) { h = dst->height - y; }
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+
+  for (int16_t r = 0; r < h; r++) {
+    if (dst->dirty) {
+      dst->dirty[y + r] = 1;
+    }
+    blit_row(&dst->data[(y + r) * dst->stride], x, &src->data[(sy + r) * src->stride], sx, w, key);
+  }
+}
+
+void LCD_Shift_Buffer(const int16_t dx, const int16_t dy) {
+  static uint8_t row[ST7789V2_WIDTH / 2];
+  const int16_t bytes = ST7789V2_WIDTH / 2;
+  const int16_t k = (dx >= 0) ? dx / 2 : -((1 - dx) / 2);  // floor(dx / 2)
+
+  if (dx == 0 && dy == 0) {
+    return;
+  }
+
+  // Walk rows against the direction of the shift so no source row is overwritten before it is read
+  for (int16_t n = 0; n < ST7789V2_HEIGHT; n++) {
+    const int16_t y = (dy > 0) ? (ST7789V2_HEIGHT - 1 - n) : n;
+    const int16_t src_y = y - dy;
+    track_changes[y] = 1;
+    if (src_y < 0 || src_y >= ST7789V2_HEIGHT) {
+      continue;  // exposed row: left for the caller to redraw
+    }
+    memcpy(row, &image_buffer[src_y * bytes], bytes);
+    uint8_t* dst = &image_buffer[y * bytes];
+
+    for (int16_t b = 0; b < bytes; b++) {
+      const int16_t s = b - k;
+      if (dx & 1) {
+        // Odd shift: each byte takes its low pixel from the high nibble of the byte to its left
+        const uint8_t lo = (s - 1 >= 0 && s - 1 < bytes) ? (row[s - 1] >> 4) : 0;
+        const uint8_t hi = (s >= 0 && s < bytes) ? (uint8_t)(row[s] << 4) : 0;
+        dst[b] = lo | hi;
+      }
+      else {
+        dst[b] = (s >= 0 && s < bytes) ? row[s] : 0;
+      }
+    }
   }
 }
 
@@ -193,7 +322,7 @@ void LCD_Refresh(ST7789V2_cfg_t* cfg) {
     // First line buffer
     if (track_changes[2*i]) {
       if (!buf) {
-        while (cfg->spi->SR & SPI_SR_BSY);
+        ST7789V2_Wait_Idle(cfg);
       }
       buf = 0;
       track_changes[2*i] = 0;
@@ -211,7 +340,7 @@ void LCD_Refresh(ST7789V2_cfg_t* cfg) {
     // Second line buffer
     if (track_changes[2*i + 1]) {
       if (buf) {
-        while (cfg->spi->SR & SPI_SR_BSY);
+        ST7789V2_Wait_Idle(cfg);
       }
       buf = 1;
       track_changes[2*i + 1] = 0;
@@ -230,9 +359,11 @@ void LCD_Refresh(ST7789V2_cfg_t* cfg) {
   }
 }
 
-void LCD_randomiseBuffer() {
-  for(int i = 0; i < BUFFER_LENGTH; i++) {
-    image_buffer[i] = (uint8_t)rand();  // Cast truncates to byte, avoiding slow modulo
+void LCD_randomiseBuffer(uint32_t (*next)(void* context), void* context) {
+  memset(track_changes, 1, sizeof(track_changes));
+  for (int i = 0; i < BUFFER_LENGTH; i += 4) {
+    uint32_t word = next(context);
+    memcpy(&image_buffer[i], &word, sizeof(word));  // 32 bits per call, any alignment
   }
 }
 
@@ -407,7 +538,7 @@ uint16_t colour_ = 0x001F;
 
 void LCD_Fill(ST7789V2_cfg_t* cfg, const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1, const uint16_t colour) {
   // Wait for not busy
-  while (cfg->spi->SR & SPI_SR_BSY);
+  ST7789V2_Wait_Idle(cfg);
 
   // Set address window
   ST7789V2_Set_Address_Window(cfg, x0, y0, x1, y1);
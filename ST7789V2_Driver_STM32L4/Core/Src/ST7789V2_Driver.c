@@ -7,6 +7,13 @@ void delay_ms_approx(uint16_t ms) {
   }
 }
 
+// Clear only this channel's DMA flags so other channels on the same controller
+// (e.g. the PWM effects engine on DMA1 Channel 7) don't lose their interrupts
+static void dma_clear_flags(ST7789V2_cfg_t* cfg) {
+  uint32_t idx = ((uint32_t)cfg->dma.channel - (uint32_t)cfg->dma.instance - 0x08) / 0x14;
+  cfg->dma.instance->IFCR = DMA_IFCR_CGIF1 << (4 * idx);
+}
+
 void gpio_write(GPIO_Pin_t gpio, uint8_t val) {
   gpio.port->BSRR = gpio.pin << (val ? GPIO_SET_LSB : GPIO_RESET_LSB);
 }
@@ -94,9 +101,7 @@ void ST7789V2_Send_Data_Block(ST7789V2_cfg_t* cfg, uint8_t* data, uint32_t lengt
     gpio_write(cfg->DC, 1);
 
     // Wait for any previous transmissions to finish
-    while(cfg->spi->SR & SPI_SR_BSY) {
-      ;
-    }
+    ST7789V2_Wait_Idle(cfg);
 
     // Send data
     spi_transmit_dma_8bit(cfg, data, length);
@@ -104,7 +109,7 @@ void ST7789V2_Send_Data_Block(ST7789V2_cfg_t* cfg, uint8_t* data, uint32_t lengt
 }
 
 void ST7789V2_Set_Address_Window(ST7789V2_cfg_t* cfg, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
-  while (cfg->spi->SR & SPI_SR_BSY);
+  ST7789V2_Wait_Idle(cfg);
   ST7789V2_Send_Command(cfg, ST7789_CASET);
   ST7789V2_Send_Data(cfg, x0 >> 8);
   ST7789V2_Send_Data(cfg, x0 & 0xFF);
@@ -132,7 +137,7 @@ void ST7789V2_Fill(ST7789V2_cfg_t* cfg, uint16_t* colour, uint32_t len) {
   ST7789V2_Send_Command(cfg, ST7789_RAMWR);
   if (len & 0xFFFF0000) {
     spi_transmit_dma_16bit_noinc(cfg, colour, 65535);
-    while (cfg->spi->SR & SPI_SR_BSY);
+    ST7789V2_Wait_Idle(cfg);
     spi_transmit_dma_16bit_noinc(cfg, colour, len - 65535);
   }
   else {
@@ -140,6 +145,32 @@ void ST7789V2_Fill(ST7789V2_cfg_t* cfg, uint16_t* colour, uint32_t len) {
   }
 }
 
+void ST7789V2_Wait_Idle(ST7789V2_cfg_t* cfg) {
+  // Let other work (e.g. a scheduler yield) use the time the DMA needs
+  if (cfg->wait_hook && (cfg->dma.channel->CCR & DMA_CCR_EN) && cfg->dma.channel->CNDTR) {
+    cfg->wait_hook();
+  }
+
+  // Sleep while the DMA still has data to hand to the SPI. The transfer complete
+  // interrupt wakes the core; interrupts are masked around the check so one that
+  // fires in between stays pending and WFI returns straight away
+  while ((cfg->dma.channel->CCR & DMA_CCR_EN) && cfg->dma.channel->CNDTR) {
+    __disable_irq();
+    if ((cfg->dma.channel->CCR & DMA_CCR_EN) && cfg->dma.channel->CNDTR) {
+      __WFI();
+    }
+    __enable_irq();
+  }
+
+  // Last few bytes are still shifting out of the SPI FIFO
+  while (cfg->spi->SR & SPI_SR_BSY);
+}
+
+void ST7789V2_DMA_IRQHandler(ST7789V2_cfg_t* cfg) {
+  // Only needed to wake ST7789V2_Wait_Idle()
+  dma_clear_flags(cfg);
+}
+
 void gpio_init(ST7789V2_cfg_t* cfg) {
   RCC->AHB2ENR |= RCC_AHB2ENR_GPIOBEN; // GPIOB for SPI2 pins
 
@@ -186,16 +217,25 @@ void dma_init(ST7789V2_cfg_t* cfg) {
                           DMA_CCR_MINC |
                           DMA_CCR_DIR;
 
-  // Set DMA CSELR
+  // Set DMA CSELR and pick the channel interrupt (transfer complete wakes ST7789V2_Wait_Idle)
+  IRQn_Type irq;
   if (cfg->dma.channel == DMA1_Channel3) {
     DMA1_CSELR->CSELR |= 0x1 << DMA_CSELR_C3S_Pos;
+    irq = DMA1_Channel3_IRQn;
   }
   else if (cfg->dma.channel == DMA1_Channel5) {
     DMA1_CSELR->CSELR |= 0x1 << DMA_CSELR_C5S_Pos;
+    irq = DMA1_Channel5_IRQn;
   }
   else if (cfg->dma.channel == DMA2_Channel2) {
     DMA2_CSELR->CSELR |= 0x3 << DMA_CSELR_C2S_Pos;
+    irq = DMA2_Channel2_IRQn;
   }
+  else {
+    return;
+  }
+  NVIC_SetPriority(irq, 14);
+  NVIC_EnableIRQ(irq);
 }
 
 void spi_transmit_byte(ST7789V2_cfg_t* cfg, uint8_t data) {
@@ -238,8 +278,7 @@ void spi_transmit_dma_8bit(ST7789V2_cfg_t* cfg, uint8_t* data, uint16_t len) {
   gpio_write(cfg->DC, 1);
 
   // Clear interrupts
-  uint32_t isr = DMA1->ISR;
-  DMA1->IFCR = isr;
+  dma_clear_flags(cfg);
 
   SPI_TypeDef* spi_inst = cfg->spi;
 
@@ -265,7 +304,8 @@ void spi_transmit_dma_8bit(ST7789V2_cfg_t* cfg, uint8_t* data, uint16_t len) {
   cfg->dma.channel->CCR = DMA_CCR_PL_0 |
                           DMA_CCR_PL_1 |
                           DMA_CCR_MINC |
-                          DMA_CCR_DIR;
+                          DMA_CCR_DIR  |
+                          DMA_CCR_TCIE;
   
   // Enable SPI
   spi_inst->CR1 |= SPI_CR1_SPE;
@@ -285,8 +325,7 @@ void spi_transmit_dma_16bit(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len) {
   gpio_write(cfg->DC, 1);
 
   // Clear interrupts
-  uint32_t isr = DMA1->ISR;
-  DMA1->IFCR = isr;
+  dma_clear_flags(cfg);
 
   SPI_TypeDef* spi_inst = cfg->spi;
 
@@ -314,7 +353,8 @@ void spi_transmit_dma_16bit(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len) {
                           DMA_CCR_MSIZE_0 |
                           DMA_CCR_PSIZE_0 |
                           DMA_CCR_MINC    |
-                          DMA_CCR_DIR;
+                          DMA_CCR_DIR     |
+                          DMA_CCR_TCIE;
   
   // Enable SPI
   spi_inst->CR1 |= SPI_CR1_SPE;
@@ -334,8 +374,7 @@ void spi_transmit_dma_16bit_noinc(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t
   gpio_write(cfg->DC, 1);
 
   // Clear interrupts
-  uint32_t isr = DMA1->ISR;
-  DMA1->IFCR = isr;
+  dma_clear_flags(cfg);
 
   SPI_TypeDef* spi_inst = cfg->spi;
 
@@ -362,7 +401,8 @@ void spi_transmit_dma_16bit_noinc(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t
                           DMA_CCR_PL_1    |
                           DMA_CCR_MSIZE_0 |
                           DMA_CCR_PSIZE_0 |
-                          DMA_CCR_DIR;
+                          DMA_CCR_DIR     |
+                          DMA_CCR_TCIE;
   
   // Enable SPI
   spi_inst->CR1 |= SPI_CR1_SPE;
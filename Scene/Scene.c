@@ -0,0 +1,130 @@
+#include "Scene.h"
+#include "main.h"
+#include "Trace.h"
+
+/**
+ * @file Scene.c
+ * @brief Implementation of the scene manager
+ */
+
+static void enter_scene(SceneManager_t* mgr, uint8_t id)
+{
+    TRACE_FSM(mgr->trace_id, mgr->current, id, 0);
+    mgr->previous = mgr->current;
+    mgr->current = id;
+    mgr->entered_ms = HAL_GetTick();
+    mgr->dirty = 1;
+
+    if (mgr->scenes[id].enter) {
+        mgr->scenes[id].enter();
+    }
+}
+
+void Scene_Init(SceneManager_t* mgr, uint8_t first)
+{
+    if (mgr->setup_done || first >= mgr->count) {
+        return;
+    }
+
+    mgr->has_pending = 0;
+    mgr->current = first;
+    mgr->setup_done = 1;
+    enter_scene(mgr, first);
+}
+
+void Scene_Request(SceneManager_t* mgr, uint8_t next)
+{
+    if (next >= mgr->count) {
+        return;
+    }
+
+    // The id and the flag change together, even if an interrupt requests too
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    mgr->pending = next;
+    mgr->has_pending = 1;
+    __set_PRIMASK(primask);
+}
+
+// Take (read and clear) the pending request; 1 if there was one. Masked, so
+// a request from an interrupt between the read and the clear is not lost.
+static uint8_t take_pending(SceneManager_t* mgr, uint8_t* next)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint8_t has_pending = mgr->has_pending;
+    *next = mgr->pending;
+    mgr->has_pending = 0;
+    __set_PRIMASK(primask);
+    return has_pending;
+}
+
+uint8_t Scene_Update(SceneManager_t* mgr)
+{
+    uint8_t changed = 0;
+
+    if (!mgr->setup_done) {
+        return 0;
+    }
+
+    // Apply transitions first (an enter callback may request another one)
+    uint8_t next;
+    while (take_pending(mgr, &next)) {
+        if (mgr->scenes[mgr->current].exit) {
+            mgr->scenes[mgr->current].exit();
+        }
+        enter_scene(mgr, next);
+        changed = 1;
+    }
+
+    if (mgr->scenes[mgr->current].update) {
+        mgr->scenes[mgr->current].update();
+    }
+    return changed;
+}
+
+uint8_t Scene_Render(SceneManager_t* mgr)
+{
+    const Scene_t* scene;
+
+    if (!mgr->setup_done) {
+        return 0;
+    }
+
+    scene = &mgr->scenes[mgr->current];
+    if (scene->is_static && !mgr->dirty) {
+        return 0;
+    }
+
+    mgr->dirty = 0;
+    if (scene->render) {
+        scene->render();
+    }
+    return 1;
+}
+
+void Scene_Invalidate(SceneManager_t* mgr)
+{
+    mgr->dirty = 1;
+}
+
+uint8_t Scene_Current(SceneManager_t* mgr)
+{
+    return mgr->current;
+}
+
+uint8_t Scene_Previous(SceneManager_t* mgr)
+{
+    return mgr->previous;
+}
+
+uint32_t Scene_TimeInScene(SceneManager_t* mgr)
+{
+    return HAL_GetTick() - mgr->entered_ms;
+}
+
+const char* Scene_Name(SceneManager_t* mgr)
+{
+    const char* name = mgr->scenes[mgr->current].name;
+    return name ? name : "???";
+}
@@ -0,0 +1,128 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <stdint.h>
+
+/**
+ * @file Scene.h
+ * @brief Outer game-flow FSM: a scene manager with per-scene enter/exit
+ *
+ * Each scene (boot, menu, play, pause, game over...) is a set of callbacks.
+ * The manager runs the current scene's update every frame and calls its
+ * render only when needed:
+ *
+ * - Static scenes (menus, splash screens) render once on enter and again
+ *   only after Scene_Invalidate(). In between they cost only their update,
+ *   which still runs every frame (it is what polls for input); the core
+ *   sleeps for the rest of the frame.
+ * - Dynamic scenes (gameplay) render every frame; their render callback
+ *   decides itself whether anything changed.
+ *
+ * Transitions requested with Scene_Request() are applied at the start of
+ * the next Scene_Update(): old scene exit, new scene enter. It is safe to
+ * request a transition from inside any callback or from an interrupt.
+ *
+ * Example usage:
+ * @code
+ * enum { SCENE_MENU, SCENE_PLAY, SCENE_COUNT };
+ *
+ * const Scene_t scenes[SCENE_COUNT] = {
+ *     [SCENE_MENU] = {"MENU", menu_enter, NULL, menu_update, menu_render, 1},
+ *     [SCENE_PLAY] = {"PLAY", play_enter, NULL, play_update, play_render, 0},
+ * };
+ *
+ * SceneManager_t scene_mgr = {.scenes = scenes, .count = SCENE_COUNT, .setup_done = 0};
+ *
+ * Scene_Init(&scene_mgr, SCENE_MENU);
+ * while (1) {
+ *     Scene_Update(&scene_mgr);
+ *     Scene_Render(&scene_mgr);
+ *     wait_for_next_frame();
+ * }
+ * @endcode
+ */
+
+/**
+ * @struct Scene_t
+ * @brief Callbacks for one scene (any callback may be NULL)
+ */
+typedef struct {
+    const char* name;           ///< Scene name for debug output
+    void (*enter)(void);        ///< Called once when the scene becomes active
+    void (*exit)(void);         ///< Called once when the scene is left
+    void (*update)(void);       ///< Called every frame (input, logic)
+    void (*render)(void);       ///< Draws the scene and refreshes the LCD
+    uint8_t is_static;          ///< 1 = render only on enter/invalidate, 0 = render every frame
+} Scene_t;
+
+/**
+ * @struct SceneManager_t
+ * @brief Scene table and manager state
+ */
+typedef struct {
+    const Scene_t* scenes;          ///< Scene table, indexed by scene id
+    uint8_t count;                  ///< Number of scenes in the table
+    uint8_t trace_id;               ///< Entity id in the FSM trace (FSM_TRACE builds)
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+    uint8_t current;                ///< Internal: active scene id
+    uint8_t previous;               ///< Internal: scene that was active before the current one
+    volatile uint8_t pending;       ///< Internal: requested scene id
+    volatile uint8_t has_pending;   ///< Internal flag: 1 if a transition is requested
+    volatile uint8_t dirty;         ///< Internal flag: 1 if the scene needs rendering
+    uint32_t entered_ms;            ///< Internal: HAL tick when the current scene was entered
+} SceneManager_t;
+
+/**
+ * @brief Initialise the manager and enter the first scene
+ */
+void Scene_Init(SceneManager_t* mgr, uint8_t first);
+
+/**
+ * @brief Request a transition, applied at the start of the next Scene_Update()
+ *
+ * A later request before then replaces an earlier one.
+ */
+void Scene_Request(SceneManager_t* mgr, uint8_t next);
+
+/**
+ * @brief Apply any pending transition, then run the current scene's update
+ *
+ * @return 1 if the scene changed during this call, 0 otherwise
+ */
+uint8_t Scene_Update(SceneManager_t* mgr);
+
+/**
+ * @brief Render the current scene if it needs it
+ *
+ * @return 1 if the render callback was called, 0 if the scene was skipped
+ */
+uint8_t Scene_Render(SceneManager_t* mgr);
+
+/**
+ * @brief Mark the current scene for rendering (e.g., after a static scene's content changed)
+ */
+void Scene_Invalidate(SceneManager_t* mgr);
+
+/**
+ * @brief Get the active scene id
+ */
+uint8_t Scene_Current(SceneManager_t* mgr);
+
+/**
+ * @brief Get the scene that was active before the current one
+ */
+uint8_t Scene_Previous(SceneManager_t* mgr);
+
+/**
+ * @brief Time spent in the current scene
+ *
+ * @return Milliseconds since the current scene was entered
+ */
+uint32_t Scene_TimeInScene(SceneManager_t* mgr);
+
+/**
+ * @brief Get the active scene's name
+ */
+const char* Scene_Name(SceneManager_t* mgr);
+
+#endif // SCENE_H
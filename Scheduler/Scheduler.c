@@ -0,0 +1,200 @@
+#include "Scheduler.h"
+
+/**
+ * @file Scheduler.c
+ * @brief Implementation of the cooperative scheduler
+ */
+
+static inline uint32_t task_deadline_us(const Sched_Task_t* task)
+{
+    uint32_t deadline_ms = task->deadline_ms ? task->deadline_ms : task->period_ms;
+    return task->release_us + deadline_ms * 1000u;
+}
+
+// Most urgent due task, only considering priorities in [0, max_priority] and more urgent than 'above'
+static uint8_t pick_task(Sched_cfg_t* cfg, uint32_t now, uint8_t max_priority, uint8_t above)
+{
+    uint8_t best = SCHED_NO_TASK;
+
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        Sched_Task_t* task = &cfg->tasks[i];
+
+        if (task->running || task->priority > max_priority || task->priority >= above) {
+            continue;
+        }
+        if (!task->triggered && (int32_t)(now - task->release_us) < 0) {
+            continue;
+        }
+
+        if (best == SCHED_NO_TASK ||
+            task->priority < cfg->tasks[best].priority ||
+            (task->priority == cfg->tasks[best].priority &&
+             (int32_t)(task_deadline_us(task) - task_deadline_us(&cfg->tasks[best])) < 0)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static void run_task(Sched_cfg_t* cfg, uint8_t index)
+{
+    Sched_Task_t* task = &cfg->tasks[index];
+    uint8_t outer = cfg->current;
+
+    // Hooks only around top-level runs (tasks run from a yield are part of
+    // the outer task), and outside the timed part
+    if (cfg->depth == 0 && cfg->task_begin) {
+        cfg->task_begin(index);
+    }
+
+    uint32_t start = cfg->time_us();
+    if (task->triggered) {
+        // Early release: deadline counts from the trigger
+        task->triggered = 0;
+        task->release_us = start;
+    }
+
+    task->running = 1;
+    cfg->current = index;
+    cfg->depth++;
+    task->run();
+    cfg->depth--;
+    cfg->current = outer;
+    task->running = 0;
+
+    uint32_t end = cfg->time_us();
+    uint32_t run_us = end - start;
+    uint32_t response_us = end - task->release_us;
+    uint8_t missed = (int32_t)(end - task_deadline_us(task)) > 0;
+
+    task->runs++;
+    if (run_us > task->max_run_us) {
+        task->max_run_us = run_us;
+    }
+    if (response_us > task->max_response_us) {
+        task->max_response_us = response_us;
+    }
+    if (missed) {
+        task->misses++;
+        cfg->misses++;
+    }
+    if (cfg->depth == 0 && cfg->task_end) {
+        cfg->task_end(index, missed);
+    }
+
+    // Nested runs are already part of the outer task's time
+    if (cfg->depth == 0) {
+        cfg->busy_us += run_us;
+    }
+
+    // Next release; drop whole periods we are already past
+    uint32_t period_us = task->period_ms * 1000u;
+    task->release_us += period_us;
+    while ((int32_t)(end - task->release_us) >= (int32_t)period_us) {
+        task->release_us += period_us;
+        task->skipped++;
+    }
+}
+
+void Sched_Init(Sched_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    uint32_t now = cfg->time_us();
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        cfg->tasks[i].release_us = now;
+        cfg->tasks[i].triggered = 0;
+        cfg->tasks[i].running = 0;
+    }
+    Sched_ResetStats(cfg);
+
+    cfg->current = SCHED_NO_TASK;
+    cfg->depth = 0;
+    cfg->busy_us = 0;
+    cfg->misses = 0;
+    cfg->setup_done = 1;
+}
+
+void Sched_RunOnce(Sched_cfg_t* cfg)
+{
+    uint32_t now = cfg->time_us();
+    uint8_t next = pick_task(cfg, now, 0xFF, 0xFF);
+
+    if (next != SCHED_NO_TASK) {
+        run_task(cfg, next);
+        return;
+    }
+
+    if (!cfg->idle) {
+        return;
+    }
+
+    // Sleep until the earliest release
+    uint32_t sleep_us = 0xFFFFFFFFu;
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        uint32_t until = cfg->tasks[i].release_us - now;
+        if ((int32_t)until <= 0 || cfg->tasks[i].triggered) {
+            return;
+        }
+        if (until < sleep_us) {
+            sleep_us = until;
+        }
+    }
+    cfg->idle(sleep_us);
+}
+
+void Sched_Yield(Sched_cfg_t* cfg, uint8_t max_priority)
+{
+    if (!cfg->setup_done) {
+        return;
+    }
+
+    uint8_t above = (cfg->current == SCHED_NO_TASK) ? 0xFF : cfg->tasks[cfg->current].priority;
+    uint8_t next;
+
+    while ((next = pick_task(cfg, cfg->time_us(), max_priority, above)) != SCHED_NO_TASK) {
+        run_task(cfg, next);
+    }
+}
+
+void Sched_Trigger(Sched_cfg_t* cfg, uint8_t task)
+{
+    if (task < cfg->count) {
+        cfg->tasks[task].triggered = 1;
+    }
+}
+
+void Sched_SetPeriod(Sched_cfg_t* cfg, uint8_t task, uint16_t period_ms, uint16_t deadline_ms)
+{
+    if (task < cfg->count) {
+        cfg->tasks[task].period_ms = period_ms;
+        cfg->tasks[task].deadline_ms = deadline_ms;
+    }
+}
+
+uint32_t Sched_TakeBusyUs(Sched_cfg_t* cfg)
+{
+    uint32_t busy = cfg->busy_us;
+    cfg->busy_us = 0;
+    return busy;
+}
+
+uint32_t Sched_TakeMisses(Sched_cfg_t* cfg)
+{
+    uint32_t misses = cfg->misses;
+    cfg->misses = 0;
+    return misses;
+}
+
+void Sched_ResetStats(Sched_cfg_t* cfg)
+{
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        cfg->tasks[i].runs = 0;
+        cfg->tasks[i].misses = 0;
+        cfg->tasks[i].skipped = 0;
+        cfg->tasks[i].max_run_us = 0;
+        cfg->tasks[i].max_response_us = 0;
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/**
+ * @file Scheduler.h
+ * @brief Run-to-completion cooperative scheduler with periods, deadlines and priorities
+ *
+ * Each task is a function that does one short piece of work and returns. The
+ * scheduler releases every task once per period. When several are due, it
+ * runs the most urgent (lowest priority number first, then earliest deadline).
+ * When nothing is due it calls the idle hook with the time until the next
+ * release, so the core can sleep (WFI).
+ *
+ * A task that finishes later than release + deadline counts as a deadline
+ * miss. A task that falls more than a whole period behind skips the missed
+ * releases instead of running back-to-back to catch up.
+ *
+ * Long tasks can call Sched_Yield() at a safe point (e.g., while waiting for
+ * a DMA transfer) to run more urgent tasks that became due meanwhile.
+ *
+ * Example usage:
+ * @code
+ * Sched_Task_t tasks[] = {
+ *     //  name     function      period deadline priority
+ *     {"input",  input_task,   10,    5,       0},
+ *     {"render", render_task,  30,    30,      3},
+ * };
+ *
+ * Sched_cfg_t sched = {
+ *     .tasks = tasks,
+ *     .count = 2,
+ *     .time_us = Power_TimeUs,
+ *     .idle = sleep_for_us,
+ *     .setup_done = 0
+ * };
+ *
+ * Sched_Init(&sched);
+ * while (1) {
+ *     Sched_RunOnce(&sched);
+ * }
+ * @endcode
+ */
+
+#define SCHED_NO_TASK 0xFF
+
+/**
+ * @struct Sched_Task_t
+ * @brief One periodic task and its statistics
+ */
+typedef struct {
+    const char* name;               ///< Task name for reports
+    void (*run)(void);              ///< Task body, must return (run to completion)
+    uint16_t period_ms;             ///< Release period
+    uint16_t deadline_ms;           ///< Completion deadline after release (0 = period)
+    uint8_t priority;               ///< 0 = most urgent
+    volatile uint8_t triggered;     ///< Internal flag: released early by Sched_Trigger()
+    uint8_t running;                ///< Internal flag: 1 while the task (or a yield inside it) runs
+    uint32_t release_us;            ///< Internal: time of the current release
+    uint32_t runs;                  ///< Completed runs
+    uint32_t misses;                ///< Runs that finished after their deadline
+    uint32_t skipped;               ///< Releases dropped because the task fell a period behind
+    uint32_t max_run_us;            ///< Longest execution time (includes tasks run from Sched_Yield)
+    uint32_t max_response_us;       ///< Longest time from release to completion
+} Sched_Task_t;
+
+/**
+ * @struct Sched_cfg_t
+ * @brief Scheduler configuration and state
+ */
+typedef struct {
+    Sched_Task_t* tasks;                    ///< Task table
+    uint8_t count;                          ///< Number of tasks
+    uint32_t (*time_us)(void);              ///< Microsecond clock (e.g., Power_TimeUs)
+    void (*idle)(uint32_t sleep_us);        ///< Called when nothing is due (e.g., sleep with WFI)
+    void (*task_begin)(uint8_t task);       ///< Optional: called before a task runs from the main loop (not from a yield)
+    void (*task_end)(uint8_t task, uint8_t missed); ///< Optional: called after it returns, missed = 1 if late (e.g., stack marks)
+    uint8_t setup_done;                     ///< Internal flag: 1 if initialised, 0 otherwise
+    uint8_t current;                        ///< Internal: index of the running task, SCHED_NO_TASK when idle
+    uint8_t depth;                          ///< Internal: nesting depth of Sched_Yield()
+    uint32_t busy_us;                       ///< Internal: task time since the last Sched_TakeBusyUs()
+    uint32_t misses;                        ///< Internal: deadline misses since the last Sched_TakeMisses()
+} Sched_cfg_t;
+
+/**
+ * @brief Initialise the scheduler, all tasks are released immediately
+ */
+void Sched_Init(Sched_cfg_t* cfg);
+
+/**
+ * @brief Run the most urgent due task, or call the idle hook if none is due
+ */
+void Sched_RunOnce(Sched_cfg_t* cfg);
+
+/**
+ * @brief Run due tasks that are more urgent than the current one
+ *
+ * Call from inside a long task at a point where running other tasks is safe.
+ * Only tasks with priority numerically <= max_priority (and more urgent than
+ * the calling task) are run, so callers can keep e.g. game logic from running
+ * in the middle of a render.
+ */
+void Sched_Yield(Sched_cfg_t* cfg, uint8_t max_priority);
+
+/**
+ * @brief Release a task now instead of at its next period (safe from interrupts)
+ */
+void Sched_Trigger(Sched_cfg_t* cfg, uint8_t task);
+
+/**
+ * @brief Change a task's period, the next release keeps its current time
+ */
+void Sched_SetPeriod(Sched_cfg_t* cfg, uint8_t task, uint16_t period_ms, uint16_t deadline_ms);
+
+/**
+ * @brief Total task execution time since the last call (for load measurement)
+ */
+uint32_t Sched_TakeBusyUs(Sched_cfg_t* cfg);
+
+/**
+ * @brief Deadline misses (all tasks) since the last call
+ */
+uint32_t Sched_TakeMisses(Sched_cfg_t* cfg);
+
+/**
+ * @brief Clear the per-task statistics (runs, misses, maxima)
+ */
+void Sched_ResetStats(Sched_cfg_t* cfg);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,224 @@
+#include "Snapshot.h"
+#include <string.h>
+
+/**
+ * @file Snapshot.c
+ * @brief Implementation of region snapshots, checksums and delta encoding
+ */
+
+#define ALIGN4(n) (((n) + 3u) & ~3u)
+
+static void dwt_enable(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Memory-to-memory DMA, waiting for completion. In M2M mode the channel
+// reads from CPAR and writes to CMAR (DIR = 0)
+static void dma_copy(DMA_Channel_TypeDef* ch, void* dst, const void* src, uint16_t size)
+{
+    uint32_t ccr = DMA_CCR_MEM2MEM | DMA_CCR_MINC | DMA_CCR_PINC | DMA_CCR_PL_0;
+    uint16_t count = size;
+
+    if (((uint32_t)dst & 3u) == 0 && ((uint32_t)src & 3u) == 0 && (size & 3u) == 0) {
+        ccr |= DMA_CCR_MSIZE_1 | DMA_CCR_PSIZE_1;   // 32-bit transfers
+        count = size / 4u;
+    }
+
+    ch->CCR = 0;
+    ch->CPAR = (uint32_t)src;
+    ch->CMAR = (uint32_t)dst;
+    ch->CNDTR = count;
+    ch->CCR = ccr | DMA_CCR_EN;
+    while (ch->CNDTR) {
+    }
+    ch->CCR = 0;
+}
+
+static void copy(const Snapshot_cfg_t* cfg, void* dst, const void* src, uint16_t size)
+{
+    if (cfg->dma_channel && size >= SNAPSHOT_DMA_MIN) {
+        dma_copy(cfg->dma_channel, dst, src, size);
+    }
+    else {
+        memcpy(dst, src, size);
+    }
+}
+
+void Snapshot_Init(Snapshot_cfg_t* cfg)
+{
+    uint32_t size = 0;
+
+    if (cfg->setup_done) {
+        return;
+    }
+
+    for (uint8_t r = 0; r < cfg->region_count; r++) {
+        size += ALIGN4(cfg->regions[r].size);
+    }
+    if (size > cfg->slot_size || ((uint32_t)cfg->slots & 3u)) {
+        Error_Handler();    // slots too small for the regions, or misaligned
+    }
+    cfg->state_size = (uint16_t)size;
+
+    if (cfg->dma_channel) {
+        RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN | RCC_AHB1ENR_DMA2EN;
+    }
+    dwt_enable();
+    memset(&cfg->stats, 0, sizeof(cfg->stats));
+    cfg->setup_done = 1;
+}
+
+void Snapshot_Save(Snapshot_cfg_t* cfg, uint8_t slot)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint8_t* p = Snapshot_Slot(cfg, slot);
+
+    for (uint8_t r = 0; r < cfg->region_count; r++) {
+        copy(cfg, p, cfg->regions[r].ptr, cfg->regions[r].size);
+        p += ALIGN4(cfg->regions[r].size);
+    }
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    cfg->stats.saves++;
+    cfg->stats.last_save_cycles = cycles;
+    if (cycles > cfg->stats.max_save_cycles) {
+        cfg->stats.max_save_cycles = cycles;
+    }
+}
+
+void Snapshot_Restore(Snapshot_cfg_t* cfg, uint8_t slot)
+{
+    uint32_t start = DWT->CYCCNT;
+    const uint8_t* p = Snapshot_Slot(cfg, slot);
+
+    for (uint8_t r = 0; r < cfg->region_count; r++) {
+        copy(cfg, cfg->regions[r].ptr, p, cfg->regions[r].size);
+        p += ALIGN4(cfg->regions[r].size);
+    }
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    cfg->stats.restores++;
+    cfg->stats.last_restore_cycles = cycles;
+    if (cycles > cfg->stats.max_restore_cycles) {
+        cfg->stats.max_restore_cycles = cycles;
+    }
+}
+
+uint16_t Snapshot_Size(const Snapshot_cfg_t* cfg)
+{
+    return cfg->state_size;
+}
+
+uint8_t* Snapshot_Slot(const Snapshot_cfg_t* cfg, uint8_t slot)
+{
+    return cfg->slots + (uint32_t)slot * cfg->slot_size;
+}
+
+uint32_t Snapshot_Checksum(const Snapshot_cfg_t* cfg, uint8_t slot)
+{
+    const uint8_t* p = Snapshot_Slot(cfg, slot);
+    uint32_t hash = 2166136261u;
+
+    // Region bytes only: the padding up to the next region is never written,
+    // so it holds whatever the (uninitialised) slot memory held
+    for (uint8_t r = 0; r < cfg->region_count; r++) {
+        for (uint16_t i = 0; i < cfg->regions[r].size; i++) {
+            hash = (hash ^ p[i]) * 16777619u;
+        }
+        p += ALIGN4(cfg->regions[r].size);
+    }
+    return hash;
+}
+
+// ===== DELTA ENCODING =====
+
+uint16_t Snapshot_DeltaEncode(Snapshot_cfg_t* cfg, uint8_t slot, uint8_t base,
+                              uint8_t* out, uint16_t out_size)
+{
+    const uint8_t* cur = Snapshot_Slot(cfg, slot);
+    const uint8_t* ref = Snapshot_Slot(cfg, base);
+    uint16_t size = cfg->state_size;
+    uint16_t i = 0;
+    uint16_t len = 0;
+
+    while (i < size) {
+        // Unchanged bytes before the next change
+        uint16_t skip = 0;
+        while (i + skip < size && cur[i + skip] == ref[i + skip]) {
+            skip++;
+        }
+        if (i + skip == size) {
+            break;      // the rest is unchanged (implied)
+        }
+        while (skip > 255u) {
+            if (len + 2u > out_size) {
+                return 0;
+            }
+            out[len++] = 255;
+            out[len++] = 0;
+            skip -= 255u;
+            i += 255u;
+        }
+        i += skip;
+
+        // Changed bytes; a single unchanged byte between changes is cheaper
+        // to copy than to start a new run for
+        uint16_t count = 0;
+        while (i + count < size && count < 255u &&
+               (cur[i + count] != ref[i + count] ||
+                (i + count + 1u < size && cur[i + count + 1u] != ref[i + count + 1u]))) {
+            count++;
+        }
+        if (len + 2u + count > out_size) {
+            return 0;
+        }
+        out[len++] = (uint8_t)skip;
+        out[len++] = (uint8_t)count;
+        memcpy(&out[len], &cur[i], count);
+        len += count;
+        i += count;
+    }
+
+    cfg->stats.last_delta_bytes = len;
+    return len;
+}
+
+uint8_t Snapshot_DeltaApply(Snapshot_cfg_t* cfg, uint8_t slot, uint8_t base,
+                            const uint8_t* delta, uint16_t len)
+{
+    uint8_t* dst = Snapshot_Slot(cfg, slot);
+    uint16_t size = cfg->state_size;
+    uint16_t i = 0;
+    uint16_t pos = 0;
+
+    if (slot != base) {
+        memcpy(dst, Snapshot_Slot(cfg, base), size);
+    }
+
+    while (pos < len) {
+        if (pos + 2u > len) {
+            return 0;
+        }
+        uint8_t skip = delta[pos++];
+        uint8_t count = delta[pos++];
+        if (i + skip + count > size || pos + count > len) {
+            return 0;
+        }
+        i += skip;
+        memcpy(&dst[i], &delta[pos], count);
+        i += count;
+        pos += count;
+    }
+    return 1;
+}
+
+void Snapshot_GetStats(Snapshot_cfg_t* cfg, Snapshot_Stats_t* stats, uint8_t reset)
+{
+    *stats = cfg->stats;
+    if (reset) {
+        cfg->stats.max_save_cycles = 0;
+        cfg->stats.max_restore_cycles = 0;
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "main.h"
+
+/**
+ * @file Snapshot.h
+ * @brief Fast save and restore of the whole game state
+ *
+ * The game state is registered as a list of memory regions (the character,
+ * the timer wheel, entity pools, the RNG state...). A save copies every
+ * region into a slot, a restore copies them back, so every object returns
+ * to its own address and pointers between objects stay valid. Nothing is
+ * serialised: a save or restore is a few memcpy (or DMA) calls and takes
+ * microseconds, cheap enough for rollback every frame, instant retry, or
+ * capturing the state for debugging.
+ *
+ * Slots are normally placed in SRAM2 (SNAPSHOT_RAM2), which leaves main RAM
+ * for the game. Each region starts on a 4-byte boundary in a slot so copies
+ * run a word at a time.
+ *
+ * Optionally, regions of at least SNAPSHOT_DMA_MIN bytes are copied by a
+ * memory-to-memory DMA channel (the CPU waits for it; whether that beats
+ * memcpy depends on the bus load, so compare the reported timings).
+ *
+ * For keeping a long history (replays) or sending a state elsewhere, a slot
+ * can be delta encoded against another slot: only the bytes that changed
+ * are stored, usually a small fraction of the state between two frames.
+ *
+ * Delta format: runs of [skip][count][count bytes], where skip is the number
+ * of unchanged bytes before the run (0-255) and count the number of changed
+ * bytes that follow (0-255; a run with count 0 only skips). Unchanged bytes
+ * after the last run are implied.
+ *
+ * Example usage:
+ * @code
+ * static const Snapshot_Region_t state[] = {
+ *     {&game_character, sizeof(game_character)},
+ *     {&game_timers, sizeof(game_timers)},
+ * };
+ * static uint8_t slots[2 * 1024] SNAPSHOT_RAM2;
+ *
+ * Snapshot_cfg_t snap = {
+ *     .regions = state, .region_count = 2,
+ *     .slots = slots, .slot_size = 1024, .slot_count = 2,
+ *     .dma_channel = NULL,        // or a free channel, e.g. DMA2_Channel1
+ *     .setup_done = 0
+ * };
+ *
+ * Snapshot_Init(&snap);
+ * Snapshot_Save(&snap, 0);        // checkpoint
+ * ...
+ * Snapshot_Restore(&snap, 0);     // back to the checkpoint
+ * @endcode
+ */
+
+// Place a buffer in SRAM2 (.ram2 section in the linker script, not zeroed at startup)
+#define SNAPSHOT_RAM2 __attribute__((section(".ram2"), aligned(4)))
+
+#define SNAPSHOT_DMA_MIN 64     // Smaller regions are always copied with memcpy
+
+/**
+ * @struct Snapshot_Region_t
+ * @brief A block of game state saved in every snapshot
+ */
+typedef struct {
+    void* ptr;
+    uint16_t size;
+} Snapshot_Region_t;
+
+/**
+ * @struct Snapshot_Stats_t
+ * @brief Size and timing of saves and restores
+ */
+typedef struct {
+    uint32_t saves;                 ///< Snapshots saved
+    uint32_t restores;              ///< Snapshots restored
+    uint32_t last_save_cycles;      ///< CPU cycles of the last save
+    uint32_t max_save_cycles;       ///< Longest save
+    uint32_t last_restore_cycles;   ///< CPU cycles of the last restore
+    uint32_t max_restore_cycles;    ///< Longest restore
+    uint32_t last_delta_bytes;      ///< Size of the last delta encoding
+} Snapshot_Stats_t;
+
+/**
+ * @struct Snapshot_cfg_t
+ * @brief Snapshot configuration and state
+ */
+typedef struct {
+    const Snapshot_Region_t* regions;   ///< Game state to save
+    uint8_t region_count;               ///< Number of regions
+    uint8_t* slots;                     ///< slot_count * slot_size bytes, 4-byte aligned (ideally SNAPSHOT_RAM2)
+    uint16_t slot_size;                 ///< Bytes per slot, at least Snapshot_Size()
+    uint8_t slot_count;                 ///< Number of slots
+    DMA_Channel_TypeDef* dma_channel;   ///< Free DMA channel for memory-to-memory copies, NULL for memcpy only
+    uint8_t setup_done;                 ///< Internal flag: 1 if initialised, 0 otherwise
+
+    uint16_t state_size;                ///< Internal: bytes used in a slot (regions plus alignment)
+    Snapshot_Stats_t stats;             ///< Internal: read with Snapshot_GetStats()
+} Snapshot_cfg_t;
+
+/**
+ * @brief Initialise: lay out the regions and check they fit in a slot
+ *
+ * Calls Error_Handler() if the regions do not fit in slot_size.
+ */
+void Snapshot_Init(Snapshot_cfg_t* cfg);
+
+/**
+ * @brief Copy the current game state into a slot
+ */
+void Snapshot_Save(Snapshot_cfg_t* cfg, uint8_t slot);
+
+/**
+ * @brief Copy a slot back into the game state
+ */
+void Snapshot_Restore(Snapshot_cfg_t* cfg, uint8_t slot);
+
+/**
+ * @brief Bytes of state in a slot (the snapshot size)
+ */
+uint16_t Snapshot_Size(const Snapshot_cfg_t* cfg);
+
+/**
+ * @brief Pointer to a slot's data (Snapshot_Size() bytes)
+ */
+uint8_t* Snapshot_Slot(const Snapshot_cfg_t* cfg, uint8_t slot);
+
+/**
+ * @brief FNV-1a checksum of a slot (compare states, detect desyncs)
+ *
+ * Covers the regions' bytes, not the alignment padding between them.
+ */
+uint32_t Snapshot_Checksum(const Snapshot_cfg_t* cfg, uint8_t slot);
+
+/**
+ * @brief Delta encode a slot against a base slot
+ *
+ * @param out Encoded delta
+ * @param out_size Size of out
+ * @return Bytes written, 0 if the delta does not fit in out_size
+ */
+uint16_t Snapshot_DeltaEncode(Snapshot_cfg_t* cfg, uint8_t slot, uint8_t base,
+                              uint8_t* out, uint16_t out_size);
+
+/**
+ * @brief Rebuild a slot from a base slot and a delta made by Snapshot_DeltaEncode()
+ *
+ * The slot may be the base itself (the delta is applied in place).
+ *
+ * @return 1 on success, 0 if the delta is malformed (the slot is then undefined)
+ */
+uint8_t Snapshot_DeltaApply(Snapshot_cfg_t* cfg, uint8_t slot, uint8_t base,
+                            const uint8_t* delta, uint16_t len);
+
+/**
+ * @brief Get the size and timing counters
+ *
+ * @param reset 1 to clear the maximums after reading
+ */
+void Snapshot_GetStats(Snapshot_cfg_t* cfg, Snapshot_Stats_t* stats, uint8_t reset);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,175 @@
+#include "StackMon.h"
+#include "main.h"
+
+/**
+ * @file StackMon.c
+ * @brief Implementation of stack painting, high-water marks and the MPU guard
+ */
+
+// Painting stops this far below the stack pointer, so the painting
+// function's own frame (and any caller registers it saves) is left alone
+#define STACKMON_MARGIN 64
+
+extern uint32_t _estack;        // Linker script: top of RAM, initial MSP
+extern uint32_t _sstack;        // Linker script: bottom of the stack area (256-byte aligned)
+
+static inline __attribute__((always_inline)) void paint(uint32_t from, uint32_t to)
+{
+    for (uint32_t* p = (uint32_t*)from; p < (uint32_t*)to; p++) {
+        *p = STACKMON_PAINT;
+    }
+}
+
+// Lowest word in [from, to) that is not paint (to if there is none)
+static inline __attribute__((always_inline)) uint32_t scan(uint32_t from, uint32_t to)
+{
+    const uint32_t* p = (const uint32_t*)from;
+
+    while (p < (const uint32_t*)to && *p == STACKMON_PAINT) {
+        p++;
+    }
+    return (uint32_t)p;
+}
+
+static void setup_guard(uint32_t base)
+{
+    MPU_Region_InitTypeDef region = {0};
+
+    HAL_MPU_Disable();
+    region.Enable = MPU_REGION_ENABLE;
+    region.Number = MPU_REGION_NUMBER0;
+    region.BaseAddress = base;
+    region.Size = MPU_REGION_SIZE_256B;
+    region.SubRegionDisable = 0;
+    region.TypeExtField = MPU_TEX_LEVEL0;
+    region.AccessPermission = MPU_REGION_NO_ACCESS;
+    region.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+    region.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+    region.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+    region.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&region);
+
+    // Default memory map everywhere else; also enables the MemManage fault
+    HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+}
+
+void StackMon_Init(StackMon_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    uint32_t sp = __get_MSP();
+
+    cfg->top = (uint32_t)&_estack;
+    cfg->bottom = (uint32_t)&_sstack;
+    if (cfg->guard) {
+        if (cfg->bottom & (STACKMON_GUARD_SIZE - 1)) {
+            Error_Handler();    // the MPU region must be aligned to its size
+        }
+        setup_guard(cfg->bottom);
+        cfg->bottom += STACKMON_GUARD_SIZE;
+    }
+
+    paint(cfg->bottom, (sp - STACKMON_MARGIN) & ~3u);
+
+    cfg->boot_depth = cfg->top - sp;
+    cfg->peak = cfg->boot_depth;
+    cfg->nesting = 0;
+    cfg->max_nesting = 0;
+    cfg->overflowed = 0;
+    for (uint8_t i = 0; i < cfg->task_count; i++) {
+        cfg->tasks[i].max_depth = 0;
+        cfg->tasks[i].saturated = 0;
+    }
+    for (uint8_t i = 0; i < cfg->isr_count; i++) {
+        cfg->isrs[i].max_depth = 0;
+    }
+    cfg->setup_done = 1;
+}
+
+uint32_t StackMon_Peak(StackMon_cfg_t* cfg)
+{
+    uint32_t depth = cfg->top - scan(cfg->bottom, cfg->top);
+
+    // Task windows repaint stack that was used before, so their marks count too
+    if (depth > cfg->peak) {
+        cfg->peak = depth;
+    }
+    return cfg->peak;
+}
+
+uint32_t StackMon_Size(const StackMon_cfg_t* cfg)
+{
+    return cfg->top - cfg->bottom;
+}
+
+void StackMon_TaskBegin(StackMon_cfg_t* cfg, uint8_t task)
+{
+    if (!cfg->setup_done || task >= cfg->task_count) {
+        return;
+    }
+
+    uint32_t to = (__get_MSP() - STACKMON_MARGIN) & ~3u;
+    uint32_t from = to - cfg->task_window;
+
+    if (from < cfg->bottom || from > to) {
+        from = cfg->bottom;
+    }
+    paint(from, to);
+    cfg->tasks[task].window = from;
+}
+
+void StackMon_TaskEnd(StackMon_cfg_t* cfg, uint8_t task)
+{
+    if (!cfg->setup_done || task >= cfg->task_count) {
+        return;
+    }
+
+    StackMon_Entry_t* entry = &cfg->tasks[task];
+    uint32_t low = scan(entry->window, cfg->top);
+    uint32_t depth = cfg->top - low;
+
+    if (low == entry->window) {
+        entry->saturated = 1;   // may have gone below the window
+    }
+    if (depth > entry->max_depth) {
+        entry->max_depth = depth;
+    }
+    if (depth > cfg->peak) {
+        cfg->peak = depth;
+    }
+}
+
+void StackMon_IsrEnter(StackMon_cfg_t* cfg, uint8_t isr)
+{
+    if (!cfg->setup_done) {
+        return;
+    }
+
+    uint32_t depth = cfg->top - __get_MSP();
+    uint8_t nesting = cfg->nesting + 1;
+
+    cfg->nesting = nesting;
+    if (nesting > cfg->max_nesting) {
+        cfg->max_nesting = nesting;
+    }
+    if (isr < cfg->isr_count && depth > cfg->isrs[isr].max_depth) {
+        cfg->isrs[isr].max_depth = depth;
+    }
+}
+
+void StackMon_IsrExit(StackMon_cfg_t* cfg)
+{
+    if (cfg->nesting) {
+        cfg->nesting--;
+    }
+}
+
+void StackMon_GuardFault(StackMon_cfg_t* cfg)
+{
+    cfg->overflowed = 1;
+    Error_Handler();
+    while (1) {
+    }
+}
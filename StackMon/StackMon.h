@@ -0,0 +1,151 @@
+#ifndef STACKMON_H
+#define STACKMON_H
+
+#include <stdint.h>
+
+/**
+ * @file StackMon.h
+ * @brief Stack high-water marks for the main stack, scheduler tasks and interrupts
+ *
+ * Everything (main loop, tasks, interrupts) runs on the one MSP stack, which
+ * grows down from the top of RAM towards the heap and .bss (image_buffer).
+ * The linker only checks that _Min_Stack_Size bytes are free, not what the
+ * code actually uses, so an overflow would silently corrupt globals.
+ *
+ * Measurements (all in bytes below the top of the stack, _estack):
+ * - Peak: StackMon_Init() paints the whole free stack area with a pattern,
+ *   and StackMon_Peak() finds the lowest word that was overwritten. This is
+ *   the worst case so far for everything together.
+ * - Tasks: StackMon_TaskBegin() repaints a window below the current stack
+ *   pointer and StackMon_TaskEnd() scans it, so each task gets its own
+ *   peak (including interrupts that hit while it ran). Hook both into the
+ *   scheduler. A task that used the whole window is reported as saturated.
+ *   This is not free: a 2 KB window is 512 words painted and scanned again,
+ *   about 3000 cycles per task run, which also lands in the run time the
+ *   scheduler measures. At several hundred runs a second that is a few
+ *   percent of the CPU at 80 MHz and most of it at 2 MHz, so the game only
+ *   hooks these in with STACKMON_TASKS (configure with -DSTACKMON_TASKS=ON).
+ * - Interrupts: StackMon_IsrEnter() records how deep the stack already was
+ *   when the handler started (exception frame included) and how many
+ *   handlers were nested. That is where nesting eats the stack: a handler's
+ *   own use shows up in the peak and in the task it interrupted.
+ *
+ * Optionally a 256-byte MPU region with no access sits at the bottom of the
+ * stack area (_sstack, just above the heap), so an overflow faults at once
+ * instead of overwriting the heap and .bss. The guard only catches a
+ * function whose first stack access lands in it: one frame larger than the
+ * guard (a local array of more than about 256 bytes) can step over it, so
+ * keep big buffers static. Every frame in the game is well under 256 bytes.
+ *
+ * Example usage:
+ * @code
+ * enum { ISR_SYSTICK, ISR_UART, ISR_COUNT };
+ * StackMon_Entry_t stack_tasks[TASK_COUNT];
+ * StackMon_Entry_t stack_isrs[ISR_COUNT] = {{"systick"}, {"uart"}};
+ *
+ * StackMon_cfg_t stack_mon = {
+ *     .tasks = stack_tasks, .task_count = TASK_COUNT,
+ *     .isrs = stack_isrs, .isr_count = ISR_COUNT,
+ *     .task_window = 2048,
+ *     .guard = 1,
+ *     .setup_done = 0
+ * };
+ *
+ * StackMon_Init(&stack_mon);                  // first thing in main()
+ *
+ * void UART_IRQHandler(void) {
+ *     StackMon_IsrEnter(&stack_mon, ISR_UART);
+ *     ...
+ *     StackMon_IsrExit(&stack_mon);
+ * }
+ *
+ * printf("Stack peak %lu\n", (unsigned long)StackMon_Peak(&stack_mon));
+ * @endcode
+ */
+
+#define STACKMON_PAINT 0xC5C5C5C5u      // Pattern in unused stack
+#define STACKMON_GUARD_SIZE 256         // MPU guard region: larger than any stack frame
+
+/**
+ * @struct StackMon_Entry_t
+ * @brief High-water mark for one task or interrupt
+ */
+typedef struct {
+    const char* name;               ///< For reports (optional)
+    uint32_t max_depth;             ///< Deepest stack seen, bytes below _estack
+    uint8_t saturated;              ///< Task used its whole window: max_depth is a lower bound
+    uint32_t window;                ///< Internal: bottom of the painted task window
+} StackMon_Entry_t;
+
+/**
+ * @struct StackMon_cfg_t
+ * @brief Stack monitor configuration and state
+ */
+typedef struct {
+    StackMon_Entry_t* tasks;        ///< One entry per scheduler task
+    uint8_t task_count;
+    StackMon_Entry_t* isrs;         ///< One entry per instrumented interrupt
+    uint8_t isr_count;
+    uint16_t task_window;           ///< Bytes repainted below the stack pointer per task run
+    uint8_t guard;                  ///< 1 = MPU no-access region at the bottom of the stack
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+
+    uint32_t top;                   ///< Internal: _estack
+    uint32_t bottom;                ///< Internal: lowest usable stack address (above the guard)
+    uint32_t peak;                  ///< Deepest stack seen by any measurement, bytes
+    uint32_t boot_depth;            ///< Stack in use when StackMon_Init() ran, bytes
+    volatile uint8_t nesting;       ///< Internal: interrupt handlers currently running
+    uint8_t max_nesting;            ///< Most interrupt handlers seen running at once
+    volatile uint8_t overflowed;    ///< 1 once the guard has been hit
+} StackMon_cfg_t;
+
+/**
+ * @brief Paint the free stack area and set up the optional guard
+ *
+ * Call at the very start of main(), before interrupts are enabled.
+ */
+void StackMon_Init(StackMon_cfg_t* cfg);
+
+/**
+ * @brief Deepest stack use so far (all code together), in bytes
+ *
+ * Scans the painted area from the bottom, so the cost is proportional to
+ * the stack that was never used: call it from a slow task (the log task),
+ * not every frame.
+ */
+uint32_t StackMon_Peak(StackMon_cfg_t* cfg);
+
+/**
+ * @brief Size of the stack area (from _sstack to _estack, without the guard)
+ */
+uint32_t StackMon_Size(const StackMon_cfg_t* cfg);
+
+/**
+ * @brief Repaint the task window (scheduler hook, before a task runs)
+ */
+void StackMon_TaskBegin(StackMon_cfg_t* cfg, uint8_t task);
+
+/**
+ * @brief Scan the task window and update the task's mark (scheduler hook)
+ */
+void StackMon_TaskEnd(StackMon_cfg_t* cfg, uint8_t task);
+
+/**
+ * @brief Record the stack depth at the start of an interrupt handler
+ */
+void StackMon_IsrEnter(StackMon_cfg_t* cfg, uint8_t isr);
+
+/**
+ * @brief Leave an interrupt handler (pairs with StackMon_IsrEnter())
+ */
+void StackMon_IsrExit(StackMon_cfg_t* cfg);
+
+/**
+ * @brief The guard was hit: called from MemManage_Handler with the MPU already off
+ *
+ * Sets overflowed (visible in the debugger) and halts in Error_Handler().
+ * Does not return.
+ */
+void StackMon_GuardFault(StackMon_cfg_t* cfg);
+
+#endif // STACKMON_H
@@ -0,0 +1,277 @@
+#include "TileMap.h"
+#include <string.h>
+
+/**
+ * @file TileMap.c
+ * @brief Implementation of the bitset collision map and swept box queries
+ */
+
+#define NO_HIT INT32_MIN
+
+// Pixel to tile. Signed right shift is arithmetic with GCC, so pixels left of
+// or above the map round down to negative tiles (outside, hence solid)
+#define TILE_OF(cfg, px) ((int32_t)(px) >> (cfg)->tile_shift)
+
+// Bits lo..hi of a word (0 <= lo <= hi <= 31)
+static inline uint32_t bit_range(uint32_t lo, uint32_t hi)
+{
+    return (0xFFFFFFFFu << lo) & (0xFFFFFFFFu >> (31u - hi));
+}
+
+// Nonzero if any tile in columns c0..c1 of row r is solid (all inside the map)
+static uint32_t row_hits(const TileMap_cfg_t* cfg, int32_t r, int32_t c0, int32_t c1)
+{
+    const uint32_t* row = &cfg->rows[(uint32_t)r * cfg->words_per_row];
+    uint32_t w0 = (uint32_t)c0 >> 5;
+    uint32_t w1 = (uint32_t)c1 >> 5;
+
+    if (w0 == w1) {
+        return row[w0] & bit_range((uint32_t)c0 & 31u, (uint32_t)c1 & 31u);
+    }
+    if (row[w0] & bit_range((uint32_t)c0 & 31u, 31u)) {
+        return 1;
+    }
+    for (uint32_t w = w0 + 1u; w < w1; w++) {
+        if (row[w]) {
+            return 1;
+        }
+    }
+    return row[w1] & bit_range(0, (uint32_t)c1 & 31u);
+}
+
+// First solid column met going from c0 to c1 (either direction) within rows
+// r0..r1, or NO_HIT. Each step ORs the rows together for 32 columns at once
+// and picks the nearest set bit with CTZ (rightwards) or CLZ (leftwards).
+static int32_t scan_columns(const TileMap_cfg_t* cfg, int32_t r0, int32_t r1, int32_t c0, int32_t c1)
+{
+    int32_t width = cfg->width;
+    int32_t step = (c1 >= c0) ? 1 : -1;
+    int32_t edge = NO_HIT;
+
+    // Rows outside the map block every column; so does entering the outside
+    if (r0 < 0 || r1 >= (int32_t)cfg->height || c0 < 0 || c0 >= width) {
+        return c0;
+    }
+    if (c1 >= width) {
+        c1 = width - 1;
+        edge = width;
+    }
+    else if (c1 < 0) {
+        c1 = 0;
+        edge = -1;
+    }
+
+    int32_t lo = (step > 0) ? c0 : c1;
+    int32_t hi = (step > 0) ? c1 : c0;
+    int32_t w_end = c1 >> 5;
+    uint16_t stride = cfg->words_per_row;
+
+    for (int32_t w = c0 >> 5; ; w += step) {
+        const uint32_t* p = &cfg->rows[(uint32_t)r0 * stride + (uint32_t)w];
+        uint32_t acc = 0;
+        for (int32_t r = r0; r <= r1; r++, p += stride) {
+            acc |= *p;
+        }
+        acc &= bit_range((w == (lo >> 5)) ? ((uint32_t)lo & 31u) : 0,
+                         (w == (hi >> 5)) ? ((uint32_t)hi & 31u) : 31u);
+        if (acc) {
+            return (step > 0) ? w * 32 + (int32_t)__builtin_ctz(acc)
+                              : w * 32 + 31 - (int32_t)__builtin_clz(acc);
+        }
+        if (w == w_end) {
+            return edge;
+        }
+    }
+}
+
+// First solid row met going from r0 to r1 within columns c0..c1, or NO_HIT
+static int32_t scan_rows(const TileMap_cfg_t* cfg, int32_t c0, int32_t c1, int32_t r0, int32_t r1)
+{
+    int32_t height = cfg->height;
+    int32_t step = (r1 >= r0) ? 1 : -1;
+    int32_t edge = NO_HIT;
+
+    if (c0 < 0 || c1 >= (int32_t)cfg->width || r0 < 0 || r0 >= height) {
+        return r0;
+    }
+    if (r1 >= height) {
+        r1 = height - 1;
+        edge = height;
+    }
+    else if (r1 < 0) {
+        r1 = 0;
+        edge = -1;
+    }
+
+    for (int32_t r = r0; ; r += step) {
+        if (row_hits(cfg, r, c0, c1)) {
+            return r;
+        }
+        if (r == r1) {
+            return edge;
+        }
+    }
+}
+
+void TileMap_Init(TileMap_cfg_t* cfg)
+{
+    cfg->words_per_row = (uint16_t)TILEMAP_WORDS_PER_ROW(cfg->width);
+    memset(cfg->rows, 0, TILEMAP_WORDS(cfg->width, cfg->height) * sizeof(uint32_t));
+    cfg->setup_done = 1;
+}
+
+void TileMap_Set(TileMap_cfg_t* cfg, uint16_t tx, uint16_t ty, uint8_t solid)
+{
+    TileMap_FillRect(cfg, tx, ty, 1, 1, solid);
+}
+
+void TileMap_FillRect(TileMap_cfg_t* cfg, uint16_t tx, uint16_t ty,
+                      uint16_t tw, uint16_t th, uint8_t solid)
+{
+    if (tx >= cfg->width || ty >= cfg->height || tw == 0 || th == 0) {
+        return;
+    }
+    uint32_t c1 = (uint32_t)tx + tw - 1u;
+    uint32_t r1 = (uint32_t)ty + th - 1u;
+    if (c1 >= cfg->width) {
+        c1 = cfg->width - 1u;
+    }
+    if (r1 >= cfg->height) {
+        r1 = cfg->height - 1u;
+    }
+
+    for (uint32_t r = ty; r <= r1; r++) {
+        uint32_t* row = &cfg->rows[r * cfg->words_per_row];
+        for (uint32_t w = tx >> 5; w <= (c1 >> 5); w++) {
+            uint32_t mask = bit_range((w == (tx >> 5u)) ? (tx & 31u) : 0,
+                                      (w == (c1 >> 5)) ? (c1 & 31u) : 31u);
+            if (solid) {
+                row[w] |= mask;
+            }
+            else {
+                row[w] &= ~mask;
+            }
+        }
+    }
+}
+
+uint8_t TileMap_IsSolid(const TileMap_cfg_t* cfg, int16_t tx, int16_t ty)
+{
+    if (tx < 0 || ty < 0 || tx >= (int16_t)cfg->width || ty >= (int16_t)cfg->height) {
+        return 1;
+    }
+    return (uint8_t)((cfg->rows[(uint32_t)ty * cfg->words_per_row + ((uint32_t)tx >> 5)]
+                      >> ((uint32_t)tx & 31u)) & 1u);
+}
+
+uint8_t TileMap_BoxHits(const TileMap_cfg_t* cfg, const TileMap_Box_t* box)
+{
+    int32_t c0 = TILE_OF(cfg, box->x);
+    int32_t c1 = TILE_OF(cfg, (int32_t)box->x + box->w - 1);
+    int32_t r0 = TILE_OF(cfg, box->y);
+    int32_t r1 = TILE_OF(cfg, (int32_t)box->y + box->h - 1);
+
+    if (c0 < 0 || r0 < 0 || c1 >= (int32_t)cfg->width || r1 >= (int32_t)cfg->height) {
+        return 1;
+    }
+    for (int32_t r = r0; r <= r1; r++) {
+        if (row_hits(cfg, r, c0, c1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int16_t TileMap_SweepX(const TileMap_cfg_t* cfg, const TileMap_Box_t* box, int16_t dx)
+{
+    int32_t tile = 1 << cfg->tile_shift;
+    int32_t left = box->x;
+    int32_t right = left + box->w;      // first pixel past the box
+    int32_t r0 = TILE_OF(cfg, box->y);
+    int32_t r1 = TILE_OF(cfg, (int32_t)box->y + box->h - 1);
+    int32_t col;
+
+    if (dx > 0) {
+        int32_t c0 = TILE_OF(cfg, right - 1) + 1;
+        int32_t c1 = TILE_OF(cfg, right - 1 + dx);
+        if (c1 < c0) {
+            return dx;      // stays within the columns it already covers
+        }
+        col = scan_columns(cfg, r0, r1, c0, c1);
+        return (col == NO_HIT) ? dx : (int16_t)(col * tile - right);
+    }
+    if (dx < 0) {
+        int32_t c0 = TILE_OF(cfg, left) - 1;
+        int32_t c1 = TILE_OF(cfg, left + dx);
+        if (c1 > c0) {
+            return dx;
+        }
+        col = scan_columns(cfg, r0, r1, c0, c1);
+        return (col == NO_HIT) ? dx : (int16_t)((col + 1) * tile - left);
+    }
+    return 0;
+}
+
+int16_t TileMap_SweepY(const TileMap_cfg_t* cfg, const TileMap_Box_t* box, int16_t dy)
+{
+    int32_t tile = 1 << cfg->tile_shift;
+    int32_t top = box->y;
+    int32_t bottom = top + box->h;      // first pixel below the box
+    int32_t c0 = TILE_OF(cfg, box->x);
+    int32_t c1 = TILE_OF(cfg, (int32_t)box->x + box->w - 1);
+    int32_t row;
+
+    if (dy > 0) {
+        int32_t r0 = TILE_OF(cfg, bottom - 1) + 1;
+        int32_t r1 = TILE_OF(cfg, bottom - 1 + dy);
+        if (r1 < r0) {
+            return dy;
+        }
+        row = scan_rows(cfg, c0, c1, r0, r1);
+        return (row == NO_HIT) ? dy : (int16_t)(row * tile - bottom);
+    }
+    if (dy < 0) {
+        int32_t r0 = TILE_OF(cfg, top) - 1;
+        int32_t r1 = TILE_OF(cfg, top + dy);
+        if (r1 > r0) {
+            return dy;
+        }
+        row = scan_rows(cfg, c0, c1, r0, r1);
+        return (row == NO_HIT) ? dy : (int16_t)((row + 1) * tile - top);
+    }
+    return 0;
+}
+
+uint8_t TileMap_Move(const TileMap_cfg_t* cfg, TileMap_Box_t* box, int16_t dx, int16_t dy)
+{
+    uint8_t hit = 0;
+
+    int16_t mx = TileMap_SweepX(cfg, box, dx);
+    if (mx != dx) {
+        hit |= TILEMAP_HIT_X;
+    }
+    box->x += mx;
+
+    int16_t my = TileMap_SweepY(cfg, box, dy);
+    if (my != dy) {
+        hit |= TILEMAP_HIT_Y;
+    }
+    box->y += my;
+
+    return hit;
+}
+
+void TileMap_ToPassable(const TileMap_cfg_t* cfg, uint8_t* bits)
+{
+    uint32_t i = 0;
+
+    memset(bits, 0, ((uint32_t)cfg->width * cfg->height + 7u) / 8u);
+    for (uint16_t y = 0; y < cfg->height; y++) {
+        const uint32_t* row = &cfg->rows[(uint32_t)y * cfg->words_per_row];
+        for (uint16_t x = 0; x < cfg->width; x++, i++) {
+            if (!((row[x >> 5] >> (x & 31u)) & 1u)) {
+                bits[i >> 3] |= (uint8_t)(1u << (i & 7u));
+            }
+        }
+    }
+}
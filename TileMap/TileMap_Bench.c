@@ -0,0 +1,164 @@
+#include "TileMap.h"
+
+/**
+ * @file TileMap_Bench.c
+ * @brief Query throughput benchmark for TileMap (define TILEMAP_BENCH to enable)
+ *
+ * Times TileMap_Move() for a 24x32 box (the Character's hitbox) from random
+ * free positions with random velocities, on:
+ * - a 30x30 screen-sized level (one word per row)
+ * - a 128x64 scrolling level (four words per row)
+ * with short moves (walking/dashing, up to 8 pixels) and long sweeps (fast
+ * projectiles, up to 64 pixels). The same queries are run through a
+ * reference that tests every tile entered with TileMap_IsSolid(), and the
+ * results are compared. Reports cycles per query and how many queries fit
+ * in one 30 ms logic frame.
+ */
+
+#ifdef TILEMAP_BENCH
+
+#include "main.h"
+#include <stdio.h>
+
+#define BENCH_W 128
+#define BENCH_H 64
+#define BENCH_QUERIES 256
+#define BENCH_FRAME_MS 30
+
+static uint32_t bench_rows[TILEMAP_WORDS(BENCH_W, BENCH_H)];
+static TileMap_Box_t bench_boxes[BENCH_QUERIES];
+static int16_t bench_moves[BENCH_QUERIES][2];
+static uint32_t bench_rng = 12345;
+static volatile int16_t bench_sink;     // keeps the timed results alive
+
+static uint16_t bench_rand(uint16_t range)
+{
+    bench_rng = bench_rng * 1664525u + 1013904223u;
+    return (uint16_t)((bench_rng >> 16) % range);
+}
+
+// Walls round the edge, then random platforms and pillars
+static void make_level(TileMap_cfg_t* map)
+{
+    TileMap_Init(map);
+    TileMap_FillRect(map, 0, 0, map->width, 1, 1);
+    TileMap_FillRect(map, 0, map->height - 1u, map->width, 1, 1);
+    TileMap_FillRect(map, 0, 0, 1, map->height, 1);
+    TileMap_FillRect(map, map->width - 1u, 0, 1, map->height, 1);
+
+    uint16_t pieces = (uint16_t)((map->width * map->height) / 40u);
+    for (uint16_t i = 0; i < pieces; i++) {
+        if (bench_rand(2)) {
+            TileMap_FillRect(map, bench_rand(map->width), bench_rand(map->height), 3 + bench_rand(6), 1, 1);
+        }
+        else {
+            TileMap_FillRect(map, bench_rand(map->width), bench_rand(map->height), 1, 2 + bench_rand(4), 1);
+        }
+    }
+}
+
+static void make_queries(const TileMap_cfg_t* map, int16_t max_speed)
+{
+    int16_t w = (int16_t)(map->width << map->tile_shift);
+    int16_t h = (int16_t)(map->height << map->tile_shift);
+
+    for (uint16_t i = 0; i < BENCH_QUERIES; i++) {
+        TileMap_Box_t box = {0, 0, 24, 32};
+        do {
+            box.x = (int16_t)bench_rand((uint16_t)(w - box.w));
+            box.y = (int16_t)bench_rand((uint16_t)(h - box.h));
+        } while (TileMap_BoxHits(map, &box));
+        bench_boxes[i] = box;
+        bench_moves[i][0] = (int16_t)bench_rand((uint16_t)(2 * max_speed + 1)) - max_speed;
+        bench_moves[i][1] = (int16_t)bench_rand((uint16_t)(2 * max_speed + 1)) - max_speed;
+    }
+}
+
+// Reference: test each tile column (then row) entered, one tile at a time
+static int16_t ref_sweep(const TileMap_cfg_t* map, const TileMap_Box_t* box, int16_t d, uint8_t vertical)
+{
+    int16_t tile = (int16_t)(1 << map->tile_shift);
+    int16_t pos = vertical ? box->y : box->x;
+    int16_t size = vertical ? box->h : box->w;
+    int16_t across0 = (vertical ? box->x : box->y) >> map->tile_shift;
+    int16_t across1 = ((vertical ? box->x + box->w : box->y + box->h) - 1) >> map->tile_shift;
+    int16_t edge = (d > 0) ? (int16_t)(pos + size - 1) : pos;
+    int16_t t = edge >> map->tile_shift;
+    int16_t last = (int16_t)(edge + d) >> map->tile_shift;
+    int16_t step = (d > 0) ? 1 : -1;
+
+    if (d == 0) {
+        return 0;
+    }
+    while (t != last) {
+        t += step;
+        for (int16_t a = across0; a <= across1; a++) {
+            if (vertical ? TileMap_IsSolid(map, a, t) : TileMap_IsSolid(map, t, a)) {
+                return (d > 0) ? (int16_t)(t * tile - (pos + size)) : (int16_t)((t + 1) * tile - pos);
+            }
+        }
+    }
+    return d;
+}
+
+static void bench_one(TileMap_cfg_t* map, int16_t max_speed)
+{
+    TileMap_Box_t results[2];
+    uint32_t mismatches = 0;
+
+    make_level(map);
+    make_queries(map, max_speed);
+
+    uint32_t start = DWT->CYCCNT;
+    for (uint16_t i = 0; i < BENCH_QUERIES; i++) {
+        TileMap_Box_t box = bench_boxes[i];
+        TileMap_Move(map, &box, bench_moves[i][0], bench_moves[i][1]);
+        bench_sink = box.x + box.y;
+    }
+    uint32_t fast_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    for (uint16_t i = 0; i < BENCH_QUERIES; i++) {
+        TileMap_Box_t box = bench_boxes[i];
+        box.x += ref_sweep(map, &box, bench_moves[i][0], 0);
+        box.y += ref_sweep(map, &box, bench_moves[i][1], 1);
+        bench_sink = box.x + box.y;
+    }
+    uint32_t ref_cycles = DWT->CYCCNT - start;
+
+    // Check outside the timed loops
+    for (uint16_t i = 0; i < BENCH_QUERIES; i++) {
+        results[0] = results[1] = bench_boxes[i];
+        TileMap_Move(map, &results[0], bench_moves[i][0], bench_moves[i][1]);
+        results[1].x += ref_sweep(map, &results[1], bench_moves[i][0], 0);
+        results[1].y += ref_sweep(map, &results[1], bench_moves[i][1], 1);
+        if (results[0].x != results[1].x || results[0].y != results[1].y) {
+            mismatches++;
+        }
+    }
+
+    uint32_t fast_per = fast_cycles / BENCH_QUERIES;
+    uint32_t ref_per = ref_cycles / BENCH_QUERIES;
+    uint32_t frame_cycles = (SystemCoreClock / 1000u) * BENCH_FRAME_MS;
+    printf("TileMap %3ux%-2u speed %2d: %4lu cycles/query (%6lu per frame), per-tile %5lu cycles (%5lu per frame)%s\n",
+           map->width, map->height, max_speed,
+           (unsigned long)fast_per, (unsigned long)(frame_cycles / (fast_per ? fast_per : 1u)),
+           (unsigned long)ref_per, (unsigned long)(frame_cycles / (ref_per ? ref_per : 1u)),
+           mismatches ? " MISMATCH" : "");
+}
+
+void TileMap_Bench(void)
+{
+    TileMap_cfg_t screen = {.width = 30, .height = 30, .tile_shift = 3, .rows = bench_rows, .setup_done = 0};
+    TileMap_cfg_t scroll = {.width = BENCH_W, .height = BENCH_H, .tile_shift = 3, .rows = bench_rows, .setup_done = 0};
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    bench_one(&screen, 8);
+    bench_one(&screen, 64);
+    bench_one(&scroll, 8);
+    bench_one(&scroll, 64);
+}
+
+#endif // TILEMAP_BENCH
@@ -0,0 +1,157 @@
+#include "TimerWheel.h"
+#include <stddef.h>
+
+/**
+ * @file TimerWheel.c
+ * @brief Implementation of the two-level timer wheel
+ */
+
+#define SLOT_MASK (TIMERWHEEL_SLOTS - 1u)
+
+static void list_add(TimerWheel_Timer_t** head, TimerWheel_Timer_t* timer)
+{
+    timer->next = *head;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = head;
+    *head = timer;
+}
+
+static void list_remove(TimerWheel_Timer_t* timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// File a timer into the slot for its expiry time relative to 'now'
+static void place(TimerWheel_t* wheel, TimerWheel_Timer_t* timer)
+{
+    uint32_t delta = timer->expires - wheel->now;
+    uint32_t block_delta = (timer->expires >> TIMERWHEEL_SLOT_BITS) - (wheel->now >> TIMERWHEEL_SLOT_BITS);
+
+    if (delta < TIMERWHEEL_SLOTS) {
+        list_add(&wheel->slots[0][timer->expires & SLOT_MASK], timer);
+    }
+    else if (block_delta < TIMERWHEEL_SLOTS) {
+        list_add(&wheel->slots[1][(timer->expires >> TIMERWHEEL_SLOT_BITS) & SLOT_MASK], timer);
+    }
+    else {
+        // Beyond the wheel: park in the furthest level 1 slot, re-filed on cascade
+        uint32_t block = (wheel->now >> TIMERWHEEL_SLOT_BITS) + TIMERWHEEL_SLOTS - 1u;
+        list_add(&wheel->slots[1][block & SLOT_MASK], timer);
+    }
+}
+
+void TimerWheel_Init(TimerWheel_t* wheel)
+{
+    for (uint32_t level = 0; level < TIMERWHEEL_LEVELS; level++) {
+        for (uint32_t slot = 0; slot < TIMERWHEEL_SLOTS; slot++) {
+            wheel->slots[level][slot] = NULL;
+        }
+    }
+    wheel->now = 0;
+    wheel->active = 0;
+    wheel->expired = 0;
+    wheel->cascaded = 0;
+    wheel->max_expired_per_tick = 0;
+    wheel->setup_done = 1;
+}
+
+void TimerWheel_TimerInit(TimerWheel_Timer_t* timer, TimerWheel_Callback_t callback, void* context)
+{
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->context = context;
+    timer->active = 0;
+}
+
+void TimerWheel_Start(TimerWheel_t* wheel, TimerWheel_Timer_t* timer, uint32_t ticks)
+{
+    if (timer->active) {
+        list_remove(timer);
+    }
+    else {
+        wheel->active++;
+    }
+
+    timer->expires = wheel->now + (ticks ? ticks : 1u);
+    timer->active = 1;
+    place(wheel, timer);
+}
+
+void TimerWheel_Cancel(TimerWheel_t* wheel, TimerWheel_Timer_t* timer)
+{
+    if (!timer->active) {
+        return;
+    }
+    list_remove(timer);
+    timer->active = 0;
+    wheel->active--;
+}
+
+uint16_t TimerWheel_Tick(TimerWheel_t* wheel)
+{
+    TimerWheel_Timer_t* list;
+    TimerWheel_Timer_t* timer;
+    uint16_t count = 0;
+
+    wheel->now++;
+    uint32_t slot0 = wheel->now & SLOT_MASK;
+
+    // Every 64 ticks the next level 1 slot moves down to level 0
+    if (slot0 == 0) {
+        uint32_t slot1 = (wheel->now >> TIMERWHEEL_SLOT_BITS) & SLOT_MASK;
+
+        list = wheel->slots[1][slot1];
+        wheel->slots[1][slot1] = NULL;
+        if (list) {
+            list->pprev = &list;
+        }
+        while ((timer = list) != NULL) {
+            list_remove(timer);
+            place(wheel, timer);
+            wheel->cascaded++;
+        }
+    }
+
+    // Detach the due slot so callbacks can freely start/cancel timers
+    list = wheel->slots[0][slot0];
+    wheel->slots[0][slot0] = NULL;
+    if (list) {
+        list->pprev = &list;
+    }
+
+    while ((timer = list) != NULL) {
+        list_remove(timer);
+        timer->active = 0;
+        wheel->active--;
+        count++;
+
+        if (timer->callback) {
+            timer->callback(timer, timer->context);
+        }
+    }
+
+    wheel->expired += count;
+    if (count > wheel->max_expired_per_tick) {
+        wheel->max_expired_per_tick = count;
+    }
+    return count;
+}
+
+uint8_t TimerWheel_IsActive(const TimerWheel_Timer_t* timer)
+{
+    return timer->active ? 1u : 0u;
+}
+
+uint32_t TimerWheel_Remaining(const TimerWheel_t* wheel, const TimerWheel_Timer_t* timer)
+{
+    return timer->active ? (timer->expires - wheel->now) : 0u;
+}
@@ -0,0 +1,127 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+
+/**
+ * @file TimerWheel.h
+ * @brief Hierarchical timer wheel for game timers and cooldowns
+ *
+ * Counting timers down in every entity every frame costs time for every
+ * active timer, every frame. The wheel instead files each timer into a slot
+ * by its expiry tick:
+ *
+ * - Level 0: 64 slots of 1 tick (timers due in the next 64 ticks)
+ * - Level 1: 64 slots of 64 ticks (up to 4096 ticks ahead; longer timers
+ *   are parked in the furthest slot and re-filed when they get closer)
+ *
+ * TimerWheel_Tick() only looks at one level 0 slot per tick, plus one level 1
+ * slot every 64 ticks (its timers cascade down to level 0). Start and cancel
+ * are O(1) (intrusive lists, no allocation). The cost per tick scales with
+ * the number of timers expiring or cascading, not with the number active.
+ *
+ * Expired timers call their callback from inside TimerWheel_Tick(). A
+ * callback may start or cancel any timer, including its own (restarting
+ * itself makes a periodic timer).
+ *
+ * Example usage:
+ * @code
+ * TimerWheel_t game_timers;
+ * TimerWheel_Timer_t cooldown;
+ *
+ * void cooldown_done(TimerWheel_Timer_t* timer, void* context) {
+ *     ((Enemy_t*)context)->can_attack = 1;
+ * }
+ *
+ * TimerWheel_Init(&game_timers);
+ * TimerWheel_TimerInit(&cooldown, cooldown_done, &enemy);
+ * TimerWheel_Start(&game_timers, &cooldown, 45);   // 45 game ticks
+ *
+ * // Once per game tick:
+ * TimerWheel_Tick(&game_timers);
+ * @endcode
+ */
+
+#define TIMERWHEEL_SLOT_BITS 6
+#define TIMERWHEEL_SLOTS (1u << TIMERWHEEL_SLOT_BITS)   // 64 slots per level
+#define TIMERWHEEL_LEVELS 2
+
+struct TimerWheel_Timer_s;
+
+/**
+ * @brief Expiry callback
+ *
+ * @param timer The timer that expired (already inactive)
+ * @param context Pointer given to TimerWheel_TimerInit()
+ */
+typedef void (*TimerWheel_Callback_t)(struct TimerWheel_Timer_s* timer, void* context);
+
+/**
+ * @struct TimerWheel_Timer_t
+ * @brief One timer, embedded in the object that owns it
+ */
+typedef struct TimerWheel_Timer_s {
+    struct TimerWheel_Timer_s* next;    ///< Internal: next timer in the slot list
+    struct TimerWheel_Timer_s** pprev;  ///< Internal: pointer to the pointer that points at this timer
+    uint32_t expires;                   ///< Internal: absolute expiry tick
+    TimerWheel_Callback_t callback;     ///< Called on expiry
+    void* context;                      ///< Passed to the callback
+    uint8_t active;                     ///< Internal flag: 1 while the timer is running
+} TimerWheel_Timer_t;
+
+/**
+ * @struct TimerWheel_t
+ * @brief Wheel state and statistics
+ */
+typedef struct {
+    TimerWheel_Timer_t* slots[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOTS];    ///< Internal: slot lists
+    uint32_t now;                   ///< Current tick
+    uint32_t active;                ///< Timers running
+    uint32_t expired;               ///< Total callbacks run
+    uint32_t cascaded;              ///< Total timers moved from level 1 to level 0
+    uint16_t max_expired_per_tick;  ///< Most timers that expired in a single tick
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+} TimerWheel_t;
+
+/**
+ * @brief Initialise an empty wheel at tick 0
+ */
+void TimerWheel_Init(TimerWheel_t* wheel);
+
+/**
+ * @brief Initialise a timer (inactive) with its callback
+ */
+void TimerWheel_TimerInit(TimerWheel_Timer_t* timer, TimerWheel_Callback_t callback, void* context);
+
+/**
+ * @brief Start (or restart) a timer
+ *
+ * @param ticks Ticks until expiry, 0 is treated as 1 (expires on the next tick)
+ */
+void TimerWheel_Start(TimerWheel_t* wheel, TimerWheel_Timer_t* timer, uint32_t ticks);
+
+/**
+ * @brief Stop a timer without calling its callback (no effect if inactive)
+ */
+void TimerWheel_Cancel(TimerWheel_t* wheel, TimerWheel_Timer_t* timer);
+
+/**
+ * @brief Advance one tick and run the callbacks of expired timers
+ *
+ * @return Number of timers that expired
+ */
+uint16_t TimerWheel_Tick(TimerWheel_t* wheel);
+
+/**
+ * @brief Check if a timer is running
+ */
+uint8_t TimerWheel_IsActive(const TimerWheel_Timer_t* timer);
+
+/**
+ * @brief Ticks until a timer expires
+ *
+ * @return Remaining ticks, 0 if inactive
+ */
+uint32_t TimerWheel_Remaining(const TimerWheel_t* wheel, const TimerWheel_Timer_t* timer);
+
+#endif // TIMERWHEEL_H
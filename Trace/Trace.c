@@ -0,0 +1,41 @@
+#include "Trace.h"
+
+/**
+ * @file Trace.c
+ * @brief Implementation of the FSM transition ring and its UART dump
+ */
+
+#ifdef FSM_TRACE
+
+#include <stdio.h>
+
+Trace_t fsm_trace;
+
+void Trace_Init(void)
+{
+    fsm_trace.count = 0;
+    fsm_trace.replaying = 0;
+}
+
+void Trace_Dump(void (*between_lines)(void))
+{
+    // Snapshot the count: transitions recorded while printing (from a
+    // yield) may overwrite the oldest entries, but the range stays valid
+    uint32_t count = fsm_trace.count;
+    uint32_t entries = count < TRACE_SIZE ? count : TRACE_SIZE;
+
+    printf("TRACE BEGIN %lu %lu %lu\n", (unsigned long)entries, (unsigned long)count,
+           (unsigned long)HAL_GetTick());
+    for (uint32_t i = count - entries; i != count; i++) {
+        const Trace_Entry_t* entry = &fsm_trace.entries[i & (TRACE_SIZE - 1)];
+
+        printf("T %08lx %02x%02x%02x%02x\n", (unsigned long)entry->time_ms,
+               entry->entity, entry->from, entry->to, entry->event);
+        if (between_lines && (i & 15) == 15) {
+            between_lines();
+        }
+    }
+    printf("TRACE END\n");
+}
+
+#endif // FSM_TRACE
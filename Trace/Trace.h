@@ -0,0 +1,117 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "main.h"
+
+/**
+ * @file Trace.h
+ * @brief FSM transition trace: a RAM ring of recent state changes, dumped over UART
+ *
+ * When a state machine misbehaves (a dash that does not start, a scene that
+ * is left too early) the current state alone does not say how it got there.
+ * Each transition records one 8-byte entry into a ring of the last
+ * TRACE_SIZE entries:
+ *   time (HAL tick, ms), entity, from state, to state, event
+ * The entity says which machine it was (the scene manager, the player, a
+ * versus player); states and events are that machine's own enum values.
+ * A record is an index increment, a tick read and two stores, so it can stay
+ * in the hot paths. Recording is only from the main loop (no locking).
+ *
+ * Frames simulated again by the netcode (a rollback, or the resimulation
+ * cost measurement) run the same state machines. Their transitions are
+ * recorded between TRACE_REPLAY(1) and TRACE_REPLAY(0) and marked with
+ * TRACE_REPLAYED in the entity byte, so the decoder can tell them from
+ * frames played live (or leave them out).
+ *
+ * Trace_Dump() prints the ring as hex lines over UART; tools/trace_decode.py
+ * turns a captured log back into named states and events. In the debugger
+ * the ring is the global fsm_trace.
+ *
+ * Tracing is only built in with FSM_TRACE defined (on by default in Debug
+ * builds, off in Release: configure with -DFSM_TRACE=ON/OFF). Without it
+ * TRACE_FSM() expands to nothing and the ring is not linked in.
+ *
+ * Example usage:
+ * @code
+ * Trace_Init();
+ *
+ * // In a state machine, after deciding the next state:
+ * if (next != obj->state) {
+ *     TRACE_FSM(obj->trace_id, obj->state, next, EV_TIMEOUT);
+ *     obj->state = next;
+ * }
+ *
+ * Trace_Dump(NULL);    // TRACE BEGIN ... TRACE END over UART
+ * @endcode
+ */
+
+#define TRACE_SIZE 128      // Entries in the ring, must be a power of two (8 bytes each)
+#define TRACE_REPLAYED 0x80 // Entity flag: recorded while replaying frames
+
+/**
+ * @struct Trace_Entry_t
+ * @brief One recorded transition
+ */
+typedef struct {
+    uint32_t time_ms;       ///< HAL tick when recorded
+    uint8_t entity;         ///< Which state machine, | TRACE_REPLAYED if replayed
+    uint8_t from;           ///< State before
+    uint8_t to;             ///< State after (same as from for events that change nothing)
+    uint8_t event;          ///< What caused it (per machine)
+} Trace_Entry_t;
+
+/**
+ * @struct Trace_t
+ * @brief The ring
+ */
+typedef struct {
+    Trace_Entry_t entries[TRACE_SIZE];
+    uint32_t count;         ///< Entries recorded since Trace_Init() (the newest is at (count - 1) % TRACE_SIZE)
+    uint8_t replaying;      ///< TRACE_REPLAYED while frames are being replayed, else 0
+} Trace_t;
+
+extern Trace_t fsm_trace;
+
+/**
+ * @brief Clear the ring
+ */
+void Trace_Init(void);
+
+/**
+ * @brief Record one transition (use TRACE_FSM() so it compiles out)
+ */
+static inline void Trace_Record(uint8_t entity, uint8_t from, uint8_t to, uint8_t event)
+{
+    Trace_Entry_t* entry = &fsm_trace.entries[fsm_trace.count++ & (TRACE_SIZE - 1)];
+
+    entry->time_ms = HAL_GetTick();
+    entry->entity = entity | fsm_trace.replaying;
+    entry->from = from;
+    entry->to = to;
+    entry->event = event;
+}
+
+/**
+ * @brief Print the ring, oldest entry first, over UART (printf)
+ *
+ * Format (decoded by tools/trace_decode.py):
+ *   TRACE BEGIN <entries> <recorded> <now ms>
+ *   T <time ms> <entity from to event>     (hex: 8 digits, then 4 bytes)
+ *   TRACE END
+ *
+ * @param between_lines Called every 16 lines (e.g. to let urgent tasks run
+ *                      while the UART is busy), may be NULL
+ */
+void Trace_Dump(void (*between_lines)(void));
+
+#ifdef FSM_TRACE
+#define TRACE_FSM(entity, from, to, event) \
+    Trace_Record((uint8_t)(entity), (uint8_t)(from), (uint8_t)(to), (uint8_t)(event))
+#define TRACE_REPLAY(on) (fsm_trace.replaying = (on) ? TRACE_REPLAYED : 0)
+#else
+#define TRACE_FSM(entity, from, to, event) ((void)0)
+#define TRACE_REPLAY(on) ((void)0)
+#endif
+
+#endif // TRACE_H
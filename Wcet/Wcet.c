@@ -0,0 +1,78 @@
+#include "Wcet.h"
+
+/**
+ * @file Wcet.c
+ * @brief Implementation of the worst-case execution time harness
+ */
+
+#ifdef WCET_BENCH
+
+#include <stdio.h>
+
+void Wcet_Init(Wcet_cfg_t* cfg)
+{
+#if defined(__arm__)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    for (uint8_t i = 0; i < cfg->probe_count; i++) {
+        Wcet_Probe_t* probe = &cfg->probes[i];
+
+        probe->max = 0;
+        probe->min = UINT32_MAX;
+        probe->samples = 0;
+        probe->worst_case = WCET_NO_CASE;
+    }
+    cfg->setup_done = 1;
+}
+
+void Wcet_Record(Wcet_cfg_t* cfg, uint8_t probe_id, uint32_t ticks, uint16_t case_id)
+{
+    Wcet_Probe_t* probe = &cfg->probes[probe_id];
+
+    if (ticks > probe->max || probe->worst_case == WCET_NO_CASE) {
+        probe->max = ticks;
+        probe->worst_case = case_id;
+    }
+    if (ticks < probe->min) {
+        probe->min = ticks;
+    }
+    probe->samples++;
+}
+
+uint8_t Wcet_Report(Wcet_cfg_t* cfg)
+{
+    uint32_t per_us = WCET_TICKS_PER_US;
+    uint32_t frame_us = 0;
+
+    for (uint8_t i = 0; i < cfg->probe_count; i++) {
+        const Wcet_Probe_t* probe = &cfg->probes[i];
+        uint32_t max_us = (probe->max + per_us - 1) / per_us;   // Round up: this is a bound
+
+        if (probe->samples == 0) {
+            printf("WCET %s: no runs\n", probe->name);
+            continue;
+        }
+        printf("WCET %s: max %lu " WCET_TICK_NAME " (%lu us) in case ", probe->name,
+               (unsigned long)probe->max, (unsigned long)max_us);
+        if (cfg->case_name) {
+            printf("%s", cfg->case_name(i, probe->worst_case));
+        }
+        else {
+            printf("%u", probe->worst_case);
+        }
+        printf(", min %lu, %lu runs%s\n", (unsigned long)probe->min,
+               (unsigned long)probe->samples, probe->in_frame ? "" : " (not in frame)");
+        if (probe->in_frame) {
+            frame_us += max_us;
+        }
+    }
+
+    uint8_t pass = frame_us <= cfg->budget_us;
+    printf("WCET frame: %lu us of %lu us: %s\n", (unsigned long)frame_us,
+           (unsigned long)cfg->budget_us, pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+#endif // WCET_BENCH
@@ -0,0 +1,157 @@
+#ifndef WCET_H
+#define WCET_H
+
+#include <stdint.h>
+
+/**
+ * @file Wcet.h
+ * @brief Worst-case execution time harness: maximum run time per function
+ *        over a set of adversarial cases, checked against a frame budget
+ *
+ * Averages hide the frame that drops. A benchmark runs typical input; this
+ * harness runs the inputs that make each path take longest (every FSM state,
+ * the sprite clipped at each screen edge, the longest HUD text, the whole
+ * screen dirty) and keeps only the maximum per function, with the case that
+ * produced it.
+ *
+ * Functions are probes in a table. The caller wraps each call in
+ * WCET_MEASURE() with the set-up of its case; each case runs a few times, so
+ * the first run (cold flash cache, empty buffers) and the later ones are
+ * both seen.
+ * Wcet_Report() prints the table and checks the sum of the maxima of the
+ * probes that run in one frame against the frame budget: the frame's worst
+ * case is assumed to be all of them at their worst at once.
+ *
+ * Time is counted in ticks of Wcet_Now(): CPU cycles (DWT cycle counter) on
+ * the target, nanoseconds (monotonic clock) elsewhere. The budget is in
+ * microseconds, so the same check works on both. Only this module is
+ * portable: the game itself has no host build to run it in. On the target the
+ * result is for the clock the harness ran at, so run the cases again (after
+ * Wcet_Init()) at every clock the frame has to hold at.
+ *
+ * The cases run with interrupts enabled, so each maximum includes handlers
+ * that preempted it (see INTERRUPT_PRIORITIES.md for their budgets).
+ *
+ * Only built with WCET_BENCH defined (configure with -DWCET_BENCH=ON).
+ *
+ * Example usage:
+ * @code
+ * enum { WCET_UPDATE, WCET_RENDER, WCET_COUNT };
+ * Wcet_Probe_t probes[WCET_COUNT] = {
+ *     [WCET_UPDATE] = {"update", 1},
+ *     [WCET_RENDER] = {"render", 1},
+ * };
+ * Wcet_cfg_t wcet = {
+ *     .probes = probes, .probe_count = WCET_COUNT,
+ *     .budget_us = 30000,
+ *     .setup_done = 0
+ * };
+ *
+ * Wcet_Init(&wcet);
+ * for (uint16_t c = 0; c < case_count; c++) {
+ *     WCET_MEASURE(&wcet, WCET_UPDATE, c, set_up_case(c), update());
+ *     WCET_MEASURE(&wcet, WCET_RENDER, c, ((void)0), render());
+ * }
+ * if (!Wcet_Report(&wcet)) {
+ *     // Over budget
+ * }
+ * @endcode
+ */
+
+#if defined(__arm__)
+#include "main.h"
+
+#define WCET_TICK_NAME "cycles"
+#define WCET_TICKS_PER_US (SystemCoreClock / 1000000u)
+
+static inline uint32_t Wcet_Now(void)
+{
+    return DWT->CYCCNT;
+}
+#else
+#include <time.h>
+
+#define WCET_TICK_NAME "ns"
+#define WCET_TICKS_PER_US 1000u
+
+static inline uint32_t Wcet_Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+#endif
+
+#define WCET_REPEAT 3              // Runs per case (the first one is cold)
+#define WCET_NO_CASE 0xFFFF        // worst_case before any sample
+
+/**
+ * @struct Wcet_Probe_t
+ * @brief One measured function
+ */
+typedef struct {
+    const char* name;
+    uint8_t in_frame;               ///< 1 if it runs once per frame (its maximum counts against the budget)
+
+    // Internal state (cleared by Wcet_Init)
+    uint32_t max;                   ///< Longest run, in ticks
+    uint32_t min;                   ///< Shortest run, in ticks
+    uint32_t samples;
+    uint16_t worst_case;            ///< Case that gave the maximum
+} Wcet_Probe_t;
+
+/**
+ * @struct Wcet_cfg_t
+ * @brief Probe table and frame budget
+ */
+typedef struct {
+    Wcet_Probe_t* probes;
+    uint8_t probe_count;
+    uint32_t budget_us;             ///< Frame budget the in-frame probes must fit in together
+    const char* (*case_name)(uint8_t probe, uint16_t case_id);  ///< Names a probe's case in the report, may be NULL
+    uint8_t setup_done;             ///< Internal flag: 1 if initialised, 0 otherwise
+} Wcet_cfg_t;
+
+/**
+ * @brief Clear every probe (and start the cycle counter on the target)
+ */
+void Wcet_Init(Wcet_cfg_t* cfg);
+
+/**
+ * @brief Add one run time to a probe
+ *
+ * @param ticks Wcet_Now() difference
+ * @param case_id Case being run, reported for the maximum
+ */
+void Wcet_Record(Wcet_cfg_t* cfg, uint8_t probe, uint32_t ticks, uint16_t case_id);
+
+/**
+ * @brief Time one call (any expression or statement) WCET_REPEAT times
+ *
+ * setup runs before each repeat and is not timed: it puts back the state the
+ * case starts from, since the call usually changes it. Use ((void)0) if
+ * there is nothing to restore.
+ */
+#define WCET_MEASURE(cfg, probe, case_id, setup, call)                     \
+    do {                                                                   \
+        for (uint8_t wcet_rep_ = 0; wcet_rep_ < WCET_REPEAT; wcet_rep_++) { \
+            setup;                                                         \
+            uint32_t wcet_start = Wcet_Now();                              \
+            call;                                                          \
+            Wcet_Record((cfg), (probe), Wcet_Now() - wcet_start, (case_id)); \
+        }                                                                  \
+    } while (0)
+
+/**
+ * @brief Print the maximum per probe and check the frame budget (printf)
+ *
+ * Format:
+ *   WCET <name>: max <ticks> (<us> us) in case <case>, min <ticks>, <n> runs
+ *   WCET frame: <sum of in-frame maxima> us of <budget> us: PASS|FAIL
+ *
+ * @return 1 if the in-frame maxima fit the budget, 0 if not
+ */
+uint8_t Wcet_Report(Wcet_cfg_t* cfg);
+
+#endif // WCET_H
@@ -0,0 +1,131 @@
+#include "WorkQueue.h"
+#include "main.h"
+
+/**
+ * @file WorkQueue.c
+ * @brief Implementation of the PendSV deferred-work queue
+ *
+ * Producers reserve a slot by advancing 'head' with LDREX/STREX, fill it, then
+ * publish it by writing the slot's sequence number. The consumer runs slots in
+ * order while they are published and stops at the first unpublished one. A
+ * producer that was pre-empted between reserving and publishing pends PendSV
+ * again when it publishes, so its item is never left behind.
+ */
+
+#if (WORKQUEUE_SIZE & (WORKQUEUE_SIZE - 1)) != 0
+#error "WORKQUEUE_SIZE must be a power of two"
+#endif
+
+typedef struct {
+    WorkQueue_Fn_t fn;
+    uint32_t arg;
+    uint32_t posted_cycles;     // DWT cycle counter at post time
+    volatile uint32_t seq;      // index + 1 once published
+} WorkQueue_Item_t;
+
+static WorkQueue_Item_t items[WORKQUEUE_SIZE];
+static volatile uint32_t head = 0;  // next slot to reserve (producers)
+static volatile uint32_t tail = 0;  // next slot to run (PendSV only)
+
+static WorkQueue_Stats_t stats;
+static uint32_t max_latency_cycles = 0;
+
+void WorkQueue_Init(void)
+{
+    // Cycle counter for latency measurement
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    for (uint32_t i = 0; i < WORKQUEUE_SIZE; i++) {
+        items[i].seq = 0;
+    }
+    head = 0;
+    tail = 0;
+
+    // Lowest priority: work runs only once every other interrupt is done
+    HAL_NVIC_SetPriority(PendSV_IRQn, 15, 0);
+}
+
+uint8_t WorkQueue_Post(WorkQueue_Fn_t fn, uint32_t arg)
+{
+    uint32_t index;
+    uint32_t depth;
+
+    // Reserve a slot
+    do {
+        index = __LDREXW(&head);
+        depth = index - tail;
+        if (depth >= WORKQUEUE_SIZE) {
+            __CLREX();
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            stats.dropped++;
+            __set_PRIMASK(primask);
+            return 0;
+        }
+    } while (__STREXW(index + 1u, &head));
+
+    WorkQueue_Item_t* item = &items[index & (WORKQUEUE_SIZE - 1u)];
+    item->fn = fn;
+    item->arg = arg;
+    item->posted_cycles = DWT->CYCCNT;
+
+    // Publish: contents must be visible before the sequence number
+    __DMB();
+    item->seq = index + 1u;
+
+    // Statistics are only touched with interrupts masked (a few cycles);
+    // PRIMASK is restored so posting from inside a critical section is safe
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    stats.posted++;
+    if (depth + 1u > stats.max_depth) {
+        stats.max_depth = depth + 1u;
+    }
+    __set_PRIMASK(primask);
+
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    return 1;
+}
+
+void WorkQueue_PendSVHandler(void)
+{
+    for (;;) {
+        uint32_t index = tail;
+        WorkQueue_Item_t* item = &items[index & (WORKQUEUE_SIZE - 1u)];
+
+        if (item->seq != index + 1u) {
+            break;  // empty, or the next slot is reserved but not published yet
+        }
+        __DMB();
+
+        WorkQueue_Fn_t fn = item->fn;
+        uint32_t arg = item->arg;
+        uint32_t latency = DWT->CYCCNT - item->posted_cycles;
+
+        // Free the slot before running, so the work function may post again
+        item->seq = 0;
+        tail = index + 1u;
+
+        if (latency > max_latency_cycles) {
+            max_latency_cycles = latency;
+        }
+        stats.run++;
+
+        fn(arg);
+    }
+}
+
+void WorkQueue_GetStats(WorkQueue_Stats_t* out, uint8_t reset)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *out = stats;
+    out->max_latency_us = max_latency_cycles / (SystemCoreClock / 1000000u);
+    if (reset) {
+        stats.max_depth = 0;
+        max_latency_cycles = 0;
+    }
+    __set_PRIMASK(primask);
+}
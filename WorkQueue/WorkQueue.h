@@ -0,0 +1,83 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <stdint.h>
+
+/**
+ * @file WorkQueue.h
+ * @brief Deferred work for interrupt "bottom halves", run from PendSV
+ *
+ * An interrupt handler should only acknowledge its hardware and return.
+ * Anything longer (debouncing, processing a finished ADC batch, starting the
+ * next DMA transfer) can be posted here as a small work item. The post pends
+ * PendSV, which runs at the lowest interrupt priority: it executes after all
+ * other interrupts have finished but before control returns to the main loop.
+ *
+ * The queue is lock-free with multiple producers and a single consumer. Any
+ * interrupt priority (and the main loop) may post, because slots are
+ * reserved with LDREX/STREX. PendSV is the only consumer.
+ *
+ * Instrumentation: items posted, run and dropped (queue full), the deepest
+ * the queue has been, and the worst post-to-run latency.
+ *
+ * Example usage:
+ * @code
+ * static void adc_batch_done(uint32_t arg) { process(samples[arg]); }
+ *
+ * WorkQueue_Init();
+ *
+ * // In an ISR:
+ * WorkQueue_Post(adc_batch_done, buffer_index);
+ *
+ * // In PendSV_Handler():
+ * WorkQueue_PendSVHandler();
+ * @endcode
+ */
+
+// Number of slots, must be a power of two
+#define WORKQUEUE_SIZE 16
+
+/**
+ * @brief Work function, called from PendSV with the argument given to WorkQueue_Post()
+ */
+typedef void (*WorkQueue_Fn_t)(uint32_t arg);
+
+/**
+ * @struct WorkQueue_Stats_t
+ * @brief Queue instrumentation
+ */
+typedef struct {
+    uint32_t posted;            ///< Items accepted
+    uint32_t run;               ///< Items executed
+    uint32_t dropped;           ///< Items rejected because the queue was full
+    uint32_t max_depth;         ///< Most items waiting at once
+    uint32_t max_latency_us;    ///< Longest time from post to start of execution
+} WorkQueue_Stats_t;
+
+/**
+ * @brief Initialise the queue, set PendSV to the lowest priority and start the cycle counter
+ */
+void WorkQueue_Init(void);
+
+/**
+ * @brief Queue a work item and pend PendSV (safe from any interrupt or the main loop)
+ *
+ * @param fn Function to run
+ * @param arg Argument passed to fn
+ * @return 1 if queued, 0 if the queue was full (item dropped)
+ */
+uint8_t WorkQueue_Post(WorkQueue_Fn_t fn, uint32_t arg);
+
+/**
+ * @brief Run all published work items - call from PendSV_Handler()
+ */
+void WorkQueue_PendSVHandler(void);
+
+/**
+ * @brief Get the instrumentation counters
+ *
+ * @param reset 1 to clear max_depth and max_latency_us after reading
+ */
+void WorkQueue_GetStats(WorkQueue_Stats_t* stats, uint8_t reset);
+
+#endif // WORKQUEUE_H
@@ -0,0 +1,279 @@
+#!/usr/bin/env python3
+"""
+Behaviour tree compiler for the BehaviourTree interpreter.
+
+Converts readable .bt files into the bytecode that BT_Tick() runs from flash.
+One tree per file; the tree is named after the file (chaser.bt -> BT_chaser).
+
+Text format - one node per line, children indented under their parent:
+
+  # Chase the player when it is close, otherwise wander
+  selector
+      memsequence
+          condition player_near
+          action attack
+          wait 20
+      sequence
+          invert
+              condition player_hidden
+          action chase
+      action wander
+
+  sequence  / seq   run children in order until one fails (or is running),
+                    from the first child every tick
+  memsequence / memseq
+                    the same, but resume at the child that was running last tick
+  selector  / sel   run children in order until one succeeds (or is running)
+  invert    / not   swap success and failure of its single child
+  condition / cond  NAME   call the condition function BT_COND_<NAME>
+  action    / act   NAME   call the action function BT_ACT_<NAME>
+  wait      TICKS   running for TICKS ticks, then success
+
+Bytecode (see BehaviourTree.h for the interpreter side), in pre-order:
+  0x01 len16   SEQUENCE     len16 = byte length of the children, little-endian
+  0x02 len16   SELECTOR
+  0x03 len16   INVERT
+  0x04 len16   MEMSEQ
+  0x10 id      CONDITION
+  0x11 id      ACTION
+  0x12 ticks16 WAIT
+
+Condition and action names are collected from all input files and numbered
+alphabetically, so every tree shares one BT_COND_* / BT_ACT_* numbering and
+one pair of function tables.
+
+Usage:
+  bt_compiler.py -o <output base path> <tree files...>
+  (writes <output>.c and <output>.h)
+"""
+
+import argparse
+import os
+import re
+import sys
+
+OP_SEQUENCE = 0x01
+OP_SELECTOR = 0x02
+OP_INVERT = 0x03
+OP_MEMSEQ = 0x04
+OP_CONDITION = 0x10
+OP_ACTION = 0x11
+OP_WAIT = 0x12
+
+# Must match BT_MAX_DEPTH in BehaviourTree.h
+MAX_DEPTH = 8
+
+COMPOSITES = {"sequence": OP_SEQUENCE, "seq": OP_SEQUENCE,
+              "memsequence": OP_MEMSEQ, "memseq": OP_MEMSEQ,
+              "selector": OP_SELECTOR, "sel": OP_SELECTOR,
+              "invert": OP_INVERT, "not": OP_INVERT}
+LEAVES = {"condition": OP_CONDITION, "cond": OP_CONDITION,
+          "action": OP_ACTION, "act": OP_ACTION,
+          "wait": OP_WAIT}
+
+
+class TreeError(Exception):
+    pass
+
+
+class Node:
+    def __init__(self, op, arg, line):
+        self.op = op
+        self.arg = arg
+        self.line = line
+        self.children = []
+
+
+# ===== PARSER =====
+
+def parse_tree(text, path):
+    root = None
+    stack = []  # (indent, node)
+
+    for number, raw in enumerate(text.splitlines(), 1):
+        line = raw.split("#", 1)[0].rstrip().expandtabs(4)
+        if not line.strip():
+            continue
+        indent = len(line) - len(line.lstrip())
+        words = line.split()
+        keyword = words[0].lower()
+        where = f"{path}:{number}"
+
+        if keyword in COMPOSITES:
+            if len(words) != 1:
+                raise TreeError(f"{where}: '{keyword}' takes no argument")
+            node = Node(COMPOSITES[keyword], None, where)
+        elif keyword in LEAVES:
+            if len(words) != 2:
+                raise TreeError(f"{where}: '{keyword}' needs one argument")
+            op = LEAVES[keyword]
+            if op == OP_WAIT:
+                try:
+                    ticks = int(words[1], 0)
+                except ValueError:
+                    raise TreeError(f"{where}: wait needs a number of ticks")
+                if not 0 <= ticks <= 0xFFFF:
+                    raise TreeError(f"{where}: wait must be 0..65535 ticks")
+                node = Node(op, ticks, where)
+            else:
+                if not re.fullmatch(r"[A-Za-z_][A-Za-z0-9_]*", words[1]):
+                    raise TreeError(f"{where}: '{words[1]}' is not a valid name")
+                node = Node(op, words[1].lower(), where)
+        else:
+            raise TreeError(f"{where}: unknown node '{words[0]}'")
+
+        while stack and stack[-1][0] >= indent:
+            stack.pop()
+        if not stack:
+            if root is not None:
+                raise TreeError(f"{where}: a tree has exactly one root node")
+            root = node
+        else:
+            parent = stack[-1][1]
+            if parent.op not in COMPOSITES.values():
+                raise TreeError(f"{where}: only sequence, memsequence, selector and invert can have children")
+            parent.children.append(node)
+        stack.append((indent, node))
+
+    if root is None:
+        raise TreeError(f"{path}: empty tree")
+    return root
+
+
+def check(node, depth=1):
+    if node.op == OP_INVERT and len(node.children) != 1:
+        raise TreeError(f"{node.line}: invert needs exactly one child")
+    if node.children and depth > MAX_DEPTH:
+        raise TreeError(f"{node.line}: nested deeper than {MAX_DEPTH} composites")
+    for child in node.children:
+        check(child, depth + (1 if child.children else 0))
+
+
+def collect_names(node, conditions, actions):
+    if node.op == OP_CONDITION:
+        conditions.add(node.arg)
+    elif node.op == OP_ACTION:
+        actions.add(node.arg)
+    for child in node.children:
+        collect_names(child, conditions, actions)
+
+
+# ===== ENCODER =====
+
+def encode(node, cond_ids, act_ids):
+    if node.op in COMPOSITES.values():
+        body = bytearray()
+        for child in node.children:
+            body += encode(child, cond_ids, act_ids)
+        if len(body) > 0xFFFF:
+            raise TreeError(f"{node.line}: subtree larger than 65535 bytes")
+        return bytearray([node.op, len(body) & 0xFF, len(body) >> 8]) + body
+    if node.op == OP_CONDITION:
+        return bytearray([OP_CONDITION, cond_ids[node.arg]])
+    if node.op == OP_ACTION:
+        return bytearray([OP_ACTION, act_ids[node.arg]])
+    return bytearray([OP_WAIT, node.arg & 0xFF, node.arg >> 8])
+
+
+def count_nodes(node):
+    return 1 + sum(count_nodes(child) for child in node.children)
+
+
+# ===== OUTPUT =====
+
+def c_identifier(name):
+    ident = re.sub(r"[^0-9a-zA-Z_]", "_", name).strip("_").lower()
+    if not ident or ident[0].isdigit():
+        ident = "t_" + ident
+    return ident
+
+
+def write_outputs(base, trees, conditions, actions):
+    guard = c_identifier(os.path.basename(base)).upper() + "_H"
+    header = [
+        "// Generated by tools/bt_compiler.py - do not edit",
+        f"#ifndef {guard}",
+        f"#define {guard}",
+        "",
+        '#include "BehaviourTree.h"',
+        "",
+        "// Condition ids (index into BT_cfg_t.conditions)",
+        "enum {",
+    ]
+    header += [f"    BT_COND_{name.upper()} = {i}," for i, name in enumerate(conditions)]
+    header += ["    BT_COND_COUNT", "};", "", "// Action ids (index into BT_cfg_t.actions)", "enum {"]
+    header += [f"    BT_ACT_{name.upper()} = {i}," for i, name in enumerate(actions)]
+    header += ["    BT_ACT_COUNT", "};", ""]
+
+    source = [
+        "// Generated by tools/bt_compiler.py - do not edit",
+        f'#include "{os.path.basename(base)}.h"',
+        "",
+    ]
+    for name, data, nodes, src in trees:
+        header.append(f"// {os.path.basename(src)}: {nodes} nodes, {len(data)} bytes")
+        header.append(f"extern const BT_Tree_t BT_{name};")
+        header.append("")
+        source.append(f"static const uint8_t bt_{name}_code[{len(data)}] = {{")
+        for i in range(0, len(data), 12):
+            source.append("    " + " ".join(f"0x{b:02X}," for b in data[i:i + 12]))
+        source.append("};")
+        source.append(f'const BT_Tree_t BT_{name} = {{"{name}", bt_{name}_code, {len(data)}}};')
+        source.append("")
+    header.append(f"#endif // {guard}")
+
+    os.makedirs(os.path.dirname(os.path.abspath(base)), exist_ok=True)
+    with open(base + ".h", "w", encoding="utf-8") as f:
+        f.write("\n".join(header) + "\n")
+    with open(base + ".c", "w", encoding="utf-8") as f:
+        f.write("\n".join(source))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", required=True, help="output base path (no extension)")
+    parser.add_argument("trees", nargs="*", help=".bt tree files")
+    args = parser.parse_args()
+
+    try:
+        roots = []
+        for path in args.trees:
+            with open(path, "r", encoding="utf-8") as f:
+                root = parse_tree(f.read(), path)
+            check(root)
+            stem = os.path.splitext(os.path.basename(path))[0]
+            roots.append((c_identifier(stem), root, path))
+
+        conditions, actions = set(), set()
+        for _, root, _ in roots:
+            collect_names(root, conditions, actions)
+        conditions, actions = sorted(conditions), sorted(actions)
+        if len(conditions) > 255 or len(actions) > 255:
+            raise TreeError("more than 255 distinct conditions or actions")
+        cond_ids = {name: i for i, name in enumerate(conditions)}
+        act_ids = {name: i for i, name in enumerate(actions)}
+
+        trees = []
+        for name, root, path in roots:
+            data = encode(root, cond_ids, act_ids)
+            if len(data) > 0xFFFF:
+                raise TreeError(f"{path}: tree larger than 65535 bytes")
+            trees.append((name, data, count_nodes(root), path))
+    except (TreeError, OSError) as e:
+        print(f"bt_compiler: error: {e}", file=sys.stderr)
+        return 1
+
+    names = [t[0] for t in trees]
+    if len(set(names)) != len(names):
+        print("bt_compiler: error: duplicate tree names", file=sys.stderr)
+        return 1
+
+    write_outputs(args.output, trees, conditions, actions)
+    for name, data, nodes, _ in trees:
+        print(f"BT_{name}: {nodes} nodes -> {len(data)} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
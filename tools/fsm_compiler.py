@@ -0,0 +1,364 @@
+#!/usr/bin/env python3
+"""
+State machine compiler: .fsm descriptions -> state enums and dispatch tables.
+
+Each .fsm file describes one machine: its states, the events it reacts to,
+the transition table, and what each state looks like (sprite frames and
+animation) plus any other per-state bindings (LED effect, sound). The
+generated code replaces hand-written switches: the next state is one table
+lookup, and a state's name, sprites and effects are one array index.
+
+Text format - one item per line, '#' starts a comment:
+
+  machine Character CHAR          # type prefix, constant prefix
+  sprite 8x8 scale 4              # frame size in pixels, draw scale
+  bind led PWM_FX_Pattern_t PWM_Effects.h
+  bind sound uint8_t[] Tunes.h
+
+  state IDLE    label=IDLE led=led_fx_idle    frames=CharacterIDLE:5
+  state WALKING label=WALK led=led_fx_walking frames=CharacterWALK1:5,CharacterWALK2:5 period=10
+  state DASHING label=DASH led=led_fx_dashing frames=CharacterDASHING:6 sound=tune_dash
+
+  event MOVE
+  event STOP
+
+  IDLE    MOVE -> WALKING
+  *       STOP -> IDLE                # '*': from every state
+
+  machine  NAME PREFIX    types NAMEState_t, NAMEEvent_t, NAMEStateInfo_t;
+                          constants PREFIX_<state>, PREFIX_EV_<event>
+  sprite   WxH scale N    PREFIX_SPRITE_W/H/SCALE; frames are const uint8_t[H][W]
+  bind     FIELD TYPE HEADER
+                          adds 'const TYPE* FIELD' to the state info, values are
+                          the addresses of 'extern const TYPE' objects; TYPE[]
+                          binds arrays instead ('extern const TYPE name[]')
+  state    NAME key=value...
+                          label=TEXT      name for displays (default NAME)
+                          frames=SPRITE:COLOUR,...   drawn in turn (at least one)
+                          period=TICKS    ticks per frame when there are several
+                          FIELD=SYMBOL    a bound value (NULL when not given)
+  event    NAME
+  FROM EVENT -> TO        a transition; (state, event) pairs not listed keep
+                          the state. The first state is the initial one (0).
+
+Output (one header and source for all machines, e.g. for Character):
+  typedef enum { CHAR_IDLE, ..., CHAR_STATE_COUNT } CharacterState_t;
+  typedef enum { CHAR_EV_MOVE, ..., CHAR_EV_COUNT } CharacterEvent_t;
+  const uint8_t CHAR_TRANSITIONS[CHAR_STATE_COUNT][CHAR_EV_COUNT];
+  const CharacterStateInfo_t CHAR_STATES[CHAR_STATE_COUNT];
+  const char* const CHAR_EVENT_NAMES[CHAR_EV_COUNT];
+  CHAR_Next(state, event)   the table lookup
+
+Usage:
+  fsm_compiler.py -o <output base path> <fsm files...>
+  (writes <output>.c and <output>.h)
+"""
+
+import argparse
+import os
+import re
+import sys
+
+IDENT = r"[A-Za-z_][A-Za-z0-9_]*"
+
+
+class FsmError(Exception):
+    pass
+
+
+class Machine:
+    def __init__(self, path):
+        self.path = path
+        self.type = None
+        self.prefix = None
+        self.sprite = None          # (w, h, scale)
+        self.binds = []             # (field, type, is_array, header)
+        self.states = []            # (name, attrs, line)
+        self.events = []
+        self.transitions = []       # (from or '*', event, to, line)
+
+    def state_names(self):
+        return [s[0] for s in self.states]
+
+
+# ===== PARSER =====
+
+def parse_machine(text, path):
+    m = Machine(path)
+
+    for number, raw in enumerate(text.splitlines(), 1):
+        line = raw.split("#", 1)[0].strip()
+        if not line:
+            continue
+        words = line.split()
+        where = f"{path}:{number}"
+        keyword = words[0]
+
+        if keyword == "machine":
+            if len(words) != 3 or not all(re.fullmatch(IDENT, w) for w in words[1:]):
+                raise FsmError(f"{where}: expected 'machine TYPE PREFIX'")
+            m.type, m.prefix = words[1], words[2].upper()
+        elif keyword == "sprite":
+            match = re.fullmatch(r"sprite\s+(\d+)x(\d+)\s+scale\s+(\d+)", line)
+            if not match:
+                raise FsmError(f"{where}: expected 'sprite WxH scale N'")
+            m.sprite = tuple(int(x) for x in match.groups())
+        elif keyword == "bind":
+            if len(words) != 4 or not re.fullmatch(IDENT, words[1]) \
+                    or not re.fullmatch(IDENT + r"(\[\])?", words[2]):
+                raise FsmError(f"{where}: expected 'bind FIELD TYPE HEADER'")
+            is_array = words[2].endswith("[]")
+            m.binds.append((words[1], words[2].rstrip("[]"), is_array, words[3]))
+        elif keyword == "state":
+            if len(words) < 2 or not re.fullmatch(IDENT, words[1]):
+                raise FsmError(f"{where}: expected 'state NAME key=value...'")
+            attrs = {}
+            for item in words[2:]:
+                key, eq, value = item.partition("=")
+                if not eq or not value:
+                    raise FsmError(f"{where}: '{item}' is not key=value")
+                attrs[key] = value
+            m.states.append((words[1].upper(), attrs, where))
+        elif keyword == "event":
+            if len(words) != 2 or not re.fullmatch(IDENT, words[1]):
+                raise FsmError(f"{where}: expected 'event NAME'")
+            m.events.append(words[1].upper())
+        elif len(words) == 4 and words[2] == "->":
+            m.transitions.append((words[0].upper(), words[1].upper(), words[3].upper(), where))
+        else:
+            raise FsmError(f"{where}: unknown line '{line}'")
+
+    check(m)
+    return m
+
+
+def check(m):
+    if not m.type:
+        raise FsmError(f"{m.path}: missing 'machine TYPE PREFIX'")
+    if not m.sprite:
+        raise FsmError(f"{m.path}: missing 'sprite WxH scale N'")
+    if not m.states or not m.events:
+        raise FsmError(f"{m.path}: needs at least one state and one event")
+    if len(m.states) > 255:
+        raise FsmError(f"{m.path}: more than 255 states")
+
+    states = m.state_names()
+    for names, what in ((states, "state"), (m.events, "event"), ([b[0] for b in m.binds], "bind")):
+        dupes = {n for n in names if names.count(n) > 1}
+        if dupes:
+            raise FsmError(f"{m.path}: duplicate {what} {', '.join(sorted(dupes))}")
+
+    fields = {b[0] for b in m.binds}
+    for name, attrs, where in m.states:
+        for key, value in attrs.items():
+            if key in ("label", "frames", "period") or key in fields:
+                continue
+            raise FsmError(f"{where}: unknown attribute '{key}'")
+        if "frames" not in attrs:
+            raise FsmError(f"{where}: state {name} has no frames")
+        for frame in attrs["frames"].split(","):
+            if not re.fullmatch(IDENT + r":\d+", frame):
+                raise FsmError(f"{where}: frame '{frame}' is not SPRITE:COLOUR")
+        if "period" in attrs and not attrs["period"].isdigit():
+            raise FsmError(f"{where}: period must be a number of ticks")
+        if len(frames(attrs)) > 1 and int(attrs.get("period", "0")) == 0:
+            raise FsmError(f"{where}: state {name} has several frames but no period")
+        for field in fields & attrs.keys():
+            if not re.fullmatch(IDENT, attrs[field]):
+                raise FsmError(f"{where}: '{attrs[field]}' is not a symbol")
+
+    seen = {}
+    for source, event, target, where in m.transitions:
+        if source != "*" and source not in states:
+            raise FsmError(f"{where}: unknown state {source}")
+        if target not in states:
+            raise FsmError(f"{where}: unknown state {target}")
+        if event not in m.events:
+            raise FsmError(f"{where}: unknown event {event}")
+        # A specific transition overrides a '*' one; two of the same kind conflict
+        key = (source, event)
+        if key in seen:
+            raise FsmError(f"{where}: {source} already has a transition on {event} ({seen[key]})")
+        seen[key] = where
+
+
+def frames(attrs):
+    return [(f.split(":")[0], int(f.split(":")[1])) for f in attrs["frames"].split(",")]
+
+
+def transition_table(m):
+    """next[state][event], starting from 'stay'; '*' rows first, specific ones win."""
+    states = m.state_names()
+    table = [[i] * len(m.events) for i in range(len(states))]
+    for wildcard in (True, False):
+        for source, event, target, _ in m.transitions:
+            if (source == "*") != wildcard:
+                continue
+            for s in (states if wildcard else [source]):
+                table[states.index(s)][m.events.index(event)] = states.index(target)
+    return table
+
+
+def load(paths):
+    machines = []
+    for path in paths:
+        with open(path, "r", encoding="utf-8") as f:
+            machines.append(parse_machine(f.read(), path))
+    for names, what in (([m.type for m in machines], "machine"), ([m.prefix for m in machines], "prefix")):
+        if len(set(names)) != len(names):
+            raise FsmError(f"duplicate {what} names")
+    return machines
+
+
+# ===== OUTPUT =====
+
+def c_identifier(name):
+    ident = re.sub(r"[^0-9a-zA-Z_]", "_", name).strip("_").lower()
+    if not ident or ident[0].isdigit():
+        ident = "t_" + ident
+    return ident
+
+
+def c_string(text):
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def write_outputs(base, machines):
+    guard = c_identifier(os.path.basename(base)).upper() + "_H"
+    headers = []
+    for m in machines:
+        for bind in m.binds:
+            if bind[3] not in headers:
+                headers.append(bind[3])
+
+    header = [
+        "// Generated by tools/fsm_compiler.py - do not edit",
+        f"#ifndef {guard}",
+        f"#define {guard}",
+        "",
+        "#include <stdint.h>",
+        "#include <stddef.h>",
+    ]
+    header += [f'#include "{h}"' for h in headers]
+    header += [
+        "",
+        "// One animation frame: a sprite drawn in one colour",
+        "typedef struct {",
+        "    const uint8_t* sprite;      // Rows as for LCD_Draw_Sprite_Colour_Scaled()",
+        "    uint8_t colour;             // Palette index",
+        "} Fsm_Frame_t;",
+        "",
+    ]
+    source = [
+        "// Generated by tools/fsm_compiler.py - do not edit",
+        f'#include "{os.path.basename(base)}.h"',
+        "",
+    ]
+
+    for m in machines:
+        p, t = m.prefix, m.type
+        states = m.state_names()
+        w, h, scale = m.sprite
+        table = transition_table(m)
+
+        header.append(f"// {os.path.basename(m.path)}: {len(states)} states, {len(m.events)} events, "
+                      f"{len(states) * len(m.events)}-byte transition table")
+        header.append("typedef enum {")
+        header += [f"    {p}_{s} = {i}," for i, s in enumerate(states)]
+        header += [f"    {p}_STATE_COUNT", f"}} {t}State_t;", "", "typedef enum {"]
+        header += [f"    {p}_EV_{e} = {i}," for i, e in enumerate(m.events)]
+        header += [f"    {p}_EV_COUNT", f"}} {t}Event_t;", ""]
+        header += [
+            f"#define {p}_SPRITE_W {w}",
+            f"#define {p}_SPRITE_H {h}",
+            f"#define {p}_SPRITE_SCALE {scale}",
+            "",
+            "typedef struct {",
+            "    const char* name;           // Label for displays",
+            "    const Fsm_Frame_t* frames;  // Animation frames, drawn in turn",
+            "    uint8_t frame_count;",
+            "    uint8_t period;             // Ticks per frame (0 = one still frame)",
+        ]
+        header += [f"    const {b[1]}* {b[0]};" for b in m.binds]
+        header += [
+            f"}} {t}StateInfo_t;",
+            "",
+            f"// Next state for each (state, event): the same state when the event changes nothing",
+            f"extern const uint8_t {p}_TRANSITIONS[{p}_STATE_COUNT][{p}_EV_COUNT];",
+            f"extern const {t}StateInfo_t {p}_STATES[{p}_STATE_COUNT];",
+            f"extern const char* const {p}_EVENT_NAMES[{p}_EV_COUNT];",
+            "",
+            f"static inline {t}State_t {p}_Next({t}State_t state, {t}Event_t event)",
+            "{",
+            f"    return ({t}State_t){p}_TRANSITIONS[state][event];",
+            "}",
+            "",
+        ]
+
+        # Symbols the tables point at, defined elsewhere in the firmware
+        sprites = sorted({name for _, attrs, _ in m.states for name, _ in frames(attrs)})
+        source += [f"extern const uint8_t {s}[{h}][{w}];" for s in sprites]
+        for field, ctype, is_array, _ in m.binds:
+            symbols = sorted({attrs[field] for _, attrs, _ in m.states if field in attrs})
+            source += [f"extern const {ctype} {s}{'[]' if is_array else ''};" for s in symbols]
+        source.append("")
+
+        for name, attrs, _ in m.states:
+            source.append(f"static const Fsm_Frame_t {p.lower()}_{name.lower()}_frames[] = {{")
+            source += [f"    {{&{s}[0][0], {c}}}," for s, c in frames(attrs)]
+            source.append("};")
+        source.append("")
+
+        source.append(f"const uint8_t {p}_TRANSITIONS[{p}_STATE_COUNT][{p}_EV_COUNT] = {{")
+        source.append("    //" + "".join(f" {e}" for e in m.events))
+        for i, row in enumerate(table):
+            cells = ", ".join(f"{p}_{states[n]}" for n in row)
+            source.append(f"    [{p}_{states[i]}] = {{{cells}}},")
+        source += ["};", ""]
+
+        source.append(f"const {t}StateInfo_t {p}_STATES[{p}_STATE_COUNT] = {{")
+        for name, attrs, _ in m.states:
+            fields = [c_string(attrs.get("label", name)),
+                      f"{p.lower()}_{name.lower()}_frames",
+                      str(len(frames(attrs))),
+                      attrs.get("period", "0")]
+            for field, _, is_array, _ in m.binds:
+                value = attrs.get(field)
+                fields.append("NULL" if value is None else value if is_array else f"&{value}")
+            source.append(f"    [{p}_{name}] = {{{', '.join(fields)}}},")
+        source += ["};", ""]
+
+        source.append(f"const char* const {p}_EVENT_NAMES[{p}_EV_COUNT] = {{")
+        source += [f"    {c_string(e)}," for e in m.events]
+        source += ["};", ""]
+
+    header.append(f"#endif // {guard}")
+
+    os.makedirs(os.path.dirname(os.path.abspath(base)), exist_ok=True)
+    with open(base + ".h", "w", encoding="utf-8") as f:
+        f.write("\n".join(header) + "\n")
+    with open(base + ".c", "w", encoding="utf-8") as f:
+        f.write("\n".join(source))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", required=True, help="output base path (no extension)")
+    parser.add_argument("machines", nargs="*", help=".fsm description files")
+    args = parser.parse_args()
+
+    try:
+        machines = load(args.machines)
+    except (FsmError, OSError) as e:
+        print(f"fsm_compiler: error: {e}", file=sys.stderr)
+        return 1
+
+    write_outputs(args.output, machines)
+    for m in machines:
+        print(f"{m.type}: {len(m.states)} states x {len(m.events)} events")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
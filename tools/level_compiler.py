@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""
+Level compiler for the LevelStream module.
+
+Converts text levels (.lvl) into run-length compressed 16x16-tile chunks
+that LevelStream decompresses from flash into RAM slots near the view.
+One level per file; the level is named after the file (cave.lvl -> LEVEL_cave).
+
+Text format - one character per tile, one line per row of tiles. Lines
+starting with ';' are comments. Rows shorter than the longest are padded
+with empty tiles.
+
+  .  or space   empty
+  #             wall        (solid, grey)
+  =             platform    (solid, brown)
+  +             gold block  (solid, gold)
+  ,             grass       (background, green)
+  ~             water       (background, navy)
+
+Tile byte (see LevelStream.h): bit 7 = solid, bits 0-3 = LCD colour index.
+
+Chunk compression, per chunk of 256 tiles in row-major order:
+  0x00-0x7F n        n + 1 literal tiles follow
+  0x80-0xFF n t      tile t repeated n - 125 times (3..130)
+
+Tiles of edge chunks beyond the level are empty.
+
+Usage:
+  level_compiler.py -o <output base path> <level files...>
+  (writes <output>.c and <output>.h)
+"""
+
+import argparse
+import os
+import re
+import sys
+
+CHUNK = 16
+MAX_CHUNKS = 256    # Must match LEVELSTREAM_MAX_CHUNKS in LevelStream.h
+SOLID = 0x80
+
+TILES = {
+    ".": 0x00,
+    " ": 0x00,
+    "#": SOLID | 13,
+    "=": SOLID | 12,
+    "+": SOLID | 10,
+    ",": 3,
+    "~": 9,
+}
+
+MAX_LITERAL = 128
+MIN_RUN = 3
+MAX_RUN = 130
+
+
+class LevelError(Exception):
+    pass
+
+
+# ===== PARSER =====
+
+def parse_level(text, path):
+    rows = []
+    for number, raw in enumerate(text.splitlines(), 1):
+        if raw.startswith(";"):
+            continue
+        line = raw.rstrip("\r\n")
+        row = []
+        for column, char in enumerate(line, 1):
+            if char not in TILES:
+                raise LevelError(f"{path}:{number}:{column}: unknown tile '{char}'")
+            row.append(TILES[char])
+        rows.append(row)
+
+    while rows and not rows[-1]:
+        rows.pop()
+    if not rows:
+        raise LevelError(f"{path}: empty level")
+    width = max(len(row) for row in rows)
+    height = len(rows)
+    if width > 0x7FFF or height > 0x7FFF:
+        raise LevelError(f"{path}: level larger than 32767 tiles")
+    for row in rows:
+        row.extend([0] * (width - len(row)))
+    return width, height, rows
+
+
+# ===== ENCODER =====
+
+def compress(tiles):
+    out = bytearray()
+    literal = bytearray()
+
+    def flush():
+        if literal:
+            out.append(len(literal) - 1)
+            out.extend(literal)
+            literal.clear()
+
+    i = 0
+    while i < len(tiles):
+        run = 1
+        while i + run < len(tiles) and run < MAX_RUN and tiles[i + run] == tiles[i]:
+            run += 1
+        if run >= MIN_RUN:
+            flush()
+            out.append(run + 125)
+            out.append(tiles[i])
+            i += run
+        else:
+            literal.append(tiles[i])
+            if len(literal) == MAX_LITERAL:
+                flush()
+            i += 1
+    flush()
+    return out
+
+
+def decompress(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        control = data[i]
+        i += 1
+        if control < 128:
+            out.extend(data[i:i + control + 1])
+            i += control + 1
+        else:
+            out.extend([data[i]] * (control - 125))
+            i += 1
+    return out
+
+
+def encode(width, height, rows, path):
+    chunks_w = (width + CHUNK - 1) // CHUNK
+    chunks_h = (height + CHUNK - 1) // CHUNK
+    if chunks_w * chunks_h > MAX_CHUNKS:
+        raise LevelError(f"{path}: {chunks_w * chunks_h} chunks, at most {MAX_CHUNKS}")
+    if chunks_w > 255 or chunks_h > 255:
+        raise LevelError(f"{path}: more than 255 chunks across or down")
+
+    data = bytearray()
+    offsets = []
+    for cy in range(chunks_h):
+        for cx in range(chunks_w):
+            tiles = bytearray()
+            for y in range(cy * CHUNK, cy * CHUNK + CHUNK):
+                for x in range(cx * CHUNK, cx * CHUNK + CHUNK):
+                    tiles.append(rows[y][x] if y < height and x < width else 0)
+            packed = compress(tiles)
+            if decompress(packed) != tiles:
+                raise LevelError(f"{path}: internal error compressing chunk ({cx}, {cy})")
+            offsets.append(len(data))
+            data += packed
+    offsets.append(len(data))
+    return chunks_w, chunks_h, offsets, data
+
+
+# ===== OUTPUT =====
+
+def c_identifier(name):
+    ident = re.sub(r"[^0-9a-zA-Z_]", "_", name).strip("_").lower()
+    if not ident or ident[0].isdigit():
+        ident = "l_" + ident
+    return ident
+
+
+def write_outputs(base, levels):
+    guard = c_identifier(os.path.basename(base)).upper() + "_H"
+    header = [
+        "// Generated by tools/level_compiler.py - do not edit",
+        f"#ifndef {guard}",
+        f"#define {guard}",
+        "",
+        '#include "LevelStream.h"',
+        "",
+    ]
+    source = [
+        "// Generated by tools/level_compiler.py - do not edit",
+        f'#include "{os.path.basename(base)}.h"',
+        "",
+    ]
+    for name, width, height, chunks_w, chunks_h, offsets, data, src in levels:
+        raw = chunks_w * chunks_h * CHUNK * CHUNK
+        header.append(f"// {os.path.basename(src)}: {width}x{height} tiles, {chunks_w}x{chunks_h} chunks, "
+                      f"{len(data)} bytes ({raw} uncompressed)")
+        header.append(f"#define LEVEL_{name.upper()}_WIDTH {width}")
+        header.append(f"#define LEVEL_{name.upper()}_HEIGHT {height}")
+        header.append(f"extern const LevelStream_Level_t LEVEL_{name};")
+        header.append("")
+
+        source.append(f"static const uint32_t level_{name}_offsets[{len(offsets)}] = {{")
+        for i in range(0, len(offsets), 8):
+            source.append("    " + " ".join(f"{o}," for o in offsets[i:i + 8]))
+        source.append("};")
+        source.append(f"static const uint8_t level_{name}_data[{len(data)}] = {{")
+        for i in range(0, len(data), 12):
+            source.append("    " + " ".join(f"0x{b:02X}," for b in data[i:i + 12]))
+        source.append("};")
+        source.append(f"const LevelStream_Level_t LEVEL_{name} = {{")
+        source.append(f'    "{name}", {width}, {height}, {chunks_w}, {chunks_h},')
+        source.append(f"    level_{name}_offsets, level_{name}_data")
+        source.append("};")
+        source.append("")
+    header.append(f"#endif // {guard}")
+
+    os.makedirs(os.path.dirname(os.path.abspath(base)), exist_ok=True)
+    with open(base + ".h", "w", encoding="utf-8") as f:
+        f.write("\n".join(header) + "\n")
+    with open(base + ".c", "w", encoding="utf-8") as f:
+        f.write("\n".join(source))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", required=True, help="output base path (no extension)")
+    parser.add_argument("levels", nargs="*", help=".lvl level files")
+    args = parser.parse_args()
+
+    levels = []
+    try:
+        for path in args.levels:
+            with open(path, "r", encoding="utf-8") as f:
+                width, height, rows = parse_level(f.read(), path)
+            name = c_identifier(os.path.splitext(os.path.basename(path))[0])
+            chunks_w, chunks_h, offsets, data = encode(width, height, rows, path)
+            levels.append((name, width, height, chunks_w, chunks_h, offsets, data, path))
+    except (LevelError, OSError) as e:
+        print(f"level_compiler: error: {e}", file=sys.stderr)
+        return 1
+
+    names = [level[0] for level in levels]
+    if len(set(names)) != len(names):
+        print("level_compiler: error: duplicate level names", file=sys.stderr)
+        return 1
+
+    write_outputs(args.output, levels)
+    for name, width, height, chunks_w, chunks_h, _, data, _ in levels:
+        print(f"LEVEL_{name}: {width}x{height} tiles, {chunks_w * chunks_h} chunks -> {len(data)} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,306 @@
+#!/usr/bin/env python3
+"""
+Music compiler for the Buzzer library.
+
+Converts RTTTL (.rtttl / .txt) and simple Standard MIDI (.mid) files into
+byte-packed, delta-encoded note streams that buzzer_tune_start() can play.
+
+Stream format (see Buzzer.h for the decoder side):
+  byte 0-1   : milliseconds per 1/32 note, little-endian uint16
+  event byte : high nibble = duration code (index into BUZZER_TUNE_DURATIONS)
+               low nibble  = signed pitch delta in semitones (-7..+7),
+                             0x8 means rest (pitch unchanged)
+  0xF0       : end of stream
+  0xF1 nn    : set absolute pitch to MIDI note nn (no duration)
+  0xF2       : tie - the next event extends the current note without retrigger
+
+Typical notes cost one byte each, compared to 4 bytes for a Buzzer_Note_t
+enum plus a separate duration array.
+
+Usage:
+  music_compiler.py -o <output base path> <tune files...>
+  (writes <output>.c and <output>.h)
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+# Duration codes in 1/32 notes - must match BUZZER_TUNE_DURATIONS in Buzzer.c
+DURATIONS = [1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96]
+
+ESC_END = 0xF0
+ESC_PITCH = 0xF1
+ESC_TIE = 0xF2
+REST_NIBBLE = 0x8
+
+MIDI_MIN = 24   # C1
+MIDI_MAX = 119  # B8
+
+NOTE_INDEX = {"c": 0, "d": 2, "e": 4, "f": 5, "g": 7, "a": 9, "b": 11}
+
+
+class TuneError(Exception):
+    pass
+
+
+# ===== PARSERS =====
+# Both parsers return (name, bpm, [(midi_note or None for rest, length in 1/32 notes), ...])
+
+def parse_rtttl(text, path):
+    text = "".join(text.split())
+    parts = text.split(":")
+    if len(parts) != 3:
+        raise TuneError(f"{path}: expected 'name:defaults:notes'")
+    name, defaults, notes = parts
+
+    d, o, b = 4, 6, 63
+    for item in filter(None, defaults.split(",")):
+        key, _, value = item.partition("=")
+        if key == "d":
+            d = int(value)
+        elif key == "o":
+            o = int(value)
+        elif key == "b":
+            b = int(value)
+        else:
+            raise TuneError(f"{path}: unknown default '{item}'")
+
+    note_re = re.compile(r"^(\d+)?([a-gp])(#)?(\.)?(\d)?(\.)?$", re.IGNORECASE)
+    events = []
+    for token in filter(None, notes.split(",")):
+        m = note_re.match(token)
+        if not m:
+            raise TuneError(f"{path}: bad note '{token}'")
+        dur = int(m.group(1)) if m.group(1) else d
+        if dur not in (1, 2, 4, 8, 16, 32):
+            raise TuneError(f"{path}: bad duration in '{token}'")
+        length = 32 // dur
+        if m.group(4) or m.group(6):
+            length = length * 3 // 2
+        letter = m.group(2).lower()
+        if letter == "p":
+            events.append((None, length))
+            continue
+        octave = int(m.group(5)) if m.group(5) else o
+        midi = (octave + 1) * 12 + NOTE_INDEX[letter] + (1 if m.group(3) else 0)
+        events.append((midi, length))
+    return name, b, events
+
+
+def _read_varlen(data, pos):
+    value = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value = (value << 7) | (byte & 0x7F)
+        if not byte & 0x80:
+            return value, pos
+
+
+def parse_midi(data, path):
+    if data[:4] != b"MThd":
+        raise TuneError(f"{path}: not a MIDI file")
+    hdr_len, _fmt, ntrks, division = struct.unpack(">IHHH", data[4:14])
+    if division & 0x8000:
+        raise TuneError(f"{path}: SMPTE time division is not supported")
+    pos = 8 + hdr_len
+
+    tempo_us = 500000  # 120 bpm default
+    tempo_set = False
+    note_events = []   # (tick, order, is_on, note)
+    order = 0
+    for _ in range(ntrks):
+        if data[pos:pos + 4] != b"MTrk":
+            raise TuneError(f"{path}: missing track chunk")
+        trk_len = struct.unpack(">I", data[pos + 4:pos + 8])[0]
+        trk = data[pos + 8:pos + 8 + trk_len]
+        pos += 8 + trk_len
+
+        i, tick, status = 0, 0, 0
+        while i < len(trk):
+            delta, i = _read_varlen(trk, i)
+            tick += delta
+            if trk[i] & 0x80:
+                status = trk[i]
+                i += 1
+            kind = status & 0xF0
+            if status == 0xFF:
+                meta = trk[i]
+                length, i = _read_varlen(trk, i + 1)
+                if meta == 0x51 and not tempo_set:
+                    tempo_us = int.from_bytes(trk[i:i + 3], "big")
+                    tempo_set = True
+                i += length
+            elif status in (0xF0, 0xF7):
+                length, i = _read_varlen(trk, i)
+                i += length
+            elif kind in (0x80, 0x90):
+                note, vel = trk[i], trk[i + 1]
+                i += 2
+                is_on = kind == 0x90 and vel > 0
+                note_events.append((tick, order, is_on, note))
+                order += 1
+            elif kind in (0xC0, 0xD0):
+                i += 1
+            else:
+                i += 2
+
+    # Monophonic reduction: last note on wins, its note off starts a rest
+    note_events.sort()
+    segments = []  # (start tick, note or None)
+    current = None
+    for tick, _, is_on, note in note_events:
+        if is_on:
+            current = note
+        elif note == current:
+            current = None
+        else:
+            continue
+        if segments and segments[-1][0] == tick:
+            segments[-1] = (tick, current)
+        else:
+            segments.append((tick, current))
+
+    ticks_per_32nd = division / 8.0
+    events = []
+    for (start, note), (end, _) in zip(segments, segments[1:]):
+        length = max(1, round((end - start) / ticks_per_32nd))
+        events.append((note, length))
+    while events and events[0][0] is None:
+        events.pop(0)
+
+    bpm = max(1, round(60000000 / tempo_us))
+    return None, bpm, events
+
+
+# ===== ENCODER =====
+
+def split_length(length):
+    """Split a length in 1/32 notes into duration codes, largest first."""
+    codes = []
+    while length > 0:
+        for code in range(len(DURATIONS) - 1, -1, -1):
+            if DURATIONS[code] <= length:
+                codes.append(code)
+                length -= DURATIONS[code]
+                break
+    return codes
+
+
+def encode(bpm, events, path):
+    ms_per_32nd = round(60000 / (bpm * 8))
+    if not 1 <= ms_per_32nd <= 0xFFFF:
+        raise TuneError(f"{path}: tempo {bpm} bpm out of range")
+
+    out = bytearray(struct.pack("<H", ms_per_32nd))
+    pitch = None
+    for note, length in events:
+        codes = split_length(length)
+        if note is None:
+            for code in codes:
+                out.append((code << 4) | REST_NIBBLE)
+            continue
+
+        if not MIDI_MIN <= note <= MIDI_MAX:
+            raise TuneError(f"{path}: note {note} outside MIDI {MIDI_MIN}..{MIDI_MAX}")
+        delta = 0 if pitch is None else note - pitch
+        if pitch is None or not -7 <= delta <= 7:
+            out += bytes((ESC_PITCH, note))
+            delta = 0
+        pitch = note
+
+        for n, code in enumerate(codes):
+            if n > 0:
+                out.append(ESC_TIE)
+            out.append((code << 4) | (delta & 0x0F))
+            delta = 0
+    out.append(ESC_END)
+    return out
+
+
+# ===== OUTPUT =====
+
+def c_identifier(name):
+    ident = re.sub(r"[^0-9a-zA-Z_]", "_", name).strip("_").lower()
+    if not ident or ident[0].isdigit():
+        ident = "t_" + ident
+    return ident
+
+
+def compile_file(path):
+    stem = os.path.splitext(os.path.basename(path))[0]
+    if path.lower().endswith((".mid", ".midi")):
+        with open(path, "rb") as f:
+            _, bpm, events = parse_midi(f.read(), path)
+    else:
+        with open(path, "r", encoding="utf-8") as f:
+            _, bpm, events = parse_rtttl(f.read(), path)
+    if not events:
+        raise TuneError(f"{path}: no notes found")
+    return c_identifier(stem), encode(bpm, events, path), len(events)
+
+
+def write_outputs(base, tunes, sources):
+    guard = c_identifier(os.path.basename(base)).upper() + "_H"
+    header = [
+        "// Generated by tools/music_compiler.py - do not edit",
+        f"#ifndef {guard}",
+        f"#define {guard}",
+        "",
+        "#include <stdint.h>",
+        "",
+    ]
+    source = [
+        "// Generated by tools/music_compiler.py - do not edit",
+        f'#include "{os.path.basename(base)}.h"',
+        "",
+    ]
+    for (name, data, count), src in zip(tunes, sources):
+        header.append(f"// {os.path.basename(src)}: {count} notes, {len(data)} bytes")
+        header.append(f"extern const uint8_t tune_{name}[{len(data)}];")
+        header.append(f"#define TUNE_{name.upper()}_SIZE {len(data)}u")
+        header.append("")
+        source.append(f"const uint8_t tune_{name}[{len(data)}] = {{")
+        for i in range(0, len(data), 12):
+            source.append("    " + " ".join(f"0x{b:02X}," for b in data[i:i + 12]))
+        source.append("};")
+        source.append("")
+    header.append(f"#endif // {guard}")
+
+    os.makedirs(os.path.dirname(os.path.abspath(base)), exist_ok=True)
+    with open(base + ".h", "w", encoding="utf-8") as f:
+        f.write("\n".join(header) + "\n")
+    with open(base + ".c", "w", encoding="utf-8") as f:
+        f.write("\n".join(source))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", required=True, help="output base path (no extension)")
+    parser.add_argument("tunes", nargs="*", help="RTTTL or MIDI files")
+    args = parser.parse_args()
+
+    try:
+        tunes = [compile_file(path) for path in args.tunes]
+    except (TuneError, OSError, IndexError, struct.error) as e:
+        print(f"music_compiler: error: {e}", file=sys.stderr)
+        return 1
+
+    names = [t[0] for t in tunes]
+    if len(set(names)) != len(names):
+        print("music_compiler: error: duplicate tune names", file=sys.stderr)
+        return 1
+
+    write_outputs(args.output, tunes, args.tunes)
+    for (name, data, count) in tunes:
+        print(f"tune_{name}: {count} notes -> {len(data)} bytes "
+              f"({count * 8 / len(data):.1f}x smaller than a {{Buzzer_Note_t, uint16_t ms}} table)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
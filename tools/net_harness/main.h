@@ -0,0 +1,88 @@
+#ifndef NET_HARNESS_MAIN_H
+#define NET_HARNESS_MAIN_H
+
+/**
+ * @file main.h
+ * @brief Host stand-in for the HAL, just enough for Netcode.c and Snapshot.c
+ *
+ * Registers are plain structs: the harness plays the UART hardware by
+ * setting ISR/RDR and reading TDR around Net_UART_IRQHandler().
+ */
+
+#include <stdint.h>
+
+typedef int IRQn_Type;
+
+typedef struct {
+    volatile uint32_t CR1;
+    volatile uint32_t ISR;
+    volatile uint32_t ICR;
+    volatile uint32_t RDR;
+    volatile uint32_t TDR;
+} USART_TypeDef;
+
+#define USART_CR1_RXNEIE (1u << 5)
+#define USART_CR1_TXEIE (1u << 7)
+#define USART_ISR_ORE (1u << 3)
+#define USART_ISR_RXNE (1u << 5)
+#define USART_ISR_TXE (1u << 7)
+#define USART_ICR_ORECF (1u << 3)
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    volatile uint32_t AHB1ENR;
+} RCC_TypeDef;
+
+typedef struct {
+    volatile uint32_t CCR;
+    volatile uint32_t CNDTR;
+    volatile uint32_t CPAR;
+    volatile uint32_t CMAR;
+} DMA_Channel_TypeDef;
+
+extern DWT_Type harness_dwt;
+extern CoreDebug_Type harness_core_debug;
+extern RCC_TypeDef harness_rcc;
+
+#define DWT (&harness_dwt)
+#define CoreDebug (&harness_core_debug)
+#define RCC (&harness_rcc)
+
+#define DWT_CTRL_CYCCNTENA_Msk 1u
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+#define RCC_AHB1ENR_DMA1EN 1u
+#define RCC_AHB1ENR_DMA2EN 2u
+#define DMA_CCR_EN 1u
+#define DMA_CCR_PINC (1u << 6)
+#define DMA_CCR_MINC (1u << 7)
+#define DMA_CCR_PSIZE_1 (1u << 9)
+#define DMA_CCR_MSIZE_1 (1u << 11)
+#define DMA_CCR_PL_0 (1u << 12)
+#define DMA_CCR_MEM2MEM (1u << 14)
+
+#define __DMB() ((void)0)
+
+static inline void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t pre, uint32_t sub)
+{
+    (void)irq;
+    (void)pre;
+    (void)sub;
+}
+
+static inline void HAL_NVIC_EnableIRQ(IRQn_Type irq)
+{
+    (void)irq;
+}
+
+uint32_t HAL_GetTick(void);
+void Error_Handler(void);
+
+#endif // NET_HARNESS_MAIN_H
@@ -0,0 +1,278 @@
+/**
+ * @file net_harness.c
+ * @brief Host test of the Netcode protocol: two boards over a lossy in-memory link
+ *
+ * Runs Netcode.c and Snapshot.c unchanged on the host, against the stand-in
+ * main.h next to this file. Each board has its own copy of a small
+ * deterministic game, and the bytes one board's UART sends reach the other
+ * 1-4 ticks later, a few of them dropped. The scenarios run one after the
+ * other:
+ * - join: board 1 starts 13 ticks after board 0
+ * - rejoin: board 1 leaves (Net_Stop) and starts again while board 0 runs,
+ *   sooner than NET_TIMEOUT_TICKS, so board 0 must follow the new session
+ * - cable cut: nothing crosses the link for longer than NET_TIMEOUT_TICKS
+ * After each one both boards must be running and advancing, must have
+ * compared checksums with no desync, and Net_MeasureResim() must reproduce
+ * the current state.
+ *
+ * Build and run from the repository root:
+ * @code
+ * gcc -std=gnu11 -Wall -Wno-pointer-to-int-cast -Itools/net_harness -INetcode -ISnapshot -ITrace \
+ *     tools/net_harness/net_harness.c Netcode/Netcode.c Snapshot/Snapshot.c -o net_harness
+ * ./net_harness [seed] [dropped bytes per 1000]
+ * @endcode
+ * The exit status is 0 if every scenario passed. Up to about 20 dropped bytes
+ * per 1000 the boards still keep up with the tick; past that most packets are
+ * lost, the input window stalls and "frames not advancing" is expected.
+ */
+
+#include "Netcode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BOARDS 2
+#define LINK_SIZE 65536             // Bytes in flight per direction (power of two)
+
+DWT_Type harness_dwt;
+CoreDebug_Type harness_core_debug;
+RCC_TypeDef harness_rcc;
+
+uint32_t HAL_GetTick(void)
+{
+    return 0;
+}
+
+void Error_Handler(void)
+{
+    printf("Error_Handler\n");
+    exit(2);
+}
+
+// ===== GAME =====
+
+typedef struct {
+    int32_t x[NET_PLAYERS];
+    int32_t y[NET_PLAYERS];
+    uint32_t hash;                  // Every input so far, in order
+    uint8_t flags;                  // Odd size: leaves padding in the snapshot slot
+} Game_t;
+
+static Game_t games[BOARDS];
+static uint8_t current;             // Board whose Netcode is running
+
+static void simulate(const Net_Input_t inputs[NET_PLAYERS])
+{
+    Game_t* game = &games[current];
+
+    for (uint8_t p = 0; p < NET_PLAYERS; p++) {
+        game->x[p] += (int32_t)(inputs[p] & 3u) - 1;
+        game->y[p] += (int32_t)((inputs[p] >> 2) & 3u) - 1;
+        game->hash = game->hash * 31u + inputs[p] + 7u * p;
+    }
+    game->flags ^= inputs[0];
+}
+
+static void restart(void)
+{
+    memset(&games[current], 0, sizeof(games[current]));
+}
+
+// ===== BOARDS =====
+
+static Snapshot_Region_t regions[BOARDS][1];
+static uint8_t slots[BOARDS][NET_SNAPSHOTS * 32] __attribute__((aligned(4)));
+static Snapshot_cfg_t snapshots[BOARDS];
+static USART_TypeDef uarts[BOARDS];
+static Net_cfg_t nets[BOARDS];
+static uint8_t active[BOARDS];      // Net_Tick() is called each tick
+
+static void boards_init(void)
+{
+    for (uint8_t b = 0; b < BOARDS; b++) {
+        regions[b][0].ptr = &games[b];
+        regions[b][0].size = sizeof(Game_t);
+        snapshots[b] = (Snapshot_cfg_t){
+            .regions = regions[b],
+            .region_count = 1,
+            .slots = slots[b],
+            .slot_size = 32,
+            .slot_count = NET_SNAPSHOTS,
+            .dma_channel = NULL,
+            .setup_done = 0
+        };
+        // Slot memory is not cleared on the target (NOLOAD SRAM2)
+        memset(slots[b], 0x11 * (b + 1), sizeof(slots[b]));
+        Snapshot_Init(&snapshots[b]);
+
+        nets[b] = (Net_cfg_t){
+            .uart = &uarts[b],
+            .irqn = 0,
+            .snapshot = &snapshots[b],
+            .simulate = simulate,
+            .restart = restart,
+            .local_id = 0x1000u + 7u * b,
+            .setup_done = 0
+        };
+        current = b;
+        Net_Init(&nets[b]);
+    }
+}
+
+static void board_start(uint8_t b)
+{
+    current = b;
+    Net_Start(&nets[b]);
+    active[b] = 1;
+}
+
+static void board_stop(uint8_t b)
+{
+    Net_Stop(&nets[b]);
+    active[b] = 0;
+}
+
+// ===== LINK =====
+
+typedef struct {
+    uint32_t arrival[LINK_SIZE];    // Tick the byte reaches the other board
+    uint8_t bytes[LINK_SIZE];
+    uint32_t head;
+    uint32_t tail;
+} Link_t;
+
+static Link_t links[BOARDS];        // links[b]: bytes on their way to board b
+static uint8_t link_up = 1;
+static uint16_t drop_per_mille;
+static uint32_t tick;
+
+// Bytes that have arrived go through the receiving board's UART interrupt
+static void link_deliver(uint8_t b)
+{
+    Link_t* link = &links[b];
+
+    while (link->tail != link->head && link->arrival[link->tail & (LINK_SIZE - 1)] <= tick) {
+        uarts[b].ISR = USART_ISR_RXNE;
+        uarts[b].RDR = link->bytes[link->tail & (LINK_SIZE - 1)];
+        Net_UART_IRQHandler(&nets[b]);
+        link->tail++;
+    }
+}
+
+// Everything the board queued leaves through its UART interrupt
+static void link_send(uint8_t b)
+{
+    Link_t* link = &links[b ^ 1u];
+    uint32_t latency = 1u + (uint32_t)(rand() % 4);
+
+    while (uarts[b].CR1 & USART_CR1_TXEIE) {
+        uarts[b].ISR = USART_ISR_TXE;
+        uarts[b].TDR = 0x100;       // Not a byte: tells if the handler sent one
+        Net_UART_IRQHandler(&nets[b]);
+        if (uarts[b].TDR == 0x100) {
+            break;
+        }
+        if (!link_up || (uint16_t)(rand() % 1000) < drop_per_mille) {
+            continue;
+        }
+        link->arrival[link->head & (LINK_SIZE - 1)] = tick + latency;
+        link->bytes[link->head & (LINK_SIZE - 1)] = (uint8_t)uarts[b].TDR;
+        link->head++;
+    }
+}
+
+static Net_Input_t held[BOARDS];
+
+static void run(uint32_t ticks)
+{
+    for (uint32_t t = 0; t < ticks; t++, tick++) {
+        for (uint8_t b = 0; b < BOARDS; b++) {
+            current = b;
+            link_deliver(b);
+            if (!active[b]) {
+                continue;
+            }
+            // Inputs held for a few ticks, like a joystick
+            if (rand() % 4 == 0) {
+                held[b] = (Net_Input_t)(rand() % 16);
+            }
+            Net_Tick(&nets[b], held[b]);
+            link_send(b);
+        }
+    }
+}
+
+// ===== CHECKS =====
+
+static uint8_t failures;
+
+static void check(uint8_t ok, const char* scenario, const char* what)
+{
+    if (!ok) {
+        printf("FAIL %s: %s\n", scenario, what);
+        failures++;
+    }
+}
+
+// Both boards running together: frames advance, checksums agree
+static void check_running(const char* scenario)
+{
+    uint32_t frames[BOARDS];
+    uint32_t checks[BOARDS];
+
+    // Time to meet (a session that starts over goes back to frame 0)
+    run(150);
+    for (uint8_t b = 0; b < BOARDS; b++) {
+        frames[b] = nets[b].frame;
+        checks[b] = nets[b].stats.checks;
+    }
+    run(150);
+
+    for (uint8_t b = 0; b < BOARDS; b++) {
+        Net_cfg_t* net = &nets[b];
+
+        check(net->state == NET_RUNNING, scenario, "board not running");
+        check(Net_IsConnected(net), scenario, "link not connected");
+        check(net->frame > frames[b] + 100u, scenario, "frames not advancing");
+        check(net->stats.checks > checks[b], scenario, "no checksums compared");
+        check(net->stats.desyncs == 0, scenario, "desync");
+
+        current = b;
+        Net_MeasureResim(net, NET_MAX_ROLLBACK);
+        check(net->stats.desyncs == 0, scenario, "resimulation did not reproduce the state");
+    }
+    check(nets[0].local_player != nets[1].local_player, scenario, "both boards are the same player");
+
+    printf("%-9s board 0 frame %lu, board 1 frame %lu, rollbacks %lu/%lu, checks %lu/%lu\n", scenario,
+           (unsigned long)nets[0].frame, (unsigned long)nets[1].frame,
+           (unsigned long)nets[0].stats.rollbacks, (unsigned long)nets[1].stats.rollbacks,
+           (unsigned long)nets[0].stats.checks, (unsigned long)nets[1].stats.checks);
+}
+
+int main(int argc, char** argv)
+{
+    srand(argc > 1 ? (unsigned)atoi(argv[1]) : 1u);
+    drop_per_mille = (argc > 2) ? (uint16_t)atoi(argv[2]) : 2u;
+
+    boards_init();
+
+    board_start(0);
+    run(13);
+    harness_dwt.CYCCNT += 12345;    // a different session number
+    board_start(1);
+    check_running("join");
+
+    board_stop(1);
+    run(NET_TIMEOUT_TICKS / 2);
+    harness_dwt.CYCCNT += 777;
+    board_start(1);
+    check_running("rejoin");
+
+    link_up = 0;
+    run(NET_TIMEOUT_TICKS * 2);
+    link_up = 1;
+    check_running("cable cut");
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
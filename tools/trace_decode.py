@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+Decoder for FSM trace dumps (Trace/Trace.h).
+
+Reads a captured UART log, finds each dump the firmware printed and turns
+it into a table of named transitions:
+
+  TRACE BEGIN <entries> <recorded> <now ms>
+  T <time ms, 8 hex digits> <entity from to event, 2 hex digits each>
+  ...
+  TRACE END
+
+becomes
+
+  Dump 1: 5 of 5 transitions (0 lost), at 14.210 s
+       time ms     +ms    ago s  entity     from          to         event
+         12034       0   -2.176  PLAYER     IDLE       -> WALKING    MOVE
+         12354     320   -1.856  PLAYER     WALKING    -> DASHING    DASH
+         12374      20   -1.836  PLAYER     DASHING    -> DASHING    DASH_IGNORED
+
+"ago s" is the time before the dump, so the last entries line up with what
+was on screen when the game was paused.
+
+Entries recorded while the netcode replayed frames (a rollback, or the
+once-a-second resimulation measurement) have TRACE_REPLAYED set in the
+entity byte. They are shown with "replay" after the event, or left out with
+--live (the "+ms" column then runs between live entries only).
+
+Names come from the firmware sources, so they never go out of step:
+  entities  TraceEntity_t (TRACE_ENTITY_*)   in Core/Inc/main.h
+  scenes    the SCENE_* enum                 in Core/Src/main.c
+  states    state lines                      in Character/fsm/character.fsm
+  events    event lines                      in Character/fsm/character.fsm
+The scene manager entity uses the scene names and has no events; every other
+entity is a Character.
+
+Usage:
+  trace_decode.py [--src <repo root>] [--live] [log files...]   (stdin if none)
+"""
+
+import argparse
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import fsm_compiler  # noqa: E402
+
+# Entity whose states are scene ids; all other entities are Characters
+SCENE_ENTITY = "SCENE"
+
+# Entity byte flag of entries recorded while replaying (TRACE_REPLAYED)
+REPLAYED = 0x80
+
+ENUM_RE = re.compile(r"\benum\s*\w*\s*\{(.*?)\}\s*(\w*)\s*;", re.S)
+
+
+def strip_comments(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    return re.sub(r"//[^\n]*", "", text)
+
+
+def parse_enums(path):
+    """All enums in a C file as (typedef name or '', {value: name})."""
+    with open(path, encoding="utf-8") as f:
+        text = strip_comments(f.read())
+    enums = []
+    for body, type_name in ENUM_RE.findall(text):
+        values = {}
+        value = -1
+        for item in body.split(","):
+            item = item.strip()
+            if not item:
+                continue
+            name, _, init = item.partition("=")
+            name = name.strip()
+            value = int(init.strip(), 0) if init.strip() else value + 1
+            values[value] = name
+        enums.append((type_name, values))
+    return enums
+
+
+def find_enum(path, type_name=None, prefix=None):
+    """One enum by typedef name, or the first one whose members start with prefix."""
+    for name, values in parse_enums(path):
+        if type_name and name == type_name:
+            return values
+        if prefix and values and all(v.startswith(prefix) for v in values.values()):
+            return values
+    sys.exit("trace_decode: enum %s not found in %s" % (type_name or prefix + "*", path))
+
+
+def short(values, prefix):
+    """Drop the common prefix and the *_COUNT terminator."""
+    return {k: v[len(prefix):] if v.startswith(prefix) else v
+            for k, v in values.items() if not v.endswith("_COUNT")}
+
+
+def load_names(src):
+    entities = short(find_enum(os.path.join(src, "Core/Inc/main.h"), "TraceEntity_t"),
+                     "TRACE_ENTITY_")
+    scenes = short(find_enum(os.path.join(src, "Core/Src/main.c"), prefix="SCENE_"), "SCENE_")
+    try:
+        machine = fsm_compiler.load([os.path.join(src, "Character/fsm/character.fsm")])[0]
+    except (fsm_compiler.FsmError, OSError) as e:
+        sys.exit("trace_decode: %s" % e)
+    states = dict(enumerate(machine.state_names()))
+    events = dict(enumerate(machine.events))
+    return entities, scenes, states, events
+
+
+def name(table, value):
+    return table.get(value, "?%d" % value)
+
+
+def decode(lines, names, live_only=False):
+    entities, scenes, states, events = names
+    dumps = 0
+    entries = None
+
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE BEGIN"):
+            fields = line.split()
+            count, recorded, now = (int(x) for x in fields[2:5])
+            entries = []
+            dumps += 1
+            print("Dump %d: %d of %d transitions (%d lost), at %.3f s" %
+                  (dumps, count, recorded, recorded - count, now / 1000.0))
+            continue
+        if entries is None:
+            continue
+        if line == "TRACE END":
+            print("%12s %7s %8s  %-10s %-10s    %-10s %s" %
+                  ("time ms", "+ms", "ago s", "entity", "from", "to", "event"))
+            previous = None
+            replayed = 0
+            for time_ms, entity, source, target, event in entries:
+                replay = entity & REPLAYED
+                if replay and live_only:
+                    replayed += 1
+                    continue
+                ent = name(entities, entity & ~REPLAYED)
+                if ent == SCENE_ENTITY:
+                    table, ev = scenes, "-"
+                else:
+                    table, ev = states, name(events, event)
+                delta = time_ms - previous if previous is not None else 0
+                print("%12d %7d %8.3f  %-10s %-10s -> %-10s %s%s" %
+                      (time_ms, delta, (time_ms - now) / 1000.0, ent,
+                       name(table, source), name(table, target), ev,
+                       "  replay" if replay else ""))
+                previous = time_ms
+            if replayed:
+                print("(%d replayed entries left out)" % replayed)
+            print()
+            entries = None
+            continue
+
+        m = re.match(r"T ([0-9a-fA-F]{8}) ([0-9a-fA-F]{8})$", line)
+        if not m:
+            # Other log output interleaved with the dump (between yields)
+            continue
+        packed = bytes.fromhex(m.group(2))
+        entries.append((int(m.group(1), 16),) + tuple(packed))
+
+    if entries is not None:
+        print("trace_decode: dump %d has no TRACE END (log cut short?)" % dumps, file=sys.stderr)
+    if dumps == 0:
+        print("trace_decode: no TRACE BEGIN found", file=sys.stderr)
+        return 1
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode FSM trace dumps from a UART log")
+    parser.add_argument("--src", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."),
+                        help="firmware source root (for the enum names)")
+    parser.add_argument("--live", action="store_true",
+                        help="leave out entries recorded while replaying frames")
+    parser.add_argument("logs", nargs="*", help="captured UART logs (default: stdin)")
+    args = parser.parse_args()
+
+    names = load_names(args.src)
+    if not args.logs:
+        return decode(sys.stdin, names, args.live)
+    status = 0
+    for path in args.logs:
+        with open(path, encoding="utf-8", errors="replace") as f:
+            status |= decode(f, names, args.live)
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())